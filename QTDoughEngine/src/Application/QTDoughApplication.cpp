@@ -390,6 +390,21 @@ int QTDoughApplication::Run() {
 
 
     CameraMain = UnigmaCameraStruct();
+    if (headless.enabled)
+    {
+        std::string error;
+        if (!headless.cameraPathFile.empty() && !headlessCameraPath.Load(headless.cameraPathFile, &error))
+            throw std::runtime_error(error);
+        if (headless.frameCount == 0)
+            headless.frameCount = headlessCameraPath.Empty() ? 1
+                : (uint32_t)std::floor((headlessCameraPath.EndTime() - headlessCameraPath.StartTime()) * headless.fps) + 1;
+        // No one to drive the editor.
+        editorState.mode = EngineMode::Play;
+        SCREEN_WIDTH = (int)headless.width;
+        SCREEN_HEIGHT = (int)headless.height;
+        std::cout << "Headless: " << headless.frameCount << " frames at " << headless.width << "x" << headless.height
+            << " into " << headless.outputFolder << std::endl;
+    }
     //InitSDLWindow();
 	InitVulkan();
 
@@ -451,7 +466,15 @@ void QTDoughApplication::SetupEngineGUI()
 {
     // Always advance ImGui's frame so RenderDrawData has valid data regardless of mode.
     ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplSDL2_NewFrame();
+    if (headless.enabled)
+    {
+        // No SDL backend to fill these in.
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2((float)swapChainExtent.width, (float)swapChainExtent.height);
+        io.DeltaTime = 1.0f / headless.fps;
+    }
+    else
+        ImGui_ImplSDL2_NewFrame();
     ImGui::NewFrame();
 
     if (editorState.IsEditor())
@@ -516,9 +539,9 @@ void QTDoughApplication::SetupEngineGUI()
         {
             static bool zWasPressed = false;
             static bool yWasPressed = false;
-            bool ctrl = (GetKeyState(VK_CONTROL) & 0x8000) != 0;
-            bool zPressed = (GetKeyState('Z') & 0x8000) != 0;
-            bool yPressed = (GetKeyState('Y') & 0x8000) != 0;
+            bool ctrl = KeyDown(VK_CONTROL);
+            bool zPressed = KeyDown('Z');
+            bool yPressed = KeyDown('Y');
 
             if (ctrl && zPressed && !zWasPressed && !undoStack.empty())
             {
@@ -593,6 +616,16 @@ void QTDoughApplication::SetupEngineGUI()
             dl->AddRectFilled(pos, ImVec2(pos.x + size.x * usedFrac, pos.y + size.y),
                 usedColor, 3.0f);
             ImGui::Dummy(size); // advance layout cursor past the bar
+
+            UnigmaMemoryStats pooled = deviceMemory.Stats();
+            ImGui::Text("Pooled: %.0f / %.0f MB, %u allocs in %u blocks (%u dedicated)",
+                (double)pooled.allocatedBytes * toMB, (double)pooled.blockBytes * toMB,
+                pooled.allocations, pooled.blocks, pooled.dedicatedBlocks);
+
+            UnigmaReadbackStats readbackStats = readback.Stats();
+            ImGui::Text("Readback: %u pending (%.1f MB), %.1f MB in flight, %.1f MB last frame",
+                readbackStats.pending, (double)readbackStats.pendingBytes * toMB,
+                (double)readbackStats.inFlightBytes * toMB, (double)readbackStats.submittedBytes * toMB);
         }
         ImGui::Separator();
 
@@ -657,6 +690,7 @@ void QTDoughApplication::SetupEngineGUI()
                     b.density = iDensity;
                     b.materialId = iMaterialId;
                     b.isDirty = 1;
+                    VoxelizerPass::instance->brushPool.MarkDirty((uint32_t)editorState.selectedBrushIndex);
                 }
 
                 ImGui::Separator();
@@ -954,14 +988,14 @@ void QTDoughApplication::SetupEngineGUI()
         glm::mat4 proj = CameraMain.getProjectionMatrix();
 
         // Gizmo mode hotkeys: G=Translate, R=Rotate, S=Scale
-        if (GetKeyState('G') & 0x8000) editorState.gizmoOperation = ImGuizmo::TRANSLATE;
-        if (GetKeyState('R') & 0x8000) editorState.gizmoOperation = ImGuizmo::ROTATE;
-        if (GetKeyState('S') & 0x8000) editorState.gizmoOperation = ImGuizmo::SCALE;
+        if (KeyDown('G')) editorState.gizmoOperation = ImGuizmo::TRANSLATE;
+        if (KeyDown('R')) editorState.gizmoOperation = ImGuizmo::ROTATE;
+        if (KeyDown('S')) editorState.gizmoOperation = ImGuizmo::SCALE;
 
         // Order beat: F = collapse + brush assign selected brush.
         {
             static bool fWasPressed = false;
-            bool fIsPressed = (GetKeyState('F') & 0x8000) != 0;
+            bool fIsPressed = KeyDown('F');
             if (fIsPressed && !fWasPressed && editorState.selectedBrushIndex >= 0)
             {
                 MaterialSimulation::instance->pendingCollapseBrushIndex = editorState.selectedBrushIndex;
@@ -1336,9 +1370,10 @@ void QTDoughApplication::RunMainGameLoop()
 {
 
     // Global F9 — toggle recording (works in both editor and play mode).
+    if (!headless.enabled)
     {
         static bool f9WasPressed = false;
-        bool f9Pressed = (GetKeyState(VK_F9) & 0x8000) != 0;
+        bool f9Pressed = KeyDown(VK_F9);
         if (f9Pressed && !f9WasPressed)
         {
             if (recorder == nullptr) StartRecording("", 30);
@@ -1410,7 +1445,8 @@ void QTDoughApplication::RunMainGameLoop()
     }
 
     DrawFrame();
-    if (GatherBlenderInfo() == 0)
+    //The Blender bridge is Win32 shared memory, which capture nodes have no use for.
+    if (!headless.enabled && GatherBlenderInfo() == 0)
     {
         //CameraToBlender();
         //GetMeshDataAllObjects();
@@ -1453,7 +1489,7 @@ void QTDoughApplication::ComputePhysics()
     }
 
     // Laser beam: emit leptons along a line while left click + spacebar held.
-    if ((GetKeyState(VK_LBUTTON) & 0x8000) && (GetKeyState(VK_SPACE) & 0x8000))
+    if (KeyDown(VK_LBUTTON) && KeyDown(VK_SPACE))
     {
         int mx, my;
         SDL_GetMouseState(&mx, &my);
@@ -1513,7 +1549,15 @@ void QTDoughApplication::DrawFrame()
 
     //Aquire the rendered image.
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(_logicalDevice, _swapChain, UINT64_MAX, _imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result = VK_SUCCESS;
+    if (headless.enabled)
+    {
+        //One offscreen target per frame in flight, guarded by that frame's fence like a swapchain image.
+        imageIndex = currentFrame;
+        AdvanceHeadlessCamera();
+    }
+    else
+        result = vkAcquireNextImageKHR(_logicalDevice, _swapChain, UINT64_MAX, _imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
 
     //Resize screen if something had changed.
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -1545,6 +1589,9 @@ void QTDoughApplication::DrawFrame()
         throw std::runtime_error("failed to submit compute command buffer!");
     };
 
+    //Readbacks enqueued while recording copy after the compute work; earlier ones are handed over.
+    readback.Pump();
+
     //Waits for this fence to finish. 
     vkWaitForFences(_logicalDevice, 1, &_inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
@@ -1586,15 +1633,16 @@ void QTDoughApplication::DrawFrame()
 
     VkSemaphore waitSemaphores[] = { _imageAvailableSemaphores[currentFrame] };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = headless.enabled ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &_commandBuffers[currentFrame];
 
+    //Headless has no present to wait on it.
     VkSemaphore signalSemaphores[] = { _renderFinishedSemaphores[currentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = headless.enabled ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     /*
@@ -1607,6 +1655,13 @@ void QTDoughApplication::DrawFrame()
         throw std::runtime_error("failed to submit draw command buffer!");
     }
 
+    if (headless.enabled)
+    {
+        FinishHeadlessFrame(imageIndex);
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        return;
+    }
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -1914,7 +1969,8 @@ void QTDoughApplication::InitImGui()
 
     // this initializes the core structures of imgui
     ImGui::CreateContext();
-    ImGui_ImplSDL2_InitForVulkan(QTSDLWindow);
+    if (!headless.enabled)
+        ImGui_ImplSDL2_InitForVulkan(QTSDLWindow);
     std::cout << "Started pool info imgui" << std::endl;
     // this initializes imgui for Vulkan
     ImGui_ImplVulkan_InitInfo init_info = {};
@@ -2207,9 +2263,15 @@ void QTDoughApplication::InitVulkan()
     //Create the intial instances, windows, get the GPU and create the swap chain.
 	CreateInstance();
     SetupDebugMessenger();
-    CreateWindowSurface();
+    if (!headless.enabled)
+        CreateWindowSurface();
     PickPhysicalDevice();
     CreateLogicalDevice();
+    deviceMemory.Init(_physicalDevice, _logicalDevice);
+    readbackQueue.Init(_logicalDevice, _vkComputeQueue, FindQueueFamilies(_physicalDevice).graphicsAndComputeFamily.value(), deviceMemory, readback);
+    pipelineCache.Init(_physicalDevice, _logicalDevice, "qtdough_pipeline_cache.bin");
+    pipelineJobs.Start();
+    auto pipelineStart = std::chrono::high_resolution_clock::now();
     CreateSwapChain();
 
     //Create command pool early so GPU benchmark can use it.
@@ -2287,6 +2349,19 @@ void QTDoughApplication::InitVulkan()
     //Sync the buffers.
     CreateSyncObjects();
 
+    //Everything else kept loading while the pipelines built; the first frame needs them all.
+    auto pipelineWaitStart = std::chrono::high_resolution_clock::now();
+    pipelineJobs.Wait();
+    auto pipelineEnd = std::chrono::high_resolution_clock::now();
+    std::cout << "Pipelines: " << pipelineJobs.Completed() << " built on " << pipelineJobs.Threads() << " threads in "
+        << std::chrono::duration<double, std::milli>(pipelineEnd - pipelineStart).count() << " ms ("
+        << pipelineJobs.BusyMilliseconds() << " ms of work, "
+        << std::chrono::duration<double, std::milli>(pipelineEnd - pipelineWaitStart).count() << " ms waited)." << std::endl;
+    //Later pipelines build inline.
+    pipelineJobs.Stop();
+    //Saved now too, so runs that never shut down cleanly still warm the next one.
+    pipelineCache.Save();
+
 }
 
 void QTDoughApplication::RunGPUBenchmark()
@@ -2361,7 +2436,7 @@ void QTDoughApplication::RunGPUBenchmark()
     aluPipelineCI.layout = aluPipelineLayout;
 
     VkPipeline aluPipeline;
-    VK_CHECK(vkCreateComputePipelines(_logicalDevice, VK_NULL_HANDLE, 1, &aluPipelineCI, nullptr, &aluPipeline));
+    VK_CHECK(vkCreateComputePipelines(_logicalDevice, pipelineCache.Handle(), 1, &aluPipelineCI, nullptr, &aluPipeline));
 
     // --- Bandwidth test resources ---
     const uint32_t bwElementCount = 2 * 1024 * 1024; // 2M float4 = 32 MB each
@@ -2416,7 +2491,7 @@ void QTDoughApplication::RunGPUBenchmark()
     bwPipelineCI.layout = bwPipelineLayout;
 
     VkPipeline bwPipeline;
-    VK_CHECK(vkCreateComputePipelines(_logicalDevice, VK_NULL_HANDLE, 1, &bwPipelineCI, nullptr, &bwPipeline));
+    VK_CHECK(vkCreateComputePipelines(_logicalDevice, pipelineCache.Handle(), 1, &bwPipelineCI, nullptr, &bwPipeline));
 
     // --- Descriptor pool and sets ---
     VkDescriptorPoolSize poolSize{};
@@ -2764,7 +2839,7 @@ void QTDoughApplication::CreateCompute()
     pipelineInfo.layout = _computePipelineLayout;
     pipelineInfo.stage = computeShaderStageInfo;
 
-    if (vkCreateComputePipelines(_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_computePipeline) != VK_SUCCESS) {
+    if (vkCreateComputePipelines(_logicalDevice, pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &_computePipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create compute pipeline!");
     }
 
@@ -3170,48 +3245,14 @@ void QTDoughApplication::EndSingleTimeCommandsAsync(uint32_t currentFrame, VkCom
 }
 
 void QTDoughApplication::ReadbackBufferData(VkBuffer srcBuffer, VkDeviceSize size, void* pDstData, VkDeviceSize srcOffset) {
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    CreateBuffer(
-        size,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer,
-        stagingBufferMemory
-    );
-
-    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
-    VkBufferMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-    barrier.buffer = srcBuffer;
-    barrier.offset = srcOffset;
-    barrier.size = size;
-
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0, 0, nullptr, 1, &barrier, 0, nullptr
-    );
-
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = srcOffset;
-    copyRegion.dstOffset = 0;
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, stagingBuffer, 1, &copyRegion);
-
-    EndSingleTimeCommands(commandBuffer);
-
-    void* mappedData;
-    vkMapMemory(_logicalDevice, stagingBufferMemory, 0, size, 0, &mappedData);
-    memcpy(pDstData, mappedData, static_cast<size_t>(size));
-    vkUnmapMemory(_logicalDevice, stagingBufferMemory);
-
-    vkDestroyBuffer(_logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(_logicalDevice, stagingBufferMemory, nullptr);
+    //Synchronous, waits for this request only. Prefer readback.Enqueue and a callback.
+    UnigmaReadbackRequest request;
+    request.source = (uint64_t)srcBuffer;
+    request.offset = srcOffset;
+    request.size = size;
+    request.destination = pDstData;
+    request.priority = UnigmaReadbackPriority::High;
+    readback.Wait(readback.Enqueue(request));
 }
 
 
@@ -3725,19 +3766,17 @@ void QTDoughApplication::LoadTexture(const std::string& filename) {
     VkDeviceSize imageSize = texWidth * texHeight * 4;
 
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    CreateBuffer(
+    UnigmaAllocationId stagingAllocation;
+    deviceMemory.CreateBuffer(
         imageSize,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
         stagingBuffer,
-        stagingBufferMemory
+        stagingAllocation,
+        deviceMemory.StagingPool()
     );
 
-    void* data;
-    vkMapMemory(_logicalDevice, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(_logicalDevice, stagingBufferMemory);
+    memcpy(deviceMemory.Mapped(stagingAllocation), pixels, static_cast<size_t>(imageSize));
 
     stbi_image_free(pixels);
 
@@ -3770,8 +3809,7 @@ void QTDoughApplication::LoadTexture(const std::string& filename) {
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     );
 
-    vkDestroyBuffer(_logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(_logicalDevice, stagingBufferMemory, nullptr);
+    deviceMemory.DestroyBuffer(stagingBuffer, stagingAllocation);
 
     texture.u_imageView = CreateImageView(texture.u_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
 
@@ -3969,22 +4007,22 @@ void QTDoughApplication::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint
             swapChainExtent.height);
     }
 
-    // Final swap transition for present.
+    // Final swap transition for present. Headless targets are read back instead, so they end as a copy source.
     {
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        barrier.newLayout = headless.enabled ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.image = swapChainImages[imageIndex];
         barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
         barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        barrier.dstAccessMask = 0;
+        barrier.dstAccessMask = headless.enabled ? VK_ACCESS_TRANSFER_READ_BIT : 0;
 
         vkCmdPipelineBarrier(commandBuffer,
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            headless.enabled ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
             0, 0, nullptr, 0, nullptr, 1, &barrier);
     }
 
@@ -4228,6 +4266,31 @@ VkShaderModule QTDoughApplication::CreateShaderModule(const std::vector<char>& c
     return shaderModule;
 }
 
+void QTDoughApplication::CreateComputePipelineAsync(const std::string& spvName, VkPipelineLayout layout, VkPipeline& outPipeline)
+{
+    pipelineJobs.Enqueue(spvName, [this, spvName, layout, &outPipeline]() {
+        auto shaderCode = readFile("src/shaders/" + spvName + ".spv");
+        VkShaderModule shaderModule = CreateShaderModule(shaderCode);
+
+        VkPipelineShaderStageCreateInfo stageInfo{};
+        stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        stageInfo.module = shaderModule;
+        stageInfo.pName = "main";
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.layout = layout;
+        pipelineInfo.stage = stageInfo;
+
+        VkResult result = vkCreateComputePipelines(_logicalDevice, pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &outPipeline);
+        vkDestroyShaderModule(_logicalDevice, shaderModule, nullptr);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute pipeline!");
+        }
+    });
+}
+
 void QTDoughApplication::CreateTextureImageView() {
     textureImageView = CreateImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
 }
@@ -4336,6 +4399,11 @@ void QTDoughApplication::CreateMaterials() {
 
 void QTDoughApplication::CreateSwapChain() {
 
+    if (headless.enabled) {
+        CreateHeadlessTargets();
+        return;
+    }
+
     std::cout << "Creating swap chain" << std::endl;
     SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(_physicalDevice);
 
@@ -4395,6 +4463,23 @@ void QTDoughApplication::CreateSwapChain() {
     swapChainExtent = extent;
 }
 
+void QTDoughApplication::CreateHeadlessTargets()
+{
+    // Stand-ins for the swapchain images: the blit and the recorder use them the same way, captures copy out of them.
+    // Same format the window surface prefers, so captures match what the window shows.
+    _swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    swapChainExtent = { headless.width, headless.height };
+
+    swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+    headlessImageMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        CreateImage(headless.width, headless.height, _swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], headlessImageMemory[i]);
+    }
+    std::cout << "Created " << MAX_FRAMES_IN_FLIGHT << " headless targets" << std::endl;
+}
+
 static bool DumpVkImageToPng(QTDoughApplication* app,
                              VkImage src, VkFormat fmt,
                              uint32_t w, uint32_t h,
@@ -4419,11 +4504,11 @@ static bool DumpVkImageToPng(QTDoughApplication* app,
 
     VkDeviceSize bufSize = (VkDeviceSize)w * h * bpp;
     VkBuffer staging;
-    VkDeviceMemory stagingMem;
-    app->CreateBuffer(bufSize,
+    UnigmaAllocationId stagingAllocation;
+    app->deviceMemory.CreateBuffer(bufSize,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging, stagingMem);
+        staging, stagingAllocation, app->deviceMemory.StagingPool());
 
     VkCommandBuffer cmd = app->BeginSingleTimeCommands();
 
@@ -4464,8 +4549,7 @@ static bool DumpVkImageToPng(QTDoughApplication* app,
 
     app->EndSingleTimeCommands(cmd);
 
-    void* mapped = nullptr;
-    vkMapMemory(app->_logicalDevice, stagingMem, 0, bufSize, 0, &mapped);
+    void* mapped = app->deviceMemory.Mapped(stagingAllocation);
 
     std::vector<uint8_t> pixels((size_t)w * h * 4);
     if (isFloat)
@@ -4501,9 +4585,7 @@ static bool DumpVkImageToPng(QTDoughApplication* app,
         }
     }
 
-    vkUnmapMemory(app->_logicalDevice, stagingMem);
-    vkDestroyBuffer(app->_logicalDevice, staging, nullptr);
-    vkFreeMemory(app->_logicalDevice, stagingMem, nullptr);
+    app->deviceMemory.DestroyBuffer(staging, stagingAllocation);
 
     int ok = stbi_write_png(outPath.c_str(), (int)w, (int)h, 4, pixels.data(), (int)(w * 4));
     return ok != 0;
@@ -4559,13 +4641,16 @@ void QTDoughApplication::StopRecording() {
     std::cout << "[Recorder] Recording stopped." << std::endl;
 }
 
-void QTDoughApplication::ExportPassOutputs()
+void QTDoughApplication::ExportPassOutputs(const std::string& outputFolder)
 {
-    char ts[32];
-    std::time_t t = std::time(nullptr);
-    std::strftime(ts, sizeof(ts), "%Y%m%d_%H%M%S", std::localtime(&t));
-
-    std::string folder = std::string("C:/ProjectsSpeed/QTDEngine/Media/Captures/passes_") + ts;
+    std::string folder = outputFolder;
+    if (folder.empty())
+    {
+        char ts[32];
+        std::time_t t = std::time(nullptr);
+        std::strftime(ts, sizeof(ts), "%Y%m%d_%H%M%S", std::localtime(&t));
+        folder = std::string("C:/ProjectsSpeed/QTDEngine/Media/Captures/passes_") + ts;
+    }
     std::filesystem::create_directories(folder);
 
     vkDeviceWaitIdle(_logicalDevice);
@@ -4624,6 +4709,94 @@ void QTDoughApplication::ExportPassOutputs()
         + " (" + std::to_string(skipped) + " skipped)");
 }
 
+void QTDoughApplication::AdvanceHeadlessCamera()
+{
+    if (headlessCameraPath.Empty())
+        return;
+
+    SDFCameraKey key = headlessCameraPath.Sample(headlessCameraPath.StartTime() + headlessFrame / headless.fps);
+    CameraMain.setPosition(key.eye);
+    CameraMain.setForward(key.target - key.eye);
+    CameraMain.fov = key.fov;
+    CameraMain.aspectRatio = (float)headless.width / (float)headless.height;
+}
+
+void QTDoughApplication::FinishHeadlessFrame(uint32_t imageIndex)
+{
+    // Frames past the last one (the final loop in Run) still render but are not captured again.
+    uint32_t frame = headlessFrame++;
+    bool last = headlessFrame == headless.frameCount;
+    if (last || (headless.captureEvery > 0 && frame % headless.captureEvery == 0))
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%05u", frame);
+        std::string folder = headless.outputFolder + "/" + name;
+
+        // Waits for the device, so the target just submitted is finished.
+        ExportPassOutputs(folder);
+        if (!DumpVkImageToPng(this, swapChainImages[imageIndex], _swapChainImageFormat, swapChainExtent.width, swapChainExtent.height,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, folder + "/final.png"))
+            ConsoleLog("Failed to dump the final image of frame " + std::to_string(frame));
+    }
+
+    if (last)
+    {
+        std::cout << "Headless run finished after " << headlessFrame << " frames" << std::endl;
+        PROGRAMEND = true;
+    }
+}
+
+bool QTDoughApplication::KeyDown(int virtualKey) const
+{
+#ifdef _WIN32
+    return !headless.enabled && (GetKeyState(virtualKey) & 0x8000) != 0;
+#else
+    return false;
+#endif
+}
+
+bool HeadlessSettings::ParseArguments(int argc, char* argv[], std::string& error)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+        {
+            enabled = true;
+            continue;
+        }
+        if (arg != "--frames" && arg != "--size" && arg != "--fps" && arg != "--capture-every" && arg != "--out" && arg != "--camera-path")
+            continue;
+        if (i + 1 >= argc)
+        {
+            error = arg + " needs a value";
+            return false;
+        }
+
+        std::string value = argv[++i];
+        bool valid = true;
+        if (arg == "--frames")
+            valid = std::sscanf(value.c_str(), "%u", &frameCount) == 1;
+        else if (arg == "--size")
+            valid = std::sscanf(value.c_str(), "%ux%u", &width, &height) == 2 && width > 0 && height > 0;
+        else if (arg == "--fps")
+            valid = std::sscanf(value.c_str(), "%f", &fps) == 1 && fps > 0.0f;
+        else if (arg == "--capture-every")
+            valid = std::sscanf(value.c_str(), "%u", &captureEvery) == 1;
+        else if (arg == "--out")
+            outputFolder = value;
+        else
+            cameraPathFile = value;
+
+        if (!valid)
+        {
+            error = "bad value for " + arg + ": " + value;
+            return false;
+        }
+    }
+    return true;
+}
+
 void QTDoughApplication::CreateInstance()
 {
 
@@ -4635,9 +4808,12 @@ void QTDoughApplication::CreateInstance()
     VkApplicationInfo appInfo{};
     VkInstanceCreateInfo createInfo{};
     
-    SDL_Vulkan_GetInstanceExtensions(QTSDLWindow, &extensionCount, NULL); //Get the count.
-    const char** extensions = (const char**)malloc(sizeof(char*) * extensionCount); //Well justified ;p
-    SDL_Vulkan_GetInstanceExtensions(QTSDLWindow, &extensionCount, extensions); //Get the extensions.
+    const char** extensions = nullptr;
+    if (!headless.enabled) {
+        SDL_Vulkan_GetInstanceExtensions(QTSDLWindow, &extensionCount, NULL); //Get the count.
+        extensions = (const char**)malloc(sizeof(char*) * extensionCount); //Well justified ;p
+        SDL_Vulkan_GetInstanceExtensions(QTSDLWindow, &extensionCount, extensions); //Get the extensions.
+    }
 
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     appInfo.pApplicationName = "QTDough";
@@ -4778,8 +4954,9 @@ bool QTDoughApplication::IsDeviceSuitable(VkPhysicalDevice device) {
 
     bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    //Headless renders offscreen and never queries a surface.
+    bool swapChainAdequate = headless.enabled;
+    if (extensionsSupported && !headless.enabled) {
         SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -4830,17 +5007,20 @@ bool QTDoughApplication::IsDeviceSuitable(VkPhysicalDevice device) {
         && swapChainAdequate
         && rayTracingFeatures.rayTracingPipeline
         && accelFeatures.accelerationStructure
-        && (TotalGPURam >= 7000); //At least 7GB VRAM, really 8GB.
+        && (TotalGPURam >= 7000 || headless.enabled); //At least 7GB VRAM, really 8GB. Software devices report host memory.
 }
 
 std::vector<const char*> QTDoughApplication::GetRequiredExtensions() {
-    uint32_t extensionCount = 0;
+    std::vector<const char*> extensions;
 
-    SDL_Vulkan_GetInstanceExtensions(QTSDLWindow, &extensionCount, NULL);
-    const char** sdlExtensions = (const char**)malloc(sizeof(char*) * extensionCount);
-    SDL_Vulkan_GetInstanceExtensions(QTSDLWindow, &extensionCount, sdlExtensions);
-
-    std::vector<const char*> extensions(sdlExtensions, sdlExtensions + extensionCount);
+    //No surface headless, so none of the window system extensions.
+    if (!headless.enabled) {
+        uint32_t extensionCount = 0;
+        SDL_Vulkan_GetInstanceExtensions(QTSDLWindow, &extensionCount, NULL);
+        const char** sdlExtensions = (const char**)malloc(sizeof(char*) * extensionCount);
+        SDL_Vulkan_GetInstanceExtensions(QTSDLWindow, &extensionCount, sdlExtensions);
+        extensions.assign(sdlExtensions, sdlExtensions + extensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -4872,8 +5052,12 @@ QueueFamilyIndices QTDoughApplication::FindQueueFamilies(VkPhysicalDevice device
             indices.physicsFamily = i;
 		}
 
+        //Headless never presents; the graphics family stands in so the rest of the setup is unchanged.
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _vkSurface, &presentSupport);
+        if (headless.enabled)
+            presentSupport = indices.graphicsAndComputeFamily == (uint32_t)i;
+        else
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _vkSurface, &presentSupport);
 
         if (presentSupport) {
             indices.presentFamily = i;
@@ -4897,10 +5081,21 @@ void QTDoughApplication::CreateLogicalDevice()
 
     std::map<uint32_t, uint32_t> familyQueueCountMap;
 
+    uint32_t qCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &qCount, nullptr);
+    std::vector<VkQueueFamilyProperties> qProps(qCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &qCount, qProps.data());
+
     familyQueueCountMap[indices.graphicsAndComputeFamily.value()] = std::max(familyQueueCountMap[indices.graphicsAndComputeFamily.value()], (uint32_t)3);
     familyQueueCountMap[indices.presentFamily.value()] = std::max(familyQueueCountMap[indices.presentFamily.value()], (uint32_t)1);
     familyQueueCountMap[indices.physicsFamily.value()] = std::max(familyQueueCountMap[indices.physicsFamily.value()], (uint32_t)1);
 
+    //Software devices such as lavapipe expose a single queue; headless shares it between graphics, compute and physics.
+    if (headless.enabled) {
+        for (auto& [family, count] : familyQueueCountMap)
+            count = std::min(count, qProps[family].queueCount);
+    }
+
 
 
     //Want compute, graphics, and physics queues.
@@ -4946,8 +5141,9 @@ void QTDoughApplication::CreateLogicalDevice()
 
     _createInfo.pEnabledFeatures = nullptr;
 
-    _createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    _createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    std::vector<const char*> enabledExtensions = RequiredDeviceExtensions();
+    _createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    _createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     if (enableValidationLayers) {
         _createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -4973,6 +5169,10 @@ void QTDoughApplication::CreateLogicalDevice()
     bufferDeviceAddress.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
     bufferDeviceAddress.bufferDeviceAddress = VK_TRUE;
 
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphore{};
+    timelineSemaphore.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineSemaphore.timelineSemaphore = VK_TRUE;
+
     VkPhysicalDeviceAccelerationStructureFeaturesKHR accelerationStructure{};
     accelerationStructure.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
     accelerationStructure.accelerationStructure = VK_TRUE;
@@ -4984,7 +5184,8 @@ void QTDoughApplication::CreateLogicalDevice()
     // Chain them
     descriptorIndexingFeatures.pNext = &scalarBlockLayoutFeatures;
     scalarBlockLayoutFeatures.pNext = &bufferDeviceAddress;
-    bufferDeviceAddress.pNext = &accelerationStructure;
+    bufferDeviceAddress.pNext = &timelineSemaphore;
+    timelineSemaphore.pNext = &accelerationStructure;
     accelerationStructure.pNext = &raytracingPipeline;
     raytracingPipeline.pNext = nullptr;
 
@@ -5004,13 +5205,8 @@ void QTDoughApplication::CreateLogicalDevice()
     _createInfo.pNext = &deviceFeatures2;
     _createInfo.pEnabledFeatures = nullptr;
 
-    uint32_t qCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &qCount, nullptr);
-    std::vector<VkQueueFamilyProperties> qProps(qCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &qCount, qProps.data());
-
     uint32_t fam = indices.graphicsAndComputeFamily.value();
-    if (qProps[fam].queueCount < 3) {
+    if (qProps[fam].queueCount < 3 && !headless.enabled) {
         throw std::runtime_error("Selected queue family does not support 3 queues.");
     }
 
@@ -5019,9 +5215,10 @@ void QTDoughApplication::CreateLogicalDevice()
         throw std::runtime_error("failed to create logical device!");
     }
 
-    vkGetDeviceQueue(_logicalDevice, indices.graphicsAndComputeFamily.value(), 0, &_vkGraphicsQueue);
-    vkGetDeviceQueue(_logicalDevice, indices.graphicsAndComputeFamily.value(), 1, &_vkComputeQueue);
-    vkGetDeviceQueue(_logicalDevice, indices.graphicsAndComputeFamily.value(), 2, &_vkPhysicsQueue);
+    uint32_t lastQueue = familyQueueCountMap[fam] - 1;
+    vkGetDeviceQueue(_logicalDevice, fam, 0, &_vkGraphicsQueue);
+    vkGetDeviceQueue(_logicalDevice, fam, std::min(1u, lastQueue), &_vkComputeQueue);
+    vkGetDeviceQueue(_logicalDevice, fam, std::min(2u, lastQueue), &_vkPhysicsQueue);
 
     vkGetDeviceQueue(_logicalDevice, indices.presentFamily.value(), 0, &_presentQueue);
 }
@@ -5036,16 +5233,32 @@ void QTDoughApplication::CleanupSwapChain()
         vkDestroyImageView(_logicalDevice, swapChainImageViews[i], nullptr);
     }
 
+    if (headless.enabled) {
+        for (size_t i = 0; i < swapChainImages.size(); i++) {
+            vkDestroyImage(_logicalDevice, swapChainImages[i], nullptr);
+            vkFreeMemory(_logicalDevice, headlessImageMemory[i], nullptr);
+        }
+        swapChainImages.clear();
+        headlessImageMemory.clear();
+        return;
+    }
+
     vkDestroySwapchainKHR(_logicalDevice, _swapChain, nullptr);
 }
 
 void QTDoughApplication::RecreateSwapChain()
 {
     int width = 0, height = 0;
-    SDL_GetWindowSize(QTSDLWindow, &width, &height);
-    while (width == 0 || height == 0) {
+    if (headless.enabled) {
+        width = (int)headless.width;
+        height = (int)headless.height;
+    }
+    else {
         SDL_GetWindowSize(QTSDLWindow, &width, &height);
-        SDL_WaitEvent(NULL);
+        while (width == 0 || height == 0) {
+            SDL_GetWindowSize(QTSDLWindow, &width, &height);
+            SDL_WaitEvent(NULL);
+        }
     }
 
     vkDeviceWaitIdle(_logicalDevice);
@@ -5188,7 +5401,8 @@ bool QTDoughApplication::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::vector<const char*> required = RequiredDeviceExtensions();
+    std::set<std::string> requiredExtensions(required.begin(), required.end());
 
     for (const auto& extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
@@ -5197,6 +5411,17 @@ bool QTDoughApplication::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+std::vector<const char*> QTDoughApplication::RequiredDeviceExtensions() const {
+    std::vector<const char*> extensions;
+    for (const char* name : deviceExtensions) {
+        //Nothing to present to headless.
+        if (headless.enabled && strcmp(name, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
+            continue;
+        extensions.push_back(name);
+    }
+    return extensions;
+}
+
 SwapChainSupportDetails QTDoughApplication::QuerySwapChainSupport(VkPhysicalDevice device) {
     std::cout << "Swap chain being queried" << std::endl;
     SwapChainSupportDetails details;
@@ -5403,9 +5628,16 @@ void QTDoughApplication::Cleanup()
     vkDestroyPipelineLayout(_logicalDevice, _pipelineLayout, nullptr);
     vkDestroyRenderPass(_logicalDevice, renderPass, nullptr);
     vkDestroyInstance(_vkInstance, nullptr);
-    vkDestroySwapchainKHR(_logicalDevice, _swapChain, nullptr);
+    if (!headless.enabled)
+        vkDestroySwapchainKHR(_logicalDevice, _swapChain, nullptr);
+    readback.Release();
+    readbackQueue.Destroy();
+    pipelineCache.Destroy();
+    deviceMemory.Destroy();
     vkDestroyDevice(_logicalDevice, nullptr);
-    vkDestroySurfaceKHR(_vkInstance, _vkSurface, nullptr);
-    SDL_DestroyWindow(QTSDLWindow);
-    SDL_Quit();
+    if (!headless.enabled) {
+        vkDestroySurfaceKHR(_vkInstance, _vkSurface, nullptr);
+        SDL_DestroyWindow(QTSDLWindow);
+        SDL_Quit();
+    }
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -30,6 +32,10 @@
 #include "../Engine/Renderer/UnigmaTexture.h"
 #include "../Engine/Renderer/UnigmaRenderingStruct.h"
 #include "../Engine/Core/UnigmaGameObject.h"
+#include "../Engine/SDF/SDFCameraPath.h"
+#include "../Engine/Renderer/UnigmaDeviceMemoryVulkan.h"
+#include "../Engine/Renderer/UnigmaReadbackVulkan.h"
+#include "../Engine/Renderer/UnigmaPipelineCacheVulkan.h"
 
 #include <array>
 #include <chrono>
@@ -192,6 +198,31 @@ struct EditorState {
     VkDescriptorSet viewportDescriptorSet = VK_NULL_HANDLE; // For ImGui_ImplVulkan_AddTexture
 };
 
+#ifndef _WIN32
+//The Win32 virtual keys the editor shortcuts ask KeyDown for, so the shortcuts compile off Windows.
+#define VK_LBUTTON 0x01
+#define VK_CONTROL 0x11
+#define VK_SPACE 0x20
+#define VK_F9 0x78
+#endif
+
+//Windowless run for capture nodes: no SDL window, surface or swapchain. Frames render into offscreen images that
+//stand in for the swapchain, the camera can follow a scripted path, and pass outputs are written to outputFolder.
+struct HeadlessSettings {
+    bool enabled = false;
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t frameCount = 0; // Frames to render before exiting. 0 with a camera path runs the whole path, else 1.
+    float fps = 30.0f; // Path time step per frame.
+    uint32_t captureEvery = 0; // Export pass outputs every N frames. 0 exports only the last frame.
+    std::string outputFolder = "Captures/headless";
+    std::string cameraPathFile; // SDFCameraPath keyframes. Empty keeps the scene camera.
+
+    // Reads --headless, --frames N, --size WxH, --fps F, --capture-every N, --out DIR and --camera-path FILE.
+    // Other arguments are left alone. Returns false with a message on a malformed value.
+    bool ParseArguments(int argc, char* argv[], std::string& error);
+};
+
 //QTDough Class.
 class QTDoughApplication {
 public:
@@ -273,9 +304,20 @@ public:
     bool framebufferResized = false;
     VkFormat FindDepthFormat();
     void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    // Sub-allocated from pooled blocks; free with deviceMemory.DestroyBuffer, never vkFreeMemory.
+    UnigmaDeviceMemoryVulkan deviceMemory;
+    // Device to host copies delivered on a later frame; pumped once per frame after the compute submit.
+    UnigmaReadbackService readback;
+    UnigmaReadbackVulkan readbackQueue;
     void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
     void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
     VkShaderModule CreateShaderModule(const std::vector<char>& code);
+    // Pass to every vkCreate*Pipelines; kept on disk between runs.
+    UnigmaPipelineCacheVulkan pipelineCache;
+    // Startup pipelines build here in parallel; waited on at the end of InitVulkan.
+    UnigmaPipelineJobs pipelineJobs;
+    // Reads src/shaders/<spvName>.spv on a pipeline worker and writes outPipeline there. The layout must already exist.
+    void CreateComputePipelineAsync(const std::string& spvName, VkPipelineLayout layout, VkPipeline& outPipeline);
     VkVertexInputBindingDescription getBindingDescription();
     std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
     const int MAX_FRAMES_IN_FLIGHT = 2;
@@ -326,7 +368,21 @@ public:
     void StopRecording();
     void SetupEngineGUI();
 
-    void ExportPassOutputs();
+    // Writes every pass output as a PNG into folder, or a timestamped capture folder when folder is empty.
+    void ExportPassOutputs(const std::string& folder = "");
+
+    //Headless.
+    HeadlessSettings headless;
+    uint32_t headlessFrame = 0;
+    SDFCameraPath headlessCameraPath;
+    std::vector<VkDeviceMemory> headlessImageMemory; // Backs swapChainImages when headless.
+    void CreateHeadlessTargets();
+    void AdvanceHeadlessCamera();
+    void FinishHeadlessFrame(uint32_t imageIndex);
+    //Whether a Win32 virtual key is held. Always false headless, so captures never depend on the node's desktop, and
+    //off Windows, where only headless runs.
+    bool KeyDown(int virtualKey) const;
+    std::vector<const char*> RequiredDeviceExtensions() const;
 
     void CreateImages3D(uint32_t width, uint32_t height, uint32_t depth, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
     VkImageView Create3DImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
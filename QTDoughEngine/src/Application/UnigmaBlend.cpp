@@ -51,6 +51,10 @@ void PrintRenderObjectRaw(const RenderObject& obj) {
 
 int GatherBlenderInfo()
 {
+#ifndef _WIN32
+    //The bridge is Win32 named events and file mapping; elsewhere there is never a file.
+    return 1;
+#else
     // Attempt to open the events
     HANDLE hDataReadyEvent = OpenEventA(
         SYNCHRONIZE,             // Desired access
@@ -131,4 +135,5 @@ int GatherBlenderInfo()
 
 
     return 0;
+#endif
 }
\ No newline at end of file
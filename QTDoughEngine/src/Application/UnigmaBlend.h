@@ -1,6 +1,8 @@
 #pragma once
 // reader.cpp
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <iostream>
 #include <unordered_map>
 #include <iomanip> // For std::setprecision
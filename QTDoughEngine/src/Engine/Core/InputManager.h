@@ -1,6 +1,6 @@
 #pragma once
 #include <cstdint>
-#include <SDL2\SDL.h>
+#include <SDL2/SDL.h>
 #include <glm/glm.hpp>
 
 struct UnigmaInputStruct
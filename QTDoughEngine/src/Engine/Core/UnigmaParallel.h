@@ -0,0 +1,64 @@
+#pragma once
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+
+//Small fork-join helpers for CPU side work (mesh processing, SDF baking, tracing...).
+//Work is handed out in chunks of `grain` items through an atomic cursor so uneven items balance out.
+//The calling thread participates, so a single core machine never spawns anything.
+
+inline uint32_t UnigmaWorkerCount()
+{
+    uint32_t hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1u : hw;
+}
+
+//Calls func(begin, end) over [0, count) in chunks of grain.
+inline void UnigmaParallelForRange(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& func, uint32_t maxThreads = 0)
+{
+    if (count == 0)
+        return;
+
+    grain = std::max(grain, 1u);
+    uint32_t chunks = (count + grain - 1) / grain;
+    uint32_t threadCount = std::min(maxThreads == 0 ? UnigmaWorkerCount() : maxThreads, chunks);
+
+    if (threadCount <= 1)
+    {
+        func(0, count);
+        return;
+    }
+
+    std::atomic<uint32_t> cursor{ 0 };
+    auto worker = [&]() {
+        while (true)
+        {
+            uint32_t chunk = cursor.fetch_add(1);
+            if (chunk >= chunks)
+                break;
+            uint32_t begin = chunk * grain;
+            uint32_t end = std::min(begin + grain, count);
+            func(begin, end);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (uint32_t t = 1; t < threadCount; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+}
+
+//Calls func(i) for every i in [0, count).
+inline void UnigmaParallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t)>& func, uint32_t maxThreads = 0)
+{
+    UnigmaParallelForRange(count, grain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+            func(i);
+    }, maxThreads);
+}
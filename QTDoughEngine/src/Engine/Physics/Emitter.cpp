@@ -230,7 +230,7 @@ void EmitterSystem::InitComputeWorkload()
 	pipelineInfo.layout = emitterPipelineLayout;
 	pipelineInfo.stage = stageInfo;
 
-	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &emitterPipeline) != VK_SUCCESS)
+	if (vkCreateComputePipelines(device, app->pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &emitterPipeline) != VK_SUCCESS)
 		throw std::runtime_error("EmitterSystem: failed to create compute pipeline!");
 
 	vkDestroyShaderModule(device, shaderModule, nullptr);
@@ -310,6 +310,30 @@ void MaterialSimulation::CreateComputeDescriptorSets()
 	}
 }
 
+void MaterialSimulation::RebindBrushBuffer(VkBuffer brushBuffer)
+{
+	VkDevice device = QTDoughApplication::instance->_logicalDevice;
+	brushesBuffer = brushBuffer;
+
+	for (VkDescriptorSet set : descriptorSets)
+	{
+		VkDescriptorBufferInfo brushesInfo{};
+		brushesInfo.buffer = brushesBuffer;
+		brushesInfo.offset = 0;
+		brushesInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = 7;
+		write.dstArrayElement = 0;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.descriptorCount = 1;
+		write.pBufferInfo = &brushesInfo;
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	}
+}
+
 void MaterialSimulation::CreateComputePipeline()
 {
 	QTDoughApplication* app = QTDoughApplication::instance;
@@ -350,7 +374,7 @@ void MaterialSimulation::CreateComputePipeline()
 	pipelineInfo.layout = pipelineLayout;
 	pipelineInfo.stage = stageInfo;
 
-	if (vkCreateComputePipelines(app->_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+	if (vkCreateComputePipelines(app->_logicalDevice, app->pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
 	{
 		throw std::runtime_error("MaterialSimulation: failed to create compute pipeline!");
 	}
@@ -376,27 +400,8 @@ void MaterialSimulation::CreateComputePipeline()
 
 void MaterialSimulation::CreateComputePipelineFromSPV(const std::string& spvName, VkPipeline& outPipeline)
 {
-	QTDoughApplication* app = QTDoughApplication::instance;
-	auto shaderCode = readFile("src/shaders/" + spvName + ".spv");
-	VkShaderModule shaderModule = app->CreateShaderModule(shaderCode);
-
-	VkPipelineShaderStageCreateInfo stageInfo{};
-	stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-	stageInfo.module = shaderModule;
-	stageInfo.pName = "main";
-
-	VkComputePipelineCreateInfo pipelineInfo{};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.stage = stageInfo;
-
-	if (vkCreateComputePipelines(app->_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &outPipeline) != VK_SUCCESS)
-	{
-		throw std::runtime_error("MaterialSimulation: failed to create sort pipeline: " + spvName);
-	}
-
-	vkDestroyShaderModule(app->_logicalDevice, shaderModule, nullptr);
+	//Built on a pipeline worker; ready once InitVulkan returns.
+	QTDoughApplication::instance->CreateComputePipelineAsync(spvName, pipelineLayout, outPipeline);
 }
 
 void MaterialSimulation::CreateSortPipelines()
@@ -569,7 +574,7 @@ void MaterialSimulation::Simulate(VkCommandBuffer commandBuffer)
 		&& dispatchesCount > 60)
 	{
 		VoxelizerPass* vox = VoxelizerPass::instance;
-		if (vox && vox->incrementalBrushJobs.empty() && !vox->brushes.empty())
+		if (vox && vox->brushScheduler.Empty() && !vox->brushes.empty())
 		{
 			if (!quantaCountDispatched)
 			{
@@ -1670,45 +1675,18 @@ void MaterialSimulation::ReadBackQuantaFull()
 
 	QTDoughApplication* app = QTDoughApplication::instance;
 
-	//Get the memory off the GPU and copy to quanta array.
-	//First need a temporary staging buffer.
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-	app->CreateBuffer(quantaMemorySize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer, stagingMemory);
-
-	//Copy GPU to staging.
-	VkCommandBuffer cmd = app->BeginSingleTimeCommands();
-
-	VkBufferCopy region{};
-	region.size = quantaMemorySize;
-
-	vkCmdCopyBuffer(
-		cmd,
-		QuantaStorageBuffers[2],
-		stagingBuffer,
-		1,
-		&region
-	);
-
-	app->EndSingleTimeCommandsAsync(currentFrame, cmd, [this, app, stagingBuffer, stagingMemory]() {
-		//Copy from staging to CPU.
-		void* mapped = nullptr;
-		vkMapMemory(app->_logicalDevice, stagingMemory, 0, quantaMemorySize, 0, &mapped);
-		memcpy(Field.Quantas, mapped, quantaMemorySize);
-		vkUnmapMemory(app->_logicalDevice, stagingMemory);
-
-		//Clean up staging resources.
-		vkDestroyBuffer(app->_logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(app->_logicalDevice, stagingMemory, nullptr);
-
-
-
+	//Streamed into the quanta array over a few frames, then dumped.
+	UnigmaReadbackRequest request;
+	request.source = (uint64_t)QuantaStorageBuffers[2];
+	request.size = quantaMemorySize;
+	request.destination = Field.Quantas;
+	request.priority = UnigmaReadbackPriority::Low;
+	request.callback = [this](const void*, uint64_t) {
 		std::cout << "Done readback..." << std::endl;
 		SerializeQuantaText(AssetsPath + "Fields/quanta.txt");
 		readbackInProgress = false;
-	});
+	};
+	app->readback.Enqueue(request);
 }
 
 void MaterialSimulation::DispatchQuantaCount(VkCommandBuffer commandBuffer)
@@ -1772,33 +1750,18 @@ void MaterialSimulation::ReadBackQuantaCount()
 		return;
 
 	QTDoughApplication* app = QTDoughApplication::instance;
-	uint64_t countBufferSize = sizeof(uint32_t) * MAX_BRUSH_COUNT;
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-	app->CreateBuffer(countBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer, stagingMemory);
-
-	VkCommandBuffer cmd = app->BeginSingleTimeCommands();
-
-	VkBufferCopy region{};
-	region.size = countBufferSize;
-	vkCmdCopyBuffer(cmd, brushQuantaCountBuffer, stagingBuffer, 1, &region);
-
-	app->EndSingleTimeCommandsAsync(currentFrame, cmd, [this, app, stagingBuffer, stagingMemory, countBufferSize]() {
-		void* mapped = nullptr;
-		vkMapMemory(app->_logicalDevice, stagingMemory, 0, countBufferSize, 0, &mapped);
-		memcpy(brushQuantaCounts.data(), mapped, countBufferSize);
-		vkUnmapMemory(app->_logicalDevice, stagingMemory);
-
-		vkDestroyBuffer(app->_logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(app->_logicalDevice, stagingMemory, nullptr);
 
+	UnigmaReadbackRequest request;
+	request.source = (uint64_t)brushQuantaCountBuffer;
+	request.size = sizeof(uint32_t) * MAX_BRUSH_COUNT;
+	request.destination = brushQuantaCounts.data();
+	request.priority = UnigmaReadbackPriority::High;
+	request.callback = [this](const void*, uint64_t) {
 		std::cout << "Quanta count readback done." << std::endl;
 		quantaCountReady = true;
 		quantaCountReadbackInProgress = false;
-	});
+	};
+	app->readback.Enqueue(request);
 }
 
 void MaterialSimulation::SurveyTemperature()
@@ -1869,38 +1832,16 @@ void MaterialSimulation::ReadBackMaterialGridFull()
 
 	QTDoughApplication* app = QTDoughApplication::instance;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-	app->CreateBuffer(materialMemorySize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer, stagingMemory);
-
-	VkCommandBuffer cmd = app->BeginSingleTimeCommands();
-
-	VkBufferCopy region{};
-	region.size = materialMemorySize;
-
-	vkCmdCopyBuffer(
-		cmd,
-		materialGridStorageBuffers[currentFrame],
-		stagingBuffer,
-		1,
-		&region
-	);
-
-	app->EndSingleTimeCommandsAsync(currentFrame, cmd, [this, app, stagingBuffer, stagingMemory]() {
-		void* mapped = nullptr;
-		vkMapMemory(app->_logicalDevice, stagingMemory, 0, materialMemorySize, 0, &mapped);
-		memcpy(Field.InteractionField, mapped, materialMemorySize);
-		vkUnmapMemory(app->_logicalDevice, stagingMemory);
-
-		vkDestroyBuffer(app->_logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(app->_logicalDevice, stagingMemory, nullptr);
-
+	UnigmaReadbackRequest request;
+	request.source = (uint64_t)materialGridStorageBuffers[currentFrame];
+	request.size = materialMemorySize;
+	request.destination = Field.InteractionField;
+	request.callback = [this](const void*, uint64_t) {
 		//std::cout << "Done materialGrid readback." << std::endl;
 		//SerializeMaterialGridText(AssetsPath + "Fields/materialGrid.txt");
 		materialGridReadbackInProgress = false;
-	});
+	};
+	app->readback.Enqueue(request);
 }
 
 void MaterialSimulation::ReadBackMaterialGridSDF()
@@ -1914,35 +1855,18 @@ void MaterialSimulation::ReadBackMaterialGridSDF()
 	auto readbackStart = std::chrono::high_resolution_clock::now();
 
 	QTDoughApplication* app = QTDoughApplication::instance;
-	uint64_t sdfBufferSize = sizeof(float) * (uint64_t)materialGridSize.x * materialGridSize.y * materialGridSize.z;
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-	app->CreateBuffer(sdfBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer, stagingMemory);
-
-	VkCommandBuffer cmd = app->BeginSingleTimeCommands();
-
-	VkBufferCopy region{};
-	region.size = sdfBufferSize;
-
-	vkCmdCopyBuffer(cmd, materialGridSDFBuffers[0], stagingBuffer, 1, &region);
-
-	app->EndSingleTimeCommandsAsync(currentFrame, cmd, [this, app, stagingBuffer, stagingMemory, sdfBufferSize, readbackStart]() {
-		void* mapped = nullptr;
-		vkMapMemory(app->_logicalDevice, stagingMemory, 0, sdfBufferSize, 0, &mapped);
-		memcpy(Field.MaterialGridSDFData, mapped, sdfBufferSize);
-		vkUnmapMemory(app->_logicalDevice, stagingMemory);
-
-		vkDestroyBuffer(app->_logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(app->_logicalDevice, stagingMemory, nullptr);
 
+	UnigmaReadbackRequest request;
+	request.source = (uint64_t)materialGridSDFBuffers[0];
+	request.size = sizeof(float) * (uint64_t)materialGridSize.x * materialGridSize.y * materialGridSize.z;
+	request.destination = Field.MaterialGridSDFData;
+	request.callback = [this, readbackStart](const void*, uint64_t) {
 		auto readbackEnd = std::chrono::high_resolution_clock::now();
 		double readbackMs = std::chrono::duration<double, std::milli>(readbackEnd - readbackStart).count();
 		//std::cout << "Done materialGridSDF readback. Took " << readbackMs << " ms." << std::endl;
 		materialGridSDFReadbackInProgress = false;
-	});
+	};
+	app->readback.Enqueue(request);
 }
 
 int MaterialSimulation::RayCast(Photon &photon, int informationDepth)
@@ -1962,7 +1886,7 @@ int MaterialSimulation::RayCast(Photon &photon, int informationDepth)
 			return 0;
 		}
 
-		float sdf = SampleMaterialGridSDF(pos, Field);
+		float sdf = SampleMaterialGridSDF(pos, Field, materialGridSize);
 
 		if(sdf < 0.0f)
 		{
@@ -1975,7 +1899,7 @@ int MaterialSimulation::RayCast(Photon &photon, int informationDepth)
 			}
 			else if (informationDepth > 0)
 			{
-				MaterialGridPoint gp = SampleMaterialGrid(pos, Field);
+				MaterialGridPoint gp = SampleMaterialGrid(pos, Field, materialGridSize);
 				photon.position = glm::vec4(pos, 1.0f);
 				photon.information = gp.information;
 				photon.force = glm::vec4(gp.velocity);
@@ -2,6 +2,7 @@
 #include <atomic>
 #include "../../Application/QTDoughApplication.h"
 #include "../Renderer/UnigmaMaterial.h"
+#include "../SDF/SDFSampling.h"
 
 #define QUANTA_COUNT 2097152 //Only changes per official build. 
 
@@ -98,6 +99,7 @@ class MaterialSimulation
 		void CreateComputeDescriptorSetLayout();
 		void CreateDescriptorPool();
 		void CreateComputeDescriptorSets();
+		void RebindBrushBuffer(VkBuffer brushBuffer); //VoxelizerPass reallocated its brush buffer.
 		void CreateComputePipeline();
 		void CreateComputePipelineFromSPV(const std::string& spvName, VkPipeline& outPipeline);
 		void CreateSortPipelines();
@@ -269,10 +271,7 @@ class MaterialSimulation
 // Converts a world position to a 3D grid coordinate. Returns clamped ivec3.
 inline glm::ivec3 WorldToGridCoord(glm::vec3 worldPos, glm::vec3 sceneBounds, glm::ivec3 gridSize)
 {
-	glm::vec3 halfScene = sceneBounds * 0.5f;
-	glm::vec3 normalized = (worldPos + halfScene) / sceneBounds;
-	glm::ivec3 coord = glm::ivec3(glm::floor(normalized * glm::vec3(gridSize)));
-	return glm::clamp(coord, glm::ivec3(0), gridSize - 1);
+	return SDFSampleCell(SDFMakeSampleGrid(gridSize, sceneBounds), worldPos);
 }
 
 // Flattens a 3D grid coordinate to a linear buffer index (x + y*resX + z*resX*resY).
@@ -284,11 +283,10 @@ inline int GridCoordToIndex(glm::ivec3 coord, glm::ivec3 gridSize)
 // Converts a world position directly to a linear buffer index. Returns -1 if out of bounds.
 inline int WorldToGridIndex(glm::vec3 worldPos, glm::vec3 sceneBounds, glm::ivec3 gridSize)
 {
-	glm::vec3 halfScene = sceneBounds * 0.5f;
-	if (glm::any(glm::lessThan(worldPos, -halfScene)) || glm::any(glm::greaterThanEqual(worldPos, halfScene)))
+	SDFSampleGrid grid = SDFMakeSampleGrid(gridSize, sceneBounds);
+	if (!SDFSampleInside(grid, worldPos))
 		return -1;
-	glm::ivec3 coord = WorldToGridCoord(worldPos, sceneBounds, gridSize);
-	return GridCoordToIndex(coord, gridSize);
+	return SDFSampleIndex(grid, SDFSampleCell(grid, worldPos));
 }
 
 // Converts a flat buffer index to a world position (cell center).
@@ -301,14 +299,18 @@ inline glm::vec3 GridIndexToWorld(int index, glm::vec3 sceneBounds, glm::ivec3 g
 	return -sceneBounds * 0.5f + (glm::vec3(gx, gy, gz) + 0.5f) * cellSize;
 }
 
-inline MaterialGridPoint SampleMaterialGrid(glm::vec3 worldPos, UnigmaField& field)
+// Nearest grid point to a world position. Callers check WorldToGridIndex first; outside the grid this clamps.
+inline MaterialGridPoint SampleMaterialGrid(glm::vec3 worldPos, UnigmaField& field, glm::ivec3 gridSize)
 {
-	int index = WorldToGridIndex(worldPos, field.FieldSize, glm::ivec3(256, 256, 64));
-	return field.InteractionField[index];
+	SDFSampleGrid grid = SDFMakeSampleGrid(gridSize, glm::vec3(field.FieldSize));
+	return field.InteractionField[SDFSampleIndex(grid, SDFSampleCell(grid, worldPos))];
 }
 
-inline float SampleMaterialGridSDF(glm::vec3 worldPos, UnigmaField& field)
+// Nearest material SDF value, empty space outside the grid (SampleMaterialGridSDF in raymarchsdf_compute.hlsl).
+inline float SampleMaterialGridSDF(glm::vec3 worldPos, UnigmaField& field, glm::ivec3 gridSize)
 {
-	int index = WorldToGridIndex(worldPos, field.FieldSize, glm::ivec3(256, 256, 64));
-	return field.MaterialGridSDFData[index];
+	SDFSampleGrid grid = SDFMakeSampleGrid(gridSize, glm::vec3(field.FieldSize));
+	if (!SDFSampleInside(grid, worldPos))
+		return SDF_EMPTY_SPACE;
+	return field.MaterialGridSDFData[SDFSampleIndex(grid, SDFSampleCell(grid, worldPos))];
 }
\ No newline at end of file
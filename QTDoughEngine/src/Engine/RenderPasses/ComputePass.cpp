@@ -379,15 +379,7 @@ void ComputePass::CreateComputePipeline()
 {
     QTDoughApplication* app = QTDoughApplication::instance;
 
-    auto computeShaderCode = readFile("src/shaders/particletestcompute.spv");
     std::cout << "Creating compute pipeline" << std::endl;
-    VkShaderModule computeShaderModule = app->CreateShaderModule(computeShaderCode);
-
-    VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
-    computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    computeShaderStageInfo.module = computeShaderModule;
-    computeShaderStageInfo.pName = "main";
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -408,17 +400,7 @@ void ComputePass::CreateComputePipeline()
         throw std::runtime_error("failed to create compute pipeline layout!");
     }
 
-    VkComputePipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    pipelineInfo.layout = computePipelineLayout;
-    pipelineInfo.stage = computeShaderStageInfo;
-
-    if (vkCreateComputePipelines(app->_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create compute pipeline!");
-    }
-
-    vkDestroyShaderModule(app->_logicalDevice, computeShaderModule, nullptr);
-    std::cout << "Compute pipeline created" << std::endl;
+    app->CreateComputePipelineAsync("particletestcompute", computePipelineLayout, computePipeline);
 
     readbackBuffers.resize(app->MAX_FRAMES_IN_FLIGHT);
     readbackBufferMemories.resize(app->MAX_FRAMES_IN_FLIGHT);
@@ -157,6 +157,18 @@ void QuantaSpherePass::CreateDescriptorSets()
     }
 }
 
+void QuantaSpherePass::RebindBrushBuffer(VkBuffer brushBuffer)
+{
+    QTDoughApplication* app = QTDoughApplication::instance;
+
+    for (VkDescriptorSet set : descriptorSets) {
+        VkDescriptorBufferInfo brushInfo{ brushBuffer, 0, VK_WHOLE_SIZE };
+        VkWriteDescriptorSet w{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+        w.dstSet = set; w.dstBinding = 7; w.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER; w.descriptorCount = 1; w.pBufferInfo = &brushInfo;
+        vkUpdateDescriptorSets(app->_logicalDevice, 1, &w, 0, nullptr);
+    }
+}
+
 void QuantaSpherePass::CreateGraphicsPipeline()
 {
     QTDoughApplication* app = QTDoughApplication::instance;
@@ -257,7 +269,7 @@ void QuantaSpherePass::CreateGraphicsPipeline()
     gp.pColorBlendState = &cb;
     gp.pDynamicState = &dyn;
     gp.layout = pipelineLayout;
-    if (vkCreateGraphicsPipelines(app->_logicalDevice, VK_NULL_HANDLE, 1, &gp, nullptr, &graphicsPipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(app->_logicalDevice, app->pipelineCache.Handle(), 1, &gp, nullptr, &graphicsPipeline) != VK_SUCCESS)
         throw std::runtime_error("QuantaSpherePass: graphics pipeline failed");
 
     vkDestroyShaderModule(app->_logicalDevice, vs, nullptr);
@@ -35,6 +35,7 @@ public:
     void CreateDescriptorPool() override;
     void CreateDescriptorSets() override;
     void CreateGraphicsPipeline() override;
+    void RebindBrushBuffer(VkBuffer brushBuffer) override;
     void Render(VkCommandBuffer cmd, uint32_t imageIndex, uint32_t currentFrame,
                 VkImageView* targetImage = nullptr, UnigmaCameraStruct* CameraMain = nullptr) override;
 };
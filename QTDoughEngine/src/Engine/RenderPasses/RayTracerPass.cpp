@@ -22,10 +22,14 @@ RayTracerPass::~RayTracerPass()
         if (F.tlasBuffer) vkDestroyBuffer(app->_logicalDevice, F.tlasBuffer, nullptr);
         if (F.scratchBuffer) vkDestroyBuffer(app->_logicalDevice, F.scratchBuffer, nullptr);
         if (F.instanceBuffer) vkDestroyBuffer(app->_logicalDevice, F.instanceBuffer, nullptr);
+        if (F.meshSnapshotBuffer) vkDestroyBuffer(app->_logicalDevice, F.meshSnapshotBuffer, nullptr);
+        if (F.vertexOffsetsBuffer) vkDestroyBuffer(app->_logicalDevice, F.vertexOffsetsBuffer, nullptr);
 
         if (F.tlasMemory) vkFreeMemory(app->_logicalDevice, F.tlasMemory, nullptr);
         if (F.scratchMemory) vkFreeMemory(app->_logicalDevice, F.scratchMemory, nullptr);
         if (F.instanceMemory) vkFreeMemory(app->_logicalDevice, F.instanceMemory, nullptr);
+        if (F.meshSnapshotMemory) vkFreeMemory(app->_logicalDevice, F.meshSnapshotMemory, nullptr);
+        if (F.vertexOffsetsMemory) vkFreeMemory(app->_logicalDevice, F.vertexOffsetsMemory, nullptr);
 
         F = {};
     }
@@ -425,7 +429,7 @@ void RayTracerPass::CreateComputePipeline()
     pci.maxPipelineRayRecursionDepth = 1;
     pci.layout = rtPipelineLayout;
 
-    VK_CHECK(vkCreateRayTracingPipelinesKHR_fn(app->_logicalDevice, VK_NULL_HANDLE, VK_NULL_HANDLE, 1, &pci, nullptr, &rtPipeline));
+    VK_CHECK(vkCreateRayTracingPipelinesKHR_fn(app->_logicalDevice, VK_NULL_HANDLE, app->pipelineCache.Handle(), 1, &pci, nullptr, &rtPipeline));
 
     vkDestroyShaderModule(app->_logicalDevice, rgen, nullptr);
     vkDestroyShaderModule(app->_logicalDevice, rmiss, nullptr);
@@ -800,6 +804,170 @@ void RayTracerPass::BuildBLAS_PerBrush(
     B.blasAddr = GetASAddress(B.blas);
 }
 
+void RayTracerPass::UpdateBrushBLASes(VkCommandBuffer cmd, uint32_t frame, uint32_t readIdx)
+{
+    QTDoughApplication* app = QTDoughApplication::instance;
+    auto& F = rtAS[frame];
+    VoxelizerPass* voxelizer = VoxelizerPass::instance;
+
+    if (F.perBrushBlas.size() < voxelizer->maxBrushCapacity)
+        F.perBrushBlas.resize(voxelizer->maxBrushCapacity);
+
+    //This frame's previous use of either buffer has completed, so both can be replaced when they are too small.
+    if (F.meshSnapshotCapacity < voxelizer->VertexMaxCount)
+    {
+        if (F.meshSnapshotBuffer != VK_NULL_HANDLE)
+        {
+            vkDestroyBuffer(app->_logicalDevice, F.meshSnapshotBuffer, nullptr);
+            vkFreeMemory(app->_logicalDevice, F.meshSnapshotMemory, nullptr);
+        }
+        F.meshSnapshotCapacity = voxelizer->VertexMaxCount;
+        app->CreateBuffer(
+            sizeof(Vertex) * VkDeviceSize(F.meshSnapshotCapacity),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            F.meshSnapshotBuffer, F.meshSnapshotMemory);
+        //None of the built meshes are in the new buffer.
+        for (auto& B : F.perBrushBlas)
+            B.builtCount = 0;
+    }
+
+    if (F.vertexOffsetsCapacity < voxelizer->maxBrushCapacity)
+    {
+        if (F.vertexOffsetsBuffer != VK_NULL_HANDLE)
+        {
+            vkDestroyBuffer(app->_logicalDevice, F.vertexOffsetsBuffer, nullptr);
+            vkFreeMemory(app->_logicalDevice, F.vertexOffsetsMemory, nullptr);
+        }
+        F.vertexOffsetsCapacity = voxelizer->maxBrushCapacity;
+        app->CreateBuffer(
+            sizeof(uint32_t) * F.vertexOffsetsCapacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            F.vertexOffsetsBuffer, F.vertexOffsetsMemory);
+    }
+
+    //A brush keeps its BLAS while its slice and generation match what the BLAS was built from. Slices of one frame
+    //never overlap, so no other brush's copy can have overwritten a kept brush's triangles in the snapshot.
+    const std::vector<uint32_t>& generations = voxelizer->meshGenerations[readIdx];
+    F.snapshotCopies.clear();
+    for (uint32_t i = 0; i < (uint32_t)F.perBrushBlas.size(); ++i)
+    {
+        auto& B = F.perBrushBlas[i];
+        B.rebuilt = false;
+
+        uint32_t vertexCount = i < voxelizer->brushes.size() && i < voxelizer->BrushVerticesCount.size() ? voxelizer->BrushVerticesCount[i] : 0;
+        uint32_t vertexOffset = vertexCount > 0 ? voxelizer->BrushVertexOffsets[i] : 0;
+        uint32_t generation = i < generations.size() ? generations[i] : 0;
+        if (vertexCount < 3 || uint64_t(vertexOffset) + vertexCount > F.meshSnapshotCapacity)
+        {
+            B.builtCount = 0;
+            continue;
+        }
+        if (B.blas != VK_NULL_HANDLE && B.builtCount == vertexCount && B.builtOffset == vertexOffset && B.builtGeneration == generation)
+            continue;
+
+        VkBufferCopy copy{};
+        copy.srcOffset = sizeof(Vertex) * VkDeviceSize(vertexOffset);
+        copy.dstOffset = copy.srcOffset;
+        copy.size = sizeof(Vertex) * VkDeviceSize(vertexCount);
+        F.snapshotCopies.push_back(copy);
+
+        B.builtOffset = vertexOffset;
+        B.builtCount = vertexCount;
+        B.builtGeneration = generation;
+        B.rebuilt = true;
+    }
+
+    void* mapped = nullptr;
+    vkMapMemory(app->_logicalDevice, F.vertexOffsetsMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    memcpy(mapped, voxelizer->BrushVertexOffsets.data(), sizeof(uint32_t) * std::min<size_t>(voxelizer->BrushVertexOffsets.size(), F.vertexOffsetsCapacity));
+    vkUnmapMemory(app->_logicalDevice, F.vertexOffsetsMemory);
+
+    if (F.snapshotCopies.empty())
+        return;
+
+    //The voxelizer wrote the soup last frame.
+    VkBufferMemoryBarrier soupBarrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+    soupBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    soupBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    soupBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    soupBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    soupBarrier.buffer = voxelizer->meshingVertexBuffers[readIdx];
+    soupBarrier.offset = 0;
+    soupBarrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 1, &soupBarrier, 0, nullptr);
+
+    vkCmdCopyBuffer(cmd, voxelizer->meshingVertexBuffers[readIdx], F.meshSnapshotBuffer,
+        (uint32_t)F.snapshotCopies.size(), F.snapshotCopies.data());
+
+    VkBufferMemoryBarrier snapshotBarrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+    snapshotBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    snapshotBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+    snapshotBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    snapshotBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    snapshotBarrier.buffer = F.meshSnapshotBuffer;
+    snapshotBarrier.offset = 0;
+    snapshotBarrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+        0, 0, nullptr, 1, &snapshotBarrier, 0, nullptr);
+
+    //Vertex starts with its float4 position, which is the BLAS vertex format.
+    for (uint32_t i = 0; i < (uint32_t)F.perBrushBlas.size(); ++i)
+    {
+        const auto& B = F.perBrushBlas[i];
+        if (B.rebuilt)
+            BuildBLAS_PerBrush(cmd, frame, i, F.meshSnapshotBuffer, sizeof(Vertex) * VkDeviceSize(B.builtOffset), B.builtCount, sizeof(Vertex));
+    }
+}
+
+namespace
+{
+    //Drives one frame's TLAS for SDFTLASTracker: records go straight into the host visible instance buffer, builds and
+    //refits are recorded into the frame's command buffer.
+    class FrameTLASBuilder : public SDFTLASBuilder
+    {
+    public:
+        FrameTLASBuilder(RayTracerPass& rayTracer, VkCommandBuffer commandBuffer, uint32_t frameIndex) :
+            pass(rayTracer), cmd(commandBuffer), frame(frameIndex)
+        {
+        }
+
+        ~FrameTLASBuilder()
+        {
+            if (mapped != nullptr)
+                vkUnmapMemory(QTDoughApplication::instance->_logicalDevice, pass.rtAS[frame].instanceMemory);
+        }
+
+        void WriteInstances(uint32_t first, const SDFTLASInstance* records, uint32_t count) override
+        {
+            if (mapped == nullptr)
+                vkMapMemory(QTDoughApplication::instance->_logicalDevice, pass.rtAS[frame].instanceMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+            memcpy(static_cast<char*>(mapped) + sizeof(VkAccelerationStructureInstanceKHR) * first, records,
+                sizeof(VkAccelerationStructureInstanceKHR) * count);
+        }
+
+        void Build(uint32_t instanceCount) override { pass.RecordTLASBuild(cmd, frame, instanceCount, false); }
+        void Refit(uint32_t instanceCount) override { pass.RecordTLASBuild(cmd, frame, instanceCount, true); }
+
+    private:
+        RayTracerPass& pass;
+        VkCommandBuffer cmd;
+        uint32_t frame;
+        void* mapped = nullptr;
+    };
+}
+
 void RayTracerPass::BuildTLAS_MultiInstance(
     VkCommandBuffer cmd,
     uint32_t frame,
@@ -809,54 +977,77 @@ void RayTracerPass::BuildTLAS_MultiInstance(
     auto& F = rtAS[frame];
     VoxelizerPass* voxelizer = VoxelizerPass::instance;
 
-    std::vector<VkAccelerationStructureInstanceKHR> instanceList;
-    instanceList.reserve(voxelizer->brushes.size());
+    static_assert(sizeof(SDFTLASInstance) == sizeof(VkAccelerationStructureInstanceKHR), "instance records are copied as is");
+
+    //One instance per brush slot. Slots without geometry stay in the list with a null BLAS, so a brush emptying out
+    //does not shift every record after it.
+    std::vector<SDFTLASSlot>& slots = F.tlasSlots;
+    slots.resize(voxelizer->brushes.size());
     for (size_t i = 0; i < voxelizer->brushes.size(); ++i)
     {
-        if (i >= voxelizer->BrushVerticesCount.size() || voxelizer->BrushVerticesCount[i] == 0)
+        SDFTLASSlot& slot = slots[i];
+        slot = SDFTLASSlot();
+        if (i >= F.perBrushBlas.size() || F.perBrushBlas[i].blas == VK_NULL_HANDLE || F.perBrushBlas[i].builtCount == 0)
             continue;
-        if (i >= F.perBrushBlas.size() || F.perBrushBlas[i].blas == VK_NULL_HANDLE)
-            continue;
-
-        VkAccelerationStructureInstanceKHR inst{};
-        inst.transform = xform;
-        inst.instanceCustomIndex = static_cast<uint32_t>(i) & 0xFFFFFF;
-        inst.mask = voxelizer->brushes[i].rayMask & 0xFF;
-        inst.instanceShaderBindingTableRecordOffset = 0;
-        inst.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-        inst.accelerationStructureReference = F.perBrushBlas[i].blasAddr;
-        instanceList.push_back(inst);
-
+        const auto& B = F.perBrushBlas[i];
+
+        static_assert(sizeof(slot.record.transform) == sizeof(xform.matrix), "3x4 row major transform");
+        memcpy(slot.record.transform, xform.matrix, sizeof(xform.matrix));
+        slot.record.customIndex = static_cast<uint32_t>(i) & 0xFFFFFF;
+        slot.record.mask = voxelizer->brushes[i].rayMask & 0xFF;
+        slot.record.sbtOffset = 0;
+        slot.record.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+        slot.record.blasAddress = B.blasAddr;
+
+        //The BLAS holds world space vertices, so the brush's world bounds are what moves the instance. A new mesh,
+        //deformed in place or moved within the soup, changes the BLAS without moving the brush.
+        if (i < voxelizer->brushProxies.size() && voxelizer->brushProxies[i] != SDFDynamicAABBTree::NullNode)
+            slot.bounds = voxelizer->brushTree.GetTightAABB(voxelizer->brushProxies[i]);
+        const uint32_t mesh[3] = { B.builtOffset, B.builtCount, B.builtGeneration };
+        slot.geometryKey = SDFHashBytes(mesh, sizeof(mesh));
+        slot.blasRebuilt = B.rebuilt;
     }
 
-
-    if (instanceList.empty())
+    if (slots.empty())
         return;
 
-    const VkDeviceSize instancesBytes = sizeof(VkAccelerationStructureInstanceKHR) * instanceList.size();
     const VkDeviceSize instanceBufferBytes = sizeof(VkAccelerationStructureInstanceKHR) * voxelizer->maxBrushCapacity;
 
+    if (F.instanceBuffer != VK_NULL_HANDLE && F.instanceCapacity < voxelizer->maxBrushCapacity) {
+        //This frame's previous TLAS build has completed, so its instance buffer can go.
+        vkDestroyBuffer(app->_logicalDevice, F.instanceBuffer, nullptr);
+        vkFreeMemory(app->_logicalDevice, F.instanceMemory, nullptr);
+        F.instanceBuffer = VK_NULL_HANDLE;
+        F.instanceMemory = VK_NULL_HANDLE;
+    }
+
     if (F.instanceBuffer == VK_NULL_HANDLE) {
+        F.instanceCapacity = voxelizer->maxBrushCapacity;
         app->CreateBuffer(
             instanceBufferBytes,
             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
             F.instanceBuffer, F.instanceMemory);
+        //The new buffer holds none of the records.
+        F.tlasTracker.Invalidate();
     }
 
-    void* mapped = nullptr;
-    vkMapMemory(app->_logicalDevice, F.instanceMemory, 0, instancesBytes, 0, &mapped);
-    memcpy(mapped, instanceList.data(), instancesBytes);
-    vkUnmapMemory(app->_logicalDevice, F.instanceMemory);
+    //A static scene stops here: nothing written, nothing built.
+    FrameTLASBuilder builder(*this, cmd, frame);
+    F.tlasTracker.Update(slots, builder);
+}
 
-    VkDeviceAddress instAddr = GetBufferAddress(F.instanceBuffer);
+void RayTracerPass::RecordTLASBuild(VkCommandBuffer cmd, uint32_t frame, uint32_t instanceCount, bool refit)
+{
+    QTDoughApplication* app = QTDoughApplication::instance;
+    auto& F = rtAS[frame];
 
     VkAccelerationStructureGeometryInstancesDataKHR instances{
         VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR
     };
     instances.arrayOfPointers = VK_FALSE;
-    instances.data.deviceAddress = instAddr;
+    instances.data.deviceAddress = GetBufferAddress(F.instanceBuffer);
 
     VkAccelerationStructureGeometryKHR geom{
         VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR
@@ -865,57 +1056,63 @@ void RayTracerPass::BuildTLAS_MultiInstance(
     geom.geometry.instances = instances;
 
     VkAccelerationStructureBuildRangeInfoKHR range{};
-    range.primitiveCount = static_cast<uint32_t>(instanceList.size());
+    range.primitiveCount = instanceCount;
     const VkAccelerationStructureBuildRangeInfoKHR* pRange = &range;
 
     VkAccelerationStructureBuildGeometryInfoKHR buildInfo{
         VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR
     };
     buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-    buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
-    buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    buildInfo.mode = refit ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
     buildInfo.geometryCount = 1;
     buildInfo.pGeometries = &geom;
 
-    VkAccelerationStructureBuildSizesInfoKHR sizes{
-        VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR
-    };
-    uint32_t primCount = static_cast<uint32_t>(instanceList.size());
+    if (!refit)
+    {
+        VkAccelerationStructureBuildSizesInfoKHR sizes{
+            VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR
+        };
+        vkGetAccelerationStructureBuildSizesKHR_fn(
+            app->_logicalDevice,
+            VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+            &buildInfo,
+            &instanceCount,
+            &sizes);
+
+        //Kept while it fits. The build and update scratch of a TLAS is far below the worst case BLAS scratch.
+        if (sizes.accelerationStructureSize > F.tlasAllocatedSize) {
+            if (F.tlas != VK_NULL_HANDLE) {
+                vkDestroyAccelerationStructureKHR_fn(app->_logicalDevice, F.tlas, nullptr);
+                vkDestroyBuffer(app->_logicalDevice, F.tlasBuffer, nullptr);
+                vkFreeMemory(app->_logicalDevice, F.tlasMemory, nullptr);
+                F.tlas = VK_NULL_HANDLE;
+                F.tlasBuffer = VK_NULL_HANDLE;
+                F.tlasMemory = VK_NULL_HANDLE;
+                F.tlasAddr = 0;
+            }
+
+            F.tlasAllocatedSize = sizes.accelerationStructureSize * 2;
 
-    vkGetAccelerationStructureBuildSizesKHR_fn(
-        app->_logicalDevice,
-        VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-        &buildInfo,
-        &primCount,
-        &sizes);
+            app->CreateBuffer(
+                F.tlasAllocatedSize,
+                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                F.tlasBuffer, F.tlasMemory);
 
+            VkAccelerationStructureCreateInfoKHR asCreate{
+                VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR
+            };
+            asCreate.buffer = F.tlasBuffer;
+            asCreate.size = F.tlasAllocatedSize;
+            asCreate.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
 
-    if (F.tlas != VK_NULL_HANDLE) {
-        vkDestroyAccelerationStructureKHR_fn(app->_logicalDevice, F.tlas, nullptr);
-        vkDestroyBuffer(app->_logicalDevice, F.tlasBuffer, nullptr);
-        vkFreeMemory(app->_logicalDevice, F.tlasMemory, nullptr);
-        F.tlas = VK_NULL_HANDLE;
-        F.tlasBuffer = VK_NULL_HANDLE;
-        F.tlasMemory = VK_NULL_HANDLE;
-        F.tlasAddr = 0;
+            VK_CHECK(vkCreateAccelerationStructureKHR_fn(app->_logicalDevice, &asCreate, nullptr, &F.tlas));
+        }
     }
-
-    app->CreateBuffer(
-        sizes.accelerationStructureSize,
-        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        F.tlasBuffer, F.tlasMemory);
-
-    VkAccelerationStructureCreateInfoKHR asCreate{
-        VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR
-    };
-    asCreate.buffer = F.tlasBuffer;
-    asCreate.size = sizes.accelerationStructureSize;
-    asCreate.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-
-    VK_CHECK(vkCreateAccelerationStructureKHR_fn(app->_logicalDevice, &asCreate, nullptr, &F.tlas));
-
+    else
+        buildInfo.srcAccelerationStructure = F.tlas; //Updated in place.
 
     buildInfo.dstAccelerationStructure = F.tlas;
     buildInfo.scratchData.deviceAddress = GetBufferAddress(F.scratchBuffer);
@@ -935,7 +1132,6 @@ void RayTracerPass::BuildTLAS_MultiInstance(
     F.tlasAddr = GetASAddress(F.tlas);
 }
 
-
 void RayTracerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFrame)
 {
     QTDoughApplication* app = QTDoughApplication::instance;
@@ -957,34 +1153,8 @@ void RayTracerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFram
 
     const uint32_t readIdx = (currentFrame + 1) % 2;
 
-    // Sync voxelizer's compute writes to meshingPositionBuffer with the per-brush BLAS reads.
-    VkBufferMemoryBarrier mpBarrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
-    mpBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    mpBarrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
-    mpBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    mpBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    mpBarrier.buffer = voxelizer->meshingPositionBuffers[readIdx];
-    mpBarrier.offset = 0;
-    mpBarrier.size = VK_WHOLE_SIZE;
-
-    vkCmdPipelineBarrier(commandBuffer,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
-        0, 0, nullptr, 1, &mpBarrier, 0, nullptr);
-
-    // Build per-brush BLASes over each brush's slice of meshingPositionBuffer.
-    const VkDeviceSize vertexStride = sizeof(float) * 4;
-    for (size_t i = 0; i < voxelizer->brushes.size(); ++i)
-    {
-        if (i >= voxelizer->BrushVerticesCount.size())
-            break;
-        uint32_t vertexCount = voxelizer->BrushVerticesCount[i];
-        if (vertexCount == 0)
-            continue;
-        VkDeviceSize vertexOffset = static_cast<VkDeviceSize>(voxelizer->BrushVertexOffsets[i]) * vertexStride;
-        BuildBLAS_PerBrush(commandBuffer, currentFrame, static_cast<uint32_t>(i),
-            voxelizer->meshingPositionBuffers[readIdx], vertexOffset, vertexCount, vertexStride);
-    }
+    // Per-brush BLASes over the brushes whose mesh changed since this frame's last build.
+    UpdateBrushBLASes(commandBuffer, currentFrame, readIdx);
     BuildTLAS_MultiInstance(commandBuffer, currentFrame);
 
     VkAccelerationStructureKHR tlasForFrame = rtAS[currentFrame].tlas;
@@ -1020,7 +1190,7 @@ void RayTracerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFram
     );
 
     VkDescriptorBufferInfo vbInfo{};
-    vbInfo.buffer = voxelizer->meshingVertexBuffers[readIdx];
+    vbInfo.buffer = rtAS[currentFrame].meshSnapshotBuffer;
     vbInfo.offset = 0;
     vbInfo.range = VK_WHOLE_SIZE;
 
@@ -1034,7 +1204,7 @@ void RayTracerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFram
     vkUpdateDescriptorSets(app->_logicalDevice, 1, &vbWrite, 0, nullptr);
 
     VkDescriptorBufferInfo bvoInfo{};
-    bvoInfo.buffer = voxelizer->brushVertexOffsetsBuffers[readIdx];
+    bvoInfo.buffer = rtAS[currentFrame].vertexOffsetsBuffer;
     bvoInfo.offset = 0;
     bvoInfo.range = VK_WHOLE_SIZE;
 
@@ -3,6 +3,7 @@
 #include "../Renderer/UnigmaMaterial.h"
 #include "../Renderer/UnigmaRenderingManager.h"
 #include "../Camera/UnigmaCamera.h"
+#include "../SDF/SDFTLASTracker.h"
 
 class RayTracerPass
 {
@@ -70,19 +71,38 @@ public:
         VkDeviceMemory blasMemory = VK_NULL_HANDLE;
         VkDeviceAddress blasAddr = 0;
         VkDeviceSize blasAllocatedSize = 0;
+
+        //The mesh the BLAS was last built from. builtCount 0 means nothing usable is built.
+        uint32_t builtOffset = 0;
+        uint32_t builtCount = 0;
+        uint32_t builtGeneration = 0;
+        bool rebuilt = false; //This frame.
     };
 
     struct RtASPerFrame
     {
-        // Per-brush BLASes. Each brush's vertices live in a contiguous slice of
-        // VoxelizerPass::meshingPositionBuffer at offset BrushVertexOffsets[i]*sizeof(vec4),
-        // length BrushVerticesCount[i]. One BLAS per brush so cullMask actually skips geometry.
+        // Per-brush BLASes. Each brush's vertices live in a contiguous slice of the meshing soup
+        // at BrushVertexOffsets[i], length BrushVerticesCount[i]. One BLAS per brush so cullMask
+        // actually skips geometry. Rebuilt only when the brush's mesh generation or slice changes.
         std::vector<PerBrushBlas> perBrushBlas;
 
+        // The soup the BLASes were built from. The meshing pass rewrites every brush every frame and the
+        // triangle order inside a brush is not stable, so the hit shader fetches attributes from here,
+        // where a kept BLAS still finds its own triangles. Rebuilt brushes are copied in at their offset.
+        VkBuffer meshSnapshotBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory meshSnapshotMemory = VK_NULL_HANDLE;
+        uint32_t meshSnapshotCapacity = 0; //In vertices.
+        // Per-brush offsets into the snapshot, for the hit shader. Host visible, written every frame.
+        VkBuffer vertexOffsetsBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory vertexOffsetsMemory = VK_NULL_HANDLE;
+        uint32_t vertexOffsetsCapacity = 0; //In brushes.
+        std::vector<VkBufferCopy> snapshotCopies; //Filled every frame, kept for its allocation.
+
         // TLAS
         VkAccelerationStructureKHR tlas = VK_NULL_HANDLE;
         VkBuffer tlasBuffer = VK_NULL_HANDLE;
         VkDeviceMemory tlasMemory = VK_NULL_HANDLE;
+        VkDeviceSize tlasAllocatedSize = 0;
 
         VkBuffer scratchBuffer = VK_NULL_HANDLE;
         VkDeviceMemory scratchMemory = VK_NULL_HANDLE;
@@ -90,8 +110,13 @@ public:
 
         VkBuffer instanceBuffer = VK_NULL_HANDLE;
         VkDeviceMemory instanceMemory = VK_NULL_HANDLE;
+        uint32_t instanceCapacity = 0; //In brushes. Recreated when the voxelizer grows its brush capacity.
 
         VkDeviceAddress tlasAddr = 0;
+
+        //What this frame's instance buffer and TLAS were last built from. Per frame in flight, like the buffer.
+        SDFTLASTracker tlasTracker;
+        std::vector<SDFTLASSlot> tlasSlots; //Filled every frame, kept for its allocation.
     };
     std::vector<RtASPerFrame> rtAS;
 
@@ -100,6 +125,8 @@ public:
     VkDeviceAddress GetASAddress(VkAccelerationStructureKHR as);
 
     void BuildBLAS_PerBrush(VkCommandBuffer cmd, uint32_t frame, uint32_t brushIdx, VkBuffer vertexBuffer, VkDeviceSize vertexOffset, uint32_t vertexCount, VkDeviceSize vertexStride);
+    //Copies the brushes whose mesh changed from the meshing soup into the frame's snapshot and rebuilds their BLASes.
+    void UpdateBrushBLASes(VkCommandBuffer cmd, uint32_t frame, uint32_t readIdx);
 
     void BuildTLAS_MultiInstance(
         VkCommandBuffer cmd,
@@ -109,6 +136,8 @@ public:
             {0,1,0,0},
             {0,0,1,0}
         } });
+    //Full build or in place update of the frame's TLAS over instanceCount records already in its instance buffer.
+    void RecordTLASBuild(VkCommandBuffer cmd, uint32_t frame, uint32_t instanceCount, bool refit);
 
     struct UniformBufferObject {
         alignas(16) glm::mat4 model;
@@ -350,7 +350,7 @@ void RenderPassObject::CreateGraphicsPipeline()
 
     std::cout << "Dynamic pipeline created" << std::endl;
 
-    if (vkCreateGraphicsPipelines(app->_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(app->_logicalDevice, app->pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
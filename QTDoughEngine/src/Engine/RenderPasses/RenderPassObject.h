@@ -66,5 +66,7 @@ class RenderPassObject
         virtual void UpdateUniformBufferObjects(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame, VkImageView* targetImage, UnigmaCameraStruct* CameraMain);
         virtual void RenderPerObject(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame, VkImageView* targetImage, UnigmaCameraStruct* CameraMain);
         virtual void RenderPerObject(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame, std::vector<VkImageView*> targetImages, UnigmaCameraStruct* CameraMain);
+        //Called when VoxelizerPass reallocates its brush buffer. Passes that bind it rewrite their descriptors.
+        virtual void RebindBrushBuffer(VkBuffer brushBuffer) {}
 
 };
\ No newline at end of file
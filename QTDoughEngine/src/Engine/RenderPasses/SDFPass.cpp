@@ -42,27 +42,8 @@ void SDFPass::CreateComputePipeline()
     QTDoughApplication* app = QTDoughApplication::instance;
     VoxelizerPass* voxelizer = VoxelizerPass::instance;
 
-    auto computeShaderCode = readFile("src/shaders/raymarchsdf.spv");
     std::cout << "Creating compute pipeline" << std::endl;
-    VkShaderModule computeShaderModule = app->CreateShaderModule(computeShaderCode);
-
-    VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
-    computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    computeShaderStageInfo.module = computeShaderModule;
-    computeShaderStageInfo.pName = "main";
-
-    VkComputePipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    pipelineInfo.layout = voxelizer->voxelizeComputePipelineLayout;
-    pipelineInfo.stage = computeShaderStageInfo;
-
-    if (vkCreateComputePipelines(app->_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create compute pipeline!");
-    }
-
-    vkDestroyShaderModule(app->_logicalDevice, computeShaderModule, nullptr);
-    std::cout << "Compute pipeline created" << std::endl;
+    app->CreateComputePipelineAsync("raymarchsdf", voxelizer->voxelizeComputePipelineLayout, computePipeline);
 }
 
 void SDFPass::CreateComputeDescriptorSets()
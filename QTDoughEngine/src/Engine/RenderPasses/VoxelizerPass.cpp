@@ -8,6 +8,14 @@ static bool ping = false;
 
 
 VoxelizerPass::~VoxelizerPass() {
+    QTDoughApplication* app = QTDoughApplication::instance;
+
+    if (brushCookQueryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(app->_logicalDevice, brushCookQueryPool, nullptr);
+        brushCookQueryPool = VK_NULL_HANDLE;
+    }
+
     PassName = "VoxelizerPass";
 }
 
@@ -125,15 +133,7 @@ void VoxelizerPass::CreateComputePipelineName(std::string shaderPass, VkPipeline
 
     QTDoughApplication* app = QTDoughApplication::instance;
 
-    auto computeShaderCode = readFile("src/shaders/" + shaderPass + ".spv");
     std::cout << "Creating compute pipeline" << std::endl;
-    VkShaderModule computeShaderModule = app->CreateShaderModule(computeShaderCode);
-
-    VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
-    computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    computeShaderStageInfo.module = computeShaderModule;
-    computeShaderStageInfo.pName = "main";
 
     VkPushConstantRange pushConstantRange{};
     pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
@@ -160,14 +160,7 @@ void VoxelizerPass::CreateComputePipelineName(std::string shaderPass, VkPipeline
         throw std::runtime_error("failed to create compute pipeline layout!");
     }
 
-    VkComputePipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    pipelineInfo.layout = rcomputePipelineLayout;
-    pipelineInfo.stage = computeShaderStageInfo;
-
-    if (vkCreateComputePipelines(app->_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &rcomputePipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create compute pipeline!");
-    }
+    app->CreateComputePipelineAsync(shaderPass, rcomputePipelineLayout, rcomputePipeline);
 
     VkDeviceSize bufferSize = sizeof(Vertex) * VertexMaxCount; // Or your max vertex count
     app->CreateBuffer(
@@ -186,8 +179,6 @@ void VoxelizerPass::CreateComputePipelineName(std::string shaderPass, VkPipeline
     if (vkCreateFence(app->_logicalDevice, &fenceInfo, nullptr, &meshingReadbackFence) != VK_SUCCESS) {
         throw std::runtime_error("failed to create readback fence!");
     }
-
-    vkDestroyShaderModule(app->_logicalDevice, computeShaderModule, nullptr);
 }
 
 void VoxelizerPass::RecordCounterReadback(VkCommandBuffer commandBuffer, uint32_t currentFrame)
@@ -301,104 +292,31 @@ void VoxelizerPass::GetMeshFromGPU()
 
     QTDoughApplication* app = QTDoughApplication::instance;
 
-    uint32_t vertexCount = 0;
-
-    uint32_t counters[2] = { 0,0 };
-
-    VkCommandBuffer cb = app->BeginSingleTimeCommands();
-
-    VkBufferMemoryBarrier barrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
-    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;     
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;   
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.buffer = globalIDCounterStorageBuffers;
-    barrier.offset = 0;
-    barrier.size = VK_WHOLE_SIZE;
-
-    vkCmdPipelineBarrier(
-        cb,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0,
-        0, nullptr,
-        1, &barrier,
-        0, nullptr
-    );
-
-    VkBufferCopy copy{};
-    copy.srcOffset = 0;
-    copy.dstOffset = 0;
-    copy.size = sizeof(uint32_t) * globalIDCounterSize;
-
-    vkCmdCopyBuffer(cb, globalIDCounterStorageBuffers, stagingGlobalIDCounterBuffer, 1, &copy);
-
-    VkBufferMemoryBarrier brushBarrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
-    brushBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    brushBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-    brushBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    brushBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    brushBarrier.buffer = brushVerticesStorageBuffer;
-    brushBarrier.offset = 0;
-    brushBarrier.size = VK_WHOLE_SIZE;
-
-    vkCmdPipelineBarrier(
-        cb,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0,
-        0, nullptr,
-        1, &brushBarrier,
-        0, nullptr
-    );
-
-    VkBufferCopy brushCopy{};
-    brushCopy.srcOffset = 0;
-    brushCopy.dstOffset = 0;
-    brushCopy.size = sizeof(uint32_t) * maxBrushCapacity;
-    vkCmdCopyBuffer(cb, brushVerticesStorageBuffer, stagingBrushVerticesBuffer, 1, &brushCopy);
-
-    app->EndSingleTimeCommands(cb);
-    vkDeviceWaitIdle(app->_logicalDevice);
-
-
-    if (stagingGlobalIDCounterMemory != VK_NULL_HANDLE)
-    {
-        void* mapped = nullptr;
-        VkResult r = vkMapMemory(app->_logicalDevice, stagingGlobalIDCounterMemory, 0, sizeof(counters), 0, &mapped);
-        if (r == VK_SUCCESS && mapped != nullptr)
-        {
-            memcpy(counters, mapped, sizeof(counters));
-            vkUnmapMemory(app->_logicalDevice, stagingGlobalIDCounterMemory);
-            vertexCount = counters[1];
-        }
-        else
-        {
-            std::cout << "GetMeshFromGPU: globalIDCounter map failed (VkResult=" << r << ")." << std::endl;
+    //Both arrive on a later frame; the copies run after the meshing dispatches already submitted.
+    UnigmaReadbackRequest counters;
+    counters.source = (uint64_t)globalIDCounterStorageBuffers;
+    counters.size = sizeof(uint32_t) * globalIDCounterSize;
+    counters.priority = UnigmaReadbackPriority::High;
+    counters.callback = [this](const void* data, uint64_t) {
+        uint32_t vertexCount = static_cast<const uint32_t*>(data)[1];
+        if (vertexCount == 0) {
+            std::cout << "No vertices generated in voxelization." << std::endl;
         }
-    }
-
-    if(vertexCount == 0) {
-		std::cout << "No vertices generated in voxelization." << std::endl;
-	}
-
-    readBackVertexCount = vertexCount;
+        readBackVertexCount = vertexCount;
+    };
+    app->readback.Enqueue(counters);
 
     // Pull per-brush vertex counts to CPU for post-DC TLAS instance build.
-    if (stagingBrushVerticesMemory != VK_NULL_HANDLE && BrushVerticesCount.size() >= maxBrushCapacity)
-    {
-        void* brushMapped = nullptr;
-        VkResult r = vkMapMemory(app->_logicalDevice, stagingBrushVerticesMemory, 0, sizeof(uint32_t) * maxBrushCapacity, 0, &brushMapped);
-        if (r == VK_SUCCESS && brushMapped != nullptr)
-        {
-            memcpy(BrushVerticesCount.data(), brushMapped, sizeof(uint32_t) * maxBrushCapacity);
-            vkUnmapMemory(app->_logicalDevice, stagingBrushVerticesMemory);
-        }
-        else
-        {
-            std::cout << "GetMeshFromGPU: brushVertices map failed (VkResult=" << r << ")." << std::endl;
-        }
-    }
+    //Copied out of the ring rather than straight into BrushVerticesCount, which may grow before this completes.
+    UnigmaReadbackRequest brushCounts;
+    brushCounts.source = (uint64_t)brushVerticesStorageBuffer;
+    brushCounts.size = sizeof(uint32_t) * maxBrushCapacity;
+    brushCounts.priority = UnigmaReadbackPriority::High;
+    brushCounts.callback = [this](const void* data, uint64_t size) {
+        if (BrushVerticesCount.size() * sizeof(uint32_t) >= size)
+            memcpy(BrushVerticesCount.data(), data, size);
+    };
+    app->readback.Enqueue(brushCounts);
 }
 
 void VoxelizerPass::CreateComputePipeline()
@@ -581,7 +499,7 @@ void VoxelizerPass::CreateShaderStorageBuffers()
 
     app->CreateBuffer(
         sizeof(Brush) * maxBrushCapacity,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         brushesStorageBuffers,
         brushesStorageMemory
@@ -670,6 +588,7 @@ void VoxelizerPass::CreateShaderStorageBuffers()
     app->CopyBuffer(stagingGlobalIDCounterBuffer, globalIDCounterStorageBuffers, sizeof(uint32_t)* globalIDCounterSize);
 
     BrushVerticesCount.resize(maxBrushCapacity, 0);
+    brushMeshGeneration.resize(maxBrushCapacity, 0);
     app->CreateBuffer(
         sizeof(uint32_t)* maxBrushCapacity,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
@@ -830,7 +749,7 @@ void VoxelizerPass::CreateShaderStorageBuffers()
     vkUnmapMemory(app->_logicalDevice, mbpStagingBufferMemory);
 
     app->CreateBuffer(materialBrushBufferSize,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         materialBrushPointsStorageBuffers, materialBrushPointsStorageMemory);
 
@@ -856,6 +775,7 @@ void VoxelizerPass::CreateShaderStorageBuffers()
         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
         VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
         VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
 
@@ -1600,6 +1520,10 @@ void VoxelizerPass::CreateBrushes()
     int vertexOffset = 0;
     int uniqueTextureCount = 0;
     std::unordered_map<int, int> batchTextureMap; // batchID -> imageIndex
+    //Brushes without a BatchID share automatically when they would cook to the same volume. Key -> first brush with it.
+    std::unordered_map<SDFBrushContentKey, int, SDFBrushContentKeyHasher> contentSources;
+    std::vector<std::vector<glm::vec3>> sourcePositions(renderingObjects.size());
+    brushInstanceSource.clear();
     for (int i = 0; i < renderingObjects.size(); i++)
     {
         UnigmaRenderingObject* obj = renderingObjects[i];
@@ -1620,8 +1544,31 @@ void VoxelizerPass::CreateBrushes()
 
         auto rayMask = gObj->GetComponentAttr<int>("RenderComp", "RayMask");
 
+        int instanceSource = -1;
+        if (batchID <= 0)
+        {
+            std::vector<glm::vec3> positions;
+            positions.reserve(obj->_renderer.vertices.size());
+            for (const auto& vertex : obj->_renderer.vertices)
+                positions.push_back(glm::vec3(vertex.pos));
+
+            SDFBrushContentKey key = SDFMakeBrushContentKey(primType, resolution, blend, positions);
+            auto found = contentSources.find(key);
+            if (found != contentSources.end() && SDFSamePositions(sourcePositions[found->second], positions))
+                instanceSource = found->second;
+            else if (found == contentSources.end())
+            {
+                contentSources[key] = i;
+                sourcePositions[i] = std::move(positions);
+            }
+        }
+
         int imageIndex;
-        if (batchID > 0 && batchTextureMap.count(batchID)) {
+        if (instanceSource >= 0) {
+            imageIndex = brushes[instanceSource].textureID;
+            std::cout << "Brush " << i << " instances brush " << instanceSource
+                      << " texture pair [" << imageIndex << ", " << imageIndex + 1 << "]" << std::endl;
+        } else if (batchID > 0 && batchTextureMap.count(batchID)) {
             imageIndex = batchTextureMap[batchID];
             std::cout << "Brush " << i << " shares batch " << batchID
                       << " texture pair [" << imageIndex << ", " << imageIndex + 1 << "]" << std::endl;
@@ -1701,11 +1648,28 @@ void VoxelizerPass::CreateBrushes()
 
         //Add the brush to the list.
         brushes.push_back(brush);
+        brushInstanceSource.push_back(instanceSource);
+
+        //Local bounds for the broadphase, same vertices getAABBWorld reads (unit sphere padded by blend otherwise).
+        SDFAABB localBounds;
+        for (const auto& vertex : obj->_renderer.vertices)
+            localBounds.Expand(glm::vec3(vertex.pos));
+        if (brush.type == 1 || !localBounds.IsValid())
+            localBounds = SDFAABB(glm::vec3(-1.0f - 2.0f * blend), glm::vec3(1.0f + 2.0f * blend));
+        brushLocalBounds.push_back(localBounds);
+        brushProxies.push_back(SDFDynamicAABBTree::NullNode);
 
         vertexOffset += brush.vertexCount;
 
     }
 
+    //Scene brushes take the first slots. The initial upload covers them, so they start clean.
+    brushPool.Reset(maxBrushCapacity, brushPoolChunk);
+    for (size_t i = 0; i < brushes.size(); i++)
+        brushPool.Allocate();
+    brushPool.TakeDirtyRanges();
+    maxBrushCapacity = brushPool.Capacity();
+
     //AddBrush(0, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), 128);
 }
 
@@ -2081,11 +2045,47 @@ void VoxelizerPass::CreateImages() {
 
 }
 
+//Refits the brush in the broadphase tree, which the cook scheduler and the TLAS read its world bounds from.
+void VoxelizerPass::UpdateBrushBounds(uint32_t brushIndex)
+{
+    SDFAABB world = TransformAABB(brushLocalBounds[brushIndex], brushes[brushIndex].model);
+    int32_t& proxy = brushProxies[brushIndex];
+
+    if (proxy == SDFDynamicAABBTree::NullNode)
+        proxy = brushTree.CreateProxy(world, brushIndex);
+    else
+        brushTree.MoveProxy(proxy, world, world.Center() - brushTree.GetTightAABB(proxy).Center());
+}
+
+//Bumps the mesh generation of the brush and of every brush it touches. The meshing pass contours the blended scene
+//field, so a brush changing also reshapes its neighbours where they meet. Called before and after a move, so both
+//the old and the new neighbours are caught.
+void VoxelizerPass::MarkBrushMeshChanged(uint32_t brushIndex)
+{
+    if (brushIndex >= brushMeshGeneration.size())
+        return;
+
+    brushMeshGeneration[brushIndex]++;
+    if (brushIndex >= brushProxies.size() || brushProxies[brushIndex] == SDFDynamicAABBTree::NullNode)
+        return;
+
+    brushTree.Query(brushTree.GetFatAABB(brushProxies[brushIndex]), [&](int32_t proxy) {
+        uint32_t other = brushTree.GetUserData(proxy);
+        if (other != brushIndex && other < brushMeshGeneration.size())
+            brushMeshGeneration[other]++;
+        return true;
+    });
+}
+
 void VoxelizerPass::UpdateBrushesGPU(VkCommandBuffer commandBuffer)
 {
     // Update CPU-side brushes first
     for (size_t i = 0; i < renderingObjects.size(); ++i)
     {
+        //Removed slots keep their inactive state until AddBrush reuses them.
+        if (!brushPool.IsSlotAlive((uint32_t)i))
+            continue;
+
         //Check if model has changed.
         glm::mat4x4 model = renderingObjects[i]->_transform.GetModelMatrixBrush();
 
@@ -2094,41 +2094,42 @@ void VoxelizerPass::UpdateBrushesGPU(VkCommandBuffer commandBuffer)
             brushes[i].model = model;
             brushes[i].invModel = glm::inverse(model);
             brushes[i].isDirty = 0;
+            brushPool.MarkDirty((uint32_t)i);
+            MarkBrushMeshChanged((uint32_t)i);
+            UpdateBrushBounds(i);
+            MarkBrushMeshChanged((uint32_t)i);
         }
     }
 
-    // Use vkCmdUpdateBuffer to update GPU buffer
-    for (size_t i = 0; i < brushes.size(); ++i)
+    //Only dirty slots are uploaded. The GPU owns the bounds and centre, so only the CPU side fields are written.
+    static_assert(offsetof(Brush, invModel) == offsetof(Brush, model) + sizeof(glm::mat4), "model and invModel are uploaded together");
+    for (const SDFSlotRange& range : brushPool.TakeDirtyRanges())
     {
-        VkDeviceSize offset = sizeof(Brush) * i + offsetof(Brush, model);
-
-        vkCmdUpdateBuffer(
-            commandBuffer,
-            brushesStorageBuffers,
-            offset,
-            sizeof(glm::mat4),
-            &brushes[i].model
-        );
+        for (uint32_t i = range.first; i < range.first + range.count; ++i)
+        {
+            //Added, removed or edited. Moves were marked above, removals in RemoveBrush while the proxy still existed.
+            MarkBrushMeshChanged(i);
 
-        offset = sizeof(Brush) * i + offsetof(Brush, invModel);
+            VkDeviceSize offset = sizeof(Brush) * i + offsetof(Brush, model);
 
-        vkCmdUpdateBuffer(
-            commandBuffer,
-            brushesStorageBuffers,
-            offset,
-            sizeof(glm::mat4),
-            &brushes[i].invModel
-        );
+            vkCmdUpdateBuffer(
+                commandBuffer,
+                brushesStorageBuffers,
+                offset,
+                2 * sizeof(glm::mat4),
+                &brushes[i].model
+            );
 
-        offset = sizeof(Brush) * i + offsetof(Brush, isDirty);
+            offset = sizeof(Brush) * i + offsetof(Brush, isDirty);
 
-        vkCmdUpdateBuffer(
-            commandBuffer,
-            brushesStorageBuffers,
-            offset,
-            sizeof(uint32_t),
-            &brushes[i].isDirty
-        );
+            vkCmdUpdateBuffer(
+                commandBuffer,
+                brushesStorageBuffers,
+                offset,
+                sizeof(uint32_t),
+                &brushes[i].isDirty
+            );
+        }
     }
 
     // Memory barrier after all updates
@@ -2211,6 +2212,8 @@ void VoxelizerPass::UpdateUniformBuffer(VkCommandBuffer commandBuffer, uint32_t
 
     ubo.view = glm::lookAt(CameraMain.position(), CameraMain.position() + CameraMain.forward(), CameraMain.up);
     ubo.proj = CameraMain.getProjectionMatrix();
+    cameraPosition = CameraMain.position();
+    cameraViewProj = ubo.proj * ubo.view;
 
     //print view matrix.
     //Update int array assignments.
@@ -2458,14 +2461,14 @@ void VoxelizerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFram
 
     UpdateBrushesGPU(commandBuffer);
 
-    if (GetKeyState('8') & 0x8000)
+    if (app->KeyDown('8'))
     {
         std::cout << "Starting readback" << std::endl;
         MaterialSimulation::instance->ReadBackMaterialGridSDF();
     }
 
     static bool wasPressed = false;
-    bool isPressed = (GetKeyState(VK_LBUTTON) & 0x8000) != 0;
+    bool isPressed = app->KeyDown(VK_LBUTTON);
     if (isPressed && !wasPressed)
     {
         int mx, my;
@@ -2571,68 +2574,43 @@ void VoxelizerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFram
     
     uint64_t voxelCount = 0;
     uint64_t particleCount = 0;
+    //Scene brushes are cooked through brushScheduler like the ones AddBrush places, so a large scene spreads its voxelization
+    //over frames within the cooking budget, nearest visible brushes first.
     if (BrushesCreated > 0)
     {
-        auto start = std::chrono::high_resolution_clock::now();
         DispatchLOD(commandBuffer, currentFrame, 0); //Clear.
 
-        //Write information to volume texture. LOD level acts as which volume texture to write to.
-
-        for(uint32_t i = 0; i < brushes.size(); i++)
+        for (uint32_t i = 0; i < brushes.size(); i++)
 		{
-            uint32_t index = brushes[i].textureID;
+            processedTextureIndexMap.insert(brushes[i].textureID);
 
-            if(processedTextureIndexMap.find(index) != processedTextureIndexMap.end()) {
-				//Already processed this texture — but still dispatch for aabb computation.
-			}
-            else {
-                processedTextureIndexMap.insert(index);
+            //Bounds give the scheduler a camera distance and let the TLAS place the brush before it ever moves.
+            if (brushPool.IsSlotAlive(i))
+                UpdateBrushBounds(i);
+
+            //Instances share their source's volume; DispatchBrushInstances fills in the rest once it is cooked.
+            if (i < brushInstanceSource.size() && brushInstanceSource[i] >= 0)
+            {
+                brushInstancesPending = true;
+                continue;
             }
 
             if (brushes[i].type >= 0) { //Mesh type
-
-                DispatchBrushCreation(commandBuffer, currentFrame, i);
+                brushScheduler.Enqueue(i, brushes[i].type, brushes[i].resolution, (brushes[i].resolution + 7) / 8);
 
                 //Sum voxels.
                 voxelCount += (uint64_t)(brushes[i].resolution * brushes[i].resolution * brushes[i].resolution);
-
             }
 		}
         particleCount += voxelCount / 8; //Estimate particles.
 
-        // Barrier: brush SDF texture writes must complete before fill reads them.
-        VkMemoryBarrier2 sdfBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
-        sdfBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
-        sdfBarrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
-        sdfBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
-        sdfBarrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
-        VkDependencyInfo sdfDep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
-        sdfDep.memoryBarrierCount = 1;
-        sdfDep.pMemoryBarriers    = &sdfBarrier;
-        vkCmdPipelineBarrier2(commandBuffer, &sdfDep);
-
-        // Assign quanta to each newly-created brush via tile acceleration structure.
-        for (uint32_t i = 0; i < brushes.size(); i++)
-        {
-            /*
-            if (brushes[i].type >= 0)
-            {
-                MaterialSimulation::instance->DispatchBrushFill(commandBuffer, i);
-            }
-            */
-        }
-
-        auto stop = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
-
-        // Print the duration
-        std::cout << "Brush creation took: " << duration.count() << " milliseconds" << std::endl;
-        std::cout << "Brushes Processed: " << processedTextureIndexMap.size() << std::endl;
-        std::cout << "Total Voxels Created: " << voxelCount << std::endl;
+        std::cout << "Brushes queued for cooking: " << brushScheduler.Jobs().size() << std::endl;
+        std::cout << "Total Voxels Queued: " << voxelCount << std::endl;
         std::cout << "Estimated Particles Created: " << particleCount << std::endl;
 
         //DispatchParticleCreation(commandBuffer, currentFrame, 0); //Create particles.
-        BrushesCreated--;
+        //Enqueue restarts a job, so the scene is only queued once.
+        BrushesCreated = 0;
     }
     //Deform brush
     if (dispatchCount > 3)
@@ -2653,9 +2631,22 @@ void VoxelizerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFram
 	}
     //UpdateBrushesTextureIds(commandBuffer);
 
-    // Incremental brush creation for dynamically added brushes.
+    // Incremental brush creation for scene and dynamically added brushes.
     DispatchBrushCreationIncremental(commandBuffer, currentFrame);
 
+    //Instances copy their source's cooked volume, so they wait until no source is still queued.
+    if (brushInstancesPending)
+    {
+        bool sourceQueued = false;
+        for (const SDFBrushJob& job : brushScheduler.Jobs())
+            sourceQueued = sourceQueued || std::find(brushInstanceSource.begin(), brushInstanceSource.end(), job.brushIndex) != brushInstanceSource.end();
+        if (!sourceQueued)
+        {
+            DispatchBrushInstances(commandBuffer, currentFrame);
+            brushInstancesPending = false;
+        }
+    }
+
     if(dispatchCount > 1)
 	{
         // Zero the position buffer so un-emitted slots are degenerate triangles.
@@ -2685,7 +2676,12 @@ void VoxelizerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFram
             for (uint32_t j = 0; j < occupancyBrushesPerFrame; j++)
             {
                 int idx = (occupancyRollingIndex + j) % brushes.size();
-                DispatchBrushOccupancy(commandBuffer, currentFrame, idx);
+                if (brushPool.IsSlotAlive(idx))
+                {
+                    //Occupancy erodes the brush's material points, which the meshing pass reads.
+                    DispatchBrushOccupancy(commandBuffer, currentFrame, idx);
+                    MarkBrushMeshChanged(idx);
+                }
             }
             occupancyRollingIndex = (occupancyRollingIndex + occupancyBrushesPerFrame) % brushes.size();
         }
@@ -2700,6 +2696,13 @@ void VoxelizerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFram
         //Smoothing Kernel Pass
         //DispatchLOD(commandBuffer, currentFrame, 10);
 
+        if (app->GeneratedMeshSmoothness != meshedSmoothness)
+        {
+            for (uint32_t& generation : brushMeshGeneration)
+                generation++;
+            meshedSmoothness = app->GeneratedMeshSmoothness;
+        }
+
         if (app->GeneratedMeshSmoothness > 0)
         {
             VkMemoryBarrier2 memBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
@@ -2790,6 +2793,7 @@ void VoxelizerPass::Dispatch(VkCommandBuffer commandBuffer, uint32_t currentFram
 
         //Finalize Mesh.
         DispatchLOD(commandBuffer, currentFrame, 100);
+        meshGenerations[currentFrame % 2] = brushMeshGeneration;
 
         //Mips
         DispatchLOD(commandBuffer, currentFrame, 2);
@@ -3189,37 +3193,66 @@ void VoxelizerPass::ReadCounterOnCPU()
 }
 
 
-void VoxelizerPass::DispatchBrushCreation(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t lodLevel)
+void VoxelizerPass::CreateBrushCookTimer()
 {
     QTDoughApplication* app = QTDoughApplication::instance;
 
-    //Get the volume texture from the lodlevel.
-    Brush brush = brushes[lodLevel];
+    VkPhysicalDeviceProperties devProps{};
+    vkGetPhysicalDeviceProperties(app->_physicalDevice, &devProps);
+    brushCookTimestampPeriod = devProps.limits.timestampPeriod;
+    brushCookInFlight.resize(app->MAX_FRAMES_IN_FLIGHT);
 
-    std::cout << "Brush resolution and ID: " << lodLevel << " , " << brush.resolution << std::endl;
+    if (brushCookTimestampPeriod == 0.0f)
+    {
+        std::cout << "GPU timestamps not supported, brush cooking stays on estimated costs." << std::endl;
+        return;
+    }
 
-    uint32_t resolutionx = brush.resolution;
-    uint32_t resolutiony = brush.resolution;
-    uint32_t resolutionz = brush.resolution;
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2 * app->MAX_FRAMES_IN_FLIGHT;
+    VK_CHECK(vkCreateQueryPool(app->_logicalDevice, &queryPoolInfo, nullptr, &brushCookQueryPool));
+}
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, voxelizeComputePipeline);
+//The frame slot's fence has been waited on by the time it records again, so its timestamps are normally there already.
+//If not, the sample is dropped rather than stalling the frame.
+void VoxelizerPass::ReadBrushCookTimings(uint32_t currentFrame)
+{
+    std::vector<SDFBrushSlice>& slices = brushCookInFlight[currentFrame];
+    if (slices.empty() || brushCookQueryPool == VK_NULL_HANDLE)
+    {
+        slices.clear();
+        return;
+    }
 
-    PushConsts pc{};
-    pc.lod = 8;
-    pc.triangleCount = lodLevel;
-    pc.voxelResolution = glm::vec4(WORLD_SDF_RESOLUTION.x, WORLD_SDF_RESOLUTION.y, WORLD_SDF_RESOLUTION.z, 0);
-    pc.aabbCenter = glm::vec4(0, 0, 0, 0);
-    pc.supportMultiplier = supportMultiplier;
-    pc.viewMode = (int)QTDoughApplication::instance->editorState.viewMode;
+    QTDoughApplication* app = QTDoughApplication::instance;
+    uint64_t results[4]; //Timestamp and availability for begin and end.
+    VkResult result = vkGetQueryPoolResults(app->_logicalDevice, brushCookQueryPool, currentFrame * 2, 2,
+        sizeof(results), results, sizeof(uint64_t) * 2,
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
 
-    vkCmdPushConstants(
-        commandBuffer,
-        voxelizeComputePipelineLayout,
-        VK_SHADER_STAGE_COMPUTE_BIT,
-        0,
-        sizeof(PushConsts),
-        &pc
-    );
+    if (result == VK_SUCCESS && results[1] != 0 && results[3] != 0 && results[2] >= results[0])
+    {
+        double ms = double(results[2] - results[0]) * double(brushCookTimestampPeriod) * 1e-6;
+        brushScheduler.ReportFrame(slices, float(ms));
+    }
+    slices.clear();
+}
+
+//Per-brush state for brushes sharing a cooked volume: bounds, cage and the coarse material grid, copied or derived from
+//the source brush instead of re-running the per-voxel cook. Must run after the sources' CreateBrush writes are visible.
+void VoxelizerPass::DispatchBrushInstances(VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+    bool any = false;
+    for (int source : brushInstanceSource)
+        any = any || source >= 0;
+    if (!any)
+        return;
+
+    QTDoughApplication* app = QTDoughApplication::instance;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, voxelizeComputePipeline);
 
     VkDescriptorSet sets[] = {
         app->globalDescriptorSets[currentFrame],
@@ -3232,21 +3265,80 @@ void VoxelizerPass::DispatchBrushCreation(VkCommandBuffer commandBuffer, uint32_
         0, 2, sets,
         0, nullptr);
 
-    uint32_t groupCountX = (resolutionx + 7) / 8;
-    uint32_t groupCountY = (resolutiony + 7) / 8;
-    uint32_t groupCountZ = (resolutionz + 7) / 8;
+    uint32_t gridGroups = (MATERIAL_BRUSH_GRID_RES + 7) / 8;
+    for (uint32_t i = 0; i < brushInstanceSource.size(); i++)
+    {
+        if (brushInstanceSource[i] < 0)
+            continue;
 
+        PushConsts pc{};
+        pc.lod = 27;
+        pc.triangleCount = i;
+        pc.voxelResolution = glm::vec4(WORLD_SDF_RESOLUTION.x, WORLD_SDF_RESOLUTION.y, WORLD_SDF_RESOLUTION.z, brushInstanceSource[i]);
+        pc.aabbCenter = glm::vec4(0, 0, 0, 0);
+        pc.supportMultiplier = supportMultiplier;
+        pc.viewMode = (int)QTDoughApplication::instance->editorState.viewMode;
 
-    vkCmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+        vkCmdPushConstants(
+            commandBuffer,
+            voxelizeComputePipelineLayout,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0, sizeof(PushConsts), &pc);
+
+        vkCmdDispatch(commandBuffer, gridGroups, gridGroups, gridGroups);
+        MarkBrushMeshChanged(i);
+    }
+
+    VkMemoryBarrier2 barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    barrier.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+    VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &barrier;
+    vkCmdPipelineBarrier2(commandBuffer, &dep);
+}
+
+//True when another live brush samples the same volume textures.
+bool VoxelizerPass::SharesBrushVolume(int brushIndex) const
+{
+    for (uint32_t i = 0; i < brushes.size(); i++)
+        if ((int)i != brushIndex && brushPool.IsSlotAlive(i) && brushes[i].textureID == brushes[brushIndex].textureID)
+            return true;
+    return false;
 }
 
 void VoxelizerPass::DispatchBrushCreationIncremental(VkCommandBuffer commandBuffer, uint32_t currentFrame)
 {
-    if (incrementalBrushJobs.empty())
+    if (brushCookInFlight.empty())
+        CreateBrushCookTimer();
+    ReadBrushCookTimings(currentFrame);
+
+    if (brushScheduler.Empty())
         return;
 
     QTDoughApplication* app = QTDoughApplication::instance;
 
+    //Rank queued brushes by distance to their bounds and whether they are on screen. Brushes without a proxy yet
+    //keep the defaults (close and visible), so a freshly placed brush cooks first.
+    SDFFrustum frustum = SDFFrustum::FromMatrix(cameraViewProj);
+    std::vector<int> queued;
+    for (const SDFBrushJob& job : brushScheduler.Jobs())
+        queued.push_back(job.brushIndex);
+    for (int brushIndex : queued)
+    {
+        if (brushIndex >= (int)brushProxies.size() || brushProxies[brushIndex] == SDFDynamicAABBTree::NullNode)
+            continue;
+        const SDFAABB& bounds = brushTree.GetTightAABB(brushProxies[brushIndex]);
+        float distance = glm::length(cameraPosition - glm::clamp(cameraPosition, bounds.min, bounds.max));
+        brushScheduler.SetView(brushIndex, distance, frustum.Intersects(bounds));
+    }
+
+    std::vector<SDFBrushSlice> slices = brushScheduler.Plan();
+    if (slices.empty())
+        return;
+
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, voxelizeComputePipeline);
 
     VkDescriptorSet sets[] = {
@@ -3260,20 +3352,24 @@ void VoxelizerPass::DispatchBrushCreationIncremental(VkCommandBuffer commandBuff
         0, 2, sets,
         0, nullptr);
 
-    for (auto& job : incrementalBrushJobs)
+    if (brushCookQueryPool != VK_NULL_HANDLE)
     {
-        Brush& brush = brushes[job.brushIndex];
-        uint32_t groupXY = (brush.resolution + 7) / 8;
+        vkCmdResetQueryPool(commandBuffer, brushCookQueryPool, currentFrame * 2, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, brushCookQueryPool, currentFrame * 2);
+    }
 
-        int sliceZ = std::min(job.groupsPerFrame, job.totalZGroups - job.currentZGroup);
+    for (const SDFBrushSlice& slice : slices)
+    {
+        Brush& brush = brushes[slice.brushIndex];
+        uint32_t groupXY = (brush.resolution + 7) / 8;
 
         PushConsts pc{};
         pc.lod = 8;
-        pc.triangleCount = job.brushIndex;
+        pc.triangleCount = slice.brushIndex;
         pc.voxelResolution = glm::vec4(WORLD_SDF_RESOLUTION.x, WORLD_SDF_RESOLUTION.y, WORLD_SDF_RESOLUTION.z, 0);
         pc.aabbCenter = glm::vec4(0, 0, 0, 0);
         pc.supportMultiplier = supportMultiplier;
-    pc.viewMode = (int)QTDoughApplication::instance->editorState.viewMode;
+        pc.viewMode = (int)QTDoughApplication::instance->editorState.viewMode;
 
         vkCmdPushConstants(
             commandBuffer,
@@ -3281,9 +3377,14 @@ void VoxelizerPass::DispatchBrushCreationIncremental(VkCommandBuffer commandBuff
             VK_SHADER_STAGE_COMPUTE_BIT,
             0, sizeof(PushConsts), &pc);
 
-        vkCmdDispatchBase(commandBuffer, 0, 0, job.currentZGroup, groupXY, groupXY, sliceZ);
+        vkCmdDispatchBase(commandBuffer, 0, 0, slice.firstSlice, groupXY, groupXY, slice.sliceCount);
+        MarkBrushMeshChanged(slice.brushIndex);
+    }
 
-        job.currentZGroup += sliceZ;
+    if (brushCookQueryPool != VK_NULL_HANDLE)
+    {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, brushCookQueryPool, currentFrame * 2 + 1);
+        brushCookInFlight[currentFrame] = slices;
     }
 
     // Barrier after all incremental writes.
@@ -3296,12 +3397,6 @@ void VoxelizerPass::DispatchBrushCreationIncremental(VkCommandBuffer commandBuff
     dep.memoryBarrierCount = 1;
     dep.pMemoryBarriers    = &barrier;
     vkCmdPipelineBarrier2(commandBuffer, &dep);
-
-    // Remove completed jobs.
-    incrementalBrushJobs.erase(
-        std::remove_if(incrementalBrushJobs.begin(), incrementalBrushJobs.end(),
-            [](const IncrementalBrushJob& j) { return j.currentZGroup >= j.totalZGroups; }),
-        incrementalBrushJobs.end());
 }
 
 void VoxelizerPass::DispatchParticleCreation(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t lodLevel)
@@ -3952,19 +4047,31 @@ void VoxelizerPass::BindVoxelBuffers(uint32_t curFrame, uint32_t prevFrame, bool
 void VoxelizerPass::ReadBackGPUData()
 {
     ReadCounterOnCPU();
+
+    //The counter readback leaves the device idle, so growing here costs no extra wait.
+    if (brushPool.Capacity() > maxBrushCapacity)
+        GrowBrushCapacity(brushPool.Capacity());
 }
 
 int VoxelizerPass::AddBrush(uint32_t type, glm::vec3 position, glm::vec3 scale, int resolution,
                              float blend, float smoothness, uint32_t opcode,
                              int density, float stiffness)
 {
-    if (brushes.size() >= maxBrushCapacity) {
-        std::cout << "AddBrush: capacity exceeded (" << maxBrushCapacity << ")" << std::endl;
-        return -1;
-    }
-
-    int index = static_cast<int>(brushes.size());
-    int imageIndex = (index * 2) + mipsCount;
+    //Removed slots are reused first. The pool keeps headroom, so the slot still fits the current buffers and growth
+    //waits for ReadBackGPUData. Only a burst of adds that eats the whole headroom within one frame grows here.
+    SDFBrushHandle handle = brushPool.Allocate();
+    if (handle.slot >= maxBrushCapacity)
+        GrowBrushCapacity(brushPool.Capacity());
+
+    const uint32_t brushResolution = 64;
+    int index = static_cast<int>(handle.slot);
+    bool reused = index < static_cast<int>(brushes.size());
+    //A reused slot keeps its volume when the resolution matches and no other brush samples it; cooking into a shared
+    //volume would overwrite theirs.
+    bool newTextures = !reused || SharesBrushVolume(index) || brushes[index].resolution != brushResolution;
+    QTDoughApplication* app = QTDoughApplication::instance;
+    //Scene brushes can share volumes, so slots and texture IDs do not line up. New textures take the next free IDs.
+    int imageIndex = newTextures ? static_cast<int>(app->textures3D.size()) : static_cast<int>(brushes[index].textureID);
 
     Brush brush{};
     brush.type = 1;
@@ -3972,7 +4079,7 @@ int VoxelizerPass::AddBrush(uint32_t type, glm::vec3 position, glm::vec3 scale,
     brush.vertexOffset = 0;
     brush.textureID = imageIndex;
     brush.textureID2 = imageIndex + 1;
-    brush.resolution = 64;
+    brush.resolution = brushResolution;
     brush.id = index + 1;
     brush.opcode = opcode;
     brush.blend = blend;
@@ -3995,13 +4102,27 @@ int VoxelizerPass::AddBrush(uint32_t type, glm::vec3 position, glm::vec3 scale,
     brush.model = t.GetModelMatrix();
     brush.invModel = glm::inverse(brush.model);
 
-    brushes.push_back(brush);
+    SDFAABB localBounds(glm::vec3(-1.0f - 2.0f * blend), glm::vec3(1.0f + 2.0f * blend));
+    if (reused)
+    {
+        brushes[index] = brush;
+        brushLocalBounds[index] = localBounds;
+        brushInstanceSource[index] = -1;
+    }
+    else
+    {
+        brushes.push_back(brush);
+        brushLocalBounds.push_back(localBounds);
+        brushProxies.push_back(SDFDynamicAABBTree::NullNode);
+        brushInstanceSource.push_back(-1);
+    }
+    UpdateBrushBounds(index);
 
     // Create the 2 volume textures for this brush.
-    CreateBrushTextures(index);
+    if (newTextures)
+        CreateBrushTextures(index);
 
     // Upload the new brush to the GPU buffer at the correct offset.
-    QTDoughApplication* app = QTDoughApplication::instance;
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingMemory;
     app->CreateBuffer(
@@ -4028,22 +4149,161 @@ int VoxelizerPass::AddBrush(uint32_t type, glm::vec3 position, glm::vec3 scale,
     vkFreeMemory(app->_logicalDevice, stagingMemory, nullptr);
 
     // Rebuild bindless descriptor set so new brush textures are bound before any dispatch.
-    app->UpdateGlobalDescriptorSet();
+    if (newTextures)
+        app->UpdateGlobalDescriptorSet();
 
     // Mark as already processed so the startup creation block skips this brush.
-    processedTextureIndexMap.insert(index);
+    processedTextureIndexMap.insert(brush.textureID);
 
-    // Queue incremental creation over ~10 frames.
-    int totalZ = (brush.resolution + 7) / 8;
-    int groupsPerFrame = std::max(1, (totalZ + 9) / 10);
-    incrementalBrushJobs.push_back({ index, 0, totalZ, groupsPerFrame });
+    // Queue incremental creation, one z-group slice at a time within the cooking budget.
+    uint32_t totalZ = (brush.resolution + 7) / 8;
+    brushScheduler.Enqueue(index, type, brush.resolution, totalZ);
 
     std::cout << "AddBrush: added brush " << index << " type=" << type
-              << " at (" << position.x << "," << position.y << "," << position.z << ")" << std::endl;
+              << " at (" << position.x << "," << position.y << "," << position.z << ")"
+              << (reused ? " (reused slot)" : "") << std::endl;
 
     return index;
 }
 
+//Frees the slot for reuse. The slot stays in the arrays marked inactive (isDirty 2) and leaves the broadphase, so tile
+//binning, occupancy and the material passes skip it until AddBrush hands it out again.
+bool VoxelizerPass::RemoveBrush(SDFBrushHandle handle)
+{
+    if (!brushPool.IsAlive(handle))
+        return false;
+
+    uint32_t slot = handle.slot;
+    Brush& brush = brushes[slot];
+    brush.isDirty = 2;
+    brush.isCollapsing = 0;
+    brush.rayMask = 0;
+
+    //The neighbours lose the blend with this brush.
+    MarkBrushMeshChanged(slot);
+    if (brushProxies[slot] != SDFDynamicAABBTree::NullNode)
+    {
+        brushTree.DestroyProxy(brushProxies[slot]);
+        brushProxies[slot] = SDFDynamicAABBTree::NullNode;
+    }
+    brushScheduler.Cancel((int)slot);
+
+    //Marks the slot dirty, UpdateBrushesGPU uploads the inactive state.
+    brushPool.Free(handle);
+    std::cout << "RemoveBrush: removed brush " << slot << std::endl;
+    return true;
+}
+
+//Moves every buffer indexed by brush slot to newCapacity slots, keeping the contents. Normally called from
+//ReadBackGPUData on an already idle device; AddBrush only calls it when a burst of adds ran out of headroom.
+void VoxelizerPass::GrowBrushCapacity(uint32_t newCapacity)
+{
+    QTDoughApplication* app = QTDoughApplication::instance;
+    if (newCapacity <= maxBrushCapacity)
+        return;
+
+    std::cout << "VoxelizerPass: growing brush capacity " << maxBrushCapacity << " -> " << newCapacity << std::endl;
+
+    //Descriptor sets of every frame in flight reference the old buffers.
+    vkDeviceWaitIdle(app->_logicalDevice);
+
+    struct Retired { VkBuffer buffer; VkDeviceMemory memory; };
+    std::vector<Retired> retired;
+    VkCommandBuffer cmd = app->BeginSingleTimeCommands();
+
+    auto grow = [&](VkBuffer& buffer, VkDeviceMemory& memory, VkDeviceSize elementSize, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+        VkBuffer newBuffer;
+        VkDeviceMemory newMemory;
+        app->CreateBuffer(elementSize * newCapacity, usage, properties, newBuffer, newMemory);
+
+        VkBufferCopy region{ 0, 0, elementSize * maxBrushCapacity };
+        vkCmdCopyBuffer(cmd, buffer, newBuffer, 1, &region);
+        vkCmdFillBuffer(cmd, newBuffer, region.size, elementSize * (newCapacity - maxBrushCapacity), 0);
+
+        retired.push_back({ buffer, memory });
+        buffer = newBuffer;
+        memory = newMemory;
+    };
+
+    const VkBufferUsageFlags deviceUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    const VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    uint32_t materialBrushGridSize = MATERIAL_BRUSH_GRID_RES * MATERIAL_BRUSH_GRID_RES * MATERIAL_BRUSH_GRID_RES;
+
+    grow(brushesStorageBuffers, brushesStorageMemory, sizeof(Brush), deviceUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    grow(brushVerticesStorageBuffer, brushVerticesStorageMemory, sizeof(uint32_t), deviceUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    for (int p = 0; p < 2; ++p)
+        grow(brushVertexOffsetsBuffers[p], brushVertexOffsetsMemories[p], sizeof(uint32_t), deviceUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    grow(brushWriteCursorsBuffer, brushWriteCursorsMemory, sizeof(uint32_t), deviceUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    grow(materialBrushPointsStorageBuffers, materialBrushPointsStorageMemory, sizeof(MaterialBrushPoint) * materialBrushGridSize,
+        deviceUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    grow(stagingBrushVerticesBuffer, stagingBrushVerticesMemory, sizeof(uint32_t), stagingUsage, hostVisible);
+    grow(stagingBrushVertexOffsetsBuffer, stagingBrushVertexOffsetsMemory, sizeof(uint32_t), stagingUsage, hostVisible);
+
+    app->EndSingleTimeCommands(cmd);
+
+    for (const Retired& r : retired)
+    {
+        vkDestroyBuffer(app->_logicalDevice, r.buffer, nullptr);
+        vkFreeMemory(app->_logicalDevice, r.memory, nullptr);
+    }
+
+    maxBrushCapacity = newCapacity;
+    BrushVerticesCount.resize(maxBrushCapacity, 0);
+    BrushVertexOffsets.resize(maxBrushCapacity, 0);
+    brushMeshGeneration.resize(maxBrushCapacity, 0);
+    RebindBrushBuffers();
+}
+
+//Points every descriptor that reads a brush indexed buffer at the current handles.
+void VoxelizerPass::RebindBrushBuffers()
+{
+    QTDoughApplication* app = QTDoughApplication::instance;
+
+    for (size_t i = 0; i < computeDescriptorSets.size(); i++)
+    {
+        VkDescriptorBufferInfo infos[5] = {
+            { brushesStorageBuffers, 0, VK_WHOLE_SIZE },
+            { materialBrushPointsStorageBuffers, 0, VK_WHOLE_SIZE },
+            { brushVerticesStorageBuffer, 0, VK_WHOLE_SIZE },
+            { brushVertexOffsetsBuffers[i % 2], 0, VK_WHOLE_SIZE },
+            { brushWriteCursorsBuffer, 0, VK_WHOLE_SIZE },
+        };
+        const uint32_t bindings[5] = { 9, 23, 25, 26, 27 };
+
+        VkWriteDescriptorSet writes[5]{};
+        for (int w = 0; w < 5; w++)
+        {
+            writes[w].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[w].dstSet = computeDescriptorSets[i];
+            writes[w].dstBinding = bindings[w];
+            writes[w].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[w].descriptorCount = 1;
+            writes[w].pBufferInfo = &infos[w];
+        }
+        vkUpdateDescriptorSets(app->_logicalDevice, 5, writes, 0, nullptr);
+    }
+
+    for (VkDescriptorSet set : sweepSets)
+    {
+        VkDescriptorBufferInfo brushInfo{ brushesStorageBuffers, 0, VK_WHOLE_SIZE };
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = 9;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &brushInfo;
+        vkUpdateDescriptorSets(app->_logicalDevice, 1, &write, 0, nullptr);
+    }
+
+    //Passes that bind the brush buffer in their own sets.
+    if (MaterialSimulation::instance)
+        MaterialSimulation::instance->RebindBrushBuffer(brushesStorageBuffers);
+    for (RenderPassObject* pass : app->renderPassStack)
+        pass->RebindBrushBuffer(brushesStorageBuffers);
+}
+
 void VoxelizerPass::CreateBrushTextures(int brushIndex)
 {
     QTDoughApplication* app = QTDoughApplication::instance;
@@ -4055,10 +4315,10 @@ void VoxelizerPass::CreateBrushTextures(int brushIndex)
         VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
     );
 
-    // Each brush gets 2 volume textures (ping-pong pair).
+    // Each brush gets 2 volume textures (ping-pong pair), created at brush.textureID and textureID2.
     for (int t = 0; t < 2; t++)
     {
-        int texIndex = brushIndex * 2 + t + mipsCount; // match AddBrush
+        int texIndex = brush.textureID + t; // match AddBrush
 
 
         Unigma3DTexture brushTexture = Unigma3DTexture(brush.resolution, brush.resolution, brush.resolution);
@@ -5,6 +5,10 @@
 #include "../Camera/UnigmaCamera.h"
 #include "ComputePass.h"
 #include "../Physics/MaterialSimulationPass.h"
+#include "../SDF/SDFDynamicTree.h"
+#include "../SDF/SDFBrushPool.h"
+#include "../SDF/SDFBrushScheduler.h"
+#include "../SDF/SDFContentHash.h"
 
 class VoxelizerPass : public ComputePass
 {
@@ -155,10 +159,21 @@ public:
     //This is the list of brushes. Brushes are basically gameObjects with a model matrix.
     //Some fields only updated once per generation which can take multiple frames. However, the vector itself updates every frame.
     std::vector<Brush> brushes;
-    uint32_t maxBrushCapacity = 256; // Pre-allocated GPU buffer capacity for dynamic brush addition.
+    uint32_t maxBrushCapacity = 256; // GPU buffer capacity in brushes. Follows brushPool.Capacity(), see GrowBrushCapacity().
     VkBuffer brushesStorageBuffers;
     VkDeviceMemory brushesStorageMemory;
 
+    //Slot bookkeeping for brushes: handles, free-list of removed slots, chunked capacity and dirty ranges for upload.
+    SDFBrushPool brushPool;
+    uint32_t brushPoolChunk = 256;
+
+    //Broadphase over brush world bounds, read by the cook scheduler and the ray tracer's TLAS. Refit in UpdateBrushesGPU.
+    SDFDynamicAABBTree brushTree;
+    std::vector<int32_t> brushProxies;
+    std::vector<SDFAABB> brushLocalBounds;
+    //Brush whose volume this one shares because their content keys matched (see CreateBrushes), -1 when it cooks its own.
+    std::vector<int> brushInstanceSource;
+
     //This is the list of tiles. Tiles are basically a collection of brushes.
     std::vector<uint32_t> BrushesIndices;
     VkBuffer brushIndicesStorageBuffers;
@@ -197,6 +212,12 @@ public:
     VkBuffer stagingBrushVertexOffsetsBuffer;
     VkDeviceMemory stagingBrushVertexOffsetsMemory;
     std::vector<uint32_t> BrushVertexOffsets;
+    //Per-brush count of changes to what the meshing pass emits for it, so the ray tracer rebuilds a BLAS only when
+    //its mesh changed. Bumped by MarkBrushMeshChanged.
+    std::vector<uint32_t> brushMeshGeneration;
+    //brushMeshGeneration as it stood when meshingVertexBuffers[i] was last written.
+    std::vector<uint32_t> meshGenerations[2];
+    int meshedSmoothness = -1; //GeneratedMeshSmoothness of the last meshing pass. Changing it reshapes every brush.
     //Per-brush write cursor used by DC pass 2 to claim slots within the brush's slice.
     VkBuffer brushWriteCursorsBuffer;
     VkDeviceMemory brushWriteCursorsMemory;
@@ -263,8 +284,11 @@ public:
     void CreateImages() override;
     void Create3DTextures();
     void CreateBrushes();
-    void DispatchBrushCreation(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t lodLevel);
     void UpdateBrushesGPU(VkCommandBuffer commandBuffer);
+    void UpdateBrushBounds(uint32_t brushIndex);
+    void MarkBrushMeshChanged(uint32_t brushIndex);
+    void GrowBrushCapacity(uint32_t newCapacity);
+    void RebindBrushBuffers();
     void BindVoxelBuffers(uint32_t curFrame, uint32_t prevFrame, bool pingFlag);
     void CreateSweepDescriptorSets();
     void PerformEikonalSweeps(VkCommandBuffer cmd, uint32_t curFrame);
@@ -284,8 +308,14 @@ public:
     int AddBrush(uint32_t type, glm::vec3 position, glm::vec3 scale, int resolution,
                   float blend = 0.0225f, float smoothness = 0.1f, uint32_t opcode = 0,
                   int density = 3, float stiffness = 1.0f);
+    bool RemoveBrush(SDFBrushHandle handle);
+    SDFBrushHandle GetBrushHandle(int brushIndex) const { return brushPool.HandleForSlot((uint32_t)brushIndex); }
     void CreateBrushTextures(int brushIndex);
     void DispatchBrushCreationIncremental(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+    void DispatchBrushInstances(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+    bool SharesBrushVolume(int brushIndex) const;
+    void CreateBrushCookTimer();
+    void ReadBrushCookTimings(uint32_t currentFrame);
     glm::ivec3 SetVoxelGridSize();
     std::vector<Triangle> ExtractTrianglesFromMeshFromTriplets(const std::vector<ComputeVertex>& vertices, const std::vector<glm::uvec3>& triangleIndices);
 
@@ -345,17 +375,19 @@ public:
     VkSampler wu_sampler;
 
     bool VolumeTexturesCreated = false;
-    int BrushesCreated = 2;
+    int BrushesCreated = 1; //Queues the scene's brushes on the first frame.
+    bool brushInstancesPending = false; //Scene instances waiting for their sources to finish cooking.
     std::set<uint32_t> processedTextureIndexMap;
     int mipsCount = 5;
 
-    struct IncrementalBrushJob {
-        int brushIndex;
-        int currentZGroup;
-        int totalZGroups;
-        int groupsPerFrame;
-    };
-    std::vector<IncrementalBrushJob> incrementalBrushJobs;
+    //Brushes still being cooked. Each frame runs as many z-slices as fit in brushScheduler.frameBudgetMs, nearest visible
+    //brushes first, and the measured GPU time of the batch trains the scheduler's cost model.
+    SDFBrushScheduler brushScheduler;
+    VkQueryPool brushCookQueryPool = VK_NULL_HANDLE; //Two timestamps per frame in flight around the cooking dispatches.
+    float brushCookTimestampPeriod = 0.0f; //Nanoseconds per tick, 0 when timestamps are unsupported.
+    std::vector<std::vector<SDFBrushSlice>> brushCookInFlight; //Slices recorded per frame slot, reported once its timestamps land.
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    glm::mat4 cameraViewProj = glm::mat4(1.0f);
     uint32_t readBackVertexCount = 0;
 
     VkBuffer indirectDrawBuffer;
@@ -0,0 +1,810 @@
+#include "UnigmaDeviceMemory.h"
+#include <algorithm>
+#include <bit>
+#include <set>
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        alignment = std::max<uint64_t>(alignment, 1);
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    //Free ranges are kept in lists by size class: the first level is the power of two below the size, the second splits
+    //that range into SLCount equal parts. Bitmaps of the non-empty lists make finding a fitting range two bit scans.
+    class TLSFMetadata : public UnigmaBlockMetadata
+    {
+    public:
+        explicit TLSFMetadata(uint64_t size) : heads(FLCount * SLCount, None), slBitmaps(FLCount, 0), freeBytes(size)
+        {
+            Node node;
+            node.size = size;
+            nodes.push_back(node);
+            InsertFree(0);
+        }
+
+        bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset) override
+        {
+            size = std::max<uint64_t>(size, 1);
+            uint32_t index = Search(size);
+            if (index == None || !Fits(index, size, alignment))
+                index = alignment > 1 ? Search(size + alignment - 1) : None;
+            if (index == None || !Fits(index, size, alignment))
+                return false;
+
+            RemoveFree(index);
+            uint64_t aligned = AlignUp(nodes[index].offset, alignment);
+            if (aligned > nodes[index].offset)
+                InsertFree(SplitFront(index, aligned - nodes[index].offset));
+            if (nodes[index].size > size)
+                InsertFree(SplitBack(index, size));
+
+            nodes[index].free = false;
+            usedNodes[aligned] = index;
+            freeBytes -= nodes[index].size;
+            offset = aligned;
+            return true;
+        }
+
+        void Free(uint64_t offset) override
+        {
+            auto found = usedNodes.find(offset);
+            if (found == usedNodes.end())
+                return;
+            uint32_t index = found->second;
+            usedNodes.erase(found);
+            freeBytes += nodes[index].size;
+            nodes[index].free = true;
+
+            uint32_t prev = nodes[index].prevPhys;
+            if (prev != None && nodes[prev].free)
+            {
+                RemoveFree(prev);
+                Merge(prev, index);
+                index = prev;
+            }
+            uint32_t next = nodes[index].nextPhys;
+            if (next != None && nodes[next].free)
+            {
+                RemoveFree(next);
+                Merge(index, next);
+            }
+            InsertFree(index);
+        }
+
+        uint64_t FreeBytes() const override { return freeBytes; }
+
+        uint64_t LargestFree() const override
+        {
+            if (flBitmap == 0)
+                return 0;
+            uint32_t fl = 63 - std::countl_zero(flBitmap);
+            uint32_t sl = 31 - std::countl_zero(slBitmaps[fl]);
+            uint64_t largest = 0;
+            for (uint32_t index = heads[fl * SLCount + sl]; index != None; index = nodes[index].nextFree)
+                largest = std::max(largest, nodes[index].size);
+            return largest;
+        }
+
+    private:
+        static constexpr uint32_t SLBits = 4;
+        static constexpr uint32_t SLCount = 1u << SLBits;
+        static constexpr uint32_t FLCount = 64;
+        static constexpr uint32_t None = UINT32_MAX;
+
+        struct Node
+        {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint32_t prevPhys = None, nextPhys = None;
+            uint32_t prevFree = None, nextFree = None;
+            bool free = true;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<uint32_t> spareNodes;
+        std::vector<uint32_t> heads;
+        uint64_t flBitmap = 0;
+        std::vector<uint32_t> slBitmaps;
+        std::unordered_map<uint64_t, uint32_t> usedNodes;
+        uint64_t freeBytes = 0;
+
+        static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+        {
+            if (size < SLCount)
+            {
+                fl = 0;
+                sl = (uint32_t)size;
+                return;
+            }
+            uint32_t f = 63 - std::countl_zero(size);
+            fl = f - SLBits + 1;
+            sl = (uint32_t)(size >> (f - SLBits)) - SLCount;
+        }
+
+        //Head of the first list whose ranges are all at least size.
+        uint32_t Search(uint64_t size) const
+        {
+            if (size >= SLCount)
+            {
+                uint32_t f = 63 - std::countl_zero(size);
+                uint64_t rounded = size + (1ull << (f - SLBits)) - 1;
+                if (rounded < size)
+                    return None;
+                size = rounded;
+            }
+            uint32_t fl, sl;
+            Mapping(size, fl, sl);
+            uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+            if (slMap == 0)
+            {
+                uint64_t flMap = fl + 1 < FLCount ? flBitmap & (~0ull << (fl + 1)) : 0;
+                if (flMap == 0)
+                    return None;
+                fl = std::countr_zero(flMap);
+                slMap = slBitmaps[fl];
+            }
+            sl = std::countr_zero(slMap);
+            return heads[fl * SLCount + sl];
+        }
+
+        bool Fits(uint32_t index, uint64_t size, uint64_t alignment) const
+        {
+            const Node& node = nodes[index];
+            return AlignUp(node.offset, alignment) + size <= node.offset + node.size;
+        }
+
+        void InsertFree(uint32_t index)
+        {
+            uint32_t fl, sl;
+            Mapping(nodes[index].size, fl, sl);
+            uint32_t& head = heads[fl * SLCount + sl];
+            nodes[index].free = true;
+            nodes[index].prevFree = None;
+            nodes[index].nextFree = head;
+            if (head != None)
+                nodes[head].prevFree = index;
+            head = index;
+            flBitmap |= 1ull << fl;
+            slBitmaps[fl] |= 1u << sl;
+        }
+
+        void RemoveFree(uint32_t index)
+        {
+            Node& node = nodes[index];
+            if (node.prevFree != None)
+                nodes[node.prevFree].nextFree = node.nextFree;
+            else
+            {
+                uint32_t fl, sl;
+                Mapping(node.size, fl, sl);
+                heads[fl * SLCount + sl] = node.nextFree;
+                if (node.nextFree == None)
+                {
+                    slBitmaps[fl] &= ~(1u << sl);
+                    if (slBitmaps[fl] == 0)
+                        flBitmap &= ~(1ull << fl);
+                }
+            }
+            if (node.nextFree != None)
+                nodes[node.nextFree].prevFree = node.prevFree;
+            node.prevFree = node.nextFree = None;
+        }
+
+        uint32_t NewNode()
+        {
+            if (!spareNodes.empty())
+            {
+                uint32_t index = spareNodes.back();
+                spareNodes.pop_back();
+                nodes[index] = Node();
+                return index;
+            }
+            nodes.push_back(Node());
+            return (uint32_t)nodes.size() - 1;
+        }
+
+        //Cuts the first size bytes of a node into a node of their own, linked in front of it.
+        uint32_t SplitFront(uint32_t index, uint64_t size)
+        {
+            uint32_t front = NewNode();
+            Node& node = nodes[index];
+            nodes[front].offset = node.offset;
+            nodes[front].size = size;
+            nodes[front].prevPhys = node.prevPhys;
+            nodes[front].nextPhys = index;
+            if (node.prevPhys != None)
+                nodes[node.prevPhys].nextPhys = front;
+            node.prevPhys = front;
+            node.offset += size;
+            node.size -= size;
+            return front;
+        }
+
+        //Keeps the first size bytes in the node and returns the rest as a new node behind it.
+        uint32_t SplitBack(uint32_t index, uint64_t size)
+        {
+            uint32_t back = NewNode();
+            Node& node = nodes[index];
+            nodes[back].offset = node.offset + size;
+            nodes[back].size = node.size - size;
+            nodes[back].prevPhys = index;
+            nodes[back].nextPhys = node.nextPhys;
+            if (node.nextPhys != None)
+                nodes[node.nextPhys].prevPhys = back;
+            node.nextPhys = back;
+            node.size = size;
+            return back;
+        }
+
+        //Folds next into index; both must be out of the free lists.
+        void Merge(uint32_t index, uint32_t next)
+        {
+            nodes[index].size += nodes[next].size;
+            nodes[index].nextPhys = nodes[next].nextPhys;
+            if (nodes[next].nextPhys != None)
+                nodes[nodes[next].nextPhys].prevPhys = index;
+            spareNodes.push_back(next);
+        }
+    };
+
+    //Ranges of minSize << order, each aligned to its own size. Freeing merges a range with its buddy while that is free.
+    class BuddyMetadata : public UnigmaBlockMetadata
+    {
+    public:
+        explicit BuddyMetadata(uint64_t size)
+        {
+            while ((MinSize << orders) <= size && orders < 48)
+                orders++;
+            freeLists.resize(std::max<uint32_t>(orders, 1));
+            if (orders > 0)
+                freeLists[orders - 1].insert(0);
+            freeBytes = orders > 0 ? MinSize << (orders - 1) : 0;
+        }
+
+        bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset) override
+        {
+            uint64_t need = std::max(size, alignment);
+            uint32_t order = 0;
+            while (order < orders && (MinSize << order) < need)
+                order++;
+            uint32_t available = order;
+            while (available < orders && freeLists[available].empty())
+                available++;
+            if (available >= orders)
+                return false;
+
+            //Lowest address first keeps the top of the block free for large requests.
+            offset = *freeLists[available].begin();
+            freeLists[available].erase(freeLists[available].begin());
+            while (available > order)
+            {
+                available--;
+                freeLists[available].insert(offset + (MinSize << available));
+            }
+            usedOrders[offset] = order;
+            freeBytes -= MinSize << order;
+            return true;
+        }
+
+        void Free(uint64_t offset) override
+        {
+            auto found = usedOrders.find(offset);
+            if (found == usedOrders.end())
+                return;
+            uint32_t order = found->second;
+            usedOrders.erase(found);
+            freeBytes += MinSize << order;
+            while (order + 1 < orders)
+            {
+                auto buddy = freeLists[order].find(offset ^ (MinSize << order));
+                if (buddy == freeLists[order].end())
+                    break;
+                offset = std::min(offset, *buddy);
+                freeLists[order].erase(buddy);
+                order++;
+            }
+            freeLists[order].insert(offset);
+        }
+
+        uint64_t FreeBytes() const override { return freeBytes; }
+
+        uint64_t LargestFree() const override
+        {
+            for (uint32_t order = orders; order-- > 0;)
+                if (!freeLists[order].empty())
+                    return MinSize << order;
+            return 0;
+        }
+
+    private:
+        static constexpr uint64_t MinSize = 256;
+        uint32_t orders = 0;
+        std::vector<std::set<uint64_t>> freeLists;
+        std::unordered_map<uint64_t, uint32_t> usedOrders;
+        uint64_t freeBytes = 0;
+    };
+
+    //Bump allocation. Frees only count down; the block starts over once everything in it is freed.
+    class LinearMetadata : public UnigmaBlockMetadata
+    {
+    public:
+        explicit LinearMetadata(uint64_t size) : size(size) {}
+
+        bool Allocate(uint64_t request, uint64_t alignment, uint64_t& offset) override
+        {
+            uint64_t aligned = AlignUp(top, alignment);
+            if (aligned + request > size)
+                return false;
+            offset = aligned;
+            top = aligned + request;
+            live++;
+            return true;
+        }
+
+        void Free(uint64_t) override
+        {
+            if (live > 0 && --live == 0)
+                top = 0;
+        }
+
+        uint64_t FreeBytes() const override { return size - top; }
+        uint64_t LargestFree() const override { return size - top; }
+
+    private:
+        uint64_t size = 0;
+        uint64_t top = 0;
+        uint32_t live = 0;
+    };
+}
+
+std::unique_ptr<UnigmaBlockMetadata> UnigmaBlockMetadata::Create(UnigmaMemoryStrategy strategy, uint64_t size)
+{
+    switch (strategy)
+    {
+    case UnigmaMemoryStrategy::Buddy: return std::make_unique<BuddyMetadata>(size);
+    case UnigmaMemoryStrategy::Linear: return std::make_unique<LinearMetadata>(size);
+    default: return std::make_unique<TLSFMetadata>(size);
+    }
+}
+
+void UnigmaDeviceMemory::Init(const UnigmaMemoryProperties& memoryProperties, UnigmaMemoryBackend* memoryBackend, const UnigmaDeviceMemorySettings& memorySettings)
+{
+    Release();
+    properties = memoryProperties;
+    backend = memoryBackend;
+    settings = memorySettings;
+    heapUsage.assign(properties.heapSizes.size(), 0);
+    backendAllocations.assign(properties.types.size(), 0);
+    backendFrees.assign(properties.types.size(), 0);
+    allocations.assign(1, Allocation());
+}
+
+void UnigmaDeviceMemory::Release()
+{
+    for (Block& block : blocks)
+        if (block.used && backend != nullptr)
+            backend->FreeBlock(block.handle);
+
+    pools.clear();
+    defaultPools.clear();
+    blocks.clear();
+    freeBlockSlots.clear();
+    allocations.assign(1, Allocation());
+    freeAllocationSlots.clear();
+    pendingReleases.clear();
+    std::fill(heapUsage.begin(), heapUsage.end(), 0);
+    blockCount = 0;
+}
+
+uint32_t UnigmaDeviceMemory::FindMemoryType(uint32_t typeBits, uint32_t requiredFlags, uint32_t preferredFlags) const
+{
+    //Cost: preferred flags missing plus flags nobody asked for, so plain requests stay off scarce memory such as
+    //host visible device local.
+    uint32_t best = UINT32_MAX;
+    int bestCost = INT32_MAX;
+    for (uint32_t i = 0; i < properties.types.size() && i < 32; i++)
+    {
+        uint32_t flags = properties.types[i].propertyFlags;
+        if (!((typeBits >> i) & 1) || (flags & requiredFlags) != requiredFlags)
+            continue;
+        int cost = std::popcount(preferredFlags & ~flags) + std::popcount(flags & ~(requiredFlags | preferredFlags));
+        if (cost < bestCost)
+        {
+            best = i;
+            bestCost = cost;
+        }
+    }
+    return best;
+}
+
+uint64_t UnigmaDeviceMemory::DefaultBlockSize(uint32_t memoryType) const
+{
+    uint64_t heapSize = properties.heapSizes[properties.types[memoryType].heapIndex];
+    return heapSize > 0 ? std::min(settings.blockSize, heapSize / 8) : settings.blockSize;
+}
+
+UnigmaPoolId UnigmaDeviceMemory::CreatePool(const UnigmaMemoryPoolDesc& desc)
+{
+    Pool pool;
+    pool.desc = desc;
+    pool.custom = true;
+    if (pool.desc.blockSize == 0)
+        pool.desc.blockSize = DefaultBlockSize(desc.memoryType);
+    if (pool.desc.strategy == UnigmaMemoryStrategy::Buddy)
+        pool.desc.blockSize = std::bit_floor(pool.desc.blockSize);
+    pools.push_back(pool);
+    return (UnigmaPoolId)pools.size() - 1;
+}
+
+UnigmaPoolId UnigmaDeviceMemory::DefaultPool(uint32_t memoryType, UnigmaResourceClass resourceClass)
+{
+    uint64_t key = (uint64_t)memoryType << 32 | (uint32_t)resourceClass;
+    auto found = defaultPools.find(key);
+    if (found != defaultPools.end())
+        return found->second;
+
+    UnigmaMemoryPoolDesc desc;
+    desc.memoryType = memoryType;
+    desc.resourceClass = resourceClass;
+    UnigmaPoolId pool = CreatePool(desc);
+    pools[pool].custom = false;
+    defaultPools[key] = pool;
+    return pool;
+}
+
+void UnigmaDeviceMemory::ResetPool(UnigmaPoolId pool)
+{
+    for (uint32_t id = 1; id < allocations.size(); id++)
+    {
+        if (!allocations[id].used || blocks[allocations[id].blockIndex].pool != pool)
+            continue;
+        allocations[id] = Allocation();
+        freeAllocationSlots.push_back(id);
+    }
+    pendingReleases.erase(std::remove_if(pendingReleases.begin(), pendingReleases.end(),
+        [&](const PendingRelease& p) { return blocks[p.blockIndex].pool == pool; }), pendingReleases.end());
+
+    std::vector<uint32_t> dedicatedBlocks;
+    for (uint32_t blockIndex : pools[pool].blocks)
+    {
+        Block& block = blocks[blockIndex];
+        if (block.metadata == nullptr)
+        {
+            dedicatedBlocks.push_back(blockIndex);
+            continue;
+        }
+        block.metadata = UnigmaBlockMetadata::Create(pools[pool].desc.strategy, block.size);
+        block.live = 0;
+        block.liveBytes = 0;
+    }
+    for (uint32_t blockIndex : dedicatedBlocks)
+        FreeBlock(blockIndex);
+}
+
+bool UnigmaDeviceMemory::Allocate(const UnigmaAllocationDesc& desc, UnigmaAllocationId& allocation)
+{
+    allocation = UnigmaNoAllocation;
+    if (backend == nullptr)
+        return false;
+    if (desc.pool != UnigmaDefaultPool)
+        return desc.pool < pools.size() && AllocateFromPool(desc.pool, desc, allocation);
+
+    //Fall back to the next best type when the best one is full.
+    uint32_t typeBits = desc.memoryTypeBits;
+    for (;;)
+    {
+        uint32_t memoryType = FindMemoryType(typeBits, desc.requiredFlags, desc.preferredFlags);
+        if (memoryType == UINT32_MAX)
+            return false;
+        if (AllocateFromPool(DefaultPool(memoryType, desc.resourceClass), desc, allocation))
+            return true;
+        typeBits &= ~(1u << memoryType);
+    }
+}
+
+bool UnigmaDeviceMemory::AllocateFromPool(UnigmaPoolId poolId, const UnigmaAllocationDesc& desc, UnigmaAllocationId& allocation)
+{
+    const Pool& pool = pools[poolId];
+    if (pool.desc.memoryType >= 32 || !((desc.memoryTypeBits >> pool.desc.memoryType) & 1))
+        return false;
+
+    UnigmaAllocationDesc request = desc;
+    request.size = std::max<uint64_t>(desc.size, 1);
+    uint64_t threshold = settings.dedicatedThreshold > 0 ? settings.dedicatedThreshold : pool.desc.blockSize / 2;
+    uint32_t blockIndex;
+    if (!pool.custom && (desc.dedicated || request.size >= threshold))
+    {
+        if (!AllocateBlock(poolId, request.size, true, blockIndex))
+            return false;
+        request.movable = false;
+        allocation = NewAllocation(blockIndex, 0, request);
+        return true;
+    }
+
+    uint64_t offset;
+    uint32_t pooledBlocks = 0;
+    for (uint32_t candidate : pool.blocks)
+    {
+        if (blocks[candidate].metadata == nullptr)
+            continue;
+        pooledBlocks++;
+        if (blocks[candidate].metadata->Allocate(request.size, request.alignment, offset))
+        {
+            allocation = NewAllocation(candidate, offset, request);
+            return true;
+        }
+    }
+
+    if (request.size > pool.desc.blockSize || (pool.desc.maxBlocks > 0 && pooledBlocks >= pool.desc.maxBlocks))
+        return false;
+    if (!AllocateBlock(poolId, pool.desc.blockSize, false, blockIndex))
+        return false;
+    if (!blocks[blockIndex].metadata->Allocate(request.size, request.alignment, offset))
+    {
+        FreeBlock(blockIndex);
+        return false;
+    }
+    allocation = NewAllocation(blockIndex, offset, request);
+    return true;
+}
+
+bool UnigmaDeviceMemory::AllocateBlock(uint32_t pool, uint64_t size, bool dedicated, uint32_t& blockIndex)
+{
+    uint32_t memoryType = pools[pool].desc.memoryType;
+    uint32_t heap = properties.types[memoryType].heapIndex;
+    if (blockCount >= settings.maxBlocks || (properties.heapSizes[heap] > 0 && heapUsage[heap] + size > properties.heapSizes[heap]))
+        return false;
+
+    uint64_t handle = 0;
+    void* mapped = nullptr;
+    if (!backend->AllocateBlock(memoryType, size, handle, mapped))
+        return false;
+    backendAllocations[memoryType]++;
+
+    if (!freeBlockSlots.empty())
+    {
+        blockIndex = freeBlockSlots.back();
+        freeBlockSlots.pop_back();
+    }
+    else
+    {
+        blockIndex = (uint32_t)blocks.size();
+        blocks.push_back(Block());
+    }
+
+    Block& block = blocks[blockIndex];
+    block.handle = handle;
+    block.size = size;
+    block.mapped = (uint8_t*)mapped;
+    block.pool = pool;
+    block.live = 0;
+    block.liveBytes = 0;
+    block.metadata = dedicated ? nullptr : UnigmaBlockMetadata::Create(pools[pool].desc.strategy, size);
+    block.used = true;
+    pools[pool].blocks.push_back(blockIndex);
+    heapUsage[heap] += size;
+    blockCount++;
+    return true;
+}
+
+void UnigmaDeviceMemory::FreeBlock(uint32_t blockIndex)
+{
+    Block& block = blocks[blockIndex];
+    uint32_t memoryType = pools[block.pool].desc.memoryType;
+    backend->FreeBlock(block.handle);
+    backendFrees[memoryType]++;
+    heapUsage[properties.types[memoryType].heapIndex] -= block.size;
+    blockCount--;
+
+    std::vector<uint32_t>& poolBlocks = pools[block.pool].blocks;
+    poolBlocks.erase(std::find(poolBlocks.begin(), poolBlocks.end(), blockIndex));
+    block = Block();
+    freeBlockSlots.push_back(blockIndex);
+}
+
+UnigmaAllocationId UnigmaDeviceMemory::NewAllocation(uint32_t blockIndex, uint64_t offset, const UnigmaAllocationDesc& desc)
+{
+    UnigmaAllocationId id;
+    if (!freeAllocationSlots.empty())
+    {
+        id = freeAllocationSlots.back();
+        freeAllocationSlots.pop_back();
+    }
+    else
+    {
+        id = (UnigmaAllocationId)allocations.size();
+        allocations.push_back(Allocation());
+    }
+
+    Block& block = blocks[blockIndex];
+    Allocation& allocation = allocations[id];
+    allocation.info.block = block.handle;
+    allocation.info.offset = offset;
+    allocation.info.size = desc.size;
+    allocation.info.memoryType = pools[block.pool].desc.memoryType;
+    allocation.info.mapped = block.mapped != nullptr ? block.mapped + offset : nullptr;
+    allocation.info.dedicated = block.metadata == nullptr;
+    allocation.blockIndex = blockIndex;
+    allocation.alignment = desc.alignment;
+    allocation.movable = desc.movable;
+    allocation.used = true;
+    block.live++;
+    block.liveBytes += desc.size;
+    return id;
+}
+
+void UnigmaDeviceMemory::Free(UnigmaAllocationId allocation)
+{
+    if (allocation == UnigmaNoAllocation || allocation >= allocations.size() || !allocations[allocation].used)
+        return;
+    Allocation& freed = allocations[allocation];
+    ReleaseRange(freed.blockIndex, freed.info.offset, freed.info.size, true);
+    freed = Allocation();
+    freeAllocationSlots.push_back(allocation);
+}
+
+void UnigmaDeviceMemory::ReleaseRange(uint32_t blockIndex, uint64_t offset, uint64_t size, bool keepOneEmpty)
+{
+    Block& block = blocks[blockIndex];
+    if (block.metadata == nullptr)
+    {
+        FreeBlock(blockIndex);
+        return;
+    }
+
+    block.metadata->Free(offset);
+    block.live--;
+    block.liveBytes -= size;
+    if (block.live > 0)
+        return;
+
+    //One empty block stays around so a resource freed and created again every frame does not reach the driver.
+    bool otherEmpty = false;
+    for (uint32_t other : pools[block.pool].blocks)
+        otherEmpty = otherEmpty || (other != blockIndex && blocks[other].metadata != nullptr && blocks[other].live == 0);
+    if (!keepOneEmpty || otherEmpty)
+        FreeBlock(blockIndex);
+}
+
+UnigmaMemoryStats UnigmaDeviceMemory::Stats(uint32_t memoryType) const
+{
+    UnigmaMemoryStats stats;
+    for (const Block& block : blocks)
+    {
+        if (!block.used || pools[block.pool].desc.memoryType != memoryType)
+            continue;
+        stats.blocks++;
+        stats.blockBytes += block.size;
+        if (block.metadata == nullptr)
+            stats.dedicatedBlocks++;
+        else
+            stats.largestFree = std::max(stats.largestFree, block.metadata->LargestFree());
+    }
+    for (const Allocation& allocation : allocations)
+    {
+        if (!allocation.used || allocation.info.memoryType != memoryType)
+            continue;
+        stats.allocations++;
+        stats.allocatedBytes += allocation.info.size;
+    }
+    if (memoryType < backendAllocations.size())
+    {
+        stats.backendAllocations = backendAllocations[memoryType];
+        stats.backendFrees = backendFrees[memoryType];
+    }
+    return stats;
+}
+
+UnigmaMemoryStats UnigmaDeviceMemory::TotalStats() const
+{
+    UnigmaMemoryStats total;
+    for (uint32_t memoryType = 0; memoryType < properties.types.size(); memoryType++)
+    {
+        UnigmaMemoryStats stats = Stats(memoryType);
+        total.blocks += stats.blocks;
+        total.dedicatedBlocks += stats.dedicatedBlocks;
+        total.allocations += stats.allocations;
+        total.blockBytes += stats.blockBytes;
+        total.allocatedBytes += stats.allocatedBytes;
+        total.largestFree = std::max(total.largestFree, stats.largestFree);
+        total.backendAllocations += stats.backendAllocations;
+        total.backendFrees += stats.backendFrees;
+    }
+    return total;
+}
+
+uint32_t UnigmaDeviceMemory::BeginDefragmentStep(std::vector<UnigmaDefragMove>& moves, uint64_t maxBytes, uint32_t maxMoves)
+{
+    moves.clear();
+    if (!pendingReleases.empty())
+        return 0;
+
+    std::vector<uint8_t> targets(blocks.size(), 0);
+    uint64_t movedBytes = 0;
+    for (uint32_t poolId = 0; poolId < pools.size(); poolId++)
+    {
+        const Pool& pool = pools[poolId];
+        if (pool.desc.strategy == UnigmaMemoryStrategy::Linear)
+            continue;
+
+        //Fullest first: the emptiest blocks are the sources, the fuller ones in front of them the destinations.
+        std::vector<uint32_t> order;
+        for (uint32_t blockIndex : pool.blocks)
+            if (blocks[blockIndex].metadata != nullptr)
+                order.push_back(blockIndex);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return blocks[a].liveBytes != blocks[b].liveBytes ? blocks[a].liveBytes > blocks[b].liveBytes : a < b;
+        });
+
+        for (size_t s = order.size(); s-- > 1;)
+        {
+            uint32_t source = order[s];
+            if (blocks[source].live == 0 || targets[source])
+                continue;
+
+            //Only worth it when the whole block can empty.
+            std::vector<UnigmaAllocationId> resident;
+            bool movable = true;
+            for (UnigmaAllocationId id = 1; id < allocations.size() && movable; id++)
+                if (allocations[id].used && allocations[id].blockIndex == source)
+                {
+                    movable = allocations[id].movable;
+                    resident.push_back(id);
+                }
+            if (!movable)
+                continue;
+            std::sort(resident.begin(), resident.end(), [&](UnigmaAllocationId a, UnigmaAllocationId b) {
+                return allocations[a].info.size != allocations[b].info.size ? allocations[a].info.size > allocations[b].info.size : a < b;
+            });
+
+            for (UnigmaAllocationId id : resident)
+            {
+                Allocation& allocation = allocations[id];
+                if (moves.size() >= maxMoves || movedBytes + allocation.info.size > maxBytes)
+                    return (uint32_t)moves.size();
+
+                uint64_t offset = 0;
+                size_t d = 0;
+                while (d < s && !blocks[order[d]].metadata->Allocate(allocation.info.size, allocation.alignment, offset))
+                    d++;
+                if (d == s)
+                    break;
+
+                Block& destination = blocks[order[d]];
+                UnigmaDefragMove move;
+                move.allocation = id;
+                move.srcBlock = allocation.info.block;
+                move.srcOffset = allocation.info.offset;
+                move.dstBlock = destination.handle;
+                move.dstOffset = offset;
+                move.size = allocation.info.size;
+                moves.push_back(move);
+
+                PendingRelease pending;
+                pending.blockIndex = source;
+                pending.offset = allocation.info.offset;
+                pending.size = allocation.info.size;
+                pendingReleases.push_back(pending);
+
+                allocation.info.block = destination.handle;
+                allocation.info.offset = offset;
+                allocation.info.mapped = destination.mapped != nullptr ? destination.mapped + offset : nullptr;
+                allocation.blockIndex = order[d];
+                destination.live++;
+                destination.liveBytes += allocation.info.size;
+                targets[order[d]] = 1;
+                movedBytes += allocation.info.size;
+            }
+        }
+    }
+    return (uint32_t)moves.size();
+}
+
+void UnigmaDeviceMemory::EndDefragmentStep()
+{
+    for (const PendingRelease& pending : pendingReleases)
+        ReleaseRange(pending.blockIndex, pending.offset, pending.size, false);
+    pendingReleases.clear();
+}
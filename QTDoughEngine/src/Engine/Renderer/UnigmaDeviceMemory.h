@@ -0,0 +1,235 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//Sub-allocates device memory out of large blocks instead of one vkAllocateMemory per resource, which runs into the
+//driver's allocation count limit in big scenes and makes resource churn expensive. Blocks come from a pool per memory
+//type and resource class (buffers and optimal-tiling images never share a block, which keeps them clear of
+//bufferImageGranularity). A pool places allocations inside its blocks with one of three strategies:
+//  - TLSF, two level segregated fit: constant time general purpose allocation, the default,
+//  - buddy: power of two ranges, fast and cheap to merge, for many similarly sized resources,
+//  - linear: bump allocation, the whole block frees at once, for staging memory freed right after use.
+//Resources over the dedicated threshold get a block of their own. Allocations marked movable can be compacted
+//incrementally: a defragmentation step moves a bounded amount of them out of the least used blocks, the caller copies
+//the contents and rebinds, and ending the step releases the old ranges and the blocks that emptied.
+//Nothing here touches Vulkan: blocks come from a UnigmaMemoryBackend, which tests mock together with the memory
+//type table. UnigmaDeviceMemoryVulkan is the device backend.
+
+//Same values as VkMemoryPropertyFlagBits.
+enum UnigmaMemoryPropertyBits : uint32_t
+{
+    UnigmaMemoryDeviceLocal = 0x1,
+    UnigmaMemoryHostVisible = 0x2,
+    UnigmaMemoryHostCoherent = 0x4,
+    UnigmaMemoryHostCached = 0x8,
+};
+
+struct UnigmaMemoryType
+{
+    uint32_t propertyFlags = 0;
+    uint32_t heapIndex = 0;
+};
+
+//What vkGetPhysicalDeviceMemoryProperties reports, or a made up table in tests.
+struct UnigmaMemoryProperties
+{
+    std::vector<UnigmaMemoryType> types;
+    std::vector<uint64_t> heapSizes;
+};
+
+enum class UnigmaMemoryStrategy : uint32_t
+{
+    TLSF = 0,
+    Buddy,
+    Linear,
+};
+
+enum class UnigmaResourceClass : uint32_t
+{
+    Buffer = 0, //And linear tiling images.
+    Image, //Optimal tiling.
+};
+
+//Where the blocks come from.
+class UnigmaMemoryBackend
+{
+public:
+    virtual ~UnigmaMemoryBackend() {}
+    //False when the memory type is out of memory. mapped stays null unless the type is host visible.
+    virtual bool AllocateBlock(uint32_t memoryType, uint64_t size, uint64_t& block, void*& mapped) = 0;
+    virtual void FreeBlock(uint64_t block) = 0;
+};
+
+//Placement of allocations inside one block.
+class UnigmaBlockMetadata
+{
+public:
+    virtual ~UnigmaBlockMetadata() {}
+    virtual bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset) = 0;
+    virtual void Free(uint64_t offset) = 0;
+    virtual uint64_t FreeBytes() const = 0;
+    virtual uint64_t LargestFree() const = 0;
+
+    static std::unique_ptr<UnigmaBlockMetadata> Create(UnigmaMemoryStrategy strategy, uint64_t size);
+};
+
+struct UnigmaMemoryPoolDesc
+{
+    uint32_t memoryType = 0;
+    UnigmaResourceClass resourceClass = UnigmaResourceClass::Buffer;
+    UnigmaMemoryStrategy strategy = UnigmaMemoryStrategy::TLSF;
+    uint64_t blockSize = 0; //0 takes the allocator default. Buddy pools round it down to a power of two.
+    uint32_t maxBlocks = 0; //0 for no limit.
+};
+
+using UnigmaPoolId = uint32_t;
+using UnigmaAllocationId = uint32_t;
+const UnigmaPoolId UnigmaDefaultPool = UINT32_MAX;
+const UnigmaAllocationId UnigmaNoAllocation = 0;
+
+struct UnigmaAllocationDesc
+{
+    uint64_t size = 0;
+    uint64_t alignment = 1;
+    uint32_t memoryTypeBits = ~0u;
+    uint32_t requiredFlags = 0;
+    uint32_t preferredFlags = 0;
+    UnigmaResourceClass resourceClass = UnigmaResourceClass::Buffer;
+    UnigmaPoolId pool = UnigmaDefaultPool; //A custom pool fixes the memory type; the flags are then ignored.
+    bool dedicated = false; //Required or preferred by the driver.
+    bool movable = false; //The owner copies and rebinds the resource when a defragmentation step moves it.
+};
+
+struct UnigmaAllocationInfo
+{
+    uint64_t block = 0; //Backend handle, the VkDeviceMemory.
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint32_t memoryType = 0;
+    void* mapped = nullptr; //Persistently mapped pointer to the allocation in host visible memory.
+    bool dedicated = false;
+};
+
+struct UnigmaMemoryStats
+{
+    uint32_t blocks = 0; //Dedicated ones included.
+    uint32_t dedicatedBlocks = 0;
+    uint32_t allocations = 0;
+    uint64_t blockBytes = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t largestFree = 0; //Largest free range in any pooled block.
+    uint32_t backendAllocations = 0; //Calls to the backend since Init, what vkAllocateMemory would have been called for.
+    uint32_t backendFrees = 0;
+};
+
+struct UnigmaDefragMove
+{
+    UnigmaAllocationId allocation = UnigmaNoAllocation;
+    uint64_t srcBlock = 0;
+    uint64_t srcOffset = 0;
+    uint64_t dstBlock = 0;
+    uint64_t dstOffset = 0;
+    uint64_t size = 0;
+};
+
+struct UnigmaDeviceMemorySettings
+{
+    uint64_t blockSize = 64ull << 20; //Default pools, capped at an eighth of small heaps.
+    uint64_t dedicatedThreshold = 0; //0 takes half the block size.
+    uint32_t maxBlocks = 4096; //maxMemoryAllocationCount.
+};
+
+class UnigmaDeviceMemory
+{
+public:
+    UnigmaDeviceMemory() {}
+    ~UnigmaDeviceMemory() { Release(); }
+    UnigmaDeviceMemory(const UnigmaDeviceMemory&) = delete;
+    UnigmaDeviceMemory& operator=(const UnigmaDeviceMemory&) = delete;
+
+    void Init(const UnigmaMemoryProperties& properties, UnigmaMemoryBackend* backend, const UnigmaDeviceMemorySettings& settings = UnigmaDeviceMemorySettings());
+    //Frees every block. Allocations still alive are dropped with them.
+    void Release();
+
+    //Memory type allowed by typeBits with all of required and most of preferred, UINT32_MAX if none has required.
+    uint32_t FindMemoryType(uint32_t typeBits, uint32_t requiredFlags, uint32_t preferredFlags = 0) const;
+    UnigmaPoolId CreatePool(const UnigmaMemoryPoolDesc& desc);
+    //Drops every allocation in the pool and keeps its blocks, for linear pools reused frame after frame.
+    void ResetPool(UnigmaPoolId pool);
+
+    //False when no allowed memory type has room left.
+    bool Allocate(const UnigmaAllocationDesc& desc, UnigmaAllocationId& allocation);
+    void Free(UnigmaAllocationId allocation);
+    const UnigmaAllocationInfo& Info(UnigmaAllocationId allocation) const { return allocations[allocation].info; }
+
+    UnigmaMemoryStats Stats(uint32_t memoryType) const;
+    UnigmaMemoryStats TotalStats() const;
+
+    //Plans moves of movable allocations out of the least used blocks of each pool, up to maxBytes and maxMoves.
+    //Allocation infos point at the new place on return, while the old ranges stay reserved until EndDefragmentStep,
+    //called once the copies have completed on the device. Returns the number of moves, 0 when there is nothing to gain.
+    uint32_t BeginDefragmentStep(std::vector<UnigmaDefragMove>& moves, uint64_t maxBytes = ~0ull, uint32_t maxMoves = ~0u);
+    void EndDefragmentStep();
+
+private:
+    struct Block
+    {
+        uint64_t handle = 0;
+        uint64_t size = 0;
+        uint8_t* mapped = nullptr;
+        uint32_t pool = 0;
+        uint32_t live = 0; //Allocations in it, reserved defragmentation sources included.
+        uint64_t liveBytes = 0;
+        std::unique_ptr<UnigmaBlockMetadata> metadata; //Null for dedicated blocks.
+        bool used = false;
+    };
+
+    struct Pool
+    {
+        UnigmaMemoryPoolDesc desc;
+        std::vector<uint32_t> blocks;
+        bool custom = false;
+    };
+
+    struct Allocation
+    {
+        UnigmaAllocationInfo info;
+        uint32_t blockIndex = 0;
+        uint64_t alignment = 1;
+        bool movable = false;
+        bool used = false;
+    };
+
+    struct PendingRelease
+    {
+        uint32_t blockIndex = 0;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    UnigmaMemoryProperties properties;
+    UnigmaMemoryBackend* backend = nullptr;
+    UnigmaDeviceMemorySettings settings;
+    std::vector<Pool> pools;
+    std::unordered_map<uint64_t, UnigmaPoolId> defaultPools; //Keyed by memory type and resource class.
+    std::vector<Block> blocks;
+    std::vector<uint32_t> freeBlockSlots;
+    std::vector<Allocation> allocations; //Slot 0 stays unused, so UnigmaNoAllocation is never handed out.
+    std::vector<uint32_t> freeAllocationSlots;
+    std::vector<uint64_t> heapUsage;
+    std::vector<PendingRelease> pendingReleases;
+    uint32_t blockCount = 0;
+    std::vector<uint32_t> backendAllocations; //Per memory type.
+    std::vector<uint32_t> backendFrees;
+
+    UnigmaPoolId DefaultPool(uint32_t memoryType, UnigmaResourceClass resourceClass);
+    uint64_t DefaultBlockSize(uint32_t memoryType) const;
+    bool AllocateFromPool(UnigmaPoolId pool, const UnigmaAllocationDesc& desc, UnigmaAllocationId& allocation);
+    bool AllocateBlock(uint32_t pool, uint64_t size, bool dedicated, uint32_t& blockIndex);
+    void FreeBlock(uint32_t blockIndex);
+    //Returns the range to the block and releases the block when it empties and the pool already holds an empty one.
+    void ReleaseRange(uint32_t blockIndex, uint64_t offset, uint64_t size, bool keepOneEmpty);
+    UnigmaAllocationId NewAllocation(uint32_t blockIndex, uint64_t offset, const UnigmaAllocationDesc& desc);
+};
@@ -0,0 +1,183 @@
+#include "UnigmaDeviceMemoryVulkan.h"
+#include <stdexcept>
+
+void UnigmaDeviceMemoryVulkan::Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, bool useDeviceAddress)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    device = logicalDevice;
+    deviceAddress = useDeviceAddress;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    UnigmaMemoryProperties properties;
+    typeFlags.clear();
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        UnigmaMemoryType type;
+        type.propertyFlags = memoryProperties.memoryTypes[i].propertyFlags;
+        type.heapIndex = memoryProperties.memoryTypes[i].heapIndex;
+        properties.types.push_back(type);
+        typeFlags.push_back(type.propertyFlags);
+    }
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+        properties.heapSizes.push_back(memoryProperties.memoryHeaps[i].size);
+
+    UnigmaDeviceMemorySettings settings;
+    //Leave room for what still allocates on its own.
+    settings.maxBlocks = deviceProperties.limits.maxMemoryAllocationCount / 2;
+    allocator.Init(properties, this, settings);
+
+    UnigmaMemoryPoolDesc staging;
+    staging.memoryType = allocator.FindMemoryType(~0u, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    staging.strategy = UnigmaMemoryStrategy::Linear;
+    stagingPool = staging.memoryType != UINT32_MAX ? allocator.CreatePool(staging) : UnigmaDefaultPool;
+}
+
+void UnigmaDeviceMemoryVulkan::Destroy()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    allocator.Release();
+    stagingPool = UnigmaDefaultPool;
+}
+
+bool UnigmaDeviceMemoryVulkan::AllocateBlock(uint32_t memoryType, uint64_t size, uint64_t& block, void*& mapped)
+{
+    VkMemoryAllocateFlagsInfo allocFlags{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO };
+    allocFlags.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = deviceAddress ? &allocFlags : nullptr;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        return false;
+
+    mapped = nullptr;
+    if ((typeFlags[memoryType] & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+        vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        vkFreeMemory(device, memory, nullptr);
+        return false;
+    }
+    block = (uint64_t)memory;
+    return true;
+}
+
+void UnigmaDeviceMemoryVulkan::FreeBlock(uint64_t block)
+{
+    //Freeing unmaps.
+    vkFreeMemory(device, (VkDeviceMemory)block, nullptr);
+}
+
+UnigmaAllocationId UnigmaDeviceMemoryVulkan::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+    UnigmaResourceClass resourceClass, UnigmaPoolId pool, bool movable)
+{
+    UnigmaAllocationDesc desc;
+    desc.size = requirements.size;
+    desc.alignment = requirements.alignment;
+    desc.memoryTypeBits = requirements.memoryTypeBits;
+    desc.requiredFlags = properties;
+    desc.resourceClass = resourceClass;
+    desc.pool = pool;
+    desc.movable = movable;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    UnigmaAllocationId allocation;
+    if (allocator.Allocate(desc, allocation))
+        return allocation;
+    //A full or unsuitable custom pool falls back to the default ones.
+    desc.pool = UnigmaDefaultPool;
+    if (pool != UnigmaDefaultPool && allocator.Allocate(desc, allocation))
+        return allocation;
+    return UnigmaNoAllocation;
+}
+
+void UnigmaDeviceMemoryVulkan::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer,
+    UnigmaAllocationId& allocation, UnigmaPoolId pool, bool movable)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+    allocation = Allocate(memRequirements, properties, UnigmaResourceClass::Buffer, pool, movable);
+    if (allocation == UnigmaNoAllocation) {
+        throw std::runtime_error("failed to allocate buffer memory!");
+    }
+
+    vkBindBufferMemory(device, buffer, Memory(allocation), Offset(allocation));
+}
+
+void UnigmaDeviceMemoryVulkan::CreateImage(const VkImageCreateInfo& info, VkMemoryPropertyFlags properties, VkImage& image, UnigmaAllocationId& allocation)
+{
+    if (vkCreateImage(device, &info, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+    UnigmaResourceClass resourceClass = info.tiling == VK_IMAGE_TILING_OPTIMAL ? UnigmaResourceClass::Image : UnigmaResourceClass::Buffer;
+    allocation = Allocate(memRequirements, properties, resourceClass, UnigmaDefaultPool, false);
+    if (allocation == UnigmaNoAllocation) {
+        throw std::runtime_error("failed to allocate image memory!");
+    }
+
+    vkBindImageMemory(device, image, Memory(allocation), Offset(allocation));
+}
+
+void UnigmaDeviceMemoryVulkan::DestroyBuffer(VkBuffer& buffer, UnigmaAllocationId& allocation)
+{
+    if (buffer != VK_NULL_HANDLE)
+        vkDestroyBuffer(device, buffer, nullptr);
+    std::lock_guard<std::mutex> lock(mutex);
+    allocator.Free(allocation);
+    buffer = VK_NULL_HANDLE;
+    allocation = UnigmaNoAllocation;
+}
+
+void UnigmaDeviceMemoryVulkan::DestroyImage(VkImage& image, UnigmaAllocationId& allocation)
+{
+    if (image != VK_NULL_HANDLE)
+        vkDestroyImage(device, image, nullptr);
+    std::lock_guard<std::mutex> lock(mutex);
+    allocator.Free(allocation);
+    image = VK_NULL_HANDLE;
+    allocation = UnigmaNoAllocation;
+}
+
+VkDeviceMemory UnigmaDeviceMemoryVulkan::Memory(UnigmaAllocationId allocation) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return (VkDeviceMemory)allocator.Info(allocation).block;
+}
+
+VkDeviceSize UnigmaDeviceMemoryVulkan::Offset(UnigmaAllocationId allocation) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocator.Info(allocation).offset;
+}
+
+void* UnigmaDeviceMemoryVulkan::Mapped(UnigmaAllocationId allocation) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocator.Info(allocation).mapped;
+}
+
+UnigmaMemoryStats UnigmaDeviceMemoryVulkan::Stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocator.TotalStats();
+}
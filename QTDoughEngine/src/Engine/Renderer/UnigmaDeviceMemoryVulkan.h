@@ -0,0 +1,47 @@
+#pragma once
+#include "UnigmaDeviceMemory.h"
+#include <vulkan/vulkan.h>
+#include <mutex>
+
+//Device backend of UnigmaDeviceMemory: blocks are VkDeviceMemory, host visible ones mapped once for their whole life.
+//Every block is allocated with the device address flag, so buffers used through their address can live in any of them.
+//Also creates and binds buffers and images in one call, the pooled counterpart of QTDoughApplication::CreateBuffer
+//and CreateImage. Calls are serialized, so loader and readback threads can share it.
+class UnigmaDeviceMemoryVulkan : public UnigmaMemoryBackend
+{
+public:
+    void Init(VkPhysicalDevice physicalDevice, VkDevice device, bool deviceAddress = true);
+    //Frees every block. The device must be idle.
+    void Destroy();
+
+    bool AllocateBlock(uint32_t memoryType, uint64_t size, uint64_t& block, void*& mapped) override;
+    void FreeBlock(uint64_t block) override;
+
+    void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer,
+        UnigmaAllocationId& allocation, UnigmaPoolId pool = UnigmaDefaultPool, bool movable = false);
+    void CreateImage(const VkImageCreateInfo& info, VkMemoryPropertyFlags properties, VkImage& image, UnigmaAllocationId& allocation);
+    void DestroyBuffer(VkBuffer& buffer, UnigmaAllocationId& allocation);
+    void DestroyImage(VkImage& image, UnigmaAllocationId& allocation);
+
+    VkDeviceMemory Memory(UnigmaAllocationId allocation) const;
+    VkDeviceSize Offset(UnigmaAllocationId allocation) const;
+    void* Mapped(UnigmaAllocationId allocation) const;
+    //Host visible, coherent, linear: for staging buffers freed once their copy completed.
+    UnigmaPoolId StagingPool() const { return stagingPool; }
+    UnigmaMemoryStats Stats() const;
+
+    //Direct access for pools and defragmentation; lock Mutex() around it when other threads allocate.
+    UnigmaDeviceMemory& Allocator() { return allocator; }
+    std::mutex& Mutex() { return mutex; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    bool deviceAddress = true;
+    std::vector<VkMemoryPropertyFlags> typeFlags;
+    UnigmaDeviceMemory allocator;
+    UnigmaPoolId stagingPool = UnigmaDefaultPool;
+    mutable std::mutex mutex;
+
+    UnigmaAllocationId Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+        UnigmaResourceClass resourceClass, UnigmaPoolId pool, bool movable);
+};
@@ -0,0 +1,246 @@
+#include "UnigmaPipelineCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+    const uint32_t FileMagic = 0x46435055; //"UPCF".
+    const uint32_t FileVersion = 1;
+    const size_t FileHeaderSize = 88;
+    //What every driver puts in front of its data, VK_PIPELINE_CACHE_HEADER_VERSION_ONE.
+    const size_t DriverHeaderSize = 32;
+    const uint32_t DriverHeaderVersion = 1;
+
+    template <typename T>
+    void Write(std::vector<uint8_t>& bytes, size_t offset, const T& value)
+    {
+        memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    template <typename T>
+    T Read(const uint8_t* bytes, size_t offset)
+    {
+        T value;
+        memcpy(&value, bytes + offset, sizeof(T));
+        return value;
+    }
+
+    uint64_t Checksum(const uint8_t* bytes, size_t size)
+    {
+        //FNV-1a.
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        return hash;
+    }
+
+    bool Fail(std::string* reason, const char* why)
+    {
+        if (reason)
+            *reason = why;
+        return false;
+    }
+}
+
+std::vector<uint8_t> UnigmaPipelineCacheFile::Pack(const UnigmaPipelineCacheIdentity& identity, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> file(FileHeaderSize + data.size(), 0);
+    Write(file, 0, FileMagic);
+    Write(file, 4, FileVersion);
+    Write(file, 8, identity.vendorID);
+    Write(file, 12, identity.deviceID);
+    Write(file, 16, identity.driverVersion);
+    memcpy(file.data() + 24, identity.deviceUUID, 16);
+    memcpy(file.data() + 40, identity.driverUUID, 16);
+    memcpy(file.data() + 56, identity.pipelineCacheUUID, 16);
+    Write(file, 72, (uint64_t)data.size());
+    Write(file, 80, Checksum(data.data(), data.size()));
+    if (!data.empty())
+        memcpy(file.data() + FileHeaderSize, data.data(), data.size());
+    return file;
+}
+
+bool UnigmaPipelineCacheFile::Unpack(const std::vector<uint8_t>& file, const UnigmaPipelineCacheIdentity& identity, std::vector<uint8_t>& data, std::string* reason)
+{
+    data.clear();
+    const uint8_t* bytes = file.data();
+    if (file.size() < FileHeaderSize || Read<uint32_t>(bytes, 0) != FileMagic)
+        return Fail(reason, "not a pipeline cache file");
+    if (Read<uint32_t>(bytes, 4) != FileVersion)
+        return Fail(reason, "file version changed");
+    if (Read<uint32_t>(bytes, 8) != identity.vendorID || Read<uint32_t>(bytes, 12) != identity.deviceID ||
+        memcmp(bytes + 24, identity.deviceUUID, 16) != 0)
+        return Fail(reason, "made on another device");
+    if (Read<uint32_t>(bytes, 16) != identity.driverVersion || memcmp(bytes + 40, identity.driverUUID, 16) != 0 ||
+        memcmp(bytes + 56, identity.pipelineCacheUUID, 16) != 0)
+        return Fail(reason, "made by another driver");
+
+    uint64_t size = Read<uint64_t>(bytes, 72);
+    if (size != file.size() - FileHeaderSize || Read<uint64_t>(bytes, 80) != Checksum(bytes + FileHeaderSize, (size_t)size))
+        return Fail(reason, "damaged");
+
+    //The driver's own header has to agree too, it is what the driver checks before trusting the rest.
+    const uint8_t* driver = bytes + FileHeaderSize;
+    if (size < DriverHeaderSize || Read<uint32_t>(driver, 0) < DriverHeaderSize || Read<uint32_t>(driver, 0) > size ||
+        Read<uint32_t>(driver, 4) != DriverHeaderVersion || Read<uint32_t>(driver, 8) != identity.vendorID ||
+        Read<uint32_t>(driver, 12) != identity.deviceID || memcmp(driver + 16, identity.pipelineCacheUUID, 16) != 0)
+        return Fail(reason, "driver data does not match its header");
+
+    data.assign(driver, driver + size);
+    return true;
+}
+
+bool UnigmaPipelineCacheFile::Load(const std::string& path, const UnigmaPipelineCacheIdentity& identity, std::vector<uint8_t>& data, std::string* reason)
+{
+    data.clear();
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open())
+        return Fail(reason, "");
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    return Unpack(file, identity, data, reason);
+}
+
+bool UnigmaPipelineCacheFile::Save(const std::string& path, const UnigmaPipelineCacheIdentity& identity, const std::vector<uint8_t>& data)
+{
+    //Unique per writer, runs started side by side each finish their own file.
+    std::string temporary = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    std::vector<uint8_t> file = Pack(identity, data);
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+        if (!stream.is_open())
+            return false;
+        stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+        if (!stream.good())
+        {
+            stream.close();
+            std::filesystem::remove(temporary);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+void UnigmaPipelineJobs::Start(uint32_t threads)
+{
+    if (!workers.empty())
+        return;
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    for (uint32_t i = 0; i < threads; i++)
+        workers.emplace_back([this]() { Worker(); });
+}
+
+void UnigmaPipelineJobs::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+    stopping = false;
+}
+
+void UnigmaPipelineJobs::Enqueue(const std::string& name, std::function<void()> run)
+{
+    Job job;
+    job.name = name;
+    job.run = std::move(run);
+    //Nobody waits on inline jobs, so their failure is thrown here.
+    if (workers.empty())
+    {
+        std::string error = Run(job);
+        if (!error.empty())
+            throw std::runtime_error(error);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+void UnigmaPipelineJobs::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&]() { return jobs.empty() && running == 0; });
+    if (!failure.empty())
+    {
+        std::string message = failure;
+        failure.clear();
+        throw std::runtime_error(message);
+    }
+}
+
+double UnigmaPipelineJobs::BusyMilliseconds() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return busyMilliseconds;
+}
+
+void UnigmaPipelineJobs::Worker()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || !jobs.empty(); });
+            //Stopping drains the queue first.
+            if (jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            running++;
+        }
+
+        std::string error = Run(job);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error.empty() && failure.empty())
+            failure = error;
+        running--;
+        if (jobs.empty() && running == 0)
+            idle.notify_all();
+    }
+}
+
+std::string UnigmaPipelineJobs::Run(Job& job)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    std::string error;
+    try
+    {
+        job.run();
+    }
+    catch (const std::exception& e)
+    {
+        error = "failed to create pipeline " + job.name + ": " + e.what();
+    }
+    catch (...)
+    {
+        error = "failed to create pipeline " + job.name + "!";
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    busyMilliseconds += ms;
+    completed++;
+    return error;
+}
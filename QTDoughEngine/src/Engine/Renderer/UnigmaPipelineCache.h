@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Startup spends most of its pipeline time compiling the same shaders as the run before. Two pieces cut that down:
+//  - UnigmaPipelineCacheFile keeps the driver's pipeline cache data on disk between runs. The file carries the device
+//    and driver it was made on (vendor, device, driver version and UUIDs); data from anything else is thrown away
+//    rather than handed to a driver that may crash on it. A checksum catches files cut short by a killed run.
+//  - UnigmaPipelineJobs creates pipelines on worker threads while the main thread goes on loading, and is waited on
+//    before the first frame. Pipeline creation and the cache are thread safe in Vulkan; the jobs only must not share
+//    anything else they write.
+//Nothing here touches Vulkan. UnigmaPipelineCacheVulkan reads the identity off the device and owns the VkPipelineCache.
+
+//Who made the cache data, from VkPhysicalDeviceProperties and VkPhysicalDeviceIDProperties.
+struct UnigmaPipelineCacheIdentity
+{
+    uint32_t vendorID = 0;
+    uint32_t deviceID = 0;
+    uint32_t driverVersion = 0;
+    uint8_t deviceUUID[16] = {};
+    uint8_t driverUUID[16] = {};
+    uint8_t pipelineCacheUUID[16] = {};
+};
+
+class UnigmaPipelineCacheFile
+{
+public:
+    //Header and identity followed by the driver data.
+    static std::vector<uint8_t> Pack(const UnigmaPipelineCacheIdentity& identity, const std::vector<uint8_t>& data);
+    //False with the reason when the file is damaged or was made by another device or driver.
+    static bool Unpack(const std::vector<uint8_t>& file, const UnigmaPipelineCacheIdentity& identity, std::vector<uint8_t>& data, std::string* reason = nullptr);
+
+    //A missing file is not an error worth a reason.
+    static bool Load(const std::string& path, const UnigmaPipelineCacheIdentity& identity, std::vector<uint8_t>& data, std::string* reason = nullptr);
+    //Written next to path and renamed over it, so a run killed halfway leaves the old file.
+    static bool Save(const std::string& path, const UnigmaPipelineCacheIdentity& identity, const std::vector<uint8_t>& data);
+};
+
+class UnigmaPipelineJobs
+{
+public:
+    UnigmaPipelineJobs() {}
+    ~UnigmaPipelineJobs() { Stop(); }
+    UnigmaPipelineJobs(const UnigmaPipelineJobs&) = delete;
+    UnigmaPipelineJobs& operator=(const UnigmaPipelineJobs&) = delete;
+
+    //0 takes one thread less than the hardware has. Until started, or once stopped, jobs run inline in Enqueue, which
+    //then throws their failure itself.
+    void Start(uint32_t threads = 0);
+    //Waits for the jobs left and joins the workers.
+    void Stop();
+
+    void Enqueue(const std::string& name, std::function<void()> job);
+    //Blocks until every job enqueued so far ran. Throws std::runtime_error naming the first job that threw.
+    void Wait();
+
+    uint32_t Threads() const { return (uint32_t)workers.size(); }
+    uint32_t Completed() const { return completed; }
+    //Summed over jobs; against the wall time it shows what running them in parallel saved.
+    double BusyMilliseconds() const;
+
+private:
+    struct Job
+    {
+        std::string name;
+        std::function<void()> run;
+    };
+
+    std::vector<std::thread> workers;
+    std::deque<Job> jobs;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    uint32_t running = 0;
+    bool stopping = false;
+    std::atomic<uint32_t> completed{ 0 };
+    double busyMilliseconds = 0.0;
+    std::string failure; //First job that threw, and why.
+
+    void Worker();
+    //Returns why the job failed, empty when it did not.
+    std::string Run(Job& job);
+};
@@ -0,0 +1,74 @@
+#include "UnigmaPipelineCacheVulkan.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+void UnigmaPipelineCacheVulkan::Init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, const std::string& cachePath)
+{
+    device = logicalDevice;
+    path = cachePath;
+
+    VkPhysicalDeviceIDProperties idProperties{};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    identity.vendorID = properties.properties.vendorID;
+    identity.deviceID = properties.properties.deviceID;
+    identity.driverVersion = properties.properties.driverVersion;
+    memcpy(identity.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+    memcpy(identity.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+    memcpy(identity.pipelineCacheUUID, properties.properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    std::vector<uint8_t> data;
+    std::string reason;
+    if (!UnigmaPipelineCacheFile::Load(path, identity, data, &reason) && !reason.empty())
+        std::cout << "Pipeline cache " << path << " discarded: " << reason << "." << std::endl;
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &cache) != VK_SUCCESS)
+    {
+        //The driver may still refuse data that passed every check; start over rather than fail.
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        data.clear();
+        if (vkCreatePipelineCache(device, &createInfo, nullptr, &cache) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+    if (!data.empty())
+        std::cout << "Pipeline cache: loaded " << data.size() / 1024 << " KB from " << path << "." << std::endl;
+}
+
+void UnigmaPipelineCacheVulkan::Save()
+{
+    if (cache == VK_NULL_HANDLE)
+        return;
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0)
+        return;
+    std::vector<uint8_t> data(size);
+    //VK_INCOMPLETE when pipelines created in between grew it; what fit is still a valid cache.
+    VkResult result = vkGetPipelineCacheData(device, cache, &size, data.data());
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE)
+        return;
+    data.resize(size);
+
+    if (!UnigmaPipelineCacheFile::Save(path, identity, data))
+        std::cout << "Pipeline cache: could not write " << path << "." << std::endl;
+}
+
+void UnigmaPipelineCacheVulkan::Destroy()
+{
+    if (cache == VK_NULL_HANDLE)
+        return;
+    Save();
+    vkDestroyPipelineCache(device, cache, nullptr);
+    cache = VK_NULL_HANDLE;
+}
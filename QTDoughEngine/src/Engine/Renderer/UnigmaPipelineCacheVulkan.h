@@ -0,0 +1,23 @@
+#pragma once
+#include "UnigmaPipelineCache.h"
+#include <vulkan/vulkan.h>
+
+//Device side of UnigmaPipelineCacheFile: one VkPipelineCache for every pipeline the app creates, seeded from the file
+//when it was made on this device and driver, and written back with whatever the run added.
+class UnigmaPipelineCacheVulkan
+{
+public:
+    void Init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path);
+    //Safe to call while pipelines are being created; what they have not added yet stays out.
+    void Save();
+    //Saves first.
+    void Destroy();
+
+    VkPipelineCache Handle() const { return cache; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    UnigmaPipelineCacheIdentity identity;
+    std::string path;
+};
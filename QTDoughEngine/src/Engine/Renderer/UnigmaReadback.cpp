@@ -0,0 +1,294 @@
+#include "UnigmaReadback.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        alignment = std::max<uint64_t>(alignment, 1);
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+void UnigmaReadbackService::Init(UnigmaReadbackQueue* readbackQueue, void* ringMemory, uint64_t ringBytes, const UnigmaReadbackSettings& readbackSettings)
+{
+    Release();
+    queue = readbackQueue;
+    ring = static_cast<uint8_t*>(ringMemory);
+    ringSize = ringBytes;
+    settings = readbackSettings;
+    submittedValue = completedValue = queue->CompletedValue();
+}
+
+void UnigmaReadbackService::Release()
+{
+    for (auto& [id, request] : requests)
+    {
+        if (request.snapshot != 0)
+            queue->DestroySnapshot(request.snapshot);
+    }
+    requests.clear();
+    inFlight.clear();
+    ringHead = ringTail = ringUsed = 0;
+    submittedBytes = 0;
+}
+
+UnigmaReadbackId UnigmaReadbackService::Enqueue(const UnigmaReadbackRequest& desc)
+{
+    if (desc.size == 0 || (!desc.destination && desc.size > ringSize))
+        return UnigmaNoReadback;
+    return Add(desc);
+}
+
+UnigmaReadbackId UnigmaReadbackService::Add(const UnigmaReadbackRequest& desc)
+{
+    UnigmaReadbackId id = nextId++;
+    if (nextId == UnigmaNoReadback)
+        nextId++;
+    Request& request = requests[id];
+    request.desc = desc;
+    request.frame = frame;
+    return id;
+}
+
+std::future<std::vector<uint8_t>> UnigmaReadbackService::EnqueueFuture(uint64_t source, uint64_t offset, uint64_t size, UnigmaReadbackPriority priority)
+{
+    auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+    std::future<std::vector<uint8_t>> future = promise->get_future();
+
+    if (size == 0)
+    {
+        promise->set_value({});
+        return future;
+    }
+
+    UnigmaReadbackRequest desc;
+    desc.source = source;
+    desc.offset = offset;
+    desc.size = size;
+    desc.priority = priority;
+    Request& request = requests[Add(desc)];
+    request.result.resize(size);
+    request.desc.destination = request.result.data();
+    request.promise = promise;
+    return future;
+}
+
+void UnigmaReadbackService::Pump()
+{
+    Retire();
+    Schedule(settings.frameBudget);
+    frame++;
+}
+
+void UnigmaReadbackService::Flush()
+{
+    while (true)
+    {
+        Retire();
+        Schedule(~0ull);
+        if (inFlight.empty())
+            break;
+        queue->Wait(submittedValue);
+    }
+}
+
+void UnigmaReadbackService::Wait(UnigmaReadbackId id)
+{
+    while (true)
+    {
+        Retire();
+        auto it = requests.find(id);
+        if (it == requests.end())
+            return;
+        if (it->second.scheduled < it->second.desc.size)
+            Schedule(~0ull, id);
+
+        //The last copy of the request, or the oldest copy when the ring was too full to take it.
+        uint64_t value = 0;
+        for (const InFlight& copy : inFlight)
+        {
+            if (copy.request == id)
+                value = copy.timelineValue;
+        }
+        if (value == 0 && !inFlight.empty())
+            value = inFlight.front().timelineValue;
+        if (value == 0)
+            return;
+        queue->Wait(value);
+    }
+}
+
+bool UnigmaReadbackService::Streams(const Request& request) const
+{
+    return request.desc.destination && (request.desc.size > settings.frameBudget || request.desc.size > ringSize);
+}
+
+bool UnigmaReadbackService::AllocateRing(uint64_t size, uint64_t& offset, uint64_t& ringBytes)
+{
+    if (ringUsed == 0)
+        ringHead = ringTail = 0;
+
+    //Copies in flight span [tail, head), or [tail, end) and [0, head) once the ring wrapped.
+    bool wrapped = ringUsed > 0 && ringHead <= ringTail;
+    uint64_t start = AlignUp(ringHead, settings.alignment);
+    if (!wrapped && start + size <= ringSize)
+        offset = start;
+    else if (!wrapped && size <= ringTail)
+        offset = 0;
+    else if (wrapped && start + size <= ringTail)
+        offset = start;
+    else
+        return false;
+
+    ringBytes = offset >= ringHead ? offset + size - ringHead : ringSize - ringHead + size;
+    ringHead = offset + size;
+    ringUsed += ringBytes;
+    return true;
+}
+
+void UnigmaReadbackService::Retire()
+{
+    completedValue = std::max(completedValue, queue->CompletedValue());
+    while (!inFlight.empty() && inFlight.front().timelineValue <= completedValue)
+    {
+        InFlight copy = inFlight.front();
+        inFlight.pop_front();
+        const uint8_t* data = ring + copy.ringOffset;
+
+        auto it = requests.find(copy.request);
+        if (it != requests.end())
+        {
+            Request& request = it->second;
+            if (request.desc.destination)
+                memcpy(static_cast<uint8_t*>(request.desc.destination) + copy.requestOffset, data, copy.size);
+            request.completed += copy.size;
+            if (request.completed == request.desc.size)
+            {
+                //Out of the map first, callbacks may enqueue again.
+                Request done = std::move(request);
+                requests.erase(it);
+                if (done.snapshot != 0)
+                    queue->DestroySnapshot(done.snapshot);
+                if (done.desc.callback)
+                    done.desc.callback(done.desc.destination ? done.desc.destination : data, done.desc.size);
+                if (done.promise)
+                    done.promise->set_value(std::move(done.result));
+            }
+        }
+
+        ringUsed -= copy.ringBytes;
+        ringTail = copy.ringOffset + copy.size;
+    }
+}
+
+void UnigmaReadbackService::Schedule(uint64_t budget, UnigmaReadbackId only)
+{
+    std::vector<UnigmaReadbackCopy> copies;
+    uint64_t value = submittedValue + 1;
+    submittedBytes = 0;
+
+    //Snapshots of every new streamed request, ahead of the copies that may read them. They stay on the device, so the
+    //budget does not hold them back; taking them now is what keeps each request to the frame it was enqueued on.
+    for (auto& [id, request] : requests)
+    {
+        if (request.snapshot != 0 || !Streams(request))
+            continue;
+        request.snapshot = queue->CreateSnapshot(request.desc.size);
+        UnigmaReadbackCopy copy;
+        copy.source = request.desc.source;
+        copy.sourceOffset = request.desc.offset;
+        copy.size = request.desc.size;
+        copy.snapshot = request.snapshot;
+        copies.push_back(copy);
+    }
+
+    //Waiting requests climb a level every agingFrames frames so a stream of high priority ones cannot starve them.
+    uint64_t aging = std::max<uint32_t>(settings.agingFrames, 1);
+    auto rank = [&](const Request& request) { return (uint64_t)request.desc.priority + (frame - request.frame) / aging; };
+
+    std::vector<UnigmaReadbackId> order;
+    for (auto& [id, request] : requests)
+    {
+        if (request.scheduled < request.desc.size && (only == UnigmaNoReadback || id == only))
+            order.push_back(id);
+    }
+    std::sort(order.begin(), order.end(), [&](UnigmaReadbackId a, UnigmaReadbackId b) {
+        uint64_t rankA = rank(requests[a]);
+        uint64_t rankB = rank(requests[b]);
+        return rankA != rankB ? rankA > rankB : a < b;
+    });
+
+    //Stops at the first request that does not fit, lower ones do not overtake it.
+    bool full = false;
+    for (size_t i = 0; i < order.size() && !full; i++)
+    {
+        Request& request = requests[order[i]];
+        //Whole requests take one copy, snapshots stream in chunks.
+        while (request.scheduled < request.desc.size)
+        {
+            uint64_t size = request.desc.size - request.scheduled;
+            uint64_t source = request.desc.source;
+            uint64_t sourceOffset = request.desc.offset + request.scheduled;
+            if (request.snapshot != 0)
+            {
+                if (settings.chunkSize > 0)
+                    size = std::min(size, settings.chunkSize);
+                size = std::min(size, ringSize);
+                source = request.snapshot;
+                sourceOffset = request.scheduled;
+            }
+
+            uint64_t ringOffset = 0;
+            uint64_t ringBytes = 0;
+            if ((submittedBytes > 0 && submittedBytes + size > budget) || !AllocateRing(size, ringOffset, ringBytes))
+            {
+                full = true;
+                break;
+            }
+
+            UnigmaReadbackCopy copy;
+            copy.source = source;
+            copy.sourceOffset = sourceOffset;
+            copy.ringOffset = ringOffset;
+            copy.size = size;
+            copies.push_back(copy);
+
+            InFlight flight;
+            flight.timelineValue = value;
+            flight.request = order[i];
+            flight.requestOffset = request.scheduled;
+            flight.ringOffset = ringOffset;
+            flight.size = size;
+            flight.ringBytes = ringBytes;
+            inFlight.push_back(flight);
+
+            request.scheduled += size;
+            submittedBytes += size;
+        }
+    }
+
+    if (copies.empty())
+        return;
+    submittedValue = value;
+    queue->Submit(copies, value);
+}
+
+UnigmaReadbackStats UnigmaReadbackService::Stats() const
+{
+    UnigmaReadbackStats stats;
+    stats.pending = (uint32_t)requests.size();
+    for (auto& [id, request] : requests)
+    {
+        stats.pendingBytes += request.desc.size - request.scheduled;
+        if (request.snapshot != 0)
+            stats.snapshotBytes += request.desc.size;
+    }
+    for (const InFlight& copy : inFlight)
+        stats.inFlightBytes += copy.size;
+    stats.submittedBytes = submittedBytes;
+    stats.submittedValue = submittedValue;
+    stats.completedValue = completedValue;
+    return stats;
+}
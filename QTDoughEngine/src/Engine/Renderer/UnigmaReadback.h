@@ -0,0 +1,167 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//Copies device buffers back to the host without stalling the frame. Callers enqueue a request and get its result on
+//a later frame, through a callback or a future, instead of creating a staging buffer and waiting on the copy.
+//Every copy lands in one persistently mapped staging ring. Once per frame Pump retires the copies the device has
+//finished, which hands the data over and frees their ring space, then schedules the next batch:
+//  - highest priority first, requests waiting longer climb one priority level every agingFrames frames,
+//  - no more than frameBudget bytes per frame, so a full grid readback does not eat the transfer time of a frame,
+//  - a request goes out whole in one batch, so all of it comes from the same frame. Requests with a destination that
+//    are larger than the budget or the ring are first copied into a snapshot, a device buffer of their own, in the
+//    first batch after they were enqueued. Chunks of the snapshot then stream through the ring over the next frames.
+//    Requests without a destination must fit the ring.
+//Each batch is tagged with the next value of a timeline, which the queue signals once its copies completed.
+//Nothing here touches Vulkan: batches go to a UnigmaReadbackQueue, which tests fake. UnigmaReadbackVulkan records them
+//into a command buffer signaling a timeline semaphore. Not thread safe; enqueue and pump from the render thread.
+
+enum class UnigmaReadbackPriority : uint32_t
+{
+    Low = 0, //Debug dumps and serialization.
+    Normal,
+    High, //Small values the next frames depend on.
+};
+
+//One copy of a batch, from a device buffer into the ring or into a snapshot.
+struct UnigmaReadbackCopy
+{
+    uint64_t source = 0; //Backend handle, the VkBuffer.
+    uint64_t sourceOffset = 0;
+    uint64_t ringOffset = 0; //Offset in the snapshot when there is one.
+    uint64_t size = 0;
+    uint64_t snapshot = 0; //Copies into this snapshot instead of the ring. Batches list these first.
+};
+
+//Where the batches go.
+class UnigmaReadbackQueue
+{
+public:
+    virtual ~UnigmaReadbackQueue() {}
+    //Copies after all previously submitted device work, then signals timelineValue. Values only increase.
+    virtual void Submit(const std::vector<UnigmaReadbackCopy>& copies, uint64_t timelineValue) = 0;
+    virtual uint64_t CompletedValue() = 0;
+    //Blocks until timelineValue is signaled.
+    virtual void Wait(uint64_t timelineValue) = 0;
+
+    //Device buffer of size bytes that copies can target and read from, a backend handle like the sources.
+    virtual uint64_t CreateSnapshot(uint64_t size) = 0;
+    //Called once no batch using it is in flight.
+    virtual void DestroySnapshot(uint64_t snapshot) = 0;
+};
+
+//Data points at the destination when the request has one, otherwise into the ring and is only valid during the call.
+using UnigmaReadbackCallback = std::function<void(const void* data, uint64_t size)>;
+
+struct UnigmaReadbackRequest
+{
+    uint64_t source = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    void* destination = nullptr; //Filled before the callback. Lets requests larger than the budget or ring stream over frames.
+    UnigmaReadbackPriority priority = UnigmaReadbackPriority::Normal;
+    UnigmaReadbackCallback callback;
+};
+
+using UnigmaReadbackId = uint32_t;
+const UnigmaReadbackId UnigmaNoReadback = 0;
+
+struct UnigmaReadbackSettings
+{
+    uint64_t frameBudget = 32ull << 20; //Bytes scheduled per Pump. A lone request over it still goes through.
+    uint64_t chunkSize = 4ull << 20; //Largest copy a snapshot is streamed in.
+    uint64_t alignment = 256; //Of copies in the ring, at least the device's optimal copy offset alignment.
+    uint32_t agingFrames = 8;
+};
+
+struct UnigmaReadbackStats
+{
+    uint32_t pending = 0; //Requests not completed yet, partly submitted ones included.
+    uint64_t pendingBytes = 0; //Still to be submitted.
+    uint64_t inFlightBytes = 0;
+    uint64_t snapshotBytes = 0; //Held in snapshots until their requests complete.
+    uint64_t submittedBytes = 0; //By the last Pump.
+    uint64_t submittedValue = 0;
+    uint64_t completedValue = 0;
+};
+
+class UnigmaReadbackService
+{
+public:
+    UnigmaReadbackService() {}
+    UnigmaReadbackService(const UnigmaReadbackService&) = delete;
+    UnigmaReadbackService& operator=(const UnigmaReadbackService&) = delete;
+
+    //ring is the mapped staging memory the queue copies into, ringSize bytes long.
+    void Init(UnigmaReadbackQueue* queue, void* ring, uint64_t ringSize, const UnigmaReadbackSettings& settings = UnigmaReadbackSettings());
+    //Drops every request without calling back. The queue must be idle.
+    void Release();
+
+    //UnigmaNoReadback for empty requests and ones without destination that do not fit the ring.
+    UnigmaReadbackId Enqueue(const UnigmaReadbackRequest& request);
+    //The bytes read, once the copy completed.
+    std::future<std::vector<uint8_t>> EnqueueFuture(uint64_t source, uint64_t offset, uint64_t size,
+        UnigmaReadbackPriority priority = UnigmaReadbackPriority::Normal);
+    bool Pending(UnigmaReadbackId id) const { return requests.count(id) != 0; }
+
+    //Once per frame, after the frame's work is submitted: calls back what completed and submits the next batch.
+    void Pump();
+    //Submits everything regardless of the budget and waits for it, for shutdown.
+    void Flush();
+    //Submits id ahead of the rest and waits until it was handed over, for the odd synchronous readback. Other requests
+    //keep their place and budget; only copies ahead of it in the queue are waited on.
+    void Wait(UnigmaReadbackId id);
+
+    UnigmaReadbackStats Stats() const;
+
+private:
+    struct Request
+    {
+        UnigmaReadbackRequest desc;
+        uint64_t scheduled = 0; //Bytes submitted so far.
+        uint64_t completed = 0;
+        uint64_t frame = 0; //Enqueued on.
+        uint64_t snapshot = 0; //Taken on the first batch after Enqueue when the request streams over frames.
+        std::shared_ptr<std::promise<std::vector<uint8_t>>> promise;
+        std::vector<uint8_t> result; //Destination of future requests.
+    };
+
+    struct InFlight
+    {
+        uint64_t timelineValue = 0;
+        UnigmaReadbackId request = UnigmaNoReadback;
+        uint64_t requestOffset = 0; //Of the chunk in the request.
+        uint64_t ringOffset = 0;
+        uint64_t size = 0;
+        uint64_t ringBytes = 0; //Size plus alignment and wrap padding, given back on retire.
+    };
+
+    UnigmaReadbackQueue* queue = nullptr;
+    uint8_t* ring = nullptr;
+    uint64_t ringSize = 0;
+    uint64_t ringHead = 0; //Next free byte.
+    uint64_t ringTail = 0; //Start of the oldest copy in flight.
+    uint64_t ringUsed = 0;
+    UnigmaReadbackSettings settings;
+
+    std::unordered_map<UnigmaReadbackId, Request> requests;
+    std::deque<InFlight> inFlight; //In submission order, so by timeline value and ring position.
+    UnigmaReadbackId nextId = 1;
+    uint64_t frame = 0;
+    uint64_t submittedValue = 0;
+    uint64_t completedValue = 0;
+    uint64_t submittedBytes = 0;
+
+    UnigmaReadbackId Add(const UnigmaReadbackRequest& desc);
+    void Retire();
+    //only limits the ring copies to that request; snapshots of new streamed requests are taken either way.
+    void Schedule(uint64_t budget, UnigmaReadbackId only = UnigmaNoReadback);
+    //Too large to go out whole in one batch.
+    bool Streams(const Request& request) const;
+    bool AllocateRing(uint64_t size, uint64_t& offset, uint64_t& ringBytes);
+};
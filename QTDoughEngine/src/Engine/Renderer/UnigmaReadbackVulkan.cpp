@@ -0,0 +1,213 @@
+#include "UnigmaReadbackVulkan.h"
+#include <stdexcept>
+
+void UnigmaReadbackVulkan::Init(VkDevice logicalDevice, VkQueue submitQueue, uint32_t queueFamily, UnigmaDeviceMemoryVulkan& deviceMemory,
+    UnigmaReadbackService& service, VkDeviceSize ringSize, const UnigmaReadbackSettings& settings)
+{
+    device = logicalDevice;
+    queue = submitQueue;
+    memory = &deviceMemory;
+    lastValue = 0;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create readback command pool!");
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create readback timeline semaphore!");
+    }
+
+    memory->CreateBuffer(ringSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ring, ringAllocation);
+    service.Init(this, memory->Mapped(ringAllocation), ringSize, settings);
+}
+
+void UnigmaReadbackVulkan::Destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+    Wait(lastValue);
+    for (auto& [value, cmd] : pending)
+        spare.push_back(cmd);
+    pending.clear();
+    if (!spare.empty())
+        vkFreeCommandBuffers(device, commandPool, (uint32_t)spare.size(), spare.data());
+    spare.clear();
+    for (auto& [handle, allocation] : snapshots)
+    {
+        VkBuffer buffer = (VkBuffer)handle;
+        memory->DestroyBuffer(buffer, allocation);
+    }
+    snapshots.clear();
+
+    memory->DestroyBuffer(ring, ringAllocation);
+    vkDestroySemaphore(device, timeline, nullptr);
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    timeline = VK_NULL_HANDLE;
+    commandPool = VK_NULL_HANDLE;
+    device = VK_NULL_HANDLE;
+}
+
+void UnigmaReadbackVulkan::Submit(const std::vector<UnigmaReadbackCopy>& copies, uint64_t timelineValue)
+{
+    //Recycle the command buffers of completed batches.
+    uint64_t completed = CompletedValue();
+    while (!pending.empty() && pending.front().first <= completed)
+    {
+        spare.push_back(pending.front().second);
+        pending.pop_front();
+    }
+
+    VkCommandBuffer cmd;
+    if (spare.empty())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &cmd) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate readback command buffer!");
+        }
+    }
+    else
+    {
+        cmd = spare.back();
+        spare.pop_back();
+        vkResetCommandBuffer(cmd, 0);
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &beginInfo);
+
+    //Sources were last written by whatever was submitted before, compute passes mostly.
+    VkMemoryBarrier2 before{};
+    before.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    before.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    before.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    before.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    before.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    VkDependencyInfo beforeDep{};
+    beforeDep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    beforeDep.memoryBarrierCount = 1;
+    beforeDep.pMemoryBarriers = &before;
+    vkCmdPipelineBarrier2(cmd, &beforeDep);
+
+    //Consecutive copies between the same buffers, the chunks of a snapshot, go in one command.
+    std::vector<VkBufferCopy> regions;
+    for (size_t i = 0; i < copies.size(); i++)
+    {
+        VkBufferCopy region{};
+        region.srcOffset = copies[i].sourceOffset;
+        region.dstOffset = copies[i].ringOffset;
+        region.size = copies[i].size;
+        regions.push_back(region);
+        bool last = i + 1 == copies.size();
+        if (last || copies[i + 1].source != copies[i].source || copies[i + 1].snapshot != copies[i].snapshot)
+        {
+            VkBuffer destination = copies[i].snapshot != 0 ? (VkBuffer)copies[i].snapshot : ring;
+            vkCmdCopyBuffer(cmd, (VkBuffer)copies[i].source, destination, (uint32_t)regions.size(), regions.data());
+            regions.clear();
+        }
+
+        //Snapshots come first, the ring copies after them may read one.
+        if (copies[i].snapshot != 0 && !last && copies[i + 1].snapshot == 0)
+        {
+            VkMemoryBarrier2 snapshotBarrier{};
+            snapshotBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+            snapshotBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+            snapshotBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            snapshotBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+            snapshotBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+            VkDependencyInfo snapshotDep{};
+            snapshotDep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            snapshotDep.memoryBarrierCount = 1;
+            snapshotDep.pMemoryBarriers = &snapshotBarrier;
+            vkCmdPipelineBarrier2(cmd, &snapshotDep);
+        }
+    }
+
+    VkMemoryBarrier2 after{};
+    after.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    after.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    after.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    after.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    after.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    VkDependencyInfo afterDep{};
+    afterDep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    afterDep.memoryBarrierCount = 1;
+    afterDep.pMemoryBarriers = &after;
+    vkCmdPipelineBarrier2(cmd, &afterDep);
+    vkEndCommandBuffer(cmd);
+
+    VkCommandBufferSubmitInfo cmdInfo{};
+    cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    cmdInfo.commandBuffer = cmd;
+    VkSemaphoreSubmitInfo signal{};
+    signal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal.semaphore = timeline;
+    signal.value = timelineValue;
+    signal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    VkSubmitInfo2 submit{};
+    submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submit.commandBufferInfoCount = 1;
+    submit.pCommandBufferInfos = &cmdInfo;
+    submit.signalSemaphoreInfoCount = 1;
+    submit.pSignalSemaphoreInfos = &signal;
+    if (vkQueueSubmit2(queue, 1, &submit, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit readback copies!");
+    }
+
+    pending.push_back({ timelineValue, cmd });
+    lastValue = timelineValue;
+}
+
+uint64_t UnigmaReadbackVulkan::CompletedValue()
+{
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(device, timeline, &value);
+    return value;
+}
+
+void UnigmaReadbackVulkan::Wait(uint64_t timelineValue)
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &timelineValue;
+    vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+}
+
+uint64_t UnigmaReadbackVulkan::CreateSnapshot(uint64_t size)
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    UnigmaAllocationId allocation = UnigmaNoAllocation;
+    memory->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, allocation);
+    snapshots[(uint64_t)buffer] = allocation;
+    return (uint64_t)buffer;
+}
+
+void UnigmaReadbackVulkan::DestroySnapshot(uint64_t snapshot)
+{
+    auto it = snapshots.find(snapshot);
+    if (it == snapshots.end())
+        return;
+    VkBuffer buffer = (VkBuffer)snapshot;
+    memory->DestroyBuffer(buffer, it->second);
+    snapshots.erase(it);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "UnigmaReadback.h"
+#include "UnigmaDeviceMemoryVulkan.h"
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+//Device queue of UnigmaReadbackService. Owns the staging ring, a host visible buffer mapped for its whole life, and
+//a timeline semaphore whose counter is the service's timeline. Each batch is one command buffer on the given queue:
+//a barrier against everything submitted before it, the copies into snapshots and a barrier after them, the copies into
+//the ring, and a barrier making them visible to the host. Snapshots are device local buffers out of memory.
+class UnigmaReadbackVulkan : public UnigmaReadbackQueue
+{
+public:
+    //Creates the ring out of memory and starts service on it.
+    void Init(VkDevice device, VkQueue queue, uint32_t queueFamily, UnigmaDeviceMemoryVulkan& memory, UnigmaReadbackService& service,
+        VkDeviceSize ringSize = 64ull << 20, const UnigmaReadbackSettings& settings = UnigmaReadbackSettings());
+    //Waits for the last batch. Release the service first.
+    void Destroy();
+
+    void Submit(const std::vector<UnigmaReadbackCopy>& copies, uint64_t timelineValue) override;
+    uint64_t CompletedValue() override;
+    void Wait(uint64_t timelineValue) override;
+    uint64_t CreateSnapshot(uint64_t size) override;
+    void DestroySnapshot(uint64_t snapshot) override;
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkSemaphore timeline = VK_NULL_HANDLE;
+    VkBuffer ring = VK_NULL_HANDLE;
+    UnigmaAllocationId ringAllocation = UnigmaNoAllocation;
+    UnigmaDeviceMemoryVulkan* memory = nullptr;
+    uint64_t lastValue = 0;
+    std::deque<std::pair<uint64_t, VkCommandBuffer>> pending; //Command buffers of batches in flight, by value.
+    std::vector<VkCommandBuffer> spare;
+    std::unordered_map<uint64_t, UnigmaAllocationId> snapshots; //By VkBuffer.
+};
@@ -0,0 +1,515 @@
+#include "UnigmaRenderGraph.h"
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        alignment = std::max<uint64_t>(alignment, 1);
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool NeedsLayout(RGUsage usage)
+    {
+        return usage != RGUsage::StorageRead && usage != RGUsage::StorageWrite && usage != RGUsage::StorageReadWrite &&
+            usage != RGUsage::TransferSrc && usage != RGUsage::TransferDst && usage != RGUsage::Uniform &&
+            usage != RGUsage::Vertex && usage != RGUsage::Indirect;
+    }
+
+    bool BufferOnly(RGUsage usage)
+    {
+        return usage == RGUsage::Uniform || usage == RGUsage::Vertex || usage == RGUsage::Indirect;
+    }
+
+    //Where a resource stands while the barriers are planned.
+    struct ResourceState
+    {
+        bool touched = false;
+        RGLayout layout = RGLayout::Undefined;
+        uint32_t writeStages = RGStageNone; //Last write, or the layout transition standing in for one.
+        uint32_t writeAccess = RGAccessNone;
+        bool unflushed = false; //The last write has no barrier behind it yet.
+        uint32_t readStages = RGStageNone; //Reads since then.
+        int32_t pendingPass = -1; //Barrier in front of the first of those reads, widened for the later ones.
+        int32_t pendingBarrier = -1;
+    };
+
+    const char* LayoutName(RGLayout layout)
+    {
+        static const char* names[] = { "undefined", "general", "color_attachment", "depth_attachment", "depth_read_only",
+            "shader_read_only", "transfer_src", "transfer_dst", "present" };
+        return names[uint32_t(layout)];
+    }
+
+    const char* PassTypeName(RGPassType type)
+    {
+        static const char* names[] = { "graphics", "compute", "ray_tracing", "transfer" };
+        return names[uint32_t(type)];
+    }
+
+    std::string BitNames(uint32_t bits, const char* const* names, uint32_t count)
+    {
+        if (bits == 0)
+            return "none";
+        std::string out;
+        for (uint32_t i = 0; i < count; i++)
+            if (bits & (1u << i))
+                out += (out.empty() ? "" : "|") + std::string(names[i]);
+        return out;
+    }
+
+    std::string StageNames(uint32_t bits)
+    {
+        static const char* names[] = { "draw_indirect", "vertex_input", "vertex", "fragment", "early_tests", "late_tests",
+            "color_output", "compute", "ray_tracing", "transfer", "all" };
+        return BitNames(bits, names, 11);
+    }
+
+    std::string AccessNames(uint32_t bits)
+    {
+        static const char* names[] = { "indirect_read", "vertex_read", "uniform_read", "sampled_read", "storage_read",
+            "storage_write", "color_read", "color_write", "depth_read", "depth_write", "transfer_read", "transfer_write",
+            "memory_write" };
+        return BitNames(bits, names, 13);
+    }
+}
+
+uint32_t UnigmaRenderGraph::CreateTransient(const std::string& name, const RGResourceDesc& desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resources.push_back(resource);
+    return (uint32_t)resources.size() - 1;
+}
+
+uint32_t UnigmaRenderGraph::Import(const std::string& name, const RGResourceDesc& desc, bool exported)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = true;
+    resource.exported = exported;
+    resources.push_back(resource);
+    return (uint32_t)resources.size() - 1;
+}
+
+uint32_t UnigmaRenderGraph::AddPass(const std::string& name, RGPassType type, bool sideEffects)
+{
+    Pass pass;
+    pass.name = name;
+    pass.type = type;
+    pass.sideEffects = sideEffects;
+    passes.push_back(pass);
+    return (uint32_t)passes.size() - 1;
+}
+
+void UnigmaRenderGraph::Use(uint32_t pass, uint32_t resource, RGUsage usage)
+{
+    ResourceUse use;
+    use.resource = resource;
+    use.usage = usage;
+    passes[pass].uses.push_back(use);
+}
+
+std::vector<RGUsage> UnigmaRenderGraph::Usages(uint32_t resource) const
+{
+    std::vector<RGUsage> usages;
+    for (const Pass& pass : passes)
+        for (const ResourceUse& use : pass.uses)
+            if (use.resource == resource)
+                usages.push_back(use.usage);
+    return usages;
+}
+
+void UnigmaRenderGraph::UsageState(RGUsage usage, RGPassType type, uint32_t& stages, uint32_t& access, RGLayout& layout)
+{
+    uint32_t shader = RGStageTransfer;
+    if (type == RGPassType::Graphics) shader = RGStageVertexShader | RGStageFragmentShader;
+    else if (type == RGPassType::Compute) shader = RGStageCompute;
+    else if (type == RGPassType::RayTracing) shader = RGStageRayTracing;
+
+    const uint32_t depthTests = RGStageEarlyFragmentTests | RGStageLateFragmentTests;
+    layout = RGLayout::Undefined;
+    switch (usage)
+    {
+    case RGUsage::ColorAttachment: stages = RGStageColorOutput; access = RGAccessColorWrite; layout = RGLayout::ColorAttachment; break;
+    case RGUsage::ColorAttachmentBlend: stages = RGStageColorOutput; access = RGAccessColorRead | RGAccessColorWrite; layout = RGLayout::ColorAttachment; break;
+    case RGUsage::DepthAttachment: stages = depthTests; access = RGAccessDepthRead | RGAccessDepthWrite; layout = RGLayout::DepthAttachment; break;
+    case RGUsage::DepthRead: stages = depthTests; access = RGAccessDepthRead; layout = RGLayout::DepthReadOnly; break;
+    case RGUsage::Sampled: stages = shader; access = RGAccessSampledRead; layout = RGLayout::ShaderReadOnly; break;
+    case RGUsage::StorageRead: stages = shader; access = RGAccessStorageRead; layout = RGLayout::General; break;
+    case RGUsage::StorageWrite: stages = shader; access = RGAccessStorageWrite; layout = RGLayout::General; break;
+    case RGUsage::StorageReadWrite: stages = shader; access = RGAccessStorageRead | RGAccessStorageWrite; layout = RGLayout::General; break;
+    case RGUsage::TransferSrc: stages = RGStageTransfer; access = RGAccessTransferRead; layout = RGLayout::TransferSrc; break;
+    case RGUsage::TransferDst: stages = RGStageTransfer; access = RGAccessTransferWrite; layout = RGLayout::TransferDst; break;
+    case RGUsage::Uniform: stages = shader; access = RGAccessUniformRead; break;
+    case RGUsage::Vertex: stages = RGStageVertexInput; access = RGAccessVertexRead; break;
+    case RGUsage::Indirect: stages = RGStageDrawIndirect; access = RGAccessIndirectRead; break;
+    default: stages = RGStageAllCommands; access = RGAccessMemoryWrite; break;
+    }
+}
+
+bool UnigmaRenderGraph::UsageReads(RGUsage usage)
+{
+    return usage != RGUsage::ColorAttachment && usage != RGUsage::DepthAttachment && usage != RGUsage::StorageWrite &&
+        usage != RGUsage::TransferDst;
+}
+
+bool UnigmaRenderGraph::UsageWrites(RGUsage usage)
+{
+    return usage == RGUsage::ColorAttachment || usage == RGUsage::ColorAttachmentBlend || usage == RGUsage::DepthAttachment ||
+        usage == RGUsage::StorageWrite || usage == RGUsage::StorageReadWrite || usage == RGUsage::TransferDst;
+}
+
+bool UnigmaRenderGraph::Compile(RGCompiled& out, std::string* error) const
+{
+    out = RGCompiled();
+
+    for (const Pass& pass : passes)
+        for (size_t i = 0; i < pass.uses.size(); i++)
+        {
+            const ResourceUse& use = pass.uses[i];
+            const Resource& resource = resources[use.resource];
+            const char* problem = nullptr;
+            if (resource.desc.kind == RGResourceKind::Buffer && NeedsLayout(use.usage))
+                problem = " uses a buffer as an image: ";
+            else if (resource.desc.kind == RGResourceKind::Image && BufferOnly(use.usage))
+                problem = " uses an image as a buffer: ";
+            for (size_t j = 0; j < i && problem == nullptr; j++)
+                if (pass.uses[j].resource == use.resource)
+                    problem = " uses a resource twice: ";
+            if (problem != nullptr)
+            {
+                if (error != nullptr)
+                    *error = "pass " + pass.name + problem + resource.name;
+                return false;
+            }
+        }
+
+    std::vector<uint8_t> kept;
+    Cull(kept);
+    for (uint32_t p = 0; p < passes.size(); p++)
+    {
+        if (!kept[p])
+        {
+            out.culled.push_back(p);
+            continue;
+        }
+        RGCompiledPass compiled;
+        compiled.pass = p;
+        out.passes.push_back(compiled);
+    }
+
+    PlaceTransients(out);
+    return PlanBarriers(out, error);
+}
+
+void UnigmaRenderGraph::Cull(std::vector<uint8_t>& kept) const
+{
+    kept.assign(passes.size(), 0);
+
+    //Walking backwards, needed[r] says a kept pass further on reads the contents r has at this point.
+    std::vector<uint8_t> needed(resources.size(), 0);
+    for (uint32_t r = 0; r < resources.size(); r++)
+        needed[r] = resources[r].exported;
+
+    for (size_t p = passes.size(); p-- > 0;)
+    {
+        const Pass& pass = passes[p];
+        bool keep = pass.sideEffects;
+        for (const ResourceUse& use : pass.uses)
+            keep = keep || (UsageWrites(use.usage) && needed[use.resource]);
+        if (!keep)
+            continue;
+
+        kept[p] = 1;
+        for (const ResourceUse& use : pass.uses)
+            if (UsageWrites(use.usage))
+                needed[use.resource] = 0;
+        for (const ResourceUse& use : pass.uses)
+            if (UsageReads(use.usage))
+                needed[use.resource] = 1;
+    }
+}
+
+void UnigmaRenderGraph::PlaceTransients(RGCompiled& out) const
+{
+    out.placements.assign(resources.size(), RGPlacement());
+    std::vector<uint8_t> used(resources.size(), 0);
+    for (uint32_t i = 0; i < out.passes.size(); i++)
+        for (const ResourceUse& use : passes[out.passes[i].pass].uses)
+        {
+            RGPlacement& placement = out.placements[use.resource];
+            if (!used[use.resource])
+                placement.firstPass = i;
+            placement.lastPass = i;
+            used[use.resource] = 1;
+        }
+
+    //Largest first, so the small ones fill the gaps between them.
+    std::vector<uint32_t> order;
+    for (uint32_t r = 0; r < resources.size(); r++)
+        if (used[r] && !resources[r].imported)
+            order.push_back(r);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (resources[a].desc.size != resources[b].desc.size)
+            return resources[a].desc.size > resources[b].desc.size;
+        return out.placements[a].firstPass != out.placements[b].firstPass ? out.placements[a].firstPass < out.placements[b].firstPass : a < b;
+    });
+
+    std::vector<uint32_t> placed;
+    std::vector<std::pair<uint64_t, uint64_t>> taken;
+    for (uint32_t r : order)
+    {
+        const RGResourceDesc& desc = resources[r].desc;
+        RGPlacement& placement = out.placements[r];
+        out.stats.transientBytes += desc.size;
+
+        uint32_t heap = 0;
+        while (heap < out.heaps.size() && out.heaps[heap].memoryTypeBits != desc.memoryTypeBits)
+            heap++;
+        if (heap == out.heaps.size())
+        {
+            RGHeap created;
+            created.memoryTypeBits = desc.memoryTypeBits;
+            out.heaps.push_back(created);
+        }
+
+        //Memory held by everything in this heap that is alive at the same time.
+        taken.clear();
+        for (uint32_t other : placed)
+        {
+            const RGPlacement& o = out.placements[other];
+            if (o.heap == heap && o.firstPass <= placement.lastPass && placement.firstPass <= o.lastPass)
+                taken.push_back({ o.offset, o.offset + resources[other].desc.size });
+        }
+        std::sort(taken.begin(), taken.end());
+
+        uint64_t offset = 0;
+        for (const auto& range : taken)
+        {
+            if (offset + desc.size <= range.first)
+                break;
+            offset = std::max(offset, AlignUp(range.second, desc.alignment));
+        }
+
+        placement.heap = heap;
+        placement.offset = offset;
+        out.heaps[heap].size = std::max(out.heaps[heap].size, offset + desc.size);
+        placed.push_back(r);
+    }
+
+    for (const RGHeap& heap : out.heaps)
+        out.stats.heapBytes += heap.size;
+}
+
+bool UnigmaRenderGraph::PlanBarriers(RGCompiled& out, std::string* error) const
+{
+    std::vector<ResourceState> states(resources.size());
+
+    for (uint32_t i = 0; i < out.passes.size(); i++)
+    {
+        RGCompiledPass& compiled = out.passes[i];
+        const Pass& pass = passes[compiled.pass];
+        auto emit = [&](ResourceState& st, uint32_t resource, uint32_t srcStages, uint32_t srcAccess, uint32_t dstStages,
+            uint32_t dstAccess, RGLayout newLayout, bool aliasing) {
+            RGBarrier barrier;
+            barrier.resource = resource;
+            barrier.srcStages = srcStages;
+            barrier.srcAccess = srcAccess;
+            barrier.dstStages = dstStages;
+            barrier.dstAccess = dstAccess;
+            barrier.oldLayout = st.layout;
+            barrier.newLayout = newLayout;
+            barrier.aliasing = aliasing;
+            compiled.barriers.push_back(barrier);
+            st.layout = newLayout;
+            return (int32_t)compiled.barriers.size() - 1;
+        };
+
+        for (const ResourceUse& use : pass.uses)
+        {
+            const Resource& resource = resources[use.resource];
+            ResourceState& st = states[use.resource];
+            bool image = resource.desc.kind == RGResourceKind::Image;
+            bool reads = UsageReads(use.usage);
+            bool writes = UsageWrites(use.usage);
+            uint32_t stages, access;
+            RGLayout layout;
+            UsageState(use.usage, pass.type, stages, access, layout);
+            out.stats.uses++;
+
+            if (!st.touched && !resource.imported)
+            {
+                if (reads)
+                {
+                    if (error != nullptr)
+                        *error = "pass " + pass.name + " reads transient " + resource.name + " before anything writes it";
+                    return false;
+                }
+
+                //Whatever used this memory before has to be done with it.
+                const RGPlacement& mine = out.placements[use.resource];
+                uint32_t aliasStages = RGStageNone, aliasAccess = RGAccessNone;
+                for (uint32_t other = 0; other < resources.size(); other++)
+                {
+                    const RGPlacement& o = out.placements[other];
+                    if (other == use.resource || resources[other].imported || o.heap != mine.heap || !states[other].touched ||
+                        o.lastPass >= mine.firstPass)
+                        continue;
+                    if (o.offset < mine.offset + resource.desc.size && mine.offset < o.offset + resources[other].desc.size)
+                    {
+                        aliasStages |= states[other].readStages | states[other].writeStages;
+                        aliasAccess |= states[other].unflushed ? states[other].writeAccess : 0;
+                    }
+                }
+                if (aliasStages != RGStageNone || image)
+                    emit(st, use.resource, aliasStages, aliasAccess, stages, access, image ? layout : RGLayout::Undefined, aliasStages != RGStageNone);
+
+                st.touched = true;
+                st.writeStages = stages;
+                st.writeAccess = access & RGAccessWrites;
+                st.unflushed = true;
+                st.readStages = RGStageNone;
+                st.pendingPass = -1;
+                continue;
+            }
+
+            if (!st.touched)
+            {
+                st.touched = true;
+                st.layout = image ? resource.desc.initialLayout : RGLayout::Undefined;
+                st.writeStages = resource.desc.initialStages;
+                st.writeAccess = resource.desc.initialAccess & RGAccessWrites;
+                st.unflushed = st.writeStages != RGStageNone;
+            }
+
+            if (image && layout != st.layout)
+            {
+                //A transition: ordered after the reads since the last write, or after that write when there were none.
+                uint32_t srcStages = st.readStages != RGStageNone ? st.readStages : st.writeStages;
+                uint32_t srcAccess = st.readStages == RGStageNone && st.unflushed ? st.writeAccess : RGAccessNone;
+                int32_t index = emit(st, use.resource, srcStages, srcAccess, stages, access, layout, false);
+                if (writes)
+                {
+                    st.writeStages = stages;
+                    st.writeAccess = access & RGAccessWrites;
+                    st.unflushed = true;
+                    st.readStages = RGStageNone;
+                    st.pendingPass = -1;
+                }
+                else
+                {
+                    st.unflushed = false;
+                    st.readStages = stages;
+                    st.pendingPass = (int32_t)i;
+                    st.pendingBarrier = index;
+                }
+            }
+            else if (!writes)
+            {
+                if (st.unflushed)
+                {
+                    st.pendingBarrier = emit(st, use.resource, st.writeStages, st.writeAccess, stages, access, layout, false);
+                    st.pendingPass = (int32_t)i;
+                    st.unflushed = false;
+                }
+                else if (st.pendingPass >= 0)
+                {
+                    RGBarrier& pending = out.passes[st.pendingPass].barriers[st.pendingBarrier];
+                    pending.dstStages |= stages;
+                    pending.dstAccess |= access;
+                }
+                st.readStages |= stages;
+            }
+            else
+            {
+                if (st.readStages != RGStageNone)
+                    emit(st, use.resource, st.readStages, RGAccessNone, stages, access, layout, false);
+                else if (st.writeStages != RGStageNone)
+                    emit(st, use.resource, st.writeStages, st.unflushed ? st.writeAccess : RGAccessNone, stages, access, layout, false);
+                st.writeStages = stages;
+                st.writeAccess = access & RGAccessWrites;
+                st.unflushed = true;
+                st.readStages = RGStageNone;
+                st.pendingPass = -1;
+            }
+        }
+
+        if (!compiled.barriers.empty())
+            out.stats.batches++;
+        out.stats.barriers += (uint32_t)compiled.barriers.size();
+    }
+
+    for (uint32_t r = 0; r < resources.size(); r++)
+    {
+        const Resource& resource = resources[r];
+        ResourceState& st = states[r];
+        if (!resource.imported || !resource.exported || resource.desc.kind != RGResourceKind::Image ||
+            resource.desc.finalLayout == RGLayout::Undefined)
+            continue;
+        if (!st.touched)
+        {
+            st.layout = resource.desc.initialLayout;
+            st.writeStages = resource.desc.initialStages;
+            st.writeAccess = resource.desc.initialAccess & RGAccessWrites;
+            st.unflushed = st.writeStages != RGStageNone;
+        }
+        if (st.layout == resource.desc.finalLayout)
+            continue;
+
+        //Whatever comes after the graph (present, the next frame) brings its own dependency.
+        RGBarrier barrier;
+        barrier.resource = r;
+        barrier.srcStages = st.readStages != RGStageNone ? st.readStages : st.writeStages;
+        barrier.srcAccess = st.readStages == RGStageNone && st.unflushed ? st.writeAccess : RGAccessNone;
+        barrier.oldLayout = st.layout;
+        barrier.newLayout = resource.desc.finalLayout;
+        out.finalBarriers.push_back(barrier);
+    }
+    if (!out.finalBarriers.empty())
+        out.stats.batches++;
+    out.stats.barriers += (uint32_t)out.finalBarriers.size();
+    return true;
+}
+
+std::string UnigmaRenderGraph::Serialize(const RGCompiled& compiled) const
+{
+    std::ostringstream text;
+    auto barrierLine = [&](const RGBarrier& b) {
+        text << "  barrier " << resources[b.resource].name << (b.aliasing ? " aliasing" : "") << " " << LayoutName(b.oldLayout)
+            << "->" << LayoutName(b.newLayout) << " stages " << StageNames(b.srcStages) << "->" << StageNames(b.dstStages)
+            << " access " << AccessNames(b.srcAccess) << "->" << AccessNames(b.dstAccess) << "\n";
+    };
+
+    for (const RGCompiledPass& pass : compiled.passes)
+    {
+        text << "pass " << pass.pass << " " << passes[pass.pass].name << " " << PassTypeName(passes[pass.pass].type) << "\n";
+        for (const RGBarrier& barrier : pass.barriers)
+            barrierLine(barrier);
+    }
+    if (!compiled.finalBarriers.empty())
+    {
+        text << "final\n";
+        for (const RGBarrier& barrier : compiled.finalBarriers)
+            barrierLine(barrier);
+    }
+    for (uint32_t pass : compiled.culled)
+        text << "culled " << pass << " " << passes[pass].name << "\n";
+    for (uint32_t h = 0; h < compiled.heaps.size(); h++)
+    {
+        text << "heap " << h << " size " << compiled.heaps[h].size << " types 0x" << std::hex << compiled.heaps[h].memoryTypeBits << std::dec << "\n";
+        for (uint32_t r = 0; r < resources.size(); r++)
+        {
+            const RGPlacement& placement = compiled.placements[r];
+            if (placement.heap == h)
+                text << "  " << resources[r].name << " offset " << placement.offset << " size " << resources[r].desc.size << " passes "
+                    << placement.firstPass << "-" << placement.lastPass << "\n";
+        }
+    }
+    text << "stats uses " << compiled.stats.uses << " barriers " << compiled.stats.barriers << " batches " << compiled.stats.batches
+        << " transient " << compiled.stats.transientBytes << " heaps " << compiled.stats.heapBytes << "\n";
+    return text.str();
+}
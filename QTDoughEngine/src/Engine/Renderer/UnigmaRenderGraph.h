@@ -0,0 +1,230 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Frame description in which every pass declares the images and buffers it touches and how. Compiling it:
+//  - culls passes whose results nothing kept reads (passes marked sideEffects, and writes to imported resources
+//    that are exported, are the roots),
+//  - derives the barriers between the kept passes, one batch in front of a pass at most, skipping read after read
+//    in the same layout and widening the barrier already in front of an earlier reader instead of adding another,
+//  - places transient resources into shared heaps, so resources whose lifetimes do not overlap share memory,
+//  - serializes the result as text, for diffing and for tests.
+//Passes run in declaration order; the graph only removes passes and adds barriers. Stages, accesses and layouts are
+//its own enums mirroring the Vulkan ones, so the compile runs and is tested without a device;
+//UnigmaRenderGraphVulkan maps them and records the compiled graph.
+
+enum RGStageBits : uint32_t
+{
+    RGStageNone = 0,
+    RGStageDrawIndirect = 1 << 0,
+    RGStageVertexInput = 1 << 1,
+    RGStageVertexShader = 1 << 2,
+    RGStageFragmentShader = 1 << 3,
+    RGStageEarlyFragmentTests = 1 << 4,
+    RGStageLateFragmentTests = 1 << 5,
+    RGStageColorOutput = 1 << 6,
+    RGStageCompute = 1 << 7,
+    RGStageRayTracing = 1 << 8,
+    RGStageTransfer = 1 << 9,
+    RGStageAllCommands = 1 << 10,
+};
+
+enum RGAccessBits : uint32_t
+{
+    RGAccessNone = 0,
+    RGAccessIndirectRead = 1 << 0,
+    RGAccessVertexRead = 1 << 1,
+    RGAccessUniformRead = 1 << 2,
+    RGAccessSampledRead = 1 << 3,
+    RGAccessStorageRead = 1 << 4,
+    RGAccessStorageWrite = 1 << 5,
+    RGAccessColorRead = 1 << 6,
+    RGAccessColorWrite = 1 << 7,
+    RGAccessDepthRead = 1 << 8,
+    RGAccessDepthWrite = 1 << 9,
+    RGAccessTransferRead = 1 << 10,
+    RGAccessTransferWrite = 1 << 11,
+    RGAccessMemoryWrite = 1 << 12,
+
+    RGAccessWrites = RGAccessStorageWrite | RGAccessColorWrite | RGAccessDepthWrite | RGAccessTransferWrite | RGAccessMemoryWrite,
+};
+
+enum class RGLayout : uint32_t
+{
+    Undefined = 0,
+    General, //Storage images.
+    ColorAttachment,
+    DepthAttachment,
+    DepthReadOnly,
+    ShaderReadOnly,
+    TransferSrc,
+    TransferDst,
+    Present,
+};
+
+//How a pass uses a resource. Sampled and Storage* take the shader stage from the pass type.
+enum class RGUsage : uint32_t
+{
+    ColorAttachment = 0, //Overwrites (clear or don't care load).
+    ColorAttachmentBlend, //Loads and writes.
+    DepthAttachment,
+    DepthRead,
+    Sampled,
+    StorageRead,
+    StorageWrite, //Overwrites.
+    StorageReadWrite,
+    TransferSrc,
+    TransferDst,
+    Uniform,
+    Vertex,
+    Indirect,
+};
+
+enum class RGPassType : uint32_t
+{
+    Graphics = 0,
+    Compute,
+    RayTracing,
+    Transfer,
+};
+
+enum class RGResourceKind : uint32_t
+{
+    Image = 0,
+    Buffer,
+};
+
+struct RGResourceDesc
+{
+    RGResourceKind kind = RGResourceKind::Image;
+    //What the resource is, for whoever creates it. The graph only reads size, alignment and memoryTypeBits.
+    uint32_t width = 0, height = 0, depth = 1;
+    uint32_t format = 0; //VkFormat value for images.
+    uint64_t bufferSize = 0;
+
+    //Memory requirements of a transient, filled in before Compile (vkGet*MemoryRequirements on the device).
+    uint64_t size = 0;
+    uint64_t alignment = 1;
+    uint32_t memoryTypeBits = ~0u;
+
+    //Imported resources only: state on entry, and the layout the graph leaves them in when exported.
+    RGLayout initialLayout = RGLayout::Undefined;
+    uint32_t initialStages = RGStageNone; //Last outside work that wrote it, RGStageNone when already visible.
+    uint32_t initialAccess = RGAccessNone;
+    RGLayout finalLayout = RGLayout::Undefined; //Undefined keeps the last layout.
+};
+
+struct RGBarrier
+{
+    uint32_t resource = 0;
+    uint32_t srcStages = RGStageNone;
+    uint32_t srcAccess = RGAccessNone;
+    uint32_t dstStages = RGStageNone;
+    uint32_t dstAccess = RGAccessNone;
+    RGLayout oldLayout = RGLayout::Undefined;
+    RGLayout newLayout = RGLayout::Undefined;
+    bool aliasing = false; //First use of memory another transient used earlier.
+};
+
+struct RGCompiledPass
+{
+    uint32_t pass = 0; //Declaration index.
+    std::vector<RGBarrier> barriers; //Recorded as one batch in front of the pass.
+};
+
+struct RGHeap
+{
+    uint64_t size = 0;
+    uint32_t memoryTypeBits = ~0u;
+};
+
+struct RGPlacement
+{
+    uint32_t heap = UINT32_MAX; //UINT32_MAX for imported and unused resources.
+    uint64_t offset = 0;
+    uint32_t firstPass = 0; //Lifetime, in positions of RGCompiled::passes.
+    uint32_t lastPass = 0;
+};
+
+struct RGCompileStats
+{
+    uint32_t uses = 0; //Resource uses in kept passes, what one barrier per use would cost.
+    uint32_t barriers = 0; //Including the final ones.
+    uint32_t batches = 0; //Passes with at least one barrier, plus the final batch.
+    uint64_t transientBytes = 0; //Sum of the transient sizes.
+    uint64_t heapBytes = 0; //What the heaps take after aliasing.
+};
+
+struct RGCompiled
+{
+    std::vector<RGCompiledPass> passes; //Kept passes in order.
+    std::vector<uint32_t> culled;
+    std::vector<RGPlacement> placements; //Per resource.
+    std::vector<RGHeap> heaps;
+    std::vector<RGBarrier> finalBarriers; //Exported resources into their final layout, after the last pass.
+    RGCompileStats stats;
+};
+
+class UnigmaRenderGraph
+{
+public:
+    uint32_t CreateTransient(const std::string& name, const RGResourceDesc& desc);
+    //exported: its contents are wanted after the frame, so passes writing it are kept.
+    uint32_t Import(const std::string& name, const RGResourceDesc& desc, bool exported = true);
+    //sideEffects: kept even when nothing reads what it writes (readbacks, presentation, anything outside the graph).
+    uint32_t AddPass(const std::string& name, RGPassType type, bool sideEffects = false);
+    //One use per resource and pass; read-modify-write has its own usages.
+    void Use(uint32_t pass, uint32_t resource, RGUsage usage);
+
+    //False with a message on a graph that cannot run: a transient read before anything writes it, a resource used
+    //twice by one pass, a layout usage on a buffer.
+    bool Compile(RGCompiled& out, std::string* error = nullptr) const;
+    std::string Serialize(const RGCompiled& compiled) const;
+
+    uint32_t ResourceCount() const { return (uint32_t)resources.size(); }
+    uint32_t PassCount() const { return (uint32_t)passes.size(); }
+    const std::string& ResourceName(uint32_t resource) const { return resources[resource].name; }
+    const std::string& PassName(uint32_t pass) const { return passes[pass].name; }
+    RGPassType PassType(uint32_t pass) const { return passes[pass].type; }
+    RGResourceDesc& Desc(uint32_t resource) { return resources[resource].desc; }
+    const RGResourceDesc& Desc(uint32_t resource) const { return resources[resource].desc; }
+    bool Transient(uint32_t resource) const { return !resources[resource].imported; }
+    //Every usage of the resource across the graph, e.g. to derive Vulkan usage flags.
+    std::vector<RGUsage> Usages(uint32_t resource) const;
+
+    //What a usage means in a pass of the given type.
+    static void UsageState(RGUsage usage, RGPassType type, uint32_t& stages, uint32_t& access, RGLayout& layout);
+    static bool UsageReads(RGUsage usage);
+    static bool UsageWrites(RGUsage usage);
+
+private:
+    struct Resource
+    {
+        std::string name;
+        RGResourceDesc desc;
+        bool imported = false;
+        bool exported = false;
+    };
+
+    struct ResourceUse
+    {
+        uint32_t resource = 0;
+        RGUsage usage = RGUsage::Sampled;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        RGPassType type = RGPassType::Graphics;
+        bool sideEffects = false;
+        std::vector<ResourceUse> uses;
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+
+    void Cull(std::vector<uint8_t>& kept) const;
+    void PlaceTransients(RGCompiled& out) const;
+    bool PlanBarriers(RGCompiled& out, std::string* error) const;
+};
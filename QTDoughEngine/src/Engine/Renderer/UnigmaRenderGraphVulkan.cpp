@@ -0,0 +1,324 @@
+#include "UnigmaRenderGraphVulkan.h"
+#include <stdexcept>
+
+namespace
+{
+    bool IsDepthFormat(VkFormat format)
+    {
+        return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_X8_D24_UNORM_PACK32 ||
+            format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+    }
+
+    bool HasStencil(VkFormat format)
+    {
+        return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+    }
+
+    VkImageUsageFlags ImageUsage(const std::vector<RGUsage>& usages)
+    {
+        VkImageUsageFlags flags = 0;
+        for (RGUsage usage : usages)
+        {
+            switch (usage)
+            {
+            case RGUsage::ColorAttachment:
+            case RGUsage::ColorAttachmentBlend: flags |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+            case RGUsage::DepthAttachment:
+            case RGUsage::DepthRead: flags |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+            case RGUsage::Sampled: flags |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+            case RGUsage::StorageRead:
+            case RGUsage::StorageWrite:
+            case RGUsage::StorageReadWrite: flags |= VK_IMAGE_USAGE_STORAGE_BIT; break;
+            case RGUsage::TransferSrc: flags |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; break;
+            case RGUsage::TransferDst: flags |= VK_IMAGE_USAGE_TRANSFER_DST_BIT; break;
+            default: break;
+            }
+        }
+        return flags;
+    }
+
+    VkBufferUsageFlags BufferUsage(const std::vector<RGUsage>& usages)
+    {
+        VkBufferUsageFlags flags = 0;
+        for (RGUsage usage : usages)
+        {
+            switch (usage)
+            {
+            case RGUsage::StorageRead:
+            case RGUsage::StorageWrite:
+            case RGUsage::StorageReadWrite: flags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT; break;
+            case RGUsage::TransferSrc: flags |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT; break;
+            case RGUsage::TransferDst: flags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT; break;
+            case RGUsage::Uniform: flags |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT; break;
+            case RGUsage::Vertex: flags |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT; break;
+            case RGUsage::Indirect: flags |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT; break;
+            default: break;
+            }
+        }
+        return flags;
+    }
+}
+
+VkPipelineStageFlags2 UnigmaRenderGraphVulkan::Stages(uint32_t stages)
+{
+    VkPipelineStageFlags2 flags = VK_PIPELINE_STAGE_2_NONE;
+    if (stages & RGStageDrawIndirect) flags |= VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+    if (stages & RGStageVertexInput) flags |= VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT;
+    if (stages & RGStageVertexShader) flags |= VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+    if (stages & RGStageFragmentShader) flags |= VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+    if (stages & RGStageEarlyFragmentTests) flags |= VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT;
+    if (stages & RGStageLateFragmentTests) flags |= VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    if (stages & RGStageColorOutput) flags |= VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    if (stages & RGStageCompute) flags |= VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    if (stages & RGStageRayTracing) flags |= VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+    if (stages & RGStageTransfer) flags |= VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    if (stages & RGStageAllCommands) flags |= VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    return flags;
+}
+
+VkAccessFlags2 UnigmaRenderGraphVulkan::Access(uint32_t access)
+{
+    VkAccessFlags2 flags = VK_ACCESS_2_NONE;
+    if (access & RGAccessIndirectRead) flags |= VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+    if (access & RGAccessVertexRead) flags |= VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+    if (access & RGAccessUniformRead) flags |= VK_ACCESS_2_UNIFORM_READ_BIT;
+    if (access & RGAccessSampledRead) flags |= VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+    if (access & RGAccessStorageRead) flags |= VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+    if (access & RGAccessStorageWrite) flags |= VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    if (access & RGAccessColorRead) flags |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+    if (access & RGAccessColorWrite) flags |= VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+    if (access & RGAccessDepthRead) flags |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    if (access & RGAccessDepthWrite) flags |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    if (access & RGAccessTransferRead) flags |= VK_ACCESS_2_TRANSFER_READ_BIT;
+    if (access & RGAccessTransferWrite) flags |= VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    if (access & RGAccessMemoryWrite) flags |= VK_ACCESS_2_MEMORY_WRITE_BIT;
+    return flags;
+}
+
+VkImageLayout UnigmaRenderGraphVulkan::Layout(RGLayout layout)
+{
+    switch (layout)
+    {
+    case RGLayout::General: return VK_IMAGE_LAYOUT_GENERAL;
+    case RGLayout::ColorAttachment: return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    case RGLayout::DepthAttachment: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    case RGLayout::DepthReadOnly: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    case RGLayout::ShaderReadOnly: return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    case RGLayout::TransferSrc: return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    case RGLayout::TransferDst: return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    case RGLayout::Present: return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    default: return VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+}
+
+void UnigmaRenderGraphVulkan::Resize(uint32_t count)
+{
+    images.resize(count, VK_NULL_HANDLE);
+    views.resize(count, VK_NULL_HANDLE);
+    aspects.resize(count, VK_IMAGE_ASPECT_COLOR_BIT);
+    buffers.resize(count, VK_NULL_HANDLE);
+    owned.resize(count, 0);
+}
+
+void UnigmaRenderGraphVulkan::CreateTransients(VkDevice device, UnigmaRenderGraph& graph)
+{
+    Resize(graph.ResourceCount());
+    for (uint32_t r = 0; r < graph.ResourceCount(); r++)
+    {
+        if (!graph.Transient(r) || owned[r])
+            continue;
+
+        RGResourceDesc& desc = graph.Desc(r);
+        VkMemoryRequirements requirements{};
+        if (desc.kind == RGResourceKind::Image)
+        {
+            VkFormat format = (VkFormat)desc.format;
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = desc.depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
+            imageInfo.extent = { desc.width, desc.height, desc.depth };
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = ImageUsage(graph.Usages(r));
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if (vkCreateImage(device, &imageInfo, nullptr, &images[r]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image " + graph.ResourceName(r));
+            }
+            vkGetImageMemoryRequirements(device, images[r], &requirements);
+            aspects[r] = IsDepthFormat(format)
+                ? (VK_IMAGE_ASPECT_DEPTH_BIT | (HasStencil(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0))
+                : VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+        else
+        {
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = desc.bufferSize;
+            bufferInfo.usage = BufferUsage(graph.Usages(r));
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffers[r]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph buffer " + graph.ResourceName(r));
+            }
+            vkGetBufferMemoryRequirements(device, buffers[r], &requirements);
+        }
+
+        desc.size = requirements.size;
+        desc.alignment = requirements.alignment;
+        desc.memoryTypeBits = requirements.memoryTypeBits;
+        owned[r] = 1;
+    }
+}
+
+void UnigmaRenderGraphVulkan::Bind(VkDevice device, VkPhysicalDevice physicalDevice, const UnigmaRenderGraph& graph, const RGCompiled& compiled)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    heaps.assign(compiled.heaps.size(), VK_NULL_HANDLE);
+    for (size_t h = 0; h < compiled.heaps.size(); h++)
+    {
+        uint32_t memoryType = UINT32_MAX;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryType == UINT32_MAX; i++)
+            if ((compiled.heaps[h].memoryTypeBits & (1u << i)) &&
+                (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+                memoryType = i;
+        if (memoryType == UINT32_MAX) {
+            throw std::runtime_error("no device local memory type for a render graph heap");
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = compiled.heaps[h].size;
+        allocInfo.memoryTypeIndex = memoryType;
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &heaps[h]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate render graph heap");
+        }
+    }
+
+    for (uint32_t r = 0; r < graph.ResourceCount(); r++)
+    {
+        const RGPlacement& placement = compiled.placements[r];
+        if (!owned[r] || placement.heap == UINT32_MAX)
+            continue;
+
+        if (graph.Desc(r).kind == RGResourceKind::Buffer)
+        {
+            vkBindBufferMemory(device, buffers[r], heaps[placement.heap], placement.offset);
+            continue;
+        }
+
+        vkBindImageMemory(device, images[r], heaps[placement.heap], placement.offset);
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = images[r];
+        viewInfo.viewType = graph.Desc(r).depth > 1 ? VK_IMAGE_VIEW_TYPE_3D : VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = (VkFormat)graph.Desc(r).format;
+        viewInfo.subresourceRange = { aspects[r], 0, 1, 0, 1 };
+        if (vkCreateImageView(device, &viewInfo, nullptr, &views[r]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render graph image view " + graph.ResourceName(r));
+        }
+    }
+}
+
+void UnigmaRenderGraphVulkan::SetImported(uint32_t resource, VkImage image, VkImageAspectFlags aspect)
+{
+    if (resource >= images.size())
+        Resize(resource + 1);
+    images[resource] = image;
+    aspects[resource] = aspect;
+}
+
+void UnigmaRenderGraphVulkan::SetImported(uint32_t resource, VkBuffer buffer)
+{
+    if (resource >= buffers.size())
+        Resize(resource + 1);
+    buffers[resource] = buffer;
+}
+
+void UnigmaRenderGraphVulkan::RecordBarriers(VkCommandBuffer cmd, const UnigmaRenderGraph& graph, const std::vector<RGBarrier>& barriers) const
+{
+    if (barriers.empty())
+        return;
+
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    for (const RGBarrier& b : barriers)
+    {
+        if (graph.Desc(b.resource).kind == RGResourceKind::Image)
+        {
+            VkImageMemoryBarrier2 barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+            barrier.srcStageMask = Stages(b.srcStages);
+            barrier.srcAccessMask = Access(b.srcAccess);
+            barrier.dstStageMask = Stages(b.dstStages);
+            barrier.dstAccessMask = Access(b.dstAccess);
+            barrier.oldLayout = Layout(b.oldLayout);
+            barrier.newLayout = Layout(b.newLayout);
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = images[b.resource];
+            barrier.subresourceRange = { aspects[b.resource], 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+            imageBarriers.push_back(barrier);
+        }
+        else
+        {
+            VkBufferMemoryBarrier2 barrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+            barrier.srcStageMask = Stages(b.srcStages);
+            barrier.srcAccessMask = Access(b.srcAccess);
+            barrier.dstStageMask = Stages(b.dstStages);
+            barrier.dstAccessMask = Access(b.dstAccess);
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffers[b.resource];
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(barrier);
+        }
+    }
+
+    VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dep.imageMemoryBarrierCount = (uint32_t)imageBarriers.size();
+    dep.pImageMemoryBarriers = imageBarriers.data();
+    dep.bufferMemoryBarrierCount = (uint32_t)bufferBarriers.size();
+    dep.pBufferMemoryBarriers = bufferBarriers.data();
+    vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+void UnigmaRenderGraphVulkan::Record(VkCommandBuffer cmd, const UnigmaRenderGraph& graph, const RGCompiled& compiled,
+    const std::vector<PassCallback>& callbacks) const
+{
+    for (const RGCompiledPass& pass : compiled.passes)
+    {
+        RecordBarriers(cmd, graph, pass.barriers);
+        if (pass.pass < callbacks.size() && callbacks[pass.pass])
+            callbacks[pass.pass](cmd);
+    }
+    RecordBarriers(cmd, graph, compiled.finalBarriers);
+}
+
+void UnigmaRenderGraphVulkan::Destroy(VkDevice device)
+{
+    for (size_t r = 0; r < owned.size(); r++)
+    {
+        if (!owned[r])
+            continue;
+        if (views[r] != VK_NULL_HANDLE)
+            vkDestroyImageView(device, views[r], nullptr);
+        if (images[r] != VK_NULL_HANDLE)
+            vkDestroyImage(device, images[r], nullptr);
+        if (buffers[r] != VK_NULL_HANDLE)
+            vkDestroyBuffer(device, buffers[r], nullptr);
+    }
+    for (VkDeviceMemory heap : heaps)
+        vkFreeMemory(device, heap, nullptr);
+
+    images.clear();
+    views.clear();
+    aspects.clear();
+    buffers.clear();
+    owned.clear();
+    heaps.clear();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "UnigmaRenderGraph.h"
+#include <vulkan/vulkan.h>
+#include <functional>
+
+//Device side of UnigmaRenderGraph. Creates the transient images and buffers with usage flags taken from how the
+//passes use them, binds them at the offsets of the compiled heaps (one allocation per heap, shared by every transient
+//placed in it) and records the kept passes, each behind its barrier batch, through synchronization2.
+class UnigmaRenderGraphVulkan
+{
+public:
+    using PassCallback = std::function<void(VkCommandBuffer)>;
+
+    //Creates every transient and writes its memory requirements into the graph, ready for Compile.
+    void CreateTransients(VkDevice device, UnigmaRenderGraph& graph);
+    //Allocates the heaps of the compiled graph and binds the transients into them.
+    void Bind(VkDevice device, VkPhysicalDevice physicalDevice, const UnigmaRenderGraph& graph, const RGCompiled& compiled);
+    //Imported resources can change every frame, e.g. the swapchain image.
+    void SetImported(uint32_t resource, VkImage image, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+    void SetImported(uint32_t resource, VkBuffer buffer);
+    //callbacks[pass] records the pass with that declaration index. Culled passes are never called.
+    void Record(VkCommandBuffer cmd, const UnigmaRenderGraph& graph, const RGCompiled& compiled, const std::vector<PassCallback>& callbacks) const;
+    void Destroy(VkDevice device);
+
+    VkImage Image(uint32_t resource) const { return resource < images.size() ? images[resource] : VK_NULL_HANDLE; }
+    VkImageView View(uint32_t resource) const { return resource < views.size() ? views[resource] : VK_NULL_HANDLE; }
+    VkBuffer Buffer(uint32_t resource) const { return resource < buffers.size() ? buffers[resource] : VK_NULL_HANDLE; }
+
+    static VkPipelineStageFlags2 Stages(uint32_t stages);
+    static VkAccessFlags2 Access(uint32_t access);
+    static VkImageLayout Layout(RGLayout layout);
+
+private:
+    std::vector<VkImage> images;
+    std::vector<VkImageView> views; //Transients only.
+    std::vector<VkImageAspectFlags> aspects;
+    std::vector<VkBuffer> buffers;
+    std::vector<uint8_t> owned; //Created here rather than imported.
+    std::vector<VkDeviceMemory> heaps;
+
+    void Resize(uint32_t count);
+    void RecordBarriers(VkCommandBuffer cmd, const UnigmaRenderGraph& graph, const std::vector<RGBarrier>& barriers) const;
+};
@@ -633,7 +633,7 @@ void UnigmaRenderingObject::CreateGraphicsPipeline(QTDoughApplication& app)
     pipelineInfo.subpass = 0;
 
 
-    if (vkCreateGraphicsPipelines(app._logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &app.graphicsPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(app._logicalDevice, app.pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &app.graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
@@ -0,0 +1,226 @@
+#include "SDFBrickMap.h"
+#include "../Core/UnigmaParallel.h"
+#include <glm/gtc/packing.hpp>
+
+namespace
+{
+    //Trilinear filter over load(voxel), the stencil of a dense texture read.
+    template<typename Load>
+    float Trilinear(Load&& load, const glm::ivec3& p0, const glm::ivec3& p1, const glm::vec3& f)
+    {
+        float c00 = glm::mix(load(glm::ivec3(p0.x, p0.y, p0.z)), load(glm::ivec3(p1.x, p0.y, p0.z)), f.x);
+        float c10 = glm::mix(load(glm::ivec3(p0.x, p1.y, p0.z)), load(glm::ivec3(p1.x, p1.y, p0.z)), f.x);
+        float c01 = glm::mix(load(glm::ivec3(p0.x, p0.y, p1.z)), load(glm::ivec3(p1.x, p0.y, p1.z)), f.x);
+        float c11 = glm::mix(load(glm::ivec3(p0.x, p1.y, p1.z)), load(glm::ivec3(p1.x, p1.y, p1.z)), f.x);
+        float c0 = glm::mix(c00, c10, f.y);
+        float c1 = glm::mix(c01, c11, f.y);
+        return glm::mix(c0, c1, f.z);
+    }
+}
+
+void SDFBrickMap::Build(const SDFGridDesc& gridDesc, const std::function<float(const glm::vec3&)>& distance, const SDFBrickMapSettings& brickSettings)
+{
+    grid = gridDesc;
+    settings = brickSettings;
+    std::function<float(const glm::ivec3&)> voxelValue = [&](const glm::ivec3& v) { return distance(grid.VoxelCenter(v)); };
+    BuildBricks(voxelValue, settings.lipschitzSkip ? &distance : nullptr);
+}
+
+void SDFBrickMap::BuildFromDense(const SDFGridDesc& gridDesc, const float* values, const SDFBrickMapSettings& brickSettings)
+{
+    grid = gridDesc;
+    settings = brickSettings;
+    std::function<float(const glm::ivec3&)> voxelValue = [&](const glm::ivec3& v) { return values[grid.Flatten(v)]; };
+    BuildBricks(voxelValue, nullptr);
+}
+
+void SDFBrickMap::BuildBricks(const std::function<float(const glm::ivec3&)>& voxelValue, const std::function<float(const glm::vec3&)>* centreDistance)
+{
+    settings.brickSize = std::max(settings.brickSize, 1);
+    settings.apron = std::max(settings.apron, 1);
+    brickCount = (grid.resolution + settings.brickSize - 1) / settings.brickSize;
+    uint32_t total = uint32_t(brickCount.x * brickCount.y * brickCount.z);
+
+    brickTable.assign(total, SDF_BRICK_UNALLOCATED);
+    brickConstants.assign(total, 0.0f);
+    pages.clear();
+    dense.clear();
+    stats = SDFBrickMapStats{};
+    stats.totalBricks = total;
+
+    glm::vec3 voxelSize = grid.VoxelSize();
+    float band = settings.bandVoxels * std::min(voxelSize.x, std::min(voxelSize.y, voxelSize.z));
+    int bs = settings.brickSize;
+    int stored = StoredBrickSize();
+    size_t storedTexels = size_t(stored) * stored * stored;
+
+    //Stored bricks are kept per brick until slots are handed out in brick order, so the layout is deterministic.
+    std::vector<std::vector<uint16_t>> brickTexels(total);
+    std::vector<uint64_t> evaluations(total, 0);
+
+    UnigmaParallelFor(total, 8, [&](uint32_t b) {
+        glm::ivec3 bc(b % brickCount.x, (b / brickCount.x) % brickCount.y, b / (brickCount.x * brickCount.y));
+        glm::ivec3 first = bc * bs - settings.apron;
+        glm::ivec3 last = bc * bs + bs - 1 + settings.apron;
+
+        if (centreDistance != nullptr)
+        {
+            //One sample at the centre bounds every texel of a Lipschitz field.
+            glm::vec3 lo = grid.VoxelCenter(first), hi = grid.VoxelCenter(last);
+            float radius = glm::length(hi - lo) * 0.5f;
+            float d = (*centreDistance)((lo + hi) * 0.5f);
+            evaluations[b] = 1;
+            if (std::abs(d) - radius >= band)
+            {
+                brickConstants[b] = d > 0.0f ? d - radius : d + radius;
+                return;
+            }
+        }
+
+        std::vector<float> values(storedTexels);
+        float closest = std::numeric_limits<float>::max();
+        size_t i = 0;
+        for (int z = first.z; z <= last.z; z++)
+            for (int y = first.y; y <= last.y; y++)
+                for (int x = first.x; x <= last.x; x++, i++)
+                {
+                    glm::ivec3 v = glm::clamp(glm::ivec3(x, y, z), glm::ivec3(0), grid.resolution - 1);
+                    float d = voxelValue(v);
+                    values[i] = d;
+                    if (std::abs(d) < std::abs(closest))
+                        closest = d;
+                }
+        evaluations[b] += storedTexels;
+
+        brickConstants[b] = closest;
+        if (std::abs(closest) >= band)
+            return;
+
+        std::vector<uint16_t>& texels = brickTexels[b];
+        texels.resize(storedTexels);
+        for (size_t t = 0; t < storedTexels; t++)
+            texels[t] = glm::packHalf1x16(values[t]);
+    });
+
+    uint32_t slots = 0;
+    for (uint32_t b = 0; b < total; b++)
+    {
+        stats.evaluatedVoxels += evaluations[b];
+        if (!brickTexels[b].empty())
+            brickTable[b] = slots++;
+    }
+    stats.allocatedBricks = slots;
+
+    //Pack slots into pages. The last page is trimmed to the z slices it uses, and to the rows and columns when it
+    //holds less than a slice.
+    uint32_t perPage = uint32_t(settings.pageBricks.x * settings.pageBricks.y * settings.pageBricks.z);
+    uint32_t perSlice = uint32_t(settings.pageBricks.x * settings.pageBricks.y);
+    uint32_t pageCount = (slots + perPage - 1) / perPage;
+    std::vector<glm::ivec3> pageBricks(pageCount);
+    size_t pageBytes = 0;
+    for (uint32_t p = 0; p < pageCount; p++)
+    {
+        uint32_t used = std::min(perPage, slots - p * perPage);
+        uint32_t columns = used < uint32_t(settings.pageBricks.x) ? used : uint32_t(settings.pageBricks.x);
+        uint32_t rows = used < perSlice ? (used + settings.pageBricks.x - 1) / settings.pageBricks.x : uint32_t(settings.pageBricks.y);
+        pageBricks[p] = glm::ivec3((int)columns, (int)rows, (int)((used + perSlice - 1) / perSlice));
+        pageBytes += size_t(pageBricks[p].x) * pageBricks[p].y * pageBricks[p].z * storedTexels * sizeof(uint16_t);
+    }
+
+    stats.sparseBytes = brickTable.size() * sizeof(uint32_t) + brickConstants.size() * sizeof(float) + pageBytes;
+    stats.denseBytes = grid.VoxelCount() * sizeof(uint16_t);
+    if (settings.denseFallback && stats.sparseBytes >= stats.denseBytes)
+    {
+        stats.dense = true;
+        stats.allocatedBricks = 0;
+        brickTable.assign(total, SDF_BRICK_UNALLOCATED);
+        dense.resize(grid.VoxelCount());
+        UnigmaParallelFor(uint32_t(grid.resolution.z), 1, [&](uint32_t z) {
+            for (int y = 0; y < grid.resolution.y; y++)
+                for (int x = 0; x < grid.resolution.x; x++)
+                {
+                    glm::ivec3 v(x, y, (int)z);
+                    dense[grid.Flatten(v)] = glm::packHalf1x16(voxelValue(v));
+                }
+        });
+        stats.evaluatedVoxels += grid.VoxelCount();
+        return;
+    }
+
+    pages.resize(pageCount);
+    for (uint32_t p = 0; p < pageCount; p++)
+    {
+        pages[p].sizeTexels = pageBricks[p] * stored;
+        pages[p].texels.assign(size_t(pages[p].sizeTexels.x) * pages[p].sizeTexels.y * pages[p].sizeTexels.z, glm::packHalf1x16(SDF_EMPTY_SPACE));
+    }
+
+    UnigmaParallelFor(total, 64, [&](uint32_t b) {
+        if (brickTable[b] == SDF_BRICK_UNALLOCATED)
+            return;
+
+        uint32_t page;
+        glm::ivec3 origin;
+        SlotLocation(brickTable[b], page, origin);
+        SDFBrickPage& dst = pages[page];
+        const std::vector<uint16_t>& src = brickTexels[b];
+        for (int z = 0; z < stored; z++)
+            for (int y = 0; y < stored; y++)
+            {
+                size_t row = size_t(origin.x) + size_t(origin.y + y) * dst.sizeTexels.x + size_t(origin.z + z) * dst.sizeTexels.x * dst.sizeTexels.y;
+                std::copy_n(src.data() + (size_t(z) * stored + y) * stored, stored, dst.texels.data() + row);
+            }
+    });
+}
+
+void SDFBrickMap::SlotLocation(uint32_t slot, uint32_t& outPage, glm::ivec3& outTexel) const
+{
+    uint32_t perPage = uint32_t(settings.pageBricks.x * settings.pageBricks.y * settings.pageBricks.z);
+    outPage = slot / perPage;
+    uint32_t local = slot % perPage;
+    glm::ivec3 brick(local % settings.pageBricks.x, (local / settings.pageBricks.x) % settings.pageBricks.y, local / (settings.pageBricks.x * settings.pageBricks.y));
+    outTexel = brick * StoredBrickSize();
+}
+
+float SDFBrickMap::LoadFromBrick(uint32_t slot, const glm::ivec3& local) const
+{
+    uint32_t page;
+    glm::ivec3 origin;
+    SlotLocation(slot, page, origin);
+    const SDFBrickPage& p = pages[page];
+    glm::ivec3 t = origin + local;
+    return glm::unpackHalf1x16(p.texels[size_t(t.x) + size_t(t.y) * p.sizeTexels.x + size_t(t.z) * p.sizeTexels.x * p.sizeTexels.y]);
+}
+
+float SDFBrickMap::Load(const glm::ivec3& voxel) const
+{
+    glm::ivec3 v = glm::clamp(voxel, glm::ivec3(0), grid.resolution - 1);
+    if (!dense.empty())
+        return glm::unpackHalf1x16(dense[grid.Flatten(v)]);
+    glm::ivec3 brick = v / settings.brickSize;
+    uint32_t index = BrickIndex(brick);
+    if (brickTable[index] == SDF_BRICK_UNALLOCATED)
+        return brickConstants[index];
+    return LoadFromBrick(brickTable[index], v - brick * settings.brickSize + settings.apron);
+}
+
+float SDFBrickMap::Sample(const glm::vec3& worldPos) const
+{
+    glm::vec3 t = grid.WorldToVoxel(worldPos) - 0.5f;
+    glm::ivec3 base = glm::ivec3(glm::floor(t));
+    glm::vec3 f = t - glm::vec3(base);
+    glm::ivec3 p0 = glm::clamp(base, glm::ivec3(0), grid.resolution - 1);
+    glm::ivec3 p1 = glm::clamp(base + 1, glm::ivec3(0), grid.resolution - 1);
+
+    if (!dense.empty())
+        return Trilinear([&](const glm::ivec3& v) { return glm::unpackHalf1x16(dense[grid.Flatten(v)]); }, p0, p1, f);
+
+    //p1 is at most one voxel past p0's brick, which the apron covers.
+    glm::ivec3 brick = p0 / settings.brickSize;
+    uint32_t index = BrickIndex(brick);
+    uint32_t slot = brickTable[index];
+    if (slot == SDF_BRICK_UNALLOCATED)
+        return brickConstants[index];
+
+    glm::ivec3 offset = settings.apron - brick * settings.brickSize;
+    return Trilinear([&](const glm::ivec3& v) { return LoadFromBrick(slot, v + offset); }, p0, p1, f);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "SDFCommon.h"
+#include <functional>
+
+//Sparse narrow band world SDF. The grid is cut into bricks; a top level table maps every brick either to a slot in
+//the brick atlas (stored distances, half floats) or to a single coarse constant when no voxel is near the surface.
+//Bricks carry an apron so one brick holds every texel a trilinear read inside it touches, which lets the atlas be
+//sampled with hardware filtering and keeps the CPU sampler to one table lookup.
+//Constants are conservative: the value of smallest magnitude over the brick, so sphere tracing never oversteps.
+//A stored brick costs (brickSize + 2 * apron)^3 texels for brickSize^3 voxels, 1.95x at the defaults, so bricks only
+//save memory once roughly half the bricks or fewer are in the band. Small or surface heavy grids are past that point and
+//are stored dense instead (denseFallback); Load and Sample read either layout.
+
+#define SDF_BRICK_UNALLOCATED 0xFFFFFFFFu
+
+struct SDFBrickMapSettings
+{
+    int brickSize = 8; //Voxels per brick edge.
+    int apron = 1; //Extra texels stored on each side.
+    float bandVoxels = 3.0f; //Bricks with any |d| below this many voxels are stored.
+    glm::ivec3 pageBricks = glm::ivec3(16, 16, 16); //Bricks per atlas page.
+    bool lipschitzSkip = true; //Function builds: skip bricks whose centre distance proves them far from the surface.
+    bool denseFallback = true; //Store the grid dense when the bricks would take at least as many bytes.
+};
+
+//One atlas page, half float texels, x fastest. Ready for vkCmdCopyBufferToImage into an R16_SFLOAT 3D image.
+struct SDFBrickPage
+{
+    glm::ivec3 sizeTexels = glm::ivec3(0);
+    std::vector<uint16_t> texels;
+};
+
+struct SDFBrickMapStats
+{
+    uint32_t allocatedBricks = 0;
+    uint32_t totalBricks = 0;
+    uint64_t evaluatedVoxels = 0; //Distance evaluations during the build.
+    size_t sparseBytes = 0; //Table, constants and atlas pages.
+    size_t denseBytes = 0; //Same grid stored dense at 16 bits.
+    bool dense = false; //The dense layout was smaller and is the one stored.
+};
+
+class SDFBrickMap
+{
+public:
+    SDFGridDesc grid;
+    SDFBrickMapSettings settings;
+    glm::ivec3 brickCount = glm::ivec3(0);
+
+    std::vector<uint32_t> brickTable; //Atlas slot or SDF_BRICK_UNALLOCATED, x fastest.
+    std::vector<float> brickConstants; //Value used for unallocated bricks.
+    std::vector<SDFBrickPage> pages;
+    std::vector<uint16_t> dense; //Whole grid in half floats, x fastest, when stored dense. Pages are empty then.
+    SDFBrickMapStats stats;
+
+    //Builds from a distance function evaluated at voxel centres.
+    void Build(const SDFGridDesc& gridDesc, const std::function<float(const glm::vec3&)>& distance,
+        const SDFBrickMapSettings& brickSettings = SDFBrickMapSettings());
+    //Builds from a dense grid (gridDesc.VoxelCount() floats, x fastest).
+    void BuildFromDense(const SDFGridDesc& gridDesc, const float* values,
+        const SDFBrickMapSettings& brickSettings = SDFBrickMapSettings());
+
+    //Voxel value, the constant for unallocated bricks.
+    float Load(const glm::ivec3& voxel) const;
+    //Trilinear sample with clamp to edge, the same stencil as a dense texture read.
+    float Sample(const glm::vec3& worldPos) const;
+
+    bool IsDense() const { return !dense.empty(); }
+    int StoredBrickSize() const { return settings.brickSize + 2 * settings.apron; }
+    uint32_t BrickIndex(const glm::ivec3& brick) const { return uint32_t(brick.x + brick.y * brickCount.x + brick.z * brickCount.x * brickCount.y); }
+    //Page and texel origin of an atlas slot.
+    void SlotLocation(uint32_t slot, uint32_t& outPage, glm::ivec3& outTexel) const;
+
+private:
+    void BuildBricks(const std::function<float(const glm::ivec3&)>& voxelValue, const std::function<float(const glm::vec3&)>* centreDistance);
+    float LoadFromBrick(uint32_t slot, const glm::ivec3& local) const;
+};
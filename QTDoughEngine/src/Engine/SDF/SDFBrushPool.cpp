@@ -0,0 +1,102 @@
+#include "SDFBrushPool.h"
+
+void SDFBrushPool::Reset(uint32_t initialCapacity, uint32_t chunk, uint32_t headroom)
+{
+    chunkSize = std::max(chunk, 1u);
+    growthHeadroom = headroom;
+    capacity = (initialCapacity + chunkSize - 1) / chunkSize * chunkSize;
+    generations.clear();
+    alive.clear();
+    freeSlots.clear();
+    dirtyFlags.clear();
+    dirtySlots.clear();
+    liveCount = 0;
+    EnsureHeadroom();
+}
+
+void SDFBrushPool::EnsureHeadroom()
+{
+    uint64_t needed = uint64_t(alive.size()) + growthHeadroom;
+    if (needed <= capacity)
+        return;
+    capacity = uint32_t((needed + chunkSize - 1) / chunkSize * chunkSize);
+}
+
+SDFBrushHandle SDFBrushPool::Allocate()
+{
+    uint32_t slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        slot = (uint32_t)alive.size();
+        generations.push_back(0);
+        alive.push_back(0);
+        dirtyFlags.push_back(0);
+        EnsureHeadroom();
+    }
+
+    alive[slot] = 1;
+    liveCount++;
+    MarkDirty(slot);
+    return SDFBrushHandle{ slot, generations[slot] };
+}
+
+bool SDFBrushPool::Free(SDFBrushHandle handle)
+{
+    if (!IsAlive(handle))
+        return false;
+
+    alive[handle.slot] = 0;
+    generations[handle.slot]++;
+    freeSlots.push_back(handle.slot);
+    liveCount--;
+    MarkDirty(handle.slot);
+    return true;
+}
+
+bool SDFBrushPool::IsAlive(SDFBrushHandle handle) const
+{
+    return IsSlotAlive(handle.slot) && generations[handle.slot] == handle.generation;
+}
+
+SDFBrushHandle SDFBrushPool::HandleForSlot(uint32_t slot) const
+{
+    if (!IsSlotAlive(slot))
+        return SDFBrushHandle{};
+    return SDFBrushHandle{ slot, generations[slot] };
+}
+
+void SDFBrushPool::MarkDirty(uint32_t slot)
+{
+    if (slot >= dirtyFlags.size() || dirtyFlags[slot])
+        return;
+    dirtyFlags[slot] = 1;
+    dirtySlots.push_back(slot);
+}
+
+void SDFBrushPool::MarkDirtyRange(uint32_t first, uint32_t count)
+{
+    uint32_t end = (uint32_t)std::min<uint64_t>(uint64_t(first) + count, dirtyFlags.size());
+    for (uint32_t slot = first; slot < end; slot++)
+        MarkDirty(slot);
+}
+
+std::vector<SDFSlotRange> SDFBrushPool::TakeDirtyRanges(uint32_t mergeGap)
+{
+    std::vector<SDFSlotRange> ranges;
+    std::sort(dirtySlots.begin(), dirtySlots.end());
+    for (uint32_t slot : dirtySlots)
+    {
+        dirtyFlags[slot] = 0;
+        if (!ranges.empty() && slot - (ranges.back().first + ranges.back().count) <= mergeGap)
+            ranges.back().count = slot - ranges.back().first + 1;
+        else
+            ranges.push_back(SDFSlotRange{ slot, 1 });
+    }
+    dirtySlots.clear();
+    return ranges;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "SDFCommon.h"
+
+//Slot allocator behind the brush arrays. Brushes are addressed through generational handles, so a handle kept past its
+//removal is rejected instead of silently reaching whatever reused the slot. Removed slots go on a free-list and are
+//handed out again before the arrays grow. Capacity grows in whole chunks and always keeps some headroom, so the owner
+//can reallocate its GPU buffers before a brush needs the new space. Writes are tracked per slot and handed back as
+//sorted, coalesced ranges so uploads only touch what changed.
+
+#define SDF_BRUSH_INVALID_SLOT 0xFFFFFFFFu
+
+struct SDFBrushHandle
+{
+    uint32_t slot = SDF_BRUSH_INVALID_SLOT;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return slot != SDF_BRUSH_INVALID_SLOT; }
+    bool operator==(const SDFBrushHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const SDFBrushHandle& other) const { return !(*this == other); }
+};
+
+struct SDFSlotRange
+{
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+class SDFBrushPool
+{
+public:
+    //initialCapacity is rounded up to whole chunks. headroom is the number of unused slots kept ahead of SlotCount().
+    void Reset(uint32_t initialCapacity, uint32_t chunk = 256, uint32_t headroom = 32);
+
+    //Reuses the most recently freed slot, otherwise appends one. The new slot is marked dirty.
+    SDFBrushHandle Allocate();
+    //Returns false for stale or invalid handles. The slot is marked dirty so its inactive state gets uploaded.
+    bool Free(SDFBrushHandle handle);
+
+    bool IsAlive(SDFBrushHandle handle) const;
+    bool IsSlotAlive(uint32_t slot) const { return slot < alive.size() && alive[slot] != 0; }
+    //Handle of a live slot, an invalid handle otherwise.
+    SDFBrushHandle HandleForSlot(uint32_t slot) const;
+
+    //Slots ever handed out. Arrays indexed by slot need this many entries.
+    uint32_t SlotCount() const { return (uint32_t)alive.size(); }
+    uint32_t LiveCount() const { return liveCount; }
+    uint32_t FreeCount() const { return (uint32_t)freeSlots.size(); }
+    //Slots the owner's buffers should be sized for. Only ever grows, in multiples of the chunk size.
+    uint32_t Capacity() const { return capacity; }
+    uint32_t ChunkSize() const { return chunkSize; }
+
+    void MarkDirty(uint32_t slot);
+    void MarkDirtyRange(uint32_t first, uint32_t count);
+    bool HasDirty() const { return !dirtySlots.empty(); }
+    //Ranges separated by at most mergeGap clean slots are joined. Clears the dirty set.
+    std::vector<SDFSlotRange> TakeDirtyRanges(uint32_t mergeGap = 0);
+
+private:
+    std::vector<uint32_t> generations;
+    std::vector<uint8_t> alive;
+    std::vector<uint32_t> freeSlots; //Used as a stack.
+    std::vector<uint8_t> dirtyFlags;
+    std::vector<uint32_t> dirtySlots; //Unsorted, one entry per dirty slot.
+    uint32_t liveCount = 0;
+    uint32_t capacity = 0;
+    uint32_t chunkSize = 256;
+    uint32_t growthHeadroom = 32;
+
+    void EnsureHeadroom();
+};
@@ -0,0 +1,193 @@
+#include "SDFBrushScheduler.h"
+
+float SDFBrushCostModel::EstimateSliceMs(const SDFBrushCostKey& key) const
+{
+    auto it = sliceMs.find(key);
+    if (it != sliceMs.end())
+        return it->second;
+
+    //A slice is resolution^2 voxels, so scale by area from the nearest measured resolution.
+    float area = float(key.resolution) * float(key.resolution);
+    const std::pair<const SDFBrushCostKey, float>* nearest = nullptr;
+    for (const auto& entry : sliceMs)
+    {
+        if (entry.first.type != key.type)
+            continue;
+        if (nearest == nullptr || std::abs(int(entry.first.resolution) - int(key.resolution)) < std::abs(int(nearest->first.resolution) - int(key.resolution)))
+            nearest = &entry;
+    }
+    if (nearest != nullptr && nearest->first.resolution > 0)
+        return nearest->second * area / (float(nearest->first.resolution) * float(nearest->first.resolution));
+    return defaultSliceMs * area / (64.0f * 64.0f);
+}
+
+void SDFBrushCostModel::Observe(const SDFBrushCostKey& key, float observedMs)
+{
+    ObserveFrame({ { key, 1u } }, observedMs);
+}
+
+void SDFBrushCostModel::ObserveFrame(const std::vector<std::pair<SDFBrushCostKey, uint32_t>>& sliceCounts, float measuredMs)
+{
+    if (!(measuredMs >= 0.0f) || sliceCounts.empty())
+        return;
+
+    for (const auto& entry : sliceCounts)
+    {
+        if (keyIndex.count(entry.first))
+            continue;
+        uint32_t n = (uint32_t)keys.size();
+        //A new key starts as one single-slice observation of its estimate, so until frames separate it from the keys
+        //it runs with it stays near that estimate instead of taking an arbitrary split. This fades like real frames.
+        float estimate = EstimateSliceMs(entry.first);
+        keyIndex[entry.first] = n;
+        keys.push_back(entry.first);
+        floorMs.push_back(0.25f * estimate);
+        std::vector<double> grown((n + 1) * (n + 1), 0.0);
+        for (uint32_t r = 0; r < n; r++)
+            for (uint32_t c = 0; c < n; c++)
+                grown[r * (n + 1) + c] = normal[r * n + c];
+        grown[n * (n + 1) + n] = 1.0;
+        normal.swap(grown);
+        rhs.push_back(estimate);
+    }
+
+    uint32_t n = (uint32_t)keys.size();
+    std::vector<double> row(n, 0.0);
+    for (const auto& entry : sliceCounts)
+        row[keyIndex[entry.first]] += double(entry.second);
+
+    for (uint32_t r = 0; r < n; r++)
+    {
+        for (uint32_t c = 0; c < n; c++)
+            normal[r * n + c] = normal[r * n + c] * forgetting + row[r] * row[c];
+        rhs[r] = rhs[r] * forgetting + row[r] * measuredMs;
+    }
+
+    //Keys that have not run for a long time have faded rows; a tiny pull to their last value keeps the system solvable.
+    std::vector<double> a(normal);
+    std::vector<double> b(rhs);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        a[i * n + i] += 1e-4;
+        b[i] += 1e-4 * EstimateSliceMs(keys[i]);
+    }
+
+    //Gaussian elimination with partial pivoting; n is the number of (type, resolution) pairs seen, so it stays small.
+    for (uint32_t col = 0; col < n; col++)
+    {
+        uint32_t pivot = col;
+        for (uint32_t r = col + 1; r < n; r++)
+            if (std::abs(a[r * n + col]) > std::abs(a[pivot * n + col]))
+                pivot = r;
+        if (pivot != col)
+        {
+            for (uint32_t c = 0; c < n; c++)
+                std::swap(a[col * n + c], a[pivot * n + c]);
+            std::swap(b[col], b[pivot]);
+        }
+        for (uint32_t r = col + 1; r < n; r++)
+        {
+            double f = a[r * n + col] / a[col * n + col];
+            for (uint32_t c = col; c < n; c++)
+                a[r * n + c] -= f * a[col * n + c];
+            b[r] -= f * b[col];
+        }
+    }
+    std::vector<double> x(n, 0.0);
+    for (int r = int(n) - 1; r >= 0; r--)
+    {
+        double sum = b[r];
+        for (uint32_t c = r + 1; c < n; c++)
+            sum -= a[r * n + c] * x[c];
+        x[r] = sum / a[r * n + r];
+    }
+
+    for (uint32_t i = 0; i < n; i++)
+        sliceMs[keys[i]] = std::max(float(x[i]), floorMs[i]); //A badly split frame must not make a key look free.
+}
+
+void SDFBrushScheduler::Enqueue(int brushIndex, uint32_t type, uint32_t resolution, uint32_t totalSlices)
+{
+    Cancel(brushIndex);
+    if (totalSlices == 0)
+        return;
+
+    SDFBrushJob job;
+    job.brushIndex = brushIndex;
+    job.key = SDFBrushCostKey{ type, resolution };
+    job.totalSlices = totalSlices;
+    jobs.push_back(job);
+}
+
+void SDFBrushScheduler::Cancel(int brushIndex)
+{
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&](const SDFBrushJob& j) { return j.brushIndex == brushIndex; }), jobs.end());
+}
+
+void SDFBrushScheduler::SetView(int brushIndex, float distance, bool visible)
+{
+    for (SDFBrushJob& job : jobs)
+        if (job.brushIndex == brushIndex)
+        {
+            job.distance = distance;
+            job.visible = visible;
+        }
+}
+
+float SDFBrushScheduler::Priority(const SDFBrushJob& job) const
+{
+    //Lower runs first.
+    float distance = job.visible ? job.distance : job.distance * invisibleDistanceScale + 1.0f;
+    return distance - agingPerFrame * float(job.waitedFrames);
+}
+
+std::vector<SDFBrushSlice> SDFBrushScheduler::Plan()
+{
+    std::vector<SDFBrushSlice> slices;
+    if (jobs.empty())
+        return slices;
+
+    std::vector<uint32_t> order(jobs.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return Priority(jobs[a]) < Priority(jobs[b]); });
+
+    float remaining = frameBudgetMs;
+    for (uint32_t i : order)
+    {
+        if (slices.size() >= maxJobsPerFrame)
+            break;
+
+        SDFBrushJob& job = jobs[i];
+        float sliceMs = costModel.EstimateSliceMs(job.key);
+        uint32_t left = job.totalSlices - job.doneSlices;
+        uint32_t count = sliceMs > 0.0f ? (uint32_t)std::min<float>(float(left), std::floor(remaining / sliceMs)) : left;
+        if (count == 0 && slices.empty())
+            count = 1;
+        if (count == 0)
+            continue; //A cheaper job further down may still fit.
+
+        slices.push_back(SDFBrushSlice{ job.brushIndex, job.key, job.doneSlices, count, sliceMs * count });
+        job.doneSlices += count;
+        remaining -= sliceMs * count;
+    }
+
+    for (SDFBrushJob& job : jobs)
+        job.waitedFrames++;
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const SDFBrushJob& j) { return j.doneSlices >= j.totalSlices; }), jobs.end());
+    return slices;
+}
+
+void SDFBrushScheduler::ReportFrame(const std::vector<SDFBrushSlice>& slices, float measuredMs)
+{
+    std::vector<std::pair<SDFBrushCostKey, uint32_t>> counts;
+    for (const SDFBrushSlice& slice : slices)
+    {
+        auto it = std::find_if(counts.begin(), counts.end(), [&](const auto& c) { return !(c.first < slice.key) && !(slice.key < c.first); });
+        if (it == counts.end())
+            counts.push_back({ slice.key, slice.sliceCount });
+        else
+            it->second += slice.sliceCount;
+    }
+    costModel.ObserveFrame(counts, measuredMs);
+}
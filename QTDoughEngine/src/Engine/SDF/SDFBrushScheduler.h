@@ -0,0 +1,93 @@
+#pragma once
+#include "SDFCommon.h"
+#include <map>
+
+//Spreads brush cooking over frames against a millisecond budget instead of a fixed number of groups.
+//A job is one brush volume split into z-group slices (one vkCmdDispatchBase each). The cost of a slice is learned per
+//(type, resolution) from measured frame timings, and queued jobs are ordered by camera distance, visibility and age.
+//Nothing here touches Vulkan: the caller reports measured milliseconds, so the same code runs against simulated costs.
+
+struct SDFBrushCostKey
+{
+    uint32_t type = 0;
+    uint32_t resolution = 0;
+
+    bool operator<(const SDFBrushCostKey& other) const
+    {
+        return type != other.type ? type < other.type : resolution < other.resolution;
+    }
+};
+
+//Each measured frame is one equation sum(slices_k * cost_k) = ms over the keys it ran. Per-key costs are the least
+//squares fit of those equations, with older frames fading out so the fit follows drivers and clock changes.
+class SDFBrushCostModel
+{
+public:
+    float defaultSliceMs = 0.25f; //Guess for a 64^3 slice before anything has been measured.
+    float forgetting = 0.97f; //Weight an older frame keeps each time a new one is added.
+
+    //Milliseconds for one z-group slice. Unmeasured keys scale the closest measured resolution of the same type by the
+    //slice area, then fall back to defaultSliceMs scaled the same way.
+    float EstimateSliceMs(const SDFBrushCostKey& key) const;
+    void Observe(const SDFBrushCostKey& key, float sliceMs);
+    //One measurement covering several keys, given as slice counts per key.
+    void ObserveFrame(const std::vector<std::pair<SDFBrushCostKey, uint32_t>>& sliceCounts, float measuredMs);
+    bool HasMeasurement(const SDFBrushCostKey& key) const { return sliceMs.count(key) != 0; }
+
+private:
+    std::map<SDFBrushCostKey, float> sliceMs;
+    std::map<SDFBrushCostKey, uint32_t> keyIndex; //Row of the key in the normal equations.
+    std::vector<SDFBrushCostKey> keys;
+    std::vector<float> floorMs; //Lowest cost a key may be fitted to, from its first estimate.
+    std::vector<double> normal; //keys.size()^2, sum of count * count^T.
+    std::vector<double> rhs; //sum of count * ms.
+};
+
+struct SDFBrushJob
+{
+    int brushIndex = -1;
+    SDFBrushCostKey key;
+    uint32_t totalSlices = 0;
+    uint32_t doneSlices = 0;
+
+    float distance = 0.0f; //Camera to brush bounds, 0 inside.
+    bool visible = true;
+    uint32_t waitedFrames = 0;
+};
+
+struct SDFBrushSlice
+{
+    int brushIndex = -1;
+    SDFBrushCostKey key;
+    uint32_t firstSlice = 0;
+    uint32_t sliceCount = 0;
+    float estimatedMs = 0.0f;
+};
+
+class SDFBrushScheduler
+{
+public:
+    float frameBudgetMs = 2.0f;
+    uint32_t maxJobsPerFrame = 16;
+    float invisibleDistanceScale = 4.0f; //Off-screen brushes rank as if this much further away.
+    float agingPerFrame = 0.5f; //Distance credit per waited frame, so far brushes still finish.
+    SDFBrushCostModel costModel;
+
+    //Replaces an existing job for the same brush.
+    void Enqueue(int brushIndex, uint32_t type, uint32_t resolution, uint32_t totalSlices);
+    void Cancel(int brushIndex);
+    void SetView(int brushIndex, float distance, bool visible);
+
+    //Picks this frame's slices, highest priority first, until the estimated cost fills the budget. The top job always
+    //gets at least one slice so a budget below one slice still makes progress. Planned slices count as done.
+    std::vector<SDFBrushSlice> Plan();
+    //Measured time of everything one Plan() returned. Fitted across the keys it contained.
+    void ReportFrame(const std::vector<SDFBrushSlice>& slices, float measuredMs);
+
+    bool Empty() const { return jobs.empty(); }
+    const std::vector<SDFBrushJob>& Jobs() const { return jobs; }
+    float Priority(const SDFBrushJob& job) const;
+
+private:
+    std::vector<SDFBrushJob> jobs;
+};
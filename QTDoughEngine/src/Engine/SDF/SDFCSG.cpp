@@ -0,0 +1,434 @@
+//The AVX2 lanes match the scalar fold bit for bit only if no multiply and add is fused into an FMA.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#include "SDFCSG.h"
+#include "SDFSampling.h"
+#include "../Core/UnigmaParallel.h"
+
+void CSGVolume::BuildBounds()
+{
+    brickRes = (resolution + BRICK - 1) / BRICK;
+    size_t brickCount = size_t(brickRes) * brickRes * brickRes;
+    brickMin.assign(brickCount, std::numeric_limits<float>::max());
+    brickMax.assign(brickCount, -std::numeric_limits<float>::max());
+
+    for (int z = 0; z < resolution; z++)
+        for (int y = 0; y < resolution; y++)
+            for (int x = 0; x < resolution; x++)
+            {
+                float v = Load(x, y, z);
+                size_t b = size_t(x / BRICK) + size_t(y / BRICK) * brickRes + size_t(z / BRICK) * brickRes * brickRes;
+                brickMin[b] = std::min(brickMin[b], v);
+                brickMax[b] = std::max(brickMax[b], v);
+            }
+}
+
+float CSGVolume::SampleTrilinear(const glm::vec3& uvwIn) const
+{
+    glm::vec3 uvw = glm::clamp(uvwIn, glm::vec3(0.0f), glm::vec3(1.0f));
+    return SDFSampleTrilinear(values.data(), Grid(), uvw - 0.5f);
+}
+
+void CSGVolume::TexelRange(const glm::vec3& uvwMin, const glm::vec3& uvwMax, float& outMin, float& outMax) const
+{
+    //Same voxel coordinate as SampleTrilinear. Every step is monotonic, so points inside the range floor inside it too.
+    SDFGridDesc grid = Grid();
+    glm::vec3 tMin = SDFSampleToVoxel(grid, glm::clamp(uvwMin, glm::vec3(0.0f), glm::vec3(1.0f)) - 0.5f) - 0.5f;
+    glm::vec3 tMax = SDFSampleToVoxel(grid, glm::clamp(uvwMax, glm::vec3(0.0f), glm::vec3(1.0f)) - 0.5f) - 0.5f;
+    glm::ivec3 lo = glm::clamp(glm::ivec3(glm::floor(tMin)), glm::ivec3(0), glm::ivec3(resolution - 1));
+    glm::ivec3 hi = glm::clamp(glm::ivec3(glm::floor(tMax)) + 1, glm::ivec3(0), glm::ivec3(resolution - 1));
+
+    outMin = std::numeric_limits<float>::max();
+    outMax = -std::numeric_limits<float>::max();
+    for (int z = lo.z / BRICK; z <= hi.z / BRICK; z++)
+        for (int y = lo.y / BRICK; y <= hi.y / BRICK; y++)
+            for (int x = lo.x / BRICK; x <= hi.x / BRICK; x++)
+            {
+                size_t b = size_t(x) + size_t(y) * brickRes + size_t(z) * brickRes * brickRes;
+                outMin = std::min(outMin, brickMin[b]);
+                outMax = std::max(outMax, brickMax[b]);
+            }
+}
+
+namespace
+{
+    //m * (p, 1) spelled out, the lanes repeat these operations in this order.
+    inline glm::vec3 TransformPoint(const glm::mat4& m, const glm::vec3& p)
+    {
+        glm::vec3 r;
+        for (int c = 0; c < 3; c++)
+            r[c] = m[0][c] * p.x + m[1][c] * p.y + m[2][c] * p.z + m[3][c];
+        return r;
+    }
+
+    //Read3DTransformed on an already transformed position.
+    inline float BrushDistanceLocal(const CSGBrush& brush, const glm::vec3& local)
+    {
+        glm::vec3 uvw = SDFBrushUVW(local, brush.aabbMin, brush.aabbMax);
+        if (!SDFBrushUVWInside(uvw))
+            return SDF_EMPTY_SPACE;
+
+        if (brush.primitive == CSGPrimitive::Sphere)
+            return std::sqrt(local.x * local.x + local.y * local.y + local.z * local.z) - 1.0f;
+        if (brush.volume == nullptr || brush.volume->resolution == 0)
+            return SDF_EMPTY_SPACE;
+        return brush.volume->SampleTrilinear(uvw);
+    }
+
+    inline float ApplyOp(const CSGBrush& brush, float k, float a, float d)
+    {
+        if (brush.op == SDFBrushOp::Subtraction)
+            return std::max(-d + 1.0f, a);
+        return SDFSmin(a, d, k);
+    }
+
+    inline float Tolerance(float a, float b)
+    {
+        return 1e-5f * (1.0f + std::abs(a) + std::abs(b));
+    }
+
+#ifdef __AVX2__
+    //BrushDistanceLocal on 8 positions. Volumes go through SDFSampleTrilinearAVX2, the gather version of the sampler
+    //SampleTrilinear uses.
+    inline __m256 BrushDistanceAVX2(const CSGBrush& brush, __m256 x, __m256 y, __m256 z)
+    {
+        const __m256 empty = _mm256_set1_ps(SDF_EMPTY_SPACE);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        glm::vec3 size = brush.aabbMax - brush.aabbMin;
+        __m256 u = _mm256_div_ps(_mm256_sub_ps(x, _mm256_set1_ps(brush.aabbMin.x)), _mm256_set1_ps(size.x));
+        __m256 v = _mm256_div_ps(_mm256_sub_ps(y, _mm256_set1_ps(brush.aabbMin.y)), _mm256_set1_ps(size.y));
+        __m256 w = _mm256_div_ps(_mm256_sub_ps(z, _mm256_set1_ps(brush.aabbMin.z)), _mm256_set1_ps(size.z));
+        __m256 inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(v, zero, _CMP_GE_OQ)), _mm256_cmp_ps(w, zero, _CMP_GE_OQ)),
+            _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(u, one, _CMP_LE_OQ), _mm256_cmp_ps(v, one, _CMP_LE_OQ)), _mm256_cmp_ps(w, one, _CMP_LE_OQ)));
+        if (_mm256_movemask_ps(inside) == 0)
+            return empty;
+
+        __m256 d;
+        if (brush.primitive == CSGPrimitive::Sphere)
+        {
+            __m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+            d = _mm256_sub_ps(_mm256_sqrt_ps(lengthSq), one);
+        }
+        else if (brush.volume != nullptr && brush.volume->resolution > 0)
+        {
+            //Lanes outside the bounds still sample, at clamped coordinates, and are replaced below.
+            const __m256 half = _mm256_set1_ps(0.5f);
+            SDFSampleGridAVX2 grid(brush.volume->values.data(), brush.volume->Grid());
+            u = _mm256_min_ps(_mm256_max_ps(u, zero), one);
+            v = _mm256_min_ps(_mm256_max_ps(v, zero), one);
+            w = _mm256_min_ps(_mm256_max_ps(w, zero), one);
+            d = SDFSampleTrilinearAVX2(grid, _mm256_sub_ps(u, half), _mm256_sub_ps(v, half), _mm256_sub_ps(w, half));
+        }
+        else
+        {
+            return empty;
+        }
+        return _mm256_blendv_ps(empty, d, inside);
+    }
+
+    //ApplyOp on 8 lanes. std::min(a, b) is b < a ? b : a, which is _mm256_min_ps(b, a); max likewise.
+    inline __m256 ApplyOpAVX2(const CSGBrush& brush, float k, __m256 a, __m256 d)
+    {
+        if (brush.op == SDFBrushOp::Subtraction)
+            return _mm256_max_ps(a, _mm256_sub_ps(_mm256_set1_ps(1.0f), d));
+
+        __m256 kk = _mm256_set1_ps(k * (16.0f / 3.0f));
+        __m256 diff = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), _mm256_sub_ps(a, d));
+        __m256 h = _mm256_div_ps(_mm256_max_ps(_mm256_setzero_ps(), _mm256_sub_ps(kk, diff)), kk);
+        __m256 blend = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(h, h), h),
+            _mm256_sub_ps(_mm256_set1_ps(4.0f), h)), kk), _mm256_set1_ps(1.0f / 16.0f));
+        return _mm256_sub_ps(_mm256_min_ps(d, a), blend);
+    }
+#endif
+}
+
+float CSGBrushDistance(const CSGBrush& brush, const glm::vec3& worldPos)
+{
+    return BrushDistanceLocal(brush, TransformPoint(brush.invModel, worldPos));
+}
+
+void CSGProgram::BrushInterval(const CSGBrush& brush, const SDFAABB& worldRegion, float& outMin, float& outMax) const
+{
+    SDFAABB local = TransformAABB(worldRegion, brush.invModel);
+    SDFAABB authored(brush.aabbMin, brush.aabbMax);
+    if (!local.Overlaps(authored))
+    {
+        outMin = outMax = SDF_EMPTY_SPACE;
+        return;
+    }
+
+    SDFAABB inside(glm::max(local.min, authored.min), glm::min(local.max, authored.max));
+    if (brush.primitive == CSGPrimitive::Sphere)
+    {
+        glm::vec3 far = glm::max(glm::abs(inside.min), glm::abs(inside.max));
+        outMin = inside.Distance(glm::vec3(0.0f)) - 1.0f;
+        outMax = glm::length(far) - 1.0f;
+    }
+    else if (brush.volume != nullptr && brush.volume->resolution > 0)
+    {
+        glm::vec3 size = authored.max - authored.min;
+        brush.volume->TexelRange((inside.min - authored.min) / size, (inside.max - authored.min) / size, outMin, outMax);
+    }
+    else
+    {
+        outMin = outMax = SDF_EMPTY_SPACE;
+    }
+
+    //Part of the region reads outside the authored bounds.
+    if (!authored.Contains(local))
+    {
+        outMin = std::min(outMin, SDF_EMPTY_SPACE);
+        outMax = std::max(outMax, SDF_EMPTY_SPACE);
+    }
+}
+
+void CSGProgram::PruneRegion(const SDFAABB& region, const std::vector<CSGInstruction>& input, std::vector<CSGInstruction>& output) const
+{
+    output.clear();
+    //Bounds of the running value over the region, starting from the empty distance like the shader.
+    float aLo = emptyDistance, aHi = emptyDistance;
+    for (const CSGInstruction& instr : input)
+    {
+        const CSGBrush& brush = brushes[instr.brush];
+        float dLo, dHi;
+        BrushInterval(brush, region, dLo, dHi);
+
+        if (brush.op == SDFBrushOp::Subtraction)
+        {
+            //max(1 - d, a) == a wherever 1 - d <= a.
+            if (1.0f - dLo < aLo - Tolerance(dLo, aLo))
+                continue;
+            output.push_back(instr);
+            aLo = std::max(1.0f - dHi, aLo);
+            aHi = std::max(1.0f - dLo, aHi);
+        }
+        else
+        {
+            //smin returns a exactly once |a - d| >= k * 16/3.
+            float kk = instr.k * (16.0f / 3.0f);
+            if (dLo - aHi > kk + Tolerance(dLo, aHi))
+                continue;
+            output.push_back(instr);
+            aLo = std::min(aLo, dLo) - instr.k;
+            aHi = std::min(aHi, dHi);
+        }
+    }
+}
+
+void CSGProgram::Compile(const std::vector<CSGBrush>& inBrushes, const SDFGridDesc& gridDesc, int tileSizeVoxels, int subTileSizeVoxels)
+{
+    brushes = inBrushes;
+    grid = gridDesc;
+    tileSize = std::max(tileSizeVoxels, 1);
+    subTileSize = glm::clamp(subTileSizeVoxels, 1, tileSize);
+    tileCount = (grid.resolution + tileSize - 1) / tileSize;
+    subTilesPerTile = glm::ivec3((tileSize + subTileSize - 1) / subTileSize);
+    stats = CSGStats{};
+
+    for (CSGBrush& b : brushes)
+        if (!b.worldBounds.IsValid())
+            b.worldBounds = TransformAABB(SDFAABB(b.aabbMin, b.aabbMax), b.model);
+
+    //Bin brushes into tiles, lists come back in brush order.
+    uint32_t tiles = uint32_t(tileCount.x * tileCount.y * tileCount.z);
+    std::vector<SDFAABB> bounds(brushes.size());
+    for (size_t i = 0; i < brushes.size(); i++)
+        bounds[i] = brushes[i].worldBounds;
+    SDFTileBins bins;
+    BinBrushesToTiles(SDFTileGrid(grid, tileSize), bounds, bins);
+
+    uint32_t subPerTile = uint32_t(subTilesPerTile.x * subTilesPerTile.y * subTilesPerTile.z);
+    std::vector<std::vector<CSGInstruction>> tilePrograms(tiles);
+    std::vector<uint32_t> tileSurvivorCounts(tiles, 0);
+    std::vector<uint64_t> tileEvaluations(tiles, 0);
+    std::vector<uint32_t> localCounts(size_t(tiles) * subPerTile, 0);
+
+    UnigmaParallelFor(tiles, 16, [&](uint32_t t) {
+        glm::ivec3 tc(t % tileCount.x, (t / tileCount.x) % tileCount.y, t / (tileCount.x * tileCount.y));
+
+        std::vector<CSGInstruction> full;
+        float blendFactor = 0.0f;
+        for (const uint32_t* it = bins.Begin(t); it != bins.End(t); ++it)
+        {
+            const CSGBrush& b = brushes[*it];
+            if (b.op == SDFBrushOp::Union)
+                blendFactor += b.blend;
+            full.push_back(CSGInstruction{ *it, blendFactor + 0.0001f });
+        }
+
+        glm::ivec3 v0 = tc * tileSize;
+        glm::ivec3 v1 = glm::min(v0 + tileSize, grid.resolution) - 1;
+        std::vector<CSGInstruction> survivors;
+        PruneRegion(SDFAABB(grid.VoxelCenter(v0), grid.VoxelCenter(v1)), full, survivors);
+        tileSurvivorCounts[t] = (uint32_t)survivors.size();
+
+        std::vector<CSGInstruction>& out = tilePrograms[t];
+        std::vector<CSGInstruction> sub;
+        for (uint32_t s = 0; s < subPerTile; s++)
+        {
+            glm::ivec3 sc(s % subTilesPerTile.x, (s / subTilesPerTile.x) % subTilesPerTile.y, s / (subTilesPerTile.x * subTilesPerTile.y));
+            glm::ivec3 s0 = v0 + sc * subTileSize;
+            glm::ivec3 s1 = glm::min(s0 + subTileSize - 1, v1);
+            if (glm::any(glm::greaterThan(s0, v1)))
+                continue;
+            PruneRegion(SDFAABB(grid.VoxelCenter(s0), grid.VoxelCenter(s1)), survivors, sub);
+            localCounts[size_t(t) * subPerTile + s] = (uint32_t)sub.size();
+            glm::ivec3 extent = s1 - s0 + 1;
+            tileEvaluations[t] += uint64_t(sub.size()) * uint64_t(extent.x * extent.y * extent.z);
+            out.insert(out.end(), sub.begin(), sub.end());
+        }
+    });
+
+    subTileOffsets.assign(size_t(tiles) * subPerTile, 0);
+    subTileCounts = localCounts;
+    instructions.clear();
+    for (uint32_t t = 0; t < tiles; t++)
+    {
+        uint32_t running = (uint32_t)instructions.size();
+        for (uint32_t s = 0; s < subPerTile; s++)
+        {
+            size_t idx = size_t(t) * subPerTile + s;
+            subTileOffsets[idx] = running;
+            running += subTileCounts[idx];
+        }
+        instructions.insert(instructions.end(), tilePrograms[t].begin(), tilePrograms[t].end());
+        stats.tileInstructions += tileSurvivorCounts[t];
+        stats.evaluatedBrushVoxels += tileEvaluations[t];
+        stats.naiveEvaluations += uint64_t(bins.counts[t]) * uint64_t(tileSize) * tileSize * tileSize;
+    }
+    stats.subTileInstructions = instructions.size();
+}
+
+float CSGProgram::EvaluateReference(const glm::vec3& worldPos) const
+{
+    SDFTileGrid tiles(grid, tileSize);
+    glm::ivec3 tc = tiles.TileForPosition(worldPos);
+
+    float minDist = emptyDistance;
+    float blendFactor = 0.0f;
+    for (const CSGBrush& brush : brushes)
+    {
+        if (!tiles.RangeForBounds(brush.worldBounds).Contains(tc))
+            continue;
+
+        float d = CSGBrushDistance(brush, worldPos);
+        if (brush.op == SDFBrushOp::Union)
+            blendFactor += brush.blend;
+        minDist = ApplyOp(brush, blendFactor + 0.0001f, minDist, d);
+    }
+    return minDist;
+}
+
+void CSGProgram::EvaluateLanes(const CSGInstruction* program, uint32_t count, const glm::vec3* positions, int laneCount, float* out) const
+{
+#ifdef __AVX2__
+    //Short batches repeat their last position in the unused lanes.
+    alignas(32) float px[CSG_LANES], py[CSG_LANES], pz[CSG_LANES];
+    for (int l = 0; l < CSG_LANES; l++)
+    {
+        const glm::vec3& p = positions[std::min(l, laneCount - 1)];
+        px[l] = p.x;
+        py[l] = p.y;
+        pz[l] = p.z;
+    }
+    __m256 x = _mm256_load_ps(px), y = _mm256_load_ps(py), z = _mm256_load_ps(pz);
+    __m256 a = _mm256_set1_ps(emptyDistance);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const CSGBrush& brush = brushes[program[i].brush];
+        const glm::mat4& m = brush.invModel;
+        __m256 local[3];
+        for (int c = 0; c < 3; c++)
+        {
+            local[c] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[0][c]), x),
+                _mm256_mul_ps(_mm256_set1_ps(m[1][c]), y)), _mm256_mul_ps(_mm256_set1_ps(m[2][c]), z)), _mm256_set1_ps(m[3][c]));
+        }
+        a = ApplyOpAVX2(brush, program[i].k, a, BrushDistanceAVX2(brush, local[0], local[1], local[2]));
+    }
+
+    alignas(32) float values[CSG_LANES];
+    _mm256_store_ps(values, a);
+    for (int l = 0; l < laneCount; l++)
+        out[l] = values[l];
+#else
+    float a[CSG_LANES];
+    for (int l = 0; l < CSG_LANES; l++)
+        a[l] = emptyDistance;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const CSGBrush& brush = brushes[program[i].brush];
+        for (int l = 0; l < laneCount; l++)
+            a[l] = ApplyOp(brush, program[i].k, a[l], BrushDistanceLocal(brush, TransformPoint(brush.invModel, positions[l])));
+    }
+
+    for (int l = 0; l < laneCount; l++)
+        out[l] = a[l];
+#endif
+}
+
+void CSGProgram::EvaluateTile(uint32_t tileIndex, float* out) const
+{
+    glm::ivec3 tc(tileIndex % tileCount.x, (tileIndex / tileCount.x) % tileCount.y, tileIndex / (tileCount.x * tileCount.y));
+    glm::ivec3 v0 = tc * tileSize;
+    glm::ivec3 v1 = glm::min(v0 + tileSize, grid.resolution) - 1;
+    uint32_t subPerTile = uint32_t(subTilesPerTile.x * subTilesPerTile.y * subTilesPerTile.z);
+
+    glm::vec3 positions[CSG_LANES];
+    float values[CSG_LANES];
+    size_t indices[CSG_LANES];
+
+    for (uint32_t s = 0; s < subPerTile; s++)
+    {
+        glm::ivec3 sc(s % subTilesPerTile.x, (s / subTilesPerTile.x) % subTilesPerTile.y, s / (subTilesPerTile.x * subTilesPerTile.y));
+        glm::ivec3 s0 = v0 + sc * subTileSize;
+        glm::ivec3 s1 = glm::min(s0 + subTileSize - 1, v1);
+        if (glm::any(glm::greaterThan(s0, v1)))
+            continue;
+
+        size_t idx = size_t(tileIndex) * subPerTile + s;
+        const CSGInstruction* program = instructions.data() + subTileOffsets[idx];
+        uint32_t count = subTileCounts[idx];
+
+        int lanes = 0;
+        for (int z = s0.z; z <= s1.z; z++)
+            for (int y = s0.y; y <= s1.y; y++)
+                for (int x = s0.x; x <= s1.x; x++)
+                {
+                    glm::ivec3 v(x, y, z);
+                    positions[lanes] = grid.VoxelCenter(v);
+                    indices[lanes] = grid.Flatten(v);
+                    lanes++;
+                    if (lanes == CSG_LANES)
+                    {
+                        EvaluateLanes(program, count, positions, lanes, values);
+                        for (int l = 0; l < lanes; l++)
+                            out[indices[l]] = values[l];
+                        lanes = 0;
+                    }
+                }
+        if (lanes > 0)
+        {
+            EvaluateLanes(program, count, positions, lanes, values);
+            for (int l = 0; l < lanes; l++)
+                out[indices[l]] = values[l];
+        }
+    }
+}
+
+void CSGProgram::EvaluateGrid(float* out) const
+{
+    uint32_t tiles = uint32_t(tileCount.x * tileCount.y * tileCount.z);
+    UnigmaParallelFor(tiles, 4, [&](uint32_t t) {
+        EvaluateTile(t, out);
+    });
+}
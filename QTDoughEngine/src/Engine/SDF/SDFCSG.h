@@ -0,0 +1,107 @@
+#pragma once
+#include "SDFTileBinning.h"
+
+//CPU CSG evaluator for the brush list that WriteToWorldSDF folds per voxel.
+//Tiles bin brushes by world bounds like DispatchTile (in brush order, without the TILE_MAX_BRUSHES cap) and the
+//running union blend accumulates over the binned brushes only, as in the shader. Each tile and sub-tile list is then
+//pruned by pushing interval bounds on every brush distance through the same fold: brushes that provably cannot change
+//the result are dropped. Survivors are evaluated 8 voxels at a time, in AVX2 registers when built with __AVX2__ (MSVC
+///arch:AVX2) and lane by lane otherwise. Both repeat the scalar operations in order, so the output is bit identical
+//to the full fold; the translation unit keeps multiply and add from being fused for that.
+
+#define CSG_LANES 8
+
+enum class CSGPrimitive : uint32_t
+{
+    Volume = 0, //Baked SDF volume (PrimMesh).
+    Sphere = 1 //Unit sphere in brush space (PrimSphere).
+};
+
+//Baked brush volume, res^3 floats, x fastest. Keeps a min/max per brick so bounds queries stay cheap.
+struct CSGVolume
+{
+    int resolution = 0;
+    std::vector<float> values;
+
+    static const int BRICK = 4;
+    int brickRes = 0;
+    std::vector<float> brickMin;
+    std::vector<float> brickMax;
+
+    void BuildBounds();
+    float Load(int x, int y, int z) const { return values[size_t(x) + size_t(y) * resolution + size_t(z) * resolution * resolution]; }
+    //The volume as a unit cube grid centred on the origin, what SDFSampleTrilinear reads it through.
+    SDFGridDesc Grid() const { return SDFGridDesc(glm::ivec3(resolution), glm::vec3(1.0f)); }
+    //Same filtering as Read3DTrilinearManual, through SDFSampleTrilinear at uvw - 0.5.
+    float SampleTrilinear(const glm::vec3& uvw) const;
+    //Range of every texel a trilinear read inside [uvwMin, uvwMax] can touch.
+    void TexelRange(const glm::vec3& uvwMin, const glm::vec3& uvwMax, float& outMin, float& outMax) const;
+};
+
+struct CSGBrush
+{
+    CSGPrimitive primitive = CSGPrimitive::Volume;
+    SDFBrushOp op = SDFBrushOp::Union;
+    float blend = 0.0225f;
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::mat4 invModel = glm::mat4(1.0f);
+    glm::vec3 aabbMin = glm::vec3(-1.0f); //Brush space bounds the volume was authored in.
+    glm::vec3 aabbMax = glm::vec3(1.0f);
+    const CSGVolume* volume = nullptr;
+    SDFAABB worldBounds; //Binning bounds. Left invalid, the authored bounds are transformed by model.
+};
+
+struct CSGInstruction
+{
+    uint32_t brush;
+    float k; //Running union blend at this brush (blendFactor + 0.0001f in the shader).
+};
+
+struct CSGStats
+{
+    uint64_t naiveEvaluations = 0; //voxels * brushes.
+    uint64_t tileInstructions = 0;
+    uint64_t subTileInstructions = 0;
+    uint64_t evaluatedBrushVoxels = 0; //Brush distance evaluations after pruning.
+};
+
+class CSGProgram
+{
+public:
+    SDFGridDesc grid;
+    int tileSize = 16; //GetTileSize(): voxelRes.z / 16 for the world grid.
+    int subTileSize = 4;
+    float emptyDistance = SDF_EMPTY_SPACE;
+
+    glm::ivec3 tileCount = glm::ivec3(0);
+    glm::ivec3 subTilesPerTile = glm::ivec3(0);
+
+    //Compiled per sub-tile programs, offset/count into instructions.
+    std::vector<uint32_t> subTileOffsets;
+    std::vector<uint32_t> subTileCounts;
+    std::vector<CSGInstruction> instructions;
+    CSGStats stats;
+
+    void Compile(const std::vector<CSGBrush>& brushes, const SDFGridDesc& gridDesc, int tileSizeVoxels = 16, int subTileSizeVoxels = 4);
+
+    //Full unpruned fold at a world position, the reference the pruned path must match.
+    float EvaluateReference(const glm::vec3& worldPos) const;
+
+    //Evaluates one tile into the dense grid `out` (grid.VoxelCount() floats).
+    void EvaluateTile(uint32_t tileIndex, float* out) const;
+
+    //Evaluates every tile across all cores.
+    void EvaluateGrid(float* out) const;
+
+    uint32_t TileIndex(const glm::ivec3& tile) const { return uint32_t(tile.x + tile.y * tileCount.x + tile.z * tileCount.x * tileCount.y); }
+
+private:
+    std::vector<CSGBrush> brushes;
+
+    void PruneRegion(const SDFAABB& region, const std::vector<CSGInstruction>& input, std::vector<CSGInstruction>& output) const;
+    void BrushInterval(const CSGBrush& brush, const SDFAABB& worldRegion, float& outMin, float& outMax) const;
+    void EvaluateLanes(const CSGInstruction* program, uint32_t count, const glm::vec3* positions, int laneCount, float* out) const;
+};
+
+//Scalar brush distance in the shader's convention (Read3DTransformed): outside the authored bounds is empty space.
+float CSGBrushDistance(const CSGBrush& brush, const glm::vec3& worldPos);
@@ -0,0 +1,378 @@
+#include "SDFCageDeformer.h"
+#include "SDFContentHash.h"
+#include "../Core/UnigmaParallel.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <immintrin.h>
+#define SDF_CAGE_SSE 1
+#endif
+
+SDFCage SDFCage::Canonical()
+{
+    SDFCage cage;
+    cage.rest = {
+        //Corners.
+        { 1, 1, 1 }, { -1, 1, 1 }, { 1, -1, 1 }, { -1, -1, 1 },
+        { 1, 1, -1 }, { -1, 1, -1 }, { 1, -1, -1 }, { -1, -1, -1 },
+        //Edge midpoints.
+        { 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 },
+        { 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+        { 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+        //Face centres.
+        { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }
+    };
+    cage.triangles = {
+        { 0, 8, 20 }, { 8, 1, 20 }, { 1, 13, 20 }, { 13, 3, 20 }, { 3, 9, 20 }, { 9, 2, 20 }, { 2, 12, 20 }, { 12, 0, 20 },
+        { 4, 10, 21 }, { 10, 5, 21 }, { 5, 15, 21 }, { 15, 7, 21 }, { 7, 11, 21 }, { 11, 6, 21 }, { 6, 14, 21 }, { 14, 4, 21 },
+        { 0, 16, 22 }, { 16, 4, 22 }, { 4, 14, 22 }, { 14, 6, 22 }, { 6, 18, 22 }, { 18, 2, 22 }, { 2, 12, 22 }, { 12, 0, 22 },
+        { 1, 17, 23 }, { 17, 5, 23 }, { 5, 15, 23 }, { 15, 7, 23 }, { 7, 19, 23 }, { 19, 3, 23 }, { 3, 13, 23 }, { 13, 1, 23 },
+        { 0, 8, 24 }, { 8, 1, 24 }, { 1, 17, 24 }, { 17, 5, 24 }, { 5, 10, 24 }, { 10, 4, 24 }, { 4, 16, 24 }, { 16, 0, 24 },
+        { 2, 9, 25 }, { 9, 3, 25 }, { 3, 19, 25 }, { 19, 7, 25 }, { 7, 11, 25 }, { 11, 6, 25 }, { 6, 18, 25 }, { 18, 2, 25 }
+    };
+
+    //The shader table winds faces both ways (only the unsigned inverse distance path uses it). The cube is star shaped
+    //around the origin, so facing away from it is outwards.
+    for (glm::uvec3& t : cage.triangles)
+    {
+        glm::vec3 a = cage.rest[t.x], b = cage.rest[t.y], c = cage.rest[t.z];
+        if (glm::dot(glm::cross(b - a, c - a), a + b + c) < 0.0f)
+            std::swap(t.y, t.z);
+    }
+    return cage;
+}
+
+uint64_t SDFCage::Hash() const
+{
+    uint64_t hash = SDFHashBytes(rest.data(), rest.size() * sizeof(glm::vec3));
+    return SDFHashBytes(triangles.data(), triangles.size() * sizeof(glm::uvec3), hash);
+}
+
+void SDFCageBinding::SolveWeights(const SDFCage& cage, const glm::vec3& p, SDFCageWeightMode mode, std::vector<float>& outWeights)
+{
+    const float eps = 1e-6f;
+    size_t n = cage.rest.size();
+    outWeights.assign(n, 0.0f);
+    if (n == 0)
+        return;
+
+    if (mode == SDFCageWeightMode::InverseDistance)
+    {
+        float denom = 0.0f;
+        for (size_t i = 0; i < n; i++)
+        {
+            glm::vec3 r = cage.rest[i] - p;
+            float l = std::sqrt(glm::dot(r, r) + eps); //lenFast.
+            outWeights[i] = 1.0f / std::pow(std::max(l, eps), 2.0f);
+            denom += outWeights[i];
+        }
+        for (float& w : outWeights)
+            w /= std::max(denom, eps);
+        return;
+    }
+
+    //Ju, Schaefer and Warren, "Mean Value Coordinates for Closed Triangular Meshes". Doubles because the terms cancel
+    //badly next to the cage.
+    std::vector<glm::dvec3> u(n);
+    std::vector<double> d(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        glm::dvec3 r = glm::dvec3(cage.rest[i]) - glm::dvec3(p);
+        d[i] = glm::length(r);
+        if (d[i] < eps)
+        {
+            outWeights[i] = 1.0f; //On a cage point.
+            return;
+        }
+        u[i] = r / d[i];
+    }
+
+    std::vector<double> w(n, 0.0);
+    for (const glm::uvec3& t : cage.triangles)
+    {
+        uint32_t v[3] = { t.x, t.y, t.z };
+        double theta[3], c[3], s[3];
+        double h = 0.0;
+        for (int k = 0; k < 3; k++)
+        {
+            double l = glm::length(u[v[(k + 1) % 3]] - u[v[(k + 2) % 3]]);
+            theta[k] = 2.0 * std::asin(std::min(l * 0.5, 1.0));
+            h += theta[k] * 0.5;
+        }
+
+        if (3.14159265358979 - h < 1e-9)
+        {
+            //p lies inside this triangle: plain barycentric weights.
+            std::fill(w.begin(), w.end(), 0.0);
+            for (int k = 0; k < 3; k++)
+                w[v[k]] = std::sin(theta[k]) * d[v[(k + 2) % 3]] * d[v[(k + 1) % 3]];
+            break;
+        }
+
+        double det = glm::dot(u[v[0]], glm::cross(u[v[1]], u[v[2]]));
+        double sign = det < 0.0 ? -1.0 : 1.0;
+        bool coplanar = false;
+        for (int k = 0; k < 3; k++)
+        {
+            c[k] = 2.0 * std::sin(h) * std::sin(h - theta[k]) / (std::sin(theta[(k + 1) % 3]) * std::sin(theta[(k + 2) % 3])) - 1.0;
+            s[k] = sign * std::sqrt(std::max(1.0 - c[k] * c[k], 0.0));
+            coplanar |= std::abs(s[k]) <= 1e-9;
+        }
+        if (coplanar)
+            continue; //In the triangle's plane but outside it, contributes nothing.
+
+        for (int k = 0; k < 3; k++)
+        {
+            int k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+            w[v[k]] += (theta[k] - c[k1] * theta[k2] - c[k2] * theta[k1]) / (d[v[k]] * std::sin(theta[k1]) * s[k2]);
+        }
+    }
+
+    double total = 0.0;
+    for (double x : w)
+        total += x;
+    for (size_t i = 0; i < n; i++)
+        outWeights[i] = total != 0.0 ? float(w[i] / total) : 0.0f;
+}
+
+//Smallest change to the kept weights that makes them sum to 1 and reproduce p from the rest cage again, so truncated
+//mean value weights still move the point exactly under any affine cage motion: w += C^T (C C^T)^-1 (b - C w) with
+//C the rows (1, x, y, z) of the kept cage points and b = (1, p). Fails, leaving them alone, if those are coplanar.
+static bool RestoreLinearPrecision(const SDFCage& cage, const std::vector<uint32_t>& order, const glm::vec3& p, std::vector<float>& kept)
+{
+    size_t n = kept.size();
+    double m[4][5] = {}; //C C^T | b - C w.
+    double b[4] = { 1.0, p.x, p.y, p.z };
+    for (size_t k = 0; k < n; k++)
+    {
+        const glm::vec3& r = cage.rest[order[k]];
+        double c[4] = { 1.0, r.x, r.y, r.z };
+        for (int i = 0; i < 4; i++)
+        {
+            for (int j = 0; j < 4; j++)
+                m[i][j] += c[i] * c[j];
+            b[i] -= c[i] * kept[k];
+        }
+    }
+    for (int i = 0; i < 4; i++)
+        m[i][4] = b[i];
+
+    for (int col = 0; col < 4; col++)
+    {
+        int pivot = col;
+        for (int r = col + 1; r < 4; r++)
+            if (std::abs(m[r][col]) > std::abs(m[pivot][col]))
+                pivot = r;
+        if (std::abs(m[pivot][col]) < 1e-9)
+            return false;
+        for (int c = 0; c < 5; c++)
+            std::swap(m[col][c], m[pivot][c]);
+        for (int r = 0; r < 4; r++)
+        {
+            if (r == col)
+                continue;
+            double f = m[r][col] / m[col][col];
+            for (int c = col; c < 5; c++)
+                m[r][c] -= f * m[col][c];
+        }
+    }
+
+    double lambda[4];
+    for (int i = 0; i < 4; i++)
+        lambda[i] = m[i][4] / m[i][i];
+    for (size_t k = 0; k < n; k++)
+    {
+        const glm::vec3& r = cage.rest[order[k]];
+        kept[k] += float(lambda[0] + lambda[1] * r.x + lambda[2] * r.y + lambda[3] * r.z);
+    }
+    return true;
+}
+
+void SDFCageBinding::Build(const SDFCage& cage, const std::vector<glm::vec3>& points, SDFCageWeightMode mode, uint32_t maxInfluences)
+{
+    pointCount = (uint32_t)points.size();
+    cageSize = (uint32_t)cage.rest.size();
+    influences = maxInfluences == 0 ? cageSize : std::min(maxInfluences, cageSize);
+    uint32_t batches = (pointCount + SDF_CAGE_BATCH - 1) / SDF_CAGE_BATCH;
+    indices.assign(size_t(batches) * influences * SDF_CAGE_BATCH, 0);
+    weights.assign(indices.size(), 0.0f);
+
+    UnigmaParallelForRange(pointCount, 64, [&](uint32_t begin, uint32_t end) {
+        std::vector<float> row;
+        std::vector<uint32_t> order(cageSize);
+        for (uint32_t i = begin; i < end; i++)
+        {
+            SolveWeights(cage, points[i], mode, row);
+
+            //Strongest influences by magnitude (mean value weights can dip below zero on concave cages).
+            for (uint32_t c = 0; c < cageSize; c++)
+                order[c] = c;
+            std::sort(order.begin(), order.end(),
+                [&](uint32_t a, uint32_t b) { return std::abs(row[a]) > std::abs(row[b]) || (std::abs(row[a]) == std::abs(row[b]) && a < b); });
+
+            std::vector<float> kept(influences);
+            for (uint32_t k = 0; k < influences; k++)
+                kept[k] = row[order[k]];
+            bool restored = false;
+            if (mode == SDFCageWeightMode::MeanValue && influences < cageSize)
+            {
+                //Next to a face the strongest points can all lie on it; trade the weakest one for the next candidates
+                //until the set spans space again.
+                std::vector<float> trial(kept);
+                for (uint32_t next = influences; next <= cageSize && !restored; next++)
+                {
+                    if (next > influences)
+                    {
+                        std::swap(order[influences - 1], order[next - 1]);
+                        trial = kept;
+                        trial[influences - 1] = row[order[influences - 1]];
+                    }
+                    restored = RestoreLinearPrecision(cage, order, points[i], trial);
+                }
+                if (restored)
+                    kept = trial;
+            }
+            if (!restored)
+            {
+                //Renormalised so a rigid translation of the cage still moves the point exactly.
+                float total = 0.0f;
+                for (float w : kept)
+                    total += w;
+                for (float& w : kept)
+                    w = total != 0.0f ? w / total : 0.0f;
+            }
+
+            size_t base = size_t(i / SDF_CAGE_BATCH) * influences * SDF_CAGE_BATCH + i % SDF_CAGE_BATCH;
+            for (uint32_t k = 0; k < influences; k++)
+            {
+                indices[base + size_t(k) * SDF_CAGE_BATCH] = order[k];
+                weights[base + size_t(k) * SDF_CAGE_BATCH] = kept[k];
+            }
+        }
+    });
+}
+
+void SDFCageBinding::BuildGrid(const SDFCage& cage, const glm::ivec3& resolution, SDFCageWeightMode mode, uint32_t maxInfluences)
+{
+    std::vector<glm::vec3> points;
+    points.reserve(size_t(resolution.x) * resolution.y * resolution.z);
+    for (int z = 0; z < resolution.z; z++)
+        for (int y = 0; y < resolution.y; y++)
+            for (int x = 0; x < resolution.x; x++)
+                points.push_back((glm::vec3(x, y, z) + 0.5f) / glm::vec3(resolution) * 2.0f - 1.0f);
+    Build(cage, points, mode, maxInfluences);
+}
+
+void SDFCageBinding::ApplyScalar(const std::vector<glm::vec3>& displacement, std::vector<glm::vec3>& outDelta) const
+{
+    outDelta.assign(pointCount, glm::vec3(0.0f));
+    for (uint32_t i = 0; i < pointCount; i++)
+    {
+        size_t base = size_t(i / SDF_CAGE_BATCH) * influences * SDF_CAGE_BATCH + i % SDF_CAGE_BATCH;
+        glm::vec3 sum(0.0f);
+        for (uint32_t k = 0; k < influences; k++)
+        {
+            float w = weights[base + size_t(k) * SDF_CAGE_BATCH];
+            const glm::vec3& d = displacement[indices[base + size_t(k) * SDF_CAGE_BATCH]];
+            sum.x = sum.x + w * d.x;
+            sum.y = sum.y + w * d.y;
+            sum.z = sum.z + w * d.z;
+        }
+        outDelta[i] = sum;
+    }
+}
+
+void SDFCageBinding::Apply(const std::vector<glm::vec3>& displacement, std::vector<glm::vec3>& outDelta) const
+{
+#ifndef SDF_CAGE_SSE
+    ApplyScalar(displacement, outDelta);
+#else
+    outDelta.resize(pointCount);
+    if (pointCount == 0)
+        return;
+
+    //Displacements as structure of arrays so lanes gather single floats.
+    std::vector<float> dx(cageSize), dy(cageSize), dz(cageSize);
+    for (uint32_t c = 0; c < cageSize; c++)
+    {
+        dx[c] = displacement[c].x;
+        dy[c] = displacement[c].y;
+        dz[c] = displacement[c].z;
+    }
+
+    uint32_t batches = (pointCount + SDF_CAGE_BATCH - 1) / SDF_CAGE_BATCH;
+    UnigmaParallelForRange(batches, 256, [&](uint32_t begin, uint32_t end) {
+        alignas(32) float sx[SDF_CAGE_BATCH], sy[SDF_CAGE_BATCH], sz[SDF_CAGE_BATCH];
+        for (uint32_t b = begin; b < end; b++)
+        {
+            const uint32_t* idx = &indices[size_t(b) * influences * SDF_CAGE_BATCH];
+            const float* w = &weights[size_t(b) * influences * SDF_CAGE_BATCH];
+
+#ifdef __AVX2__
+            __m256 ax = _mm256_setzero_ps(), ay = _mm256_setzero_ps(), az = _mm256_setzero_ps();
+            for (uint32_t k = 0; k < influences; k++)
+            {
+                __m256i i8 = _mm256_loadu_si256((const __m256i*)(idx + k * SDF_CAGE_BATCH));
+                __m256 w8 = _mm256_loadu_ps(w + k * SDF_CAGE_BATCH);
+                //Separate multiply and add, the same rounding as ApplyScalar.
+                ax = _mm256_add_ps(ax, _mm256_mul_ps(w8, _mm256_i32gather_ps(dx.data(), i8, 4)));
+                ay = _mm256_add_ps(ay, _mm256_mul_ps(w8, _mm256_i32gather_ps(dy.data(), i8, 4)));
+                az = _mm256_add_ps(az, _mm256_mul_ps(w8, _mm256_i32gather_ps(dz.data(), i8, 4)));
+            }
+            _mm256_store_ps(sx, ax);
+            _mm256_store_ps(sy, ay);
+            _mm256_store_ps(sz, az);
+#else
+            for (uint32_t half = 0; half < SDF_CAGE_BATCH; half += 4)
+            {
+                __m128 ax = _mm_setzero_ps(), ay = _mm_setzero_ps(), az = _mm_setzero_ps();
+                for (uint32_t k = 0; k < influences; k++)
+                {
+                    const uint32_t* i4 = idx + k * SDF_CAGE_BATCH + half;
+                    __m128 w4 = _mm_loadu_ps(w + k * SDF_CAGE_BATCH + half);
+                    ax = _mm_add_ps(ax, _mm_mul_ps(w4, _mm_setr_ps(dx[i4[0]], dx[i4[1]], dx[i4[2]], dx[i4[3]])));
+                    ay = _mm_add_ps(ay, _mm_mul_ps(w4, _mm_setr_ps(dy[i4[0]], dy[i4[1]], dy[i4[2]], dy[i4[3]])));
+                    az = _mm_add_ps(az, _mm_mul_ps(w4, _mm_setr_ps(dz[i4[0]], dz[i4[1]], dz[i4[2]], dz[i4[3]])));
+                }
+                _mm_store_ps(sx + half, ax);
+                _mm_store_ps(sy + half, ay);
+                _mm_store_ps(sz + half, az);
+            }
+#endif
+            uint32_t first = b * SDF_CAGE_BATCH;
+            uint32_t lanes = std::min<uint32_t>(SDF_CAGE_BATCH, pointCount - first);
+            for (uint32_t l = 0; l < lanes; l++)
+                outDelta[first + l] = glm::vec3(sx[l], sy[l], sz[l]);
+        }
+    });
+#endif
+}
+
+std::shared_ptr<const SDFCageBinding> SDFCageWeightCache::Get(const SDFCage& cage, const glm::ivec3& resolution, SDFCageWeightMode mode, uint32_t maxInfluences)
+{
+    Key key{ cage.Hash(), resolution, (uint32_t)mode, maxInfluences };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = bindings.find(key);
+        if (it != bindings.end())
+            return it->second;
+    }
+
+    //Solved outside the lock; if two threads race the first insert wins and both return it.
+    auto binding = std::make_shared<SDFCageBinding>();
+    binding->BuildGrid(cage, resolution, mode, maxInfluences);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return bindings.emplace(key, binding).first->second;
+}
+
+size_t SDFCageWeightCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return bindings.size();
+}
+
+void SDFCageWeightCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    bindings.clear();
+}
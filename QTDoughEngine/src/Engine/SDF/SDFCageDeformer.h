@@ -0,0 +1,92 @@
+#pragma once
+#include "SDFCommon.h"
+#include <memory>
+#include <map>
+#include <mutex>
+
+//Cage deformation with the weights solved once instead of per evaluation.
+//DeformBrush recomputes inverse distance weights to all 26 cage points for every voxel on every dispatch, yet they only
+//depend on the voxel's normalised position and the rest cage. A binding stores them per point, truncated to the
+//strongest few (mean value weights are then corrected to stay exact under affine cage motion, the others renormalised),
+//in a fixed width (ELL) layout of 8 point batches. Applying a deformation is then one sparse matrix * displacement
+//product, SIMD over each batch, so a deforming brush costs points * influences per frame.
+//Bindings are shared through SDFCageWeightCache: every brush of one resolution on the canonical cage uses the same one.
+
+#define SDF_CAGE_BATCH 8
+
+enum class SDFCageWeightMode : uint32_t
+{
+    InverseDistance = 0, //1 / d^2 over the cage points, as DeformBrush does.
+    MeanValue = 1 //3D mean value coordinates over the cage triangles: smooth, and exact for affine cage motion.
+};
+
+struct SDFCage
+{
+    std::vector<glm::vec3> rest;
+    std::vector<glm::uvec3> triangles; //Closed, facing outwards.
+
+    //canonicalControlPoints and the 48 triangles in ShaderHelpers.hlsl, with the winding made consistent.
+    static SDFCage Canonical();
+    uint64_t Hash() const;
+};
+
+class SDFCageBinding
+{
+public:
+    //points in cage space. maxInfluences 0 keeps every cage point.
+    void Build(const SDFCage& cage, const std::vector<glm::vec3>& points, SDFCageWeightMode mode, uint32_t maxInfluences = 8);
+    //Voxel centres of a brush volume mapped to [-1, 1]^3 like DeformBrush, x fastest.
+    void BuildGrid(const SDFCage& cage, const glm::ivec3& resolution, SDFCageWeightMode mode, uint32_t maxInfluences = 8);
+
+    //outDelta[i] = sum_k w_ik * displacement[c_ik], displacement being current cage minus rest. Resized to PointCount().
+    void Apply(const std::vector<glm::vec3>& displacement, std::vector<glm::vec3>& outDelta) const;
+    //Plain loop over the same weights, the reference for Apply.
+    void ApplyScalar(const std::vector<glm::vec3>& displacement, std::vector<glm::vec3>& outDelta) const;
+
+    //Full weight row of one point before truncation, for tests and tools.
+    static void SolveWeights(const SDFCage& cage, const glm::vec3& p, SDFCageWeightMode mode, std::vector<float>& outWeights);
+
+    uint32_t PointCount() const { return pointCount; }
+    uint32_t Influences() const { return influences; }
+    uint32_t CageSize() const { return cageSize; }
+    size_t MemoryBytes() const { return indices.size() * sizeof(uint32_t) + weights.size() * sizeof(float); }
+
+private:
+    uint32_t pointCount = 0;
+    uint32_t influences = 0;
+    uint32_t cageSize = 0;
+    //Batch b, slot k, lane l at (b * influences + k) * SDF_CAGE_BATCH + l. Padding lanes and slots have weight 0.
+    std::vector<uint32_t> indices;
+    std::vector<float> weights;
+};
+
+//Bindings by (cage, resolution, mode, influences), solved on first use and kept for the life of the cache.
+class SDFCageWeightCache
+{
+public:
+    std::shared_ptr<const SDFCageBinding> Get(const SDFCage& cage, const glm::ivec3& resolution, SDFCageWeightMode mode, uint32_t maxInfluences = 8);
+    size_t Size() const;
+    void Clear();
+
+private:
+    struct Key
+    {
+        uint64_t cageHash;
+        glm::ivec3 resolution;
+        uint32_t mode;
+        uint32_t influences;
+
+        bool operator<(const Key& o) const
+        {
+            if (cageHash != o.cageHash) return cageHash < o.cageHash;
+            if (resolution.x != o.resolution.x) return resolution.x < o.resolution.x;
+            if (resolution.y != o.resolution.y) return resolution.y < o.resolution.y;
+            if (resolution.z != o.resolution.z) return resolution.z < o.resolution.z;
+            if (mode != o.mode) return mode < o.mode;
+            return influences < o.influences;
+        }
+    };
+
+    mutable std::mutex mutex;
+    std::map<Key, std::shared_ptr<const SDFCageBinding>> bindings;
+};
@@ -0,0 +1,100 @@
+#include "SDFCameraPath.h"
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    //Uniform Catmull-Rom segment from p1 to p2.
+    glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float u)
+    {
+        float u2 = u * u;
+        float u3 = u2 * u;
+        return 0.5f * (2.0f * p1 + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+    }
+}
+
+bool SDFCameraPath::Parse(const std::string& text, std::string* error)
+{
+    std::vector<SDFCameraKey> parsed;
+    std::istringstream lines(text);
+    std::string line;
+    for (int lineNumber = 1; std::getline(lines, line); lineNumber++)
+    {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        std::istringstream fields(line);
+        SDFCameraKey key;
+        fields >> key.time >> key.eye.x >> key.eye.y >> key.eye.z >> key.target.x >> key.target.y >> key.target.z;
+        bool valid = !fields.fail();
+        if (valid && !(fields >> std::ws).eof())
+            valid = !(fields >> key.fov).fail() && (fields >> std::ws).eof() && key.fov > 0.0f && key.fov < 180.0f;
+        if (!valid)
+        {
+            if (error != nullptr)
+                *error = "camera path line " + std::to_string(lineNumber) + ": expected time, eye xyz, target xyz and an optional fov";
+            return false;
+        }
+        parsed.push_back(key);
+    }
+
+    std::stable_sort(parsed.begin(), parsed.end(), [](const SDFCameraKey& a, const SDFCameraKey& b) { return a.time < b.time; });
+    keys = std::move(parsed);
+    return true;
+}
+
+bool SDFCameraPath::Load(const std::string& path, std::string* error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        if (error != nullptr)
+            *error = "cannot open camera path " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return Parse(text.str(), error);
+}
+
+void SDFCameraPath::AddKey(const SDFCameraKey& key)
+{
+    auto at = std::upper_bound(keys.begin(), keys.end(), key.time, [](float t, const SDFCameraKey& k) { return t < k.time; });
+    keys.insert(at, key);
+}
+
+SDFCameraKey SDFCameraPath::Sample(float time) const
+{
+    if (keys.empty())
+        return SDFCameraKey();
+    if (time <= keys.front().time)
+        return keys.front();
+    if (time >= keys.back().time)
+        return keys.back();
+
+    //Last key at or before time; the checks above keep it short of the end.
+    size_t i = size_t(std::upper_bound(keys.begin(), keys.end(), time, [](float t, const SDFCameraKey& k) { return t < k.time; }) - keys.begin()) - 1;
+    const SDFCameraKey& a = keys[i];
+    const SDFCameraKey& b = keys[i + 1];
+    const SDFCameraKey& before = keys[i > 0 ? i - 1 : i];
+    const SDFCameraKey& after = keys[std::min(i + 2, keys.size() - 1)];
+
+    float span = b.time - a.time;
+    float u = span > 0.0f ? (time - a.time) / span : 1.0f;
+
+    SDFCameraKey out;
+    out.time = time;
+    out.eye = CatmullRom(before.eye, a.eye, b.eye, after.eye, u);
+    out.target = CatmullRom(before.target, a.target, b.target, after.target, u);
+    out.fov = a.fov + (b.fov - a.fov) * u;
+    return out;
+}
+
+SDFTraceCamera SDFCameraPath::Camera(float time, float aspect, const glm::vec3& up) const
+{
+    SDFCameraKey key = Sample(time);
+    return SDFTraceCamera::LookAt(key.eye, key.target, up, key.fov, aspect);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "SDFSphereTracer.h"
+#include <string>
+
+//Scripted camera for unattended runs: the headless renderer follows one frame by frame, and the CPU tracer tools can
+//render the same shots. A path is a text file of keyframes, one per line:
+//  time  eyeX eyeY eyeZ  targetX targetY targetZ  [fovDegrees]
+//Blank lines and anything after '#' are skipped. Keys may come in any order and are sorted by time.
+//Eye and target follow a Catmull-Rom spline through the keys, the field of view is linear, and times outside the
+//keys hold the first or last key. Nothing here touches Vulkan or SDL.
+
+struct SDFCameraKey
+{
+    float time = 0.0f;
+    glm::vec3 eye = glm::vec3(0.0f);
+    glm::vec3 target = glm::vec3(0.0f, 1.0f, 0.0f);
+    float fov = 45.0f;
+};
+
+class SDFCameraPath
+{
+public:
+    //Replaces the keys. On a malformed line nothing changes and error, when given, names the line.
+    bool Parse(const std::string& text, std::string* error = nullptr);
+    bool Load(const std::string& path, std::string* error = nullptr);
+    void AddKey(const SDFCameraKey& key);
+
+    bool Empty() const { return keys.empty(); }
+    const std::vector<SDFCameraKey>& Keys() const { return keys; }
+    float StartTime() const { return keys.empty() ? 0.0f : keys.front().time; }
+    float EndTime() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+    //Passes through every key exactly.
+    SDFCameraKey Sample(float time) const;
+    //Sample as a tool camera, z up like the scene.
+    SDFTraceCamera Camera(float time, float aspect, const glm::vec3& up = glm::vec3(0.0f, 0.0f, 1.0f)) const;
+
+private:
+    std::vector<SDFCameraKey> keys; //By time.
+};
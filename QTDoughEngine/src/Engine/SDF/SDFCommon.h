@@ -0,0 +1,188 @@
+#pragma once
+//Shared types for the CPU side SDF tooling. Kept free of Vulkan/SDL so it can run headless.
+//Same GLM configuration as QTDoughApplication.h so struct layouts agree across translation units.
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+struct SDFAABB
+{
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    SDFAABB() {}
+    SDFAABB(const glm::vec3& mn, const glm::vec3& mx) : min(mn), max(mx) {}
+
+    bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    void Expand(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+    void Expand(const SDFAABB& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+    glm::vec3 Center() const { return (min + max) * 0.5f; }
+    glm::vec3 Extent() const { return max - min; }
+
+    float SurfaceArea() const
+    {
+        glm::vec3 e = glm::max(max - min, glm::vec3(0.0f));
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    bool Overlaps(const SDFAABB& b) const
+    {
+        return min.x <= b.max.x && max.x >= b.min.x &&
+            min.y <= b.max.y && max.y >= b.min.y &&
+            min.z <= b.max.z && max.z >= b.min.z;
+    }
+
+    bool Contains(const SDFAABB& b) const
+    {
+        return min.x <= b.min.x && min.y <= b.min.y && min.z <= b.min.z &&
+            max.x >= b.max.x && max.y >= b.max.y && max.z >= b.max.z;
+    }
+
+    bool Contains(const glm::vec3& p) const
+    {
+        return p.x >= min.x && p.y >= min.y && p.z >= min.z &&
+            p.x <= max.x && p.y <= max.y && p.z <= max.z;
+    }
+
+    //Unsigned distance from p to the box, 0 inside.
+    float Distance(const glm::vec3& p) const
+    {
+        glm::vec3 d = glm::max(glm::max(min - p, p - max), glm::vec3(0.0f));
+        return glm::length(d);
+    }
+};
+
+//Transforms a box by an affine matrix and returns the axis aligned bounds of the result.
+inline SDFAABB TransformAABB(const SDFAABB& b, const glm::mat4& m)
+{
+    glm::vec3 center = glm::vec3(m * glm::vec4(b.Center(), 1.0f));
+    glm::vec3 half = b.Extent() * 0.5f;
+    glm::vec3 extent = glm::abs(glm::vec3(m[0])) * half.x + glm::abs(glm::vec3(m[1])) * half.y + glm::abs(glm::vec3(m[2])) * half.z;
+    return SDFAABB(center - extent, center + extent);
+}
+
+struct SDFRay
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, 1.0f);
+    float tMax = std::numeric_limits<float>::max();
+
+    SDFRay() {}
+    SDFRay(const glm::vec3& o, const glm::vec3& d, float maxT = std::numeric_limits<float>::max()) : origin(o), direction(d), tMax(maxT) {}
+};
+
+//Slab test. Writes the entry distance (0 when the origin is inside) and returns false on a miss or when entry > tMax.
+inline bool RayAABB(const SDFRay& ray, const glm::vec3& invDir, const SDFAABB& b, float& outT)
+{
+    glm::vec3 t0 = (b.min - ray.origin) * invDir;
+    glm::vec3 t1 = (b.max - ray.origin) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, ray.tMax));
+    outT = enter;
+    return enter <= exit;
+}
+
+//Six inward facing planes (xyz normal, w offset) pulled from a view projection matrix with 0..1 depth.
+struct SDFFrustum
+{
+    glm::vec4 planes[6];
+
+    static SDFFrustum FromMatrix(const glm::mat4& viewProj)
+    {
+        SDFFrustum f;
+        glm::vec4 r0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+        glm::vec4 r1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+        glm::vec4 r2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+        glm::vec4 r3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+        f.planes[0] = r3 + r0;
+        f.planes[1] = r3 - r0;
+        f.planes[2] = r3 + r1;
+        f.planes[3] = r3 - r1;
+        f.planes[4] = r2;
+        f.planes[5] = r3 - r2;
+        for (glm::vec4& p : f.planes)
+            p /= glm::length(glm::vec3(p));
+        return f;
+    }
+
+    //Conservative: a box straddling two planes outside the corner still counts as visible.
+    bool Intersects(const SDFAABB& b) const
+    {
+        for (const glm::vec4& p : planes)
+        {
+            glm::vec3 n(p);
+            glm::vec3 positive = glm::mix(b.min, b.max, glm::vec3(glm::greaterThanEqual(n, glm::vec3(0.0f))));
+            if (glm::dot(n, positive) + p.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
+
+//A regular voxel grid centred on the origin, laid out like the world SDF:
+//voxel i covers [i, i+1) * voxelSize - sceneSize/2 and is stored x fastest.
+struct SDFGridDesc
+{
+    glm::ivec3 resolution = glm::ivec3(1024, 1024, 256);
+    glm::vec3 sceneSize = glm::vec3(64.0f, 64.0f, 16.0f); //GetSceneSize() in ShaderHelpers.hlsl.
+
+    SDFGridDesc() {}
+    SDFGridDesc(const glm::ivec3& res, const glm::vec3& size) : resolution(res), sceneSize(size) {}
+
+    glm::vec3 VoxelSize() const { return sceneSize / glm::vec3(resolution); }
+    glm::vec3 Origin() const { return -sceneSize * 0.5f; }
+    size_t VoxelCount() const { return size_t(resolution.x) * size_t(resolution.y) * size_t(resolution.z); }
+
+    glm::vec3 VoxelCenter(const glm::ivec3& v) const
+    {
+        return (glm::vec3(v) + 0.5f) * VoxelSize() + Origin();
+    }
+
+    size_t Flatten(const glm::ivec3& v) const
+    {
+        return size_t(v.x) + size_t(v.y) * resolution.x + size_t(v.z) * size_t(resolution.x) * resolution.y;
+    }
+
+    //Continuous voxel coordinate, voxel centres land on i + 0.5.
+    glm::vec3 WorldToVoxel(const glm::vec3& p) const
+    {
+        return (p - Origin()) / VoxelSize();
+    }
+};
+
+//Brush opcodes as consumed by WriteToWorldSDF.
+enum class SDFBrushOp : uint32_t
+{
+    Union = 0,
+    Subtraction = 1
+};
+
+#define SDF_EMPTY_SPACE 2.0f //DEFUALT_EMPTY_SPACE in ShaderHelpers.hlsl.
+
+//CPU mirrors of the blend operators in ShaderHelpers.hlsl. Keep them bit for bit in sync.
+inline float SDFSmin(float a, float b, float k)
+{
+    k *= 16.0f / 3.0f;
+    float h = std::max(k - std::abs(a - b), 0.0f) / k;
+    return std::min(a, b) - h * h * h * (4.0f - h) * k * (1.0f / 16.0f);
+}
+
+inline float SDFOpSmoothUnion(float d1, float d2, float k)
+{
+    float h = glm::clamp(0.5f + 0.5f * (d2 - d1) / k, 0.0f, 1.0f);
+    return glm::mix(d2, d1, h) - k * h * (1.0f - h);
+}
+
+inline float SDFOpSmoothSubtraction(float d1, float d2, float k)
+{
+    float h = glm::clamp(0.5f - 0.5f * (d2 + d1) / k, 0.0f, 1.0f);
+    return glm::mix(d2, -d1, h) + k * h * (1.0f - h);
+}
@@ -0,0 +1,130 @@
+#include "SDFConeMarch.h"
+#include "../Core/UnigmaParallel.h"
+
+SDFTileCone SDFMakeTileCone(const SDFCameraRays& camera, int x0, int y0, int x1, int y1, int width, int height, const SDFGridDesc& grid)
+{
+    SDFTileCone cone;
+    cone.axis = camera.At(glm::vec2(float(x0 + x1), float(y0 + y1)) * 0.5f, width, height);
+
+    //Pixel origins are affine over the tile and the directions are normalized affine ones, so the corners bound both.
+    const glm::vec2 corners[4] = { glm::vec2(x0, y0), glm::vec2(x1, y0), glm::vec2(x0, y1), glm::vec2(x1, y1) };
+    for (const glm::vec2& corner : corners)
+    {
+        SDFRay ray = camera.At(corner, width, height);
+        cone.offset = std::max(cone.offset, glm::length(ray.origin - cone.axis.origin));
+        cone.spread = std::max(cone.spread, glm::length(ray.direction - cone.axis.direction));
+    }
+
+    //No pixel ray origin is further than offset from the axis origin, so past the farthest grid corner they are all out.
+    glm::vec3 lo = grid.Origin();
+    glm::vec3 hi = grid.Origin() + grid.sceneSize;
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner((i & 1) ? hi.x : lo.x, (i & 2) ? hi.y : lo.y, (i & 4) ? hi.z : lo.z);
+        cone.tFar = std::max(cone.tFar, glm::length(corner - cone.axis.origin));
+    }
+    cone.tFar += cone.offset;
+    return cone;
+}
+
+namespace
+{
+    //What SDFConeBound derives from the pyramid for one level, worked out once per march instead of every step.
+    struct ConeLevel
+    {
+        const SDFMipLevel* level = nullptr;
+        int mip = 0;
+        float slack = 0.0f;
+        glm::vec3 origin, voxelSize;
+        glm::ivec3 lastVoxel;
+
+        ConeLevel(const SDFMipPyramid& pyramid, int coneLevel)
+        {
+            const SDFGridDesc& grid = pyramid.grid;
+            mip = std::min(std::max(coneLevel - 1, 1), int(pyramid.levels.size()));
+            level = &pyramid.Level(mip);
+            float voxelDiagonal = glm::length(grid.VoxelSize());
+            slack = pyramid.reduce == SDFMipReduce::Min ? 0.5f * voxelDiagonal : float(1 << mip) * voxelDiagonal;
+            origin = grid.Origin();
+            voxelSize = grid.VoxelSize();
+            lastVoxel = grid.resolution - 1;
+        }
+
+        //The cell whose level 1 footprint holds p. A Min cell bounds the voxel centre next to p, an Average cell only
+        //bounds some centre of its footprint.
+        float Bound(const glm::vec3& p, const glm::vec3& sceneMax) const
+        {
+            glm::vec3 q = glm::clamp(p, origin, sceneMax);
+            glm::ivec3 v = glm::clamp(glm::ivec3(glm::floor((q - origin) / voxelSize)), glm::ivec3(0), lastVoxel);
+            glm::ivec3 cell(v.x >> mip, v.y >> mip, v.z >> mip);
+            float inside = level->Load(cell) - slack;
+
+            //Outside, q is the grid point nearest p, so for anything in the grid |p - g|^2 >= |p - q|^2 + |q - g|^2.
+            float outside = glm::length(p - q);
+            if (outside <= 0.0f)
+                return inside;
+            inside = std::max(inside, 0.0f);
+            return std::sqrt(outside * outside + inside * inside);
+        }
+    };
+}
+
+float SDFConeBound(const SDFMipPyramid& pyramid, int level, const glm::vec3& p)
+{
+    if (pyramid.levels.empty())
+        return 0.0f;
+    return ConeLevel(pyramid, level).Bound(p, pyramid.grid.Origin() + pyramid.grid.sceneSize);
+}
+
+float SDFMarchCone(const SDFMipPyramid& pyramid, const SDFTileCone& cone, int* outSteps)
+{
+    glm::vec3 voxelSize = pyramid.grid.VoxelSize();
+    float voxel = std::min(voxelSize.x, std::min(voxelSize.y, voxelSize.z));
+    float margin = voxel * SDF_CONE_MARGIN_VOXELS;
+
+    //The ball of the bound around axis(t) holds every pixel ray over [t, t + step] while
+    //offset + spread * t + (1 + spread) * step stays inside it.
+    float t = 0.0f;
+    int steps = 0;
+    if (!pyramid.levels.empty())
+    {
+        ConeLevel fine(pyramid, SDF_CONE_FINE_LEVEL), coarse(pyramid, SDF_CONE_COARSE_LEVEL);
+        glm::vec3 sceneMax = pyramid.grid.Origin() + pyramid.grid.sceneSize;
+        for (; steps < SDF_CONE_MAX_STEPS && t < cone.tFar; steps++)
+        {
+            glm::vec3 p = cone.axis.origin + cone.axis.direction * t;
+            float bound = std::max(fine.Bound(p, sceneMax), coarse.Bound(p, sceneMax));
+            float clearance = bound - (cone.offset + cone.spread * t) - margin;
+            if (clearance < voxel)
+                break;
+            t += clearance / (1.0f + cone.spread);
+        }
+    }
+
+    if (outSteps != nullptr)
+        *outSteps = steps;
+    return std::min(t, cone.tFar);
+}
+
+SDFConeStats SDFConeStartDepths(const SDFMipPyramid& pyramid, const SDFTraceCamera& camera, int width, int height, std::vector<float>& outStarts)
+{
+    int tilesX = (std::max(width, 0) + SDF_CONE_TILE - 1) / SDF_CONE_TILE;
+    int tilesY = (std::max(height, 0) + SDF_CONE_TILE - 1) / SDF_CONE_TILE;
+    outStarts.assign(size_t(tilesX) * tilesY, 0.0f);
+    std::vector<int> tileSteps(outStarts.size(), 0);
+    SDFCameraRays rays(camera);
+
+    UnigmaParallelFor(uint32_t(outStarts.size()), 16, [&](uint32_t tile) {
+        int x0 = int(tile % uint32_t(tilesX)) * SDF_CONE_TILE;
+        int y0 = int(tile / uint32_t(tilesX)) * SDF_CONE_TILE;
+        SDFTileCone cone = SDFMakeTileCone(rays, x0, y0, std::min(x0 + SDF_CONE_TILE, width), std::min(y0 + SDF_CONE_TILE, height),
+            width, height, pyramid.grid);
+        outStarts[tile] = SDFMarchCone(pyramid, cone, &tileSteps[tile]);
+    });
+
+    SDFConeStats stats;
+    stats.tiles = outStarts.size();
+    for (int s : tileSteps)
+        stats.steps += uint64_t(s);
+    return stats;
+}
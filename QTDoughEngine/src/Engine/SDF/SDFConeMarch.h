@@ -0,0 +1,47 @@
+#pragma once
+#include "SDFMipPyramid.h"
+#include "SDFSphereTracer.h"
+
+//Cone prepass for the sphere tracers, mirrored in shaders/Helpers/ConeMarch.hlsl. Keep both files in sync; this side
+//is the reference.
+//One cone per 8x8 pixel tile (a thread group of raymarchsdf_compute.hlsl) is marched over the coarse L3 and L4 levels.
+//The cone holds every pixel ray of the tile, and it only advances through space the coarse levels prove empty, so the
+//returned depth is a safe start for all of those rays: nothing closer than marginVoxels lies before it. Open scenes
+//then spend their full resolution steps near surfaces instead of crossing empty space one voxel at a time.
+//Levels follow the shader: L1 is the full resolution field, every level halves the one before. Bounds are taken per
+//cell as stored value minus the largest error the reduction allows, so Average chains (GenerateMIPS) work as well as
+//Min pyramids, only less tightly. Fields must be distances (gradient length <= 1), as the eikonal sweeps leave them.
+
+#define SDF_CONE_TILE 8
+#define SDF_CONE_FINE_LEVEL 3
+#define SDF_CONE_COARSE_LEVEL 4
+#define SDF_CONE_MAX_STEPS 64
+#define SDF_CONE_MARGIN_VOXELS 1.0f
+
+//The cone of one tile. Every pixel ray x(t) = o + d * t of the tile stays within offset + spread * t of axis(t).
+struct SDFTileCone
+{
+    SDFRay axis;
+    float offset = 0.0f; //Largest distance between pixel ray origins and the axis origin (orthographic spread).
+    float spread = 0.0f; //Largest |d - axis.direction| over the tile.
+    float tFar = 0.0f; //Past this every pixel ray is outside the grid.
+};
+
+struct SDFConeStats
+{
+    uint64_t tiles = 0;
+    uint64_t steps = 0;
+};
+
+//Cone through the pixel rectangle [x0, x1) x [y0, y1), from the rays at its corners.
+SDFTileCone SDFMakeTileCone(const SDFCameraRays& camera, int x0, int y0, int x1, int y1, int width, int height, const SDFGridDesc& grid);
+
+//Lower bound of the field at p from one level (SDF_CONE_FINE_LEVEL, ...) of pyramid, which was built from the traced
+//field. Outside the grid it combines the distance to the grid with the bound at the nearest grid point.
+float SDFConeBound(const SDFMipPyramid& pyramid, int level, const glm::vec3& p);
+
+//Safe start depth along the axis for every ray of cone. outSteps counts the cone steps taken.
+float SDFMarchCone(const SDFMipPyramid& pyramid, const SDFTileCone& cone, int* outSteps = nullptr);
+
+//Start depth of every SDF_CONE_TILE tile of a width x height image, row major. Tiles run in parallel.
+SDFConeStats SDFConeStartDepths(const SDFMipPyramid& pyramid, const SDFTraceCamera& camera, int width, int height, std::vector<float>& outStarts);
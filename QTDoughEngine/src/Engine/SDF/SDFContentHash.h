@@ -0,0 +1,78 @@
+#pragma once
+#include "SDFCommon.h"
+#include <cstring>
+
+//Identity of a cooked brush volume. Two brushes with equal keys cook to the same texels, so they can share one volume
+//and differ only by transform. Everything CreateBrush reads from the brush before applying the model matrix goes in:
+//primitive type, resolution, blend (it pads the cook bounds) and the local space vertex positions.
+//The hash is 64-bit FNV-1a over the raw bits, with -0.0 folded into 0.0. Equal hashes are a strong hint, not proof,
+//so callers compare the vertices before sharing.
+
+struct SDFBrushContentKey
+{
+    uint64_t hash = 0;
+    uint32_t type = 0;
+    uint32_t resolution = 0;
+    uint32_t vertexCount = 0;
+    uint32_t blendBits = 0;
+
+    bool operator==(const SDFBrushContentKey& other) const
+    {
+        return hash == other.hash && type == other.type && resolution == other.resolution &&
+            vertexCount == other.vertexCount && blendBits == other.blendBits;
+    }
+    bool operator!=(const SDFBrushContentKey& other) const { return !(*this == other); }
+};
+
+struct SDFBrushContentKeyHasher
+{
+    size_t operator()(const SDFBrushContentKey& key) const { return size_t(key.hash ^ (uint64_t(key.resolution) << 32)); }
+};
+
+inline uint64_t SDFHashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint32_t SDFFloatBits(float v)
+{
+    v += 0.0f; //-0.0 + 0.0 is +0.0.
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+inline SDFBrushContentKey SDFMakeBrushContentKey(uint32_t type, uint32_t resolution, float blend, const std::vector<glm::vec3>& positions)
+{
+    SDFBrushContentKey key;
+    key.type = type;
+    key.resolution = resolution;
+    key.vertexCount = (uint32_t)positions.size();
+    key.blendBits = SDFFloatBits(blend);
+
+    uint64_t hash = 14695981039346656037ull;
+    for (const glm::vec3& p : positions)
+    {
+        uint32_t bits[3] = { SDFFloatBits(p.x), SDFFloatBits(p.y), SDFFloatBits(p.z) };
+        hash = SDFHashBytes(bits, sizeof(bits), hash);
+    }
+    key.hash = hash;
+    return key;
+}
+
+//Exact check behind a hash match.
+inline bool SDFSamePositions(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (SDFFloatBits(a[i].x) != SDFFloatBits(b[i].x) || SDFFloatBits(a[i].y) != SDFFloatBits(b[i].y) || SDFFloatBits(a[i].z) != SDFFloatBits(b[i].z))
+            return false;
+    return true;
+}
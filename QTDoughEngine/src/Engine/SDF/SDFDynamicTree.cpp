@@ -0,0 +1,330 @@
+#include "SDFDynamicTree.h"
+#include "../Core/UnigmaParallel.h"
+
+namespace
+{
+    SDFAABB Union(const SDFAABB& a, const SDFAABB& b)
+    {
+        return SDFAABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+    }
+}
+
+int32_t SDFDynamicAABBTree::AllocateNode()
+{
+    if (freeList == NullNode)
+    {
+        nodes.push_back(Node{});
+        nodes.back().height = 0;
+        return (int32_t)nodes.size() - 1;
+    }
+
+    int32_t id = freeList;
+    freeList = nodes[id].parent;
+    nodes[id] = Node{};
+    nodes[id].height = 0;
+    return id;
+}
+
+void SDFDynamicAABBTree::FreeNode(int32_t id)
+{
+    nodes[id].parent = freeList;
+    nodes[id].height = -1;
+    freeList = id;
+}
+
+int32_t SDFDynamicAABBTree::CreateProxy(const SDFAABB& bounds, uint32_t userData)
+{
+    int32_t id = AllocateNode();
+    Node& node = nodes[id];
+    node.tight = bounds;
+    node.bounds = SDFAABB(bounds.min - fatMargin, bounds.max + fatMargin);
+    node.userData = userData;
+    InsertLeaf(id);
+    proxyCount++;
+    return id;
+}
+
+void SDFDynamicAABBTree::DestroyProxy(int32_t proxy)
+{
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    proxyCount--;
+}
+
+bool SDFDynamicAABBTree::MoveProxy(int32_t proxy, const SDFAABB& bounds, const glm::vec3& displacement)
+{
+    Node& node = nodes[proxy];
+    node.tight = bounds;
+    if (node.bounds.Contains(bounds))
+    {
+        //Still inside, but shrink a box that has become far too loose so queries stay tight.
+        glm::vec3 slack = node.bounds.Extent() - bounds.Extent();
+        glm::vec3 limit = 4.0f * (glm::vec3(2.0f * fatMargin) + glm::abs(displacement) * displacementMultiplier);
+        if (slack.x <= limit.x && slack.y <= limit.y && slack.z <= limit.z)
+            return false;
+    }
+
+    RemoveLeaf(proxy);
+
+    //Stretch along the motion so the next few frames of the same movement stay inside.
+    SDFAABB fat(bounds.min - fatMargin, bounds.max + fatMargin);
+    glm::vec3 d = displacement * displacementMultiplier;
+    fat.min += glm::min(d, glm::vec3(0.0f));
+    fat.max += glm::max(d, glm::vec3(0.0f));
+    nodes[proxy].bounds = fat;
+
+    InsertLeaf(proxy);
+    return true;
+}
+
+void SDFDynamicAABBTree::InsertLeaf(int32_t leaf)
+{
+    if (root == NullNode)
+    {
+        root = leaf;
+        nodes[root].parent = NullNode;
+        return;
+    }
+
+    //Walk down to the sibling that adds the least surface area.
+    SDFAABB leafBounds = nodes[leaf].bounds;
+    int32_t index = root;
+    while (!nodes[index].IsLeaf())
+    {
+        const Node& node = nodes[index];
+        float area = node.bounds.SurfaceArea();
+        float combinedArea = Union(node.bounds, leafBounds).SurfaceArea();
+
+        //Cost of making a new parent here, and the cost pushed down to the children.
+        float cost = 2.0f * combinedArea;
+        float inheritance = 2.0f * (combinedArea - area);
+
+        auto childCost = [&](int32_t child) {
+            const Node& c = nodes[child];
+            float grown = Union(leafBounds, c.bounds).SurfaceArea();
+            return c.IsLeaf() ? grown + inheritance : (grown - c.bounds.SurfaceArea()) + inheritance;
+        };
+        float cost1 = childCost(node.child1);
+        float cost2 = childCost(node.child2);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    int32_t sibling = index;
+    int32_t oldParent = nodes[sibling].parent;
+    int32_t newParent = AllocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].bounds = Union(leafBounds, nodes[sibling].bounds);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == NullNode)
+        root = newParent;
+    else if (nodes[oldParent].child1 == sibling)
+        nodes[oldParent].child1 = newParent;
+    else
+        nodes[oldParent].child2 = newParent;
+
+    RefitUpwards(nodes[leaf].parent);
+}
+
+void SDFDynamicAABBTree::RemoveLeaf(int32_t leaf)
+{
+    if (leaf == root)
+    {
+        root = NullNode;
+        return;
+    }
+
+    int32_t parent = nodes[leaf].parent;
+    int32_t grandParent = nodes[parent].parent;
+    int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent == NullNode)
+    {
+        root = sibling;
+        nodes[sibling].parent = NullNode;
+        FreeNode(parent);
+        return;
+    }
+
+    if (nodes[grandParent].child1 == parent)
+        nodes[grandParent].child1 = sibling;
+    else
+        nodes[grandParent].child2 = sibling;
+    nodes[sibling].parent = grandParent;
+    FreeNode(parent);
+
+    RefitUpwards(grandParent);
+}
+
+void SDFDynamicAABBTree::RefitUpwards(int32_t id)
+{
+    while (id != NullNode)
+    {
+        id = Balance(id);
+        Node& node = nodes[id];
+        node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+        node.bounds = Union(nodes[node.child1].bounds, nodes[node.child2].bounds);
+        id = node.parent;
+    }
+}
+
+//Rotates a up when one subtree is more than one level taller than the other. Returns the new subtree root.
+int32_t SDFDynamicAABBTree::Balance(int32_t iA)
+{
+    Node& A = nodes[iA];
+    if (A.IsLeaf() || A.height < 2)
+        return iA;
+
+    int32_t iB = A.child1;
+    int32_t iC = A.child2;
+    int32_t balance = nodes[iC].height - nodes[iB].height;
+
+    //Rotate C up, or B up in the mirrored case. Both share the same shape.
+    auto rotate = [&](int32_t iUp, int32_t iOther, bool upIsChild2) {
+        Node& up = nodes[iUp];
+        int32_t iF = up.child1;
+        int32_t iG = up.child2;
+
+        up.child1 = iA;
+        up.parent = A.parent;
+        A.parent = iUp;
+
+        if (up.parent == NullNode)
+            root = iUp;
+        else if (nodes[up.parent].child1 == iA)
+            nodes[up.parent].child1 = iUp;
+        else
+            nodes[up.parent].child2 = iUp;
+
+        //Keep the taller grandchild under up, hand the other one to A.
+        int32_t iKeep = nodes[iF].height > nodes[iG].height ? iF : iG;
+        int32_t iGive = iKeep == iF ? iG : iF;
+        up.child2 = iKeep;
+        if (upIsChild2)
+            A.child2 = iGive;
+        else
+            A.child1 = iGive;
+        nodes[iGive].parent = iA;
+
+        A.bounds = Union(nodes[iOther].bounds, nodes[iGive].bounds);
+        A.height = 1 + std::max(nodes[iOther].height, nodes[iGive].height);
+        up.bounds = Union(A.bounds, nodes[iKeep].bounds);
+        up.height = 1 + std::max(A.height, nodes[iKeep].height);
+        return iUp;
+    };
+
+    if (balance > 1)
+        return rotate(iC, iB, true);
+    if (balance < -1)
+        return rotate(iB, iC, false);
+    return iA;
+}
+
+float SDFDynamicAABBTree::GetAreaRatio() const
+{
+    if (root == NullNode)
+        return 0.0f;
+
+    float rootArea = nodes[root].bounds.SurfaceArea();
+    float total = 0.0f;
+    for (const Node& node : nodes)
+        if (node.height >= 0)
+            total += node.bounds.SurfaceArea();
+    return rootArea > 0.0f ? total / rootArea : 0.0f;
+}
+
+bool SDFDynamicAABBTree::ValidateNode(int32_t id, int32_t parent) const
+{
+    const Node& node = nodes[id];
+    if (node.parent != parent)
+        return false;
+    if (node.IsLeaf())
+        return node.height == 0 && node.child2 == NullNode && node.bounds.Contains(node.tight);
+
+    const Node& c1 = nodes[node.child1];
+    const Node& c2 = nodes[node.child2];
+    if (node.height != 1 + std::max(c1.height, c2.height) || std::abs(c1.height - c2.height) > 1)
+        return false;
+    if (!node.bounds.Contains(c1.bounds) || !node.bounds.Contains(c2.bounds))
+        return false;
+    return ValidateNode(node.child1, id) && ValidateNode(node.child2, id);
+}
+
+bool SDFDynamicAABBTree::Validate() const
+{
+    if (root == NullNode)
+        return proxyCount == 0;
+
+    uint32_t leaves = 0;
+    for (const Node& node : nodes)
+        if (node.height == 0)
+            leaves++;
+    return leaves == proxyCount && ValidateNode(root, NullNode);
+}
+
+void SDFDynamicAABBTree::QueryBatch(const std::vector<SDFAABB>& boxes, SDFQueryResults& out) const
+{
+    uint32_t count = (uint32_t)boxes.size();
+    std::vector<std::vector<uint32_t>> hits(count);
+    UnigmaParallelFor(count, 16, [&](uint32_t q) {
+        Query(boxes[q], [&](int32_t proxy) { hits[q].push_back(nodes[proxy].userData); return true; });
+        std::sort(hits[q].begin(), hits[q].end());
+    });
+
+    out.offsets.resize(count);
+    out.counts.resize(count);
+    out.userData.clear();
+    for (uint32_t q = 0; q < count; q++)
+    {
+        out.offsets[q] = (uint32_t)out.userData.size();
+        out.counts[q] = (uint32_t)hits[q].size();
+        out.userData.insert(out.userData.end(), hits[q].begin(), hits[q].end());
+    }
+}
+
+void SDFDynamicAABBTree::QueryFrustumBatch(const std::vector<SDFFrustum>& frustums, SDFQueryResults& out) const
+{
+    uint32_t count = (uint32_t)frustums.size();
+    std::vector<std::vector<uint32_t>> hits(count);
+    UnigmaParallelFor(count, 1, [&](uint32_t q) {
+        QueryFrustum(frustums[q], [&](int32_t proxy) { hits[q].push_back(nodes[proxy].userData); return true; });
+        std::sort(hits[q].begin(), hits[q].end());
+    });
+
+    out.offsets.resize(count);
+    out.counts.resize(count);
+    out.userData.clear();
+    for (uint32_t q = 0; q < count; q++)
+    {
+        out.offsets[q] = (uint32_t)out.userData.size();
+        out.counts[q] = (uint32_t)hits[q].size();
+        out.userData.insert(out.userData.end(), hits[q].begin(), hits[q].end());
+    }
+}
+
+void SDFDynamicAABBTree::RayCastBatch(const std::vector<SDFRay>& rays, std::vector<SDFRayHit>& out) const
+{
+    out.assign(rays.size(), SDFRayHit{});
+    UnigmaParallelFor((uint32_t)rays.size(), 64, [&](uint32_t r) {
+        SDFRayHit& hit = out[r];
+        glm::vec3 invDir = 1.0f / rays[r].direction;
+        RayCast(rays[r], [&](int32_t proxy, const SDFRay& ray) {
+            float t;
+            if (RayAABB(ray, invDir, nodes[proxy].tight, t) && t < hit.t)
+            {
+                hit.t = t;
+                hit.proxy = proxy;
+                hit.userData = nodes[proxy].userData;
+                return t;
+            }
+            return ray.tMax;
+        });
+    });
+}
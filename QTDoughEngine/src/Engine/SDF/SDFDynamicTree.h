@@ -0,0 +1,165 @@
+#pragma once
+#include "SDFCommon.h"
+
+//Incremental AABB tree for moving things (brushes). Leaves store a fattened box so small moves don't touch the tree;
+//only leaving the fat box reinserts the leaf. Inserts pick the cheapest sibling by surface area and every ancestor
+//is rebalanced with AVL style rotations, so the height stays logarithmic under any insertion order.
+
+struct SDFQueryResults
+{
+    //Hits of query q are userData[offsets[q] .. offsets[q] + counts[q]).
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> userData;
+};
+
+struct SDFRayHit
+{
+    int32_t proxy = -1;
+    uint32_t userData = 0;
+    float t = std::numeric_limits<float>::max();
+};
+
+class SDFDynamicAABBTree
+{
+public:
+    static const int32_t NullNode = -1;
+
+    float fatMargin = 0.1f; //Added on every side of a leaf box.
+    float displacementMultiplier = 2.0f; //Leaves are stretched along their last displacement by this much.
+
+    //Returns the proxy id, stable until DestroyProxy.
+    int32_t CreateProxy(const SDFAABB& bounds, uint32_t userData);
+    void DestroyProxy(int32_t proxy);
+    //Updates the tight box. Returns true when the leaf left its fat box and was reinserted.
+    bool MoveProxy(int32_t proxy, const SDFAABB& bounds, const glm::vec3& displacement = glm::vec3(0.0f));
+
+    const SDFAABB& GetFatAABB(int32_t proxy) const { return nodes[proxy].bounds; }
+    const SDFAABB& GetTightAABB(int32_t proxy) const { return nodes[proxy].tight; }
+    uint32_t GetUserData(int32_t proxy) const { return nodes[proxy].userData; }
+    uint32_t GetProxyCount() const { return proxyCount; }
+    int32_t GetRoot() const { return root; }
+    int GetHeight() const { return root == NullNode ? 0 : nodes[root].height; }
+    //Sum of node areas over the root area, a quick quality number.
+    float GetAreaRatio() const;
+    //Checks parent links, heights and bounds. Meant for tests.
+    bool Validate() const;
+
+    //callback(proxy) returns false to stop. Leaves are tested against their tight box.
+    template<typename Callback>
+    void Query(const SDFAABB& bounds, Callback&& callback) const
+    {
+        Traverse([&](const SDFAABB& b) { return b.Overlaps(bounds); }, callback);
+    }
+
+    template<typename Callback>
+    void QueryFrustum(const SDFFrustum& frustum, Callback&& callback) const
+    {
+        Traverse([&](const SDFAABB& b) { return frustum.Intersects(b); }, callback);
+    }
+
+    //callback(proxy, ray) returns the new clip distance: ray.tMax to keep going, a smaller t to clip, 0 to stop.
+    //Leaves are visited roughly front to back.
+    template<typename Callback>
+    void RayCast(const SDFRay& inRay, Callback&& callback) const
+    {
+        if (root == NullNode)
+            return;
+
+        SDFRay ray = inRay;
+        glm::vec3 invDir = 1.0f / ray.direction;
+        int32_t stack[128];
+        int top = 0;
+        stack[top++] = root;
+        while (top > 0)
+        {
+            int32_t id = stack[--top];
+            const Node& node = nodes[id];
+            float t;
+            if (!RayAABB(ray, invDir, node.IsLeaf() ? node.tight : node.bounds, t))
+                continue;
+
+            if (node.IsLeaf())
+            {
+                float clip = callback(id, ray);
+                if (clip == 0.0f)
+                    return;
+                ray.tMax = std::min(ray.tMax, clip);
+                continue;
+            }
+
+            //Push the far child first so the near one pops next.
+            float t1, t2;
+            bool hit1 = RayAABB(ray, invDir, nodes[node.child1].bounds, t1);
+            bool hit2 = RayAABB(ray, invDir, nodes[node.child2].bounds, t2);
+            if (hit1 && hit2)
+            {
+                if (t1 < t2) { stack[top++] = node.child2; stack[top++] = node.child1; }
+                else { stack[top++] = node.child1; stack[top++] = node.child2; }
+            }
+            else if (hit1)
+                stack[top++] = node.child1;
+            else if (hit2)
+                stack[top++] = node.child2;
+        }
+    }
+
+    //Batched queries, spread over all cores. Results hold userData and are sorted per query.
+    void QueryBatch(const std::vector<SDFAABB>& boxes, SDFQueryResults& out) const;
+    void QueryFrustumBatch(const std::vector<SDFFrustum>& frustums, SDFQueryResults& out) const;
+    //Nearest leaf (tight box entry distance) per ray.
+    void RayCastBatch(const std::vector<SDFRay>& rays, std::vector<SDFRayHit>& out) const;
+
+private:
+    struct Node
+    {
+        SDFAABB bounds; //Fat for leaves, union of children otherwise.
+        SDFAABB tight;
+        int32_t parent = NullNode; //Next free node while on the free list.
+        int32_t child1 = NullNode;
+        int32_t child2 = NullNode;
+        int32_t height = -1; //0 for leaves, -1 when free.
+        uint32_t userData = 0;
+
+        bool IsLeaf() const { return child1 == NullNode; }
+    };
+
+    std::vector<Node> nodes;
+    int32_t root = NullNode;
+    int32_t freeList = NullNode;
+    uint32_t proxyCount = 0;
+
+    int32_t AllocateNode();
+    void FreeNode(int32_t id);
+    void InsertLeaf(int32_t leaf);
+    void RemoveLeaf(int32_t leaf);
+    int32_t Balance(int32_t a);
+    void RefitUpwards(int32_t id);
+    bool ValidateNode(int32_t id, int32_t parent) const;
+
+    template<typename Test, typename Callback>
+    void Traverse(Test&& test, Callback&& callback) const
+    {
+        if (root == NullNode)
+            return;
+
+        int32_t stack[128];
+        int top = 0;
+        stack[top++] = root;
+        while (top > 0)
+        {
+            const int32_t id = stack[--top];
+            const Node& node = nodes[id];
+            if (node.IsLeaf())
+            {
+                if (test(node.tight) && !callback(id))
+                    return;
+                continue;
+            }
+            if (!test(node.bounds))
+                continue;
+            stack[top++] = node.child1;
+            stack[top++] = node.child2;
+        }
+    }
+};
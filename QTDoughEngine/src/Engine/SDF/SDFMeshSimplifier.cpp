@@ -0,0 +1,570 @@
+#include "SDFMeshSimplifier.h"
+#include "../Core/UnigmaParallel.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace
+{
+    //Symmetric 4x4 plane quadric stored as its 10 unique terms. Doubles keep large flat areas stable.
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0 = 0, b1 = 0, b2 = 0;
+        double c = 0;
+        double w = 0; //Total weight, used to turn the error back into a squared distance.
+
+        void AddPlane(const glm::vec3& n, float d, double weight)
+        {
+            a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z;
+            a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a22 += weight * n.z * n.z;
+            b0 += weight * n.x * d; b1 += weight * n.y * d; b2 += weight * n.z * d;
+            c += weight * d * d;
+            w += weight;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c; w += q.w;
+        }
+
+        //Mean squared distance of p to the accumulated planes.
+        double Evaluate(const glm::vec3& p) const
+        {
+            if (w <= 0.0)
+                return 0.0;
+            double x = p.x, y = p.y, z = p.z;
+            double r = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + a11 * y * y + 2.0 * a12 * y * z + a22 * z * z
+                + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return r < 0.0 ? 0.0 : r / w;
+        }
+    };
+
+    enum VertexKind : uint8_t
+    {
+        KindInterior = 0,
+        KindBorder = 1,
+        KindLocked = 2
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float cost;
+    };
+
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        if (a > b) std::swap(a, b);
+        return (uint64_t(a) << 32) | b;
+    }
+
+    bool OnAABBFace(const glm::vec3& p, const SDFAABB& box, float eps)
+    {
+        for (int i = 0; i < 3; i++)
+            if (std::abs(p[i] - box.min[i]) <= eps || std::abs(p[i] - box.max[i]) <= eps)
+                return true;
+        return false;
+    }
+
+    bool Contains(const glm::uvec3& tri, uint32_t v)
+    {
+        return tri.x == v || tri.y == v || tri.z == v;
+    }
+
+    //Progressive collapse state. Triangles are rewritten in place as vertices collapse.
+    class QuadricSimplifier
+    {
+    public:
+        //maxThreads is handed to the candidate pass, 1 when the caller already runs simplifiers in parallel.
+        QuadricSimplifier(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& sourceTriangles, const MeshSimplifySettings& settings,
+            uint32_t maxThreads = 0)
+            : positions(positions), settings(settings), maxThreads(maxThreads), tris(sourceTriangles)
+        {
+            uint32_t vertexCount = (uint32_t)positions.size();
+            quadrics.resize(vertexCount);
+            planeSets.resize(vertexCount);
+            kinds.assign(vertexCount, KindInterior);
+            alive.assign(tris.size(), 0);
+
+            //Edge use count finds open (border) edges.
+            std::unordered_map<uint64_t, uint32_t> edgeUse;
+            edgeUse.reserve(tris.size() * 3);
+            for (size_t t = 0; t < tris.size(); t++)
+            {
+                const glm::uvec3& tri = tris[t];
+                if (tri.x == tri.y || tri.y == tri.z || tri.z == tri.x)
+                    continue;
+                alive[t] = 1;
+                liveTriangles++;
+                edgeUse[EdgeKey(tri.x, tri.y)]++;
+                edgeUse[EdgeKey(tri.y, tri.z)]++;
+                edgeUse[EdgeKey(tri.z, tri.x)]++;
+
+                glm::vec3 p0 = positions[tri.x], p1 = positions[tri.y], p2 = positions[tri.z];
+                glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                float area2 = glm::length(n);
+                if (area2 <= 0.0f)
+                    continue;
+                n /= area2;
+                Quadric q;
+                q.AddPlane(n, -glm::dot(n, p0), area2 * 0.5);
+                quadrics[tri.x].Add(q);
+                quadrics[tri.y].Add(q);
+                quadrics[tri.z].Add(q);
+                AddPlane(glm::vec4(n, -glm::dot(n, p0)), { tri.x, tri.y, tri.z });
+            }
+
+            for (size_t t = 0; t < tris.size(); t++)
+            {
+                if (!alive[t])
+                    continue;
+                uint32_t idx[3] = { tris[t].x, tris[t].y, tris[t].z };
+                for (int e = 0; e < 3; e++)
+                {
+                    uint32_t a = idx[e], b = idx[(e + 1) % 3];
+                    if (edgeUse[EdgeKey(a, b)] != 1)
+                        continue;
+                    borderEdges.insert(EdgeKey(a, b));
+                    kinds[a] = KindBorder;
+                    kinds[b] = KindBorder;
+
+                    if (!settings.lockBorder)
+                    {
+                        //Plane through the border edge, perpendicular to the face, keeps the outline in place.
+                        uint32_t c = idx[(e + 2) % 3];
+                        glm::vec3 edgeDir = positions[b] - positions[a];
+                        glm::vec3 faceN = glm::cross(edgeDir, positions[c] - positions[a]);
+                        glm::vec3 n = glm::cross(edgeDir, faceN);
+                        float len = glm::length(n);
+                        if (len > 0.0f)
+                        {
+                            n /= len;
+                            Quadric q;
+                            q.AddPlane(n, -glm::dot(n, positions[a]), glm::dot(edgeDir, edgeDir));
+                            quadrics[a].Add(q);
+                            quadrics[b].Add(q);
+                            AddPlane(glm::vec4(n, -glm::dot(n, positions[a])), { a, b });
+                        }
+                    }
+                }
+            }
+
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                if (kinds[v] == KindBorder && settings.lockBorder)
+                    kinds[v] = KindLocked;
+                if (settings.lockBounds && OnAABBFace(positions[v], settings.lockAABB, settings.lockEpsilon))
+                    kinds[v] = KindLocked;
+            }
+        }
+
+        uint32_t LiveTriangleCount() const { return liveTriangles; }
+        float CurrentError() const { return maxDeviation; }
+
+        //Runs collapse passes until the live count reaches target or nothing else can go.
+        void Run(uint32_t targetTriangles)
+        {
+            //The quadric cost is a weighted mean of squared plane distances, so it never exceeds the squared deviation
+            //and can prune candidates early; PlaneDeviation makes the real call.
+            double maxAllowed = (double)settings.maxError * (double)settings.maxError;
+            while (liveTriangles > targetTriangles)
+            {
+                BuildAdjacency();
+                std::vector<Collapse> candidates = GatherCandidates(maxAllowed);
+                if (candidates.empty())
+                    break;
+
+                //Each vertex takes part in at most one collapse per pass so costs stay valid.
+                std::vector<uint8_t> touched(positions.size(), 0);
+                uint32_t collapsed = 0;
+                for (const Collapse& c : candidates)
+                {
+                    if (liveTriangles <= targetTriangles)
+                        break;
+                    if (touched[c.from] || touched[c.to])
+                        continue;
+                    if (!CanCollapse(c.from, c.to))
+                        continue;
+                    float deviation = PlaneDeviation(c.from, c.to);
+                    if (deviation > settings.maxError)
+                        continue;
+
+                    ApplyCollapse(c.from, c.to);
+                    touched[c.from] = 1;
+                    touched[c.to] = 1;
+                    maxDeviation = std::max(maxDeviation, deviation);
+                    collapsed++;
+                }
+
+                if (collapsed == 0)
+                    break;
+            }
+        }
+
+        std::vector<glm::uvec3> CurrentTriangles() const
+        {
+            std::vector<glm::uvec3> out;
+            out.reserve(liveTriangles);
+            for (size_t t = 0; t < tris.size(); t++)
+                if (alive[t])
+                    out.push_back(tris[t]);
+            return out;
+        }
+
+    private:
+        const std::vector<glm::vec3>& positions;
+        const MeshSimplifySettings& settings;
+        uint32_t maxThreads;
+
+        std::vector<glm::uvec3> tris;
+        std::vector<uint8_t> alive;
+        std::vector<Quadric> quadrics;
+        //Source planes (faces and border constraints) each vertex has absorbed, sorted indices into planes.
+        std::vector<glm::vec4> planes;
+        std::vector<std::vector<uint32_t>> planeSets;
+        std::vector<uint8_t> kinds;
+        std::unordered_set<uint64_t> borderEdges;
+        uint32_t liveTriangles = 0;
+        float maxDeviation = 0.0f;
+
+        //Vertex -> live triangle adjacency in CSR form, rebuilt every pass.
+        std::vector<uint32_t> adjOffsets;
+        std::vector<uint32_t> adjTriangles;
+
+        void AddPlane(const glm::vec4& plane, std::initializer_list<uint32_t> vertices)
+        {
+            uint32_t index = (uint32_t)planes.size();
+            planes.push_back(plane);
+            for (uint32_t v : vertices)
+                planeSets[v].push_back(index);
+        }
+
+        //Largest distance of the collapse target to any source plane either vertex absorbed. Every source face the
+        //merged vertex stands for lies on one of those planes, so unlike the quadric mean this bounds how far the
+        //surface around it moved off the source.
+        float PlaneDeviation(uint32_t from, uint32_t to) const
+        {
+            glm::vec4 p(positions[to], 1.0f);
+            float deviation = 0.0f;
+            for (uint32_t v : { from, to })
+                for (uint32_t plane : planeSets[v])
+                    deviation = std::max(deviation, std::abs(glm::dot(planes[plane], p)));
+            return deviation;
+        }
+
+        void BuildAdjacency()
+        {
+            uint32_t vertexCount = (uint32_t)positions.size();
+            adjOffsets.assign(vertexCount + 1, 0);
+            for (size_t t = 0; t < tris.size(); t++)
+            {
+                if (!alive[t])
+                    continue;
+                adjOffsets[tris[t].x + 1]++;
+                adjOffsets[tris[t].y + 1]++;
+                adjOffsets[tris[t].z + 1]++;
+            }
+            for (uint32_t v = 0; v < vertexCount; v++)
+                adjOffsets[v + 1] += adjOffsets[v];
+
+            adjTriangles.resize(adjOffsets[vertexCount]);
+            std::vector<uint32_t> cursor(adjOffsets.begin(), adjOffsets.end() - 1);
+            for (uint32_t t = 0; t < (uint32_t)tris.size(); t++)
+            {
+                if (!alive[t])
+                    continue;
+                adjTriangles[cursor[tris[t].x]++] = t;
+                adjTriangles[cursor[tris[t].y]++] = t;
+                adjTriangles[cursor[tris[t].z]++] = t;
+            }
+        }
+
+        bool CanMove(uint32_t from, uint32_t to) const
+        {
+            if (kinds[from] == KindLocked)
+                return false;
+            //Border vertices may only slide along the border.
+            if (kinds[from] == KindBorder)
+                return kinds[to] != KindInterior && borderEdges.count(EdgeKey(from, to)) != 0;
+            return true;
+        }
+
+        std::vector<Collapse> GatherCandidates(double maxAllowed)
+        {
+            std::vector<uint64_t> edges;
+            edges.reserve(liveTriangles * 3);
+            for (size_t t = 0; t < tris.size(); t++)
+            {
+                if (!alive[t])
+                    continue;
+                edges.push_back(EdgeKey(tris[t].x, tris[t].y));
+                edges.push_back(EdgeKey(tris[t].y, tris[t].z));
+                edges.push_back(EdgeKey(tris[t].z, tris[t].x));
+            }
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+            std::vector<Collapse> costs(edges.size());
+            UnigmaParallelFor((uint32_t)edges.size(), 4096, [&](uint32_t i) {
+                uint32_t a = uint32_t(edges[i] >> 32);
+                uint32_t b = uint32_t(edges[i] & 0xFFFFFFFFu);
+                Quadric q = quadrics[a];
+                q.Add(quadrics[b]);
+
+                Collapse best{ a, b, std::numeric_limits<float>::max() };
+                if (CanMove(a, b))
+                    best.cost = (float)q.Evaluate(positions[b]);
+                if (CanMove(b, a))
+                {
+                    float cost = (float)q.Evaluate(positions[a]);
+                    if (cost < best.cost)
+                        best = Collapse{ b, a, cost };
+                }
+                costs[i] = best;
+            }, maxThreads);
+
+            std::vector<Collapse> candidates;
+            candidates.reserve(costs.size());
+            for (const Collapse& c : costs)
+                if (c.cost != std::numeric_limits<float>::max() && c.cost <= maxAllowed)
+                    candidates.push_back(c);
+
+            std::sort(candidates.begin(), candidates.end(), [](const Collapse& l, const Collapse& r) {
+                return l.cost < r.cost;
+            });
+            return candidates;
+        }
+
+        void GatherNeighbours(uint32_t v, std::vector<uint32_t>& out) const
+        {
+            out.clear();
+            for (uint32_t i = adjOffsets[v]; i < adjOffsets[v + 1]; i++)
+            {
+                uint32_t t = adjTriangles[i];
+                if (!alive[t])
+                    continue;
+                const glm::uvec3& tri = tris[t];
+                if (tri.x != v) out.push_back(tri.x);
+                if (tri.y != v) out.push_back(tri.y);
+                if (tri.z != v) out.push_back(tri.z);
+            }
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        }
+
+        bool CanCollapse(uint32_t from, uint32_t to) const
+        {
+            //Link condition: the only shared neighbours may be the apexes of the triangles on the edge,
+            //otherwise the collapse pinches the surface into a non-manifold fan.
+            std::vector<uint32_t> nFrom, nTo;
+            GatherNeighbours(from, nFrom);
+            GatherNeighbours(to, nTo);
+            uint32_t shared = 0;
+            for (size_t i = 0, j = 0; i < nFrom.size() && j < nTo.size();)
+            {
+                if (nFrom[i] < nTo[j]) i++;
+                else if (nFrom[i] > nTo[j]) j++;
+                else { shared++; i++; j++; }
+            }
+
+            uint32_t edgeTriangles = 0;
+            for (uint32_t i = adjOffsets[from]; i < adjOffsets[from + 1]; i++)
+            {
+                uint32_t t = adjTriangles[i];
+                if (alive[t] && Contains(tris[t], to))
+                    edgeTriangles++;
+            }
+            if (edgeTriangles == 0 || shared != edgeTriangles)
+                return false;
+
+            //Reject flips and slivers in the surviving triangles around `from`.
+            glm::vec3 target = positions[to];
+            for (uint32_t i = adjOffsets[from]; i < adjOffsets[from + 1]; i++)
+            {
+                uint32_t t = adjTriangles[i];
+                if (!alive[t] || Contains(tris[t], to))
+                    continue;
+
+                const glm::uvec3& tri = tris[t];
+                glm::vec3 p[3] = { positions[tri.x], positions[tri.y], positions[tri.z] };
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int k = 0; k < 3; k++)
+                    if (tri[k] == from)
+                        p[k] = target;
+                glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+                float lb = glm::length(before), la = glm::length(after);
+                if (la <= 1e-12f || lb <= 1e-12f)
+                    return false;
+                if (glm::dot(before, after) < settings.minNormalDot * lb * la)
+                    return false;
+            }
+            return true;
+        }
+
+        void ApplyCollapse(uint32_t from, uint32_t to)
+        {
+            for (uint32_t i = adjOffsets[from]; i < adjOffsets[from + 1]; i++)
+            {
+                uint32_t t = adjTriangles[i];
+                if (!alive[t])
+                    continue;
+                glm::uvec3& tri = tris[t];
+                if (Contains(tri, to))
+                {
+                    alive[t] = 0;
+                    liveTriangles--;
+                    continue;
+                }
+                for (int k = 0; k < 3; k++)
+                    if (tri[k] == from)
+                        tri[k] = to;
+            }
+            quadrics[to].Add(quadrics[from]);
+
+            std::vector<uint32_t> merged;
+            merged.reserve(planeSets[from].size() + planeSets[to].size());
+            std::set_union(planeSets[from].begin(), planeSets[from].end(), planeSets[to].begin(), planeSets[to].end(), std::back_inserter(merged));
+            planeSets[to].swap(merged);
+            std::vector<uint32_t>().swap(planeSets[from]);
+        }
+    };
+}
+
+void WeldTriangleSoup(const glm::vec4* soup, uint32_t vertexCount, float weldDistance,
+    std::vector<glm::vec3>& outPositions, std::vector<glm::uvec3>& outTriangles)
+{
+    outPositions.clear();
+    outTriangles.clear();
+    if (soup == nullptr || vertexCount < 3)
+        return;
+
+    //Quantize to the weld grid. The dual contouring pass emits bit-identical shared vertices,
+    //so the grid only needs to catch float noise.
+    float inv = weldDistance > 0.0f ? 1.0f / weldDistance : 1e6f;
+    struct KeyHash
+    {
+        size_t operator()(const glm::ivec3& k) const
+        {
+            return (size_t(uint32_t(k.x)) * 73856093u) ^ (size_t(uint32_t(k.y)) * 19349663u) ^ (size_t(uint32_t(k.z)) * 83492791u);
+        }
+    };
+    std::unordered_map<glm::ivec3, uint32_t, KeyHash> lookup;
+    lookup.reserve(vertexCount);
+
+    auto vertexIndex = [&](const glm::vec4& p) {
+        glm::ivec3 key = glm::ivec3(glm::floor(glm::vec3(p) * inv + 0.5f));
+        auto it = lookup.find(key);
+        if (it != lookup.end())
+            return it->second;
+        uint32_t idx = (uint32_t)outPositions.size();
+        outPositions.push_back(glm::vec3(p));
+        lookup.emplace(key, idx);
+        return idx;
+    };
+
+    outTriangles.reserve(vertexCount / 3);
+    for (uint32_t v = 0; v + 2 < vertexCount; v += 3)
+    {
+        glm::uvec3 tri(vertexIndex(soup[v]), vertexIndex(soup[v + 1]), vertexIndex(soup[v + 2]));
+        if (tri.x == tri.y || tri.y == tri.z || tri.z == tri.x)
+            continue;
+        outTriangles.push_back(tri);
+    }
+}
+
+std::vector<glm::uvec3> SimplifyMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles,
+    uint32_t targetTriangleCount, const MeshSimplifySettings& settings, float* outError)
+{
+    QuadricSimplifier simplifier(positions, triangles, settings);
+    simplifier.Run(targetTriangleCount);
+    if (outError)
+        *outError = simplifier.CurrentError();
+    return simplifier.CurrentTriangles();
+}
+
+namespace
+{
+    MeshLODChain BuildChain(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles,
+        const MeshSimplifySettings& settings, uint32_t maxThreads)
+    {
+        MeshLODChain chain;
+        chain.positions = positions;
+        for (const glm::vec3& p : positions)
+            chain.bounds.Expand(p);
+
+        QuadricSimplifier simplifier(positions, triangles, settings, maxThreads);
+        uint32_t sourceCount = simplifier.LiveTriangleCount();
+
+        MeshLOD lod0;
+        lod0.triangles = simplifier.CurrentTriangles();
+        chain.lods.push_back(std::move(lod0));
+        if (sourceCount == 0)
+            return chain;
+
+        //One progressive run; each LOD is a snapshot, so errors are monotonic along the chain.
+        for (float ratio : settings.lodRatios)
+        {
+            uint32_t target = (uint32_t)std::floor((float)sourceCount * ratio);
+            uint32_t before = simplifier.LiveTriangleCount();
+            simplifier.Run(target);
+            if (simplifier.LiveTriangleCount() >= before)
+                break; //Everything left is locked or over the error limit.
+
+            MeshLOD lod;
+            lod.triangles = simplifier.CurrentTriangles();
+            lod.error = simplifier.CurrentError();
+            lod.ratio = (float)lod.triangles.size() / (float)sourceCount;
+            chain.lods.push_back(std::move(lod));
+        }
+        return chain;
+    }
+}
+
+MeshLODChain BuildMeshLODChain(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles,
+    const MeshSimplifySettings& settings)
+{
+    return BuildChain(positions, triangles, settings, 0);
+}
+
+void BuildMeshLODChains(const std::vector<std::vector<glm::vec3>>& positions, const std::vector<std::vector<glm::uvec3>>& triangles,
+    const std::vector<MeshSimplifySettings>& settings, std::vector<MeshLODChain>& outChains)
+{
+    uint32_t count = (uint32_t)std::min(positions.size(), triangles.size());
+    outChains.clear();
+    outChains.resize(count);
+    MeshSimplifySettings defaults;
+    //Parallel over chains only; a lone chain keeps its candidate pass parallel instead.
+    uint32_t innerThreads = count > 1 ? 1 : 0;
+    UnigmaParallelFor(count, 1, [&](uint32_t i) {
+        const MeshSimplifySettings& s = i < settings.size() ? settings[i] : (settings.empty() ? defaults : settings.back());
+        outChains[i] = BuildChain(positions[i], triangles[i], s, innerThreads);
+    });
+}
+
+float ProjectedErrorPixels(float error, float distance, float fovY, float screenHeight)
+{
+    distance = std::max(distance, 1e-4f);
+    return error * screenHeight / (2.0f * distance * std::tan(fovY * 0.5f));
+}
+
+uint32_t SelectMeshLOD(const MeshLODChain& chain, const glm::vec3& cameraPosition, float fovY, float screenHeight, float pixelThreshold)
+{
+    if (chain.lods.empty())
+        return 0;
+
+    float distance = chain.bounds.Distance(cameraPosition);
+    uint32_t selected = 0;
+    for (uint32_t i = 1; i < (uint32_t)chain.lods.size(); i++)
+    {
+        if (ProjectedErrorPixels(chain.lods[i].error, distance, fovY, screenHeight) > pixelThreshold)
+            break;
+        selected = i;
+    }
+    return selected;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "SDFCommon.h"
+
+//Quadric error edge-collapse simplifier for meshes extracted from the SDF (per tile or per brush).
+//Collapses always move a vertex onto one of its neighbours, so every LOD is just a new index list
+//over the same vertex buffer. Open borders (tile seams) are locked by default so neighbouring tiles still stitch.
+
+struct MeshSimplifySettings
+{
+    std::vector<float> lodRatios = { 0.5f, 0.25f, 0.125f }; //Fraction of the source triangle count for each LOD after LOD0.
+    //Largest allowed collapse error, in mesh units: the furthest any kept vertex sits from the plane of a source face
+    //it absorbed. Quadrics only order the collapses; this bound is what gets checked and reported.
+    float maxError = std::numeric_limits<float>::max();
+    bool lockBorder = true; //Never move vertices on open edges.
+    bool lockBounds = false; //Never move vertices lying on a face of lockAABB (tile faces).
+    SDFAABB lockAABB;
+    float lockEpsilon = 1e-4f;
+    float minNormalDot = 0.2f; //Reject collapses that rotate a face normal further than this.
+};
+
+struct MeshLOD
+{
+    std::vector<glm::uvec3> triangles;
+    float error = 0.0f; //Upper bound on the vertex deviation from the source planes, in mesh units; see MeshSimplifySettings::maxError.
+    float ratio = 1.0f; //Achieved triangle ratio relative to LOD0.
+};
+
+struct MeshLODChain
+{
+    std::vector<glm::vec3> positions; //Shared by every LOD.
+    std::vector<MeshLOD> lods; //lods[0] is the source mesh.
+    SDFAABB bounds;
+};
+
+//Welds a non-indexed triangle soup (3 vec4 per triangle, as written by the meshing pass) into an indexed mesh.
+void WeldTriangleSoup(const glm::vec4* soup, uint32_t vertexCount, float weldDistance,
+    std::vector<glm::vec3>& outPositions, std::vector<glm::uvec3>& outTriangles);
+
+//Simplifies towards targetTriangleCount. Returns the new index list and writes the reached error.
+std::vector<glm::uvec3> SimplifyMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles,
+    uint32_t targetTriangleCount, const MeshSimplifySettings& settings, float* outError = nullptr);
+
+//Builds LOD0 plus one LOD per settings.lodRatios entry in a single progressive run.
+MeshLODChain BuildMeshLODChain(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles,
+    const MeshSimplifySettings& settings);
+
+//Builds chains for many tiles/brushes at once across all cores, one chain per thread.
+void BuildMeshLODChains(const std::vector<std::vector<glm::vec3>>& positions, const std::vector<std::vector<glm::uvec3>>& triangles,
+    const std::vector<MeshSimplifySettings>& settings, std::vector<MeshLODChain>& outChains);
+
+//Screen space size of a world space error at the given distance.
+float ProjectedErrorPixels(float error, float distance, float fovY, float screenHeight);
+
+//Picks the coarsest LOD whose error projects below pixelThreshold for the camera.
+uint32_t SelectMeshLOD(const MeshLODChain& chain, const glm::vec3& cameraPosition, float fovY, float screenHeight, float pixelThreshold = 1.0f);
@@ -0,0 +1,151 @@
+#include "SDFMipPyramid.h"
+#include "../Core/UnigmaParallel.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <immintrin.h>
+#define SDF_MIP_SSE 1
+#endif
+
+void SDFMipReduceRow(const float* r00, const float* r10, const float* r01, const float* r11, int fineWidth,
+    float* out, int coarseWidth, SDFMipReduce mode)
+{
+    int cx = 0;
+    int pairs = fineWidth / 2;
+
+#ifdef SDF_MIP_SSE
+    //Four coarse voxels per step: fold the four rows, then split even/odd x and fold those.
+    if (mode == SDFMipReduce::Min)
+    {
+        for (; cx + 4 <= pairs; cx += 4)
+        {
+            int x = cx * 2;
+            __m128 lo = _mm_min_ps(_mm_min_ps(_mm_loadu_ps(r00 + x), _mm_loadu_ps(r10 + x)), _mm_min_ps(_mm_loadu_ps(r01 + x), _mm_loadu_ps(r11 + x)));
+            __m128 hi = _mm_min_ps(_mm_min_ps(_mm_loadu_ps(r00 + x + 4), _mm_loadu_ps(r10 + x + 4)), _mm_min_ps(_mm_loadu_ps(r01 + x + 4), _mm_loadu_ps(r11 + x + 4)));
+            __m128 even = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(out + cx, _mm_min_ps(even, odd));
+        }
+    }
+    else
+    {
+        const __m128 eighth = _mm_set1_ps(0.125f);
+        for (; cx + 4 <= pairs; cx += 4)
+        {
+            int x = cx * 2;
+            __m128 lo = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(r00 + x), _mm_loadu_ps(r10 + x)), _mm_add_ps(_mm_loadu_ps(r01 + x), _mm_loadu_ps(r11 + x)));
+            __m128 hi = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(r00 + x + 4), _mm_loadu_ps(r10 + x + 4)), _mm_add_ps(_mm_loadu_ps(r01 + x + 4), _mm_loadu_ps(r11 + x + 4)));
+            __m128 even = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(out + cx, _mm_mul_ps(_mm_add_ps(even, odd), eighth));
+        }
+    }
+#endif
+
+    //Same operation order as the SIMD path so both give identical bits.
+    for (; cx < coarseWidth; cx++)
+    {
+        int x0 = cx * 2;
+        int x1 = std::min(x0 + 1, fineWidth - 1);
+        if (mode == SDFMipReduce::Min)
+        {
+            float a = std::min(std::min(r00[x0], r10[x0]), std::min(r01[x0], r11[x0]));
+            float b = std::min(std::min(r00[x1], r10[x1]), std::min(r01[x1], r11[x1]));
+            out[cx] = std::min(a, b);
+        }
+        else
+        {
+            float a = (r00[x0] + r10[x0]) + (r01[x0] + r11[x0]);
+            float b = (r00[x1] + r10[x1]) + (r01[x1] + r11[x1]);
+            out[cx] = (a + b) * 0.125f;
+        }
+    }
+}
+
+void SDFMipPyramid::Build(const SDFGridDesc& gridDesc, const float* values, SDFMipReduce mode, int maxLevels)
+{
+    grid = gridDesc;
+    reduce = mode;
+    BuildLevels([&](int y, int z, float*) {
+        return values + size_t(y) * grid.resolution.x + size_t(z) * grid.resolution.x * grid.resolution.y;
+    }, maxLevels);
+}
+
+void SDFMipPyramid::BuildStrided(const SDFGridDesc& gridDesc, const void* first, size_t strideBytes, SDFMipReduce mode, int maxLevels)
+{
+    grid = gridDesc;
+    reduce = mode;
+    const uint8_t* base = static_cast<const uint8_t*>(first);
+    BuildLevels([&](int y, int z, float* scratch) {
+        const uint8_t* row = base + (size_t(y) * grid.resolution.x + size_t(z) * grid.resolution.x * grid.resolution.y) * strideBytes;
+        for (int x = 0; x < grid.resolution.x; x++)
+            std::memcpy(scratch + x, row + size_t(x) * strideBytes, sizeof(float));
+        return (const float*)scratch;
+    }, maxLevels);
+}
+
+void SDFMipPyramid::BuildLevels(const std::function<const float*(int y, int z, float* scratch)>& fetchRow, int maxLevels)
+{
+    levels.clear();
+    glm::ivec3 fineRes = grid.resolution;
+    const SDFMipLevel* previous = nullptr;
+
+    while (glm::any(glm::greaterThan(fineRes, glm::ivec3(1))) && (maxLevels <= 0 || (int)levels.size() < maxLevels))
+    {
+        SDFMipLevel level;
+        level.resolution = (fineRes + 1) / 2;
+        level.values.resize(size_t(level.resolution.x) * level.resolution.y * level.resolution.z);
+
+        auto row = [&](int y, int z, float* scratch) -> const float* {
+            if (previous == nullptr)
+                return fetchRow(y, z, scratch);
+            return previous->values.data() + size_t(y) * fineRes.x + size_t(z) * fineRes.x * fineRes.y;
+        };
+
+        uint32_t rows = uint32_t(level.resolution.y * level.resolution.z);
+        UnigmaParallelForRange(rows, 16, [&](uint32_t begin, uint32_t end) {
+            std::vector<float> scratch(size_t(fineRes.x) * 4);
+            for (uint32_t r = begin; r < end; r++)
+            {
+                int cy = int(r) % level.resolution.y;
+                int cz = int(r) / level.resolution.y;
+                int y0 = cy * 2, y1 = std::min(y0 + 1, fineRes.y - 1);
+                int z0 = cz * 2, z1 = std::min(z0 + 1, fineRes.z - 1);
+                const float* r00 = row(y0, z0, scratch.data());
+                const float* r10 = row(y1, z0, scratch.data() + fineRes.x);
+                const float* r01 = row(y0, z1, scratch.data() + fineRes.x * 2);
+                const float* r11 = row(y1, z1, scratch.data() + fineRes.x * 3);
+                float* out = level.values.data() + size_t(cy) * level.resolution.x + size_t(cz) * level.resolution.x * level.resolution.y;
+                SDFMipReduceRow(r00, r10, r01, r11, fineRes.x, out, level.resolution.x, reduce);
+            }
+        });
+
+        levels.push_back(std::move(level));
+        previous = &levels.back();
+        fineRes = previous->resolution;
+    }
+}
+
+float SDFMipPyramid::SafeDistance(int mip, const glm::vec3& worldPos) const
+{
+    glm::ivec3 v = glm::clamp(glm::ivec3(glm::floor(grid.WorldToVoxel(worldPos))), glm::ivec3(0), grid.resolution - 1);
+    glm::ivec3 cell = glm::ivec3(v.x >> mip, v.y >> mip, v.z >> mip);
+    //The footprint min bounds every level 0 centre, any point is within half a voxel diagonal of one.
+    return Level(mip).Load(cell) - 0.5f * glm::length(grid.VoxelSize());
+}
+
+float SDFMipPyramid::Sample(int mip, const glm::vec3& worldPos) const
+{
+    const SDFMipLevel& level = Level(mip);
+    SDFGridDesc levelGrid(level.resolution, grid.sceneSize);
+    glm::vec3 t = levelGrid.WorldToVoxel(worldPos) - 0.5f;
+    glm::ivec3 p0 = glm::ivec3(glm::floor(t));
+    glm::vec3 f = t - glm::vec3(p0);
+    glm::ivec3 p1 = p0 + 1;
+
+    float c00 = glm::mix(level.Load(glm::ivec3(p0.x, p0.y, p0.z)), level.Load(glm::ivec3(p1.x, p0.y, p0.z)), f.x);
+    float c10 = glm::mix(level.Load(glm::ivec3(p0.x, p1.y, p0.z)), level.Load(glm::ivec3(p1.x, p1.y, p0.z)), f.x);
+    float c01 = glm::mix(level.Load(glm::ivec3(p0.x, p0.y, p1.z)), level.Load(glm::ivec3(p1.x, p0.y, p1.z)), f.x);
+    float c11 = glm::mix(level.Load(glm::ivec3(p0.x, p1.y, p1.z)), level.Load(glm::ivec3(p1.x, p1.y, p1.z)), f.x);
+    return glm::mix(glm::mix(c00, c10, f.y), glm::mix(c01, c11, f.y), f.z);
+}
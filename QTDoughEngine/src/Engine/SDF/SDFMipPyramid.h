@@ -0,0 +1,53 @@
+#pragma once
+#include "SDFCommon.h"
+#include <functional>
+
+//CPU counterpart of GenerateMIPS. Each level halves the previous one (odd edges repeat their last voxel).
+//Min pyramids keep the smallest distance of every level 0 voxel under a cell, so SafeDistance() is a true lower bound
+//of the field anywhere in that footprint and can be used to skip empty space. Average pyramids match the GPU filter.
+
+enum class SDFMipReduce : uint32_t
+{
+    Min = 0,
+    Average = 1
+};
+
+struct SDFMipLevel
+{
+    glm::ivec3 resolution = glm::ivec3(0);
+    std::vector<float> values; //x fastest.
+
+    float Load(const glm::ivec3& v) const
+    {
+        glm::ivec3 c = glm::clamp(v, glm::ivec3(0), resolution - 1);
+        return values[size_t(c.x) + size_t(c.y) * resolution.x + size_t(c.z) * resolution.x * resolution.y];
+    }
+};
+
+class SDFMipPyramid
+{
+public:
+    SDFGridDesc grid; //Level 0, owned by the caller.
+    SDFMipReduce reduce = SDFMipReduce::Min;
+    std::vector<SDFMipLevel> levels; //levels[0] is mip 1.
+
+    //values: level 0 distances, x fastest. maxLevels 0 goes down to a single voxel.
+    void Build(const SDFGridDesc& gridDesc, const float* values, SDFMipReduce mode, int maxLevels = 0);
+    //Same, reading one float every strideBytes, e.g. Voxel::isoPhi in a voxel buffer readback.
+    void BuildStrided(const SDFGridDesc& gridDesc, const void* first, size_t strideBytes, SDFMipReduce mode, int maxLevels = 0);
+
+    int MipCount() const { return (int)levels.size() + 1; }
+    const SDFMipLevel& Level(int mip) const { return levels[mip - 1]; }
+
+    //Lower bound of the level 0 field at worldPos using mip (>= 1) of a Min pyramid.
+    float SafeDistance(int mip, const glm::vec3& worldPos) const;
+    //Trilinear read of a mip, the same placement as the GPU mip chain (level covers the full scene).
+    float Sample(int mip, const glm::vec3& worldPos) const;
+
+private:
+    void BuildLevels(const std::function<const float*(int y, int z, float* scratch)>& fetchRow, int maxLevels);
+};
+
+//Reduces one coarse row from four fine rows (y0/y1 x z0/z1). SIMD where available; the scalar path gives identical results.
+void SDFMipReduceRow(const float* r00, const float* r10, const float* r01, const float* r11, int fineWidth,
+    float* out, int coarseWidth, SDFMipReduce mode);
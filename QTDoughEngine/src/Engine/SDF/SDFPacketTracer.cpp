@@ -0,0 +1,229 @@
+//Packets have to give the bits the scalar tracer gives, so no multiply and add is fused into an FMA in either path.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#include "SDFPacketTracer.h"
+#include "SDFSampling.h"
+#include <climits>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    //The rays of one packet, one array per component so a lane is a column.
+    struct PacketLanes
+    {
+        alignas(32) float ox[SDF_PACKET_WIDTH], oy[SDF_PACKET_WIDTH], oz[SDF_PACKET_WIDTH];
+        alignas(32) float dx[SDF_PACKET_WIDTH], dy[SDF_PACKET_WIDTH], dz[SDF_PACKET_WIDTH];
+        alignas(32) float t[SDF_PACKET_WIDTH];
+        alignas(32) float exit[SDF_PACKET_WIDTH];
+        alignas(32) int steps[SDF_PACKET_WIDTH];
+        uint32_t started = 0; //Lanes given a ray.
+        uint32_t marching = 0; //Lanes still to march.
+        uint32_t hit = 0; //Lanes that reached the surface, with t at the hit.
+
+        PacketLanes()
+        {
+            for (int i = 0; i < SDF_PACKET_WIDTH; i++)
+            {
+                ox[i] = oy[i] = oz[i] = dx[i] = dy[i] = dz[i] = t[i] = 0.0f;
+                exit[i] = -1.0f;
+                steps[i] = 0;
+            }
+        }
+
+        void Set(int lane, const SDFRay& ray, float tEnter, float tExit, int stepCount)
+        {
+            ox[lane] = ray.origin.x; oy[lane] = ray.origin.y; oz[lane] = ray.origin.z;
+            dx[lane] = ray.direction.x; dy[lane] = ray.direction.y; dz[lane] = ray.direction.z;
+            t[lane] = tEnter;
+            exit[lane] = tExit;
+            steps[lane] = stepCount;
+            started |= 1u << lane;
+            marching |= 1u << lane;
+        }
+
+        SDFRay Ray(int lane) const { return SDFRay(glm::vec3(ox[lane], oy[lane], oz[lane]), glm::vec3(dx[lane], dy[lane], dz[lane])); }
+    };
+
+#ifdef __AVX2__
+    int LaneCount(uint32_t bits)
+    {
+        int n = 0;
+        for (; bits != 0; bits &= bits - 1)
+            n++;
+        return n;
+    }
+
+    //SDFSphereTracer::March on all lanes at once, stopping when no more than compactLanes are left. The samples come from
+    //SDFSampleTrilinearAVX2, which repeats SDFSampleTrilinear lane for lane, so every lane takes the steps the scalar
+    //march would.
+    void MarchAVX2(const SDFSphereTracer& tracer, PacketLanes& lanes, const SDFTraceSettings& settings, int compactLanes)
+    {
+        SDFSampleGridAVX2 sampler(tracer.Values()->data(), tracer.Grid());
+        const __m256 hitDistance = _mm256_set1_ps(tracer.VoxelEdge() * settings.hitVoxels);
+        const __m256 minStep = _mm256_set1_ps(tracer.VoxelEdge() * settings.minStepVoxels);
+        const __m256i maxSteps = _mm256_set1_epi32(settings.maxSteps);
+
+        const __m256 ox = _mm256_load_ps(lanes.ox), oy = _mm256_load_ps(lanes.oy), oz = _mm256_load_ps(lanes.oz);
+        const __m256 dx = _mm256_load_ps(lanes.dx), dy = _mm256_load_ps(lanes.dy), dz = _mm256_load_ps(lanes.dz);
+        const __m256 exit = _mm256_load_ps(lanes.exit);
+        __m256 t = _mm256_load_ps(lanes.t);
+        __m256i steps = _mm256_load_si256((const __m256i*)lanes.steps);
+
+        const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        __m256 marching = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32(int(lanes.marching)), laneBits), laneBits));
+        uint32_t hits = 0;
+
+        for (;;)
+        {
+            //March's loop condition, per lane.
+            __m256 live = _mm256_and_ps(marching, _mm256_and_ps(
+                _mm256_castsi256_ps(_mm256_cmpgt_epi32(maxSteps, steps)), _mm256_cmp_ps(t, exit, _CMP_LE_OQ)));
+            marching = live;
+            int liveBits = _mm256_movemask_ps(live);
+            if (liveBits == 0 || LaneCount(uint32_t(liveBits)) <= compactLanes)
+                break;
+
+            __m256 d = SDFSampleTrilinearAVX2(sampler, _mm256_add_ps(ox, _mm256_mul_ps(dx, t)), _mm256_add_ps(oy, _mm256_mul_ps(dy, t)),
+                _mm256_add_ps(oz, _mm256_mul_ps(dz, t)));
+
+            __m256 hitNow = _mm256_and_ps(live, _mm256_cmp_ps(d, hitDistance, _CMP_LT_OQ));
+            hits |= uint32_t(_mm256_movemask_ps(hitNow));
+            marching = _mm256_andnot_ps(hitNow, live);
+            //max(minStep, d) keeps d when it is NaN, as std::max(d, minStep) does.
+            t = _mm256_blendv_ps(t, _mm256_add_ps(t, _mm256_max_ps(minStep, d)), marching);
+            steps = _mm256_sub_epi32(steps, _mm256_castps_si256(marching));
+        }
+
+        _mm256_store_ps(lanes.t, t);
+        _mm256_store_si256((__m256i*)lanes.steps, steps);
+        lanes.marching = uint32_t(_mm256_movemask_ps(marching));
+        lanes.hit |= hits;
+    }
+#endif
+
+    //Marches every lane to its end: packed while enough lanes are left, then lane by lane.
+    void MarchPacket(const SDFSphereTracer& tracer, PacketLanes& lanes, const SDFTraceSettings& settings, int compactLanes)
+    {
+#ifdef __AVX2__
+        const std::vector<float>* values = tracer.Values();
+        if (values != nullptr && values->size() == tracer.Grid().VoxelCount() && values->size() <= size_t(INT_MAX))
+            MarchAVX2(tracer, lanes, settings, std::max(compactLanes, 0));
+#else
+        (void)compactLanes;
+#endif
+        for (int i = 0; i < SDF_PACKET_WIDTH; i++)
+            if (lanes.marching & (1u << i))
+                if (tracer.March(lanes.Ray(i), lanes.t[i], lanes.exit[i], lanes.steps[i], settings))
+                    lanes.hit |= 1u << i;
+        lanes.marching = 0;
+    }
+}
+
+SDFPacketTracer::SDFPacketTracer(const SDFSphereTracer& sphereTracer, const SDFPacketSettings& settings) :
+    tracer(sphereTracer), packetSettings(settings)
+{
+}
+
+void SDFPacketTracer::Trace8(const SDFRay* rays, int count, const SDFTraceSettings& settings, SDFTraceHit* outHits, const float* tStart) const
+{
+    count = std::min(std::max(count, 0), SDF_PACKET_WIDTH);
+    PacketLanes primary;
+    for (int i = 0; i < count; i++)
+    {
+        outHits[i] = SDFTraceHit();
+        float enter, exit;
+        if (tracer.Values() != nullptr && tracer.ClipToGrid(rays[i], enter, exit))
+            primary.Set(i, rays[i], std::max(enter, tStart != nullptr ? tStart[i] : 0.0f), exit, 0);
+    }
+    MarchPacket(tracer, primary, settings, packetSettings.compactLanes);
+
+    //Surface first, with the normals of all hit lanes in one batch (Shade without its shadow ray), then the shadow rays
+    //as a packet of their own: they all head for the same light.
+    glm::vec3 positions[SDF_PACKET_WIDTH], normals[SDF_PACKET_WIDTH];
+    int hitLanes[SDF_PACKET_WIDTH];
+    int hitCount = 0;
+    for (int i = 0; i < count; i++)
+    {
+        outHits[i].steps = primary.steps[i];
+        if (!(primary.hit & (1u << i)))
+            continue;
+        outHits[i].hit = true;
+        outHits[i].t = primary.t[i];
+        outHits[i].position = rays[i].origin + rays[i].direction * primary.t[i];
+        positions[hitCount] = outHits[i].position;
+        hitLanes[hitCount++] = i;
+    }
+    tracer.Normals(positions, size_t(hitCount), normals);
+
+    PacketLanes shadow;
+    for (int h = 0; h < hitCount; h++)
+    {
+        int i = hitLanes[h];
+        outHits[i].normal = normals[h];
+
+        float enter, exit;
+        SDFRay shadowRay = tracer.ShadowRay(outHits[i], settings);
+        if (settings.shadows && tracer.ClipToGrid(shadowRay, enter, exit))
+            shadow.Set(i, shadowRay, enter, exit, outHits[i].steps);
+    }
+    if (shadow.started == 0)
+        return;
+
+    MarchPacket(tracer, shadow, settings, packetSettings.compactLanes);
+    for (int i = 0; i < count; i++)
+        if (shadow.started & (1u << i))
+        {
+            outHits[i].steps = shadow.steps[i];
+            if (shadow.hit & (1u << i))
+                outHits[i].visibility = 0.0f;
+        }
+}
+
+SDFPacketStats SDFPacketTracer::TraceRays(const SDFRay* rays, size_t count, const SDFTraceSettings& settings, SDFTraceHit* outHits,
+    const float* tStart) const
+{
+    SDFPacketStats stats;
+    for (size_t first = 0; first < count; first += SDF_PACKET_WIDTH)
+    {
+        int n = int(std::min<size_t>(SDF_PACKET_WIDTH, count - first));
+        const float* starts = tStart != nullptr ? tStart + first : nullptr;
+        if (n > 1 && Coherent(rays + first, n, packetSettings.coherenceCos))
+        {
+            Trace8(rays + first, n, settings, outHits + first, starts);
+            stats.packets++;
+            stats.packetRays += uint64_t(n);
+            continue;
+        }
+        for (int i = 0; i < n; i++)
+            outHits[first + i] = tracer.Trace(rays[first + i], settings, starts != nullptr ? starts[i] : 0.0f);
+        stats.scalarRays += uint64_t(n);
+    }
+    return stats;
+}
+
+bool SDFPacketTracer::Coherent(const SDFRay* rays, int count, float coherenceCos)
+{
+    for (int i = 1; i < count; i++)
+        if (glm::dot(rays[i].direction, rays[0].direction) < coherenceCos)
+            return false;
+    return true;
+}
+
+bool SDFPacketTracer::Vectorized()
+{
+#ifdef __AVX2__
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "SDFSphereTracer.h"
+
+//Sphere tracing of 8 rays at once for coherent bundles (camera tiles, sensor fans, shadow rays towards one light).
+//Lanes march together with their own step sizes and the 8 trilinear reads gathered per corner (AVX2); the packet
+//stops when every lane is done, and once only a few lanes are left those finish on the scalar path rather than
+//dragging 8 wide work along. Groups whose directions spread too far are traced one ray at a time instead.
+//Hit normals are taken for the whole packet at once (SDFSphereTracer::Normals).
+//Every ray ends exactly where SDFSphereTracer::Trace ends it: the lanes repeat its arithmetic operation for operation.
+//The Visual Studio projects build with /arch:AVX2 (-mavx2 elsewhere); without __AVX2__ packets run lane by lane
+//through the scalar march.
+
+#define SDF_PACKET_WIDTH 8
+
+struct SDFPacketSettings
+{
+    float coherenceCos = 0.9f; //Every direction in a packet within acos(coherenceCos) of the first one.
+    int compactLanes = 2; //Lanes still marching at or below which the packet hands over to the scalar path.
+};
+
+struct SDFPacketStats
+{
+    uint64_t packets = 0;
+    uint64_t packetRays = 0;
+    uint64_t scalarRays = 0; //Rays of divergent groups.
+};
+
+class SDFPacketTracer
+{
+public:
+    explicit SDFPacketTracer(const SDFSphereTracer& tracer, const SDFPacketSettings& settings = SDFPacketSettings());
+
+    //Up to SDF_PACKET_WIDTH rays as one packet, whatever their coherence. tStart is per ray and may be null.
+    void Trace8(const SDFRay* rays, int count, const SDFTraceSettings& settings, SDFTraceHit* outHits, const float* tStart = nullptr) const;
+
+    //Consecutive groups of SDF_PACKET_WIDTH, coherent ones as packets and the rest one ray at a time.
+    SDFPacketStats TraceRays(const SDFRay* rays, size_t count, const SDFTraceSettings& settings, SDFTraceHit* outHits,
+        const float* tStart = nullptr) const;
+
+    static bool Coherent(const SDFRay* rays, int count, float coherenceCos);
+    //True when the packets run 8 wide.
+    static bool Vectorized();
+
+private:
+    const SDFSphereTracer& tracer;
+    SDFPacketSettings packetSettings;
+};
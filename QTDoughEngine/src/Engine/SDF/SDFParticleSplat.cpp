@@ -0,0 +1,257 @@
+#include "SDFParticleSplat.h"
+#include "../Core/UnigmaParallel.h"
+
+namespace
+{
+    //Per voxel/particle weights with the constants the kernels derive from the grid.
+    struct SplatKernel
+    {
+        SDFParticleKernel kernel;
+        SDFParticleBlend blend;
+        float h, sigma, support, support2, invSigma, radius, inflate, smoothK;
+        glm::vec3 voxelSize, halfScene;
+
+        SplatKernel(const SDFGridDesc& grid, const SDFParticleSplatSettings& s)
+        {
+            kernel = s.kernel;
+            blend = s.blend;
+            voxelSize = grid.VoxelSize();
+            halfScene = grid.sceneSize * 0.5f;
+            h = std::max(voxelSize.x, std::max(voxelSize.y, voxelSize.z));
+            sigma = h * s.sigmaScale;
+            support = sigma * s.supportScale * s.supportMultiplier;
+            support2 = support * support;
+            invSigma = 1.0f / (2.0f * sigma * sigma);
+            radius = s.radiusScale;
+            inflate = s.inflate;
+            smoothK = s.smoothK > 0.0f ? s.smoothK : sigma;
+        }
+
+        //Voxels the support box touches, as the kernels floor it. Not clamped.
+        void Range(const glm::vec3& p, glm::ivec3& v0, glm::ivec3& v1) const
+        {
+            v0 = glm::ivec3(glm::floor((p - support + halfScene) / voxelSize));
+            v1 = glm::ivec3(glm::floor((p + support + halfScene) / voxelSize));
+        }
+
+        glm::vec3 WorldPos(const glm::ivec3& v) const { return (glm::vec3(v) + 0.5f) * voxelSize - halfScene; }
+
+        //False when the particle does not reach the voxel.
+        bool Evaluate(const glm::vec3& worldPos, const glm::vec3& p, uint32_t& outDensity, int32_t& outDistance, float& outSd) const
+        {
+            glm::vec3 diff = worldPos - p;
+            float squaredDist = glm::dot(diff, diff);
+
+            if (kernel == SDFParticleKernel::P2GFast)
+            {
+                float gaussianValue = std::exp2(-squaredDist * invSigma * 1.44269504089f);
+                outDensity = (uint32_t)std::round(gaussianValue * SDF_DENSITY_SCALE);
+                outSd = glm::length(diff) - radius * h;
+            }
+            else
+            {
+                if (squaredDist > support2)
+                    return false;
+                float gaussianValue = std::exp(-squaredDist / (2.0f * sigma * sigma));
+                outDensity = (uint32_t)std::round(gaussianValue * SDF_DENSITY_SCALE);
+                float sd = glm::length(diff) - radius * h;
+                sd -= inflate * sigma;
+                float sdN = sd / sigma;
+                sdN = (sdN > 0.0f ? 1.0f : (sdN < 0.0f ? -1.0f : 0.0f)) * (1.0f - std::exp(-std::abs(sdN)));
+                outSd = sdN * sigma;
+            }
+            outDistance = (int32_t)std::round(outSd * (float)outDensity);
+            return true;
+        }
+    };
+
+    //One voxel's running sums. Integer sums wrap like InterlockedAdd.
+    struct SplatAccum
+    {
+        uint32_t density = 0;
+        uint32_t distance = 0;
+        float nearest = 0.0f; //Exponential smooth min kept as nearest - k * log(sum), relative to the nearest sd.
+        float sum = 0.0f;
+        bool touched = false;
+
+        void Add(const SplatKernel& k, uint32_t d, int32_t dist, float sd)
+        {
+            if (k.blend == SDFParticleBlend::GaussianAverage)
+            {
+                density += d;
+                distance += (uint32_t)dist;
+            }
+            else if (!touched)
+            {
+                nearest = sd;
+                sum = 1.0f;
+            }
+            else if (sd < nearest)
+            {
+                sum = sum * std::exp((sd - nearest) / k.smoothK) + 1.0f;
+                nearest = sd;
+            }
+            else
+                sum += std::exp((nearest - sd) / k.smoothK);
+            touched = true;
+        }
+
+        void Store(const SplatKernel& k, SDFParticleField& out, size_t index) const
+        {
+            if (k.blend == SDFParticleBlend::GaussianAverage)
+            {
+                out.density[index] = density;
+                out.distance[index] = (int32_t)distance;
+                //CalculateSDFGaussDistance.
+                out.phi[index] = density == 0 ? SDF_EMPTY_SPACE : (float)(int32_t)distance / std::max(1.0f, (float)density);
+            }
+            else
+                out.phi[index] = touched ? nearest - k.smoothK * std::log(sum) : SDF_EMPTY_SPACE;
+        }
+    };
+
+    void PrepareField(const SDFGridDesc& grid, const SplatKernel& k, SDFParticleField& out)
+    {
+        out.grid = grid;
+        size_t count = grid.VoxelCount();
+        out.phi.assign(count, SDF_EMPTY_SPACE);
+        if (k.blend == SDFParticleBlend::GaussianAverage)
+        {
+            out.density.assign(count, 0);
+            out.distance.assign(count, 0);
+        }
+        else
+        {
+            out.density.clear();
+            out.distance.clear();
+        }
+    }
+}
+
+glm::ivec3 SDFParticleCells::CellOf(const glm::vec3& p) const
+{
+    glm::vec3 cellWorld = grid.VoxelSize() * float(cellVoxels);
+    glm::ivec3 c = glm::ivec3(glm::floor((p - grid.Origin()) / cellWorld));
+    return glm::clamp(c, glm::ivec3(0), cells - 1);
+}
+
+void SDFParticleCells::Build(const SDFGridDesc& gridDesc, int cellEdge, const std::vector<glm::vec3>& positions)
+{
+    grid = gridDesc;
+    cellVoxels = std::max(cellEdge, 1);
+    cells = (grid.resolution + cellVoxels - 1) / cellVoxels;
+    uint32_t cellTotal = uint32_t(cells.x * cells.y * cells.z);
+
+    //Histogram, exclusive prefix sum, scatter. The scatter walks particles in order so every cell stays sorted.
+    counts.assign(cellTotal, 0);
+    std::vector<uint32_t> cellOfParticle(positions.size());
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        cellOfParticle[i] = Flatten(CellOf(positions[i]));
+        counts[cellOfParticle[i]]++;
+    }
+
+    offsets.assign(cellTotal, 0);
+    uint32_t running = 0;
+    for (uint32_t c = 0; c < cellTotal; c++)
+    {
+        offsets[c] = running;
+        running += counts[c];
+    }
+
+    ids.resize(positions.size());
+    std::vector<uint32_t> cursor(offsets);
+    for (size_t i = 0; i < positions.size(); i++)
+        ids[cursor[cellOfParticle[i]]++] = (uint32_t)i;
+}
+
+void SDFSplatParticles(const SDFGridDesc& grid, const std::vector<glm::vec3>& positions, const SDFParticleSplatSettings& settings,
+    SDFParticleField& out, int brickVoxels)
+{
+    SplatKernel k(grid, settings);
+    PrepareField(grid, k, out);
+    if (positions.empty() || grid.VoxelCount() == 0)
+        return;
+
+    brickVoxels = std::max(brickVoxels, 1);
+    SDFParticleCells cells;
+    cells.Build(grid, brickVoxels, positions);
+
+    glm::ivec3 bricks = (grid.resolution + brickVoxels - 1) / brickVoxels;
+    uint32_t brickCount = uint32_t(bricks.x * bricks.y * bricks.z);
+    glm::vec3 voxelSize = grid.VoxelSize();
+
+    UnigmaParallelFor(brickCount, 1, [&](uint32_t b) {
+        glm::ivec3 brick(b % bricks.x, (b / bricks.x) % bricks.y, b / (bricks.x * bricks.y));
+        glm::ivec3 lo = brick * brickVoxels;
+        glm::ivec3 hi = glm::min(lo + brickVoxels, grid.resolution) - 1;
+        glm::ivec3 size = hi - lo + 1;
+        std::vector<SplatAccum> local(size_t(size.x) * size.y * size.z);
+
+        //A particle reaches at most support plus the voxel its floored box edge lands in, so pad by one more voxel.
+        glm::vec3 pad = glm::vec3(k.support) + voxelSize;
+        glm::ivec3 c0 = cells.CellOf(glm::vec3(lo) * voxelSize + grid.Origin() - pad);
+        glm::ivec3 c1 = cells.CellOf(glm::vec3(hi + 1) * voxelSize + grid.Origin() + pad);
+
+        for (int cz = c0.z; cz <= c1.z; cz++)
+            for (int cy = c0.y; cy <= c1.y; cy++)
+                for (int cx = c0.x; cx <= c1.x; cx++)
+                {
+                    uint32_t cell = cells.Flatten(glm::ivec3(cx, cy, cz));
+                    uint32_t first = cells.Offsets()[cell];
+                    for (uint32_t n = 0; n < cells.Counts()[cell]; n++)
+                    {
+                        const glm::vec3& p = positions[cells.Ids()[first + n]];
+                        glm::ivec3 v0, v1;
+                        k.Range(p, v0, v1);
+                        v0 = glm::max(v0, lo);
+                        v1 = glm::min(v1, hi);
+                        for (int z = v0.z; z <= v1.z; z++)
+                            for (int y = v0.y; y <= v1.y; y++)
+                                for (int x = v0.x; x <= v1.x; x++)
+                                {
+                                    uint32_t d;
+                                    int32_t dist;
+                                    float sd;
+                                    if (!k.Evaluate(k.WorldPos(glm::ivec3(x, y, z)), p, d, dist, sd))
+                                        continue;
+                                    local[size_t(x - lo.x) + size_t(y - lo.y) * size.x + size_t(z - lo.z) * size.x * size.y].Add(k, d, dist, sd);
+                                }
+                    }
+                }
+
+        for (int z = lo.z; z <= hi.z; z++)
+            for (int y = lo.y; y <= hi.y; y++)
+                for (int x = lo.x; x <= hi.x; x++)
+                    local[size_t(x - lo.x) + size_t(y - lo.y) * size.x + size_t(z - lo.z) * size.x * size.y].Store(k, out, grid.Flatten(glm::ivec3(x, y, z)));
+    });
+}
+
+void SDFSplatParticlesReference(const SDFGridDesc& grid, const std::vector<glm::vec3>& positions, const SDFParticleSplatSettings& settings,
+    SDFParticleField& out)
+{
+    SplatKernel k(grid, settings);
+    PrepareField(grid, k, out);
+
+    std::vector<SplatAccum> accum(grid.VoxelCount());
+    for (const glm::vec3& p : positions)
+    {
+        glm::ivec3 v0, v1;
+        k.Range(p, v0, v1);
+        v0 = glm::max(v0, glm::ivec3(0));
+        v1 = glm::min(v1, grid.resolution - 1);
+        for (int z = v0.z; z <= v1.z; z++)
+            for (int y = v0.y; y <= v1.y; y++)
+                for (int x = v0.x; x <= v1.x; x++)
+                {
+                    uint32_t d;
+                    int32_t dist;
+                    float sd;
+                    if (k.Evaluate(k.WorldPos(glm::ivec3(x, y, z)), p, d, dist, sd))
+                        accum[grid.Flatten(glm::ivec3(x, y, z))].Add(k, d, dist, sd);
+                }
+    }
+
+    for (size_t i = 0; i < accum.size(); i++)
+        accum[i].Store(k, out, i);
+}
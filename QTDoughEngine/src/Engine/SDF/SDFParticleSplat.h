@@ -0,0 +1,78 @@
+#pragma once
+#include "SDFCommon.h"
+
+//CPU counterpart of the particle splats in voxelizer_compute.hlsl, for baking and checking particle surfaces headless
+//and for rebuilding them offline from recorded quanta positions (one position array per frame).
+//Particles are counting sorted into cells of the voxel grid (what matsim_histogram/prefixsum/scatter do with quanta
+//tiles), then the grid is processed brick by brick across the cores. A brick gathers the cells its support can reach
+//and accumulates privately, so there are no atomics and the result does not depend on the thread count.
+//Density and distance use the same fixed point sums as VoxelL1 (DENSITY_SCALE, int rounding, wrapping adds), so a
+//field matches the GPU up to the precision of the shader's exp/exp2.
+
+#define SDF_DENSITY_SCALE 1048576.0f //DENSITY_SCALE in ShaderHelpers.hlsl.
+
+enum class SDFParticleKernel : uint32_t
+{
+    P2GFast = 0, //Box support, plain distance minus the particle radius.
+    TiledGather = 1 //ParticlesSDF_Tiled: spherical support, inflated and soft saturated distance.
+};
+
+enum class SDFParticleBlend : uint32_t
+{
+    GaussianAverage = 0, //The kernels: sum(sd * w) / sum(w), written to phi like CalculateSDFGaussDistance.
+    //Exponential smooth min of every particle distance in support, for sharper offline reconstruction. Unlike SDFSmin it
+    //does not depend on the order particles arrive in, so bricks and threads cannot change the surface.
+    SmoothMin = 1
+};
+
+struct SDFParticleSplatSettings
+{
+    SDFParticleKernel kernel = SDFParticleKernel::P2GFast;
+    SDFParticleBlend blend = SDFParticleBlend::GaussianAverage;
+    float supportMultiplier = 1.0f; //pc.supportMultiplier.
+    float sigmaScale = 1.75f; //sigma = h * sigmaScale, h the largest voxel edge.
+    float supportScale = 2.25f; //Support half width = sigma * supportScale * supportMultiplier.
+    float radiusScale = 6.0f * 0.35f; //Particle radius = h * radiusScale.
+    float inflate = 0.315f; //TiledGather only, in sigmas.
+    float smoothK = 0.0f; //SmoothMin only, world units; blend width, about k * ln(2) for two equal particles. 0 uses sigma.
+};
+
+struct SDFParticleField
+{
+    SDFGridDesc grid;
+    std::vector<uint32_t> density; //Fixed point, GaussianAverage only.
+    std::vector<int32_t> distance; //Fixed point, GaussianAverage only.
+    std::vector<float> phi; //SDF_EMPTY_SPACE where no particle reaches. x fastest like the grid.
+};
+
+//Particle indices sorted by cell: cell c holds ids[offsets[c] .. offsets[c] + counts[c]), ascending particle index.
+//Positions outside the grid clamp into the border cells like ComputeTileIndex does.
+class SDFParticleCells
+{
+public:
+    void Build(const SDFGridDesc& grid, int cellVoxels, const std::vector<glm::vec3>& positions);
+
+    glm::ivec3 CellCount() const { return cells; }
+    glm::ivec3 CellOf(const glm::vec3& p) const;
+    uint32_t Flatten(const glm::ivec3& c) const { return uint32_t(c.x + c.y * cells.x + c.z * cells.x * cells.y); }
+
+    const std::vector<uint32_t>& Offsets() const { return offsets; }
+    const std::vector<uint32_t>& Counts() const { return counts; }
+    const std::vector<uint32_t>& Ids() const { return ids; }
+
+private:
+    SDFGridDesc grid;
+    int cellVoxels = 8;
+    glm::ivec3 cells = glm::ivec3(0);
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> ids;
+};
+
+//Splats positions into out (resized to grid). brickVoxels is the edge of one task and of a hash cell.
+void SDFSplatParticles(const SDFGridDesc& grid, const std::vector<glm::vec3>& positions, const SDFParticleSplatSettings& settings,
+    SDFParticleField& out, int brickVoxels = 8);
+
+//Per particle scatter in index order, the way the GPU kernels walk the support box. Slow; for tests.
+void SDFSplatParticlesReference(const SDFGridDesc& grid, const std::vector<glm::vec3>& positions, const SDFParticleSplatSettings& settings,
+    SDFParticleField& out);
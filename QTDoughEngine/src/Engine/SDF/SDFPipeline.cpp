@@ -0,0 +1,690 @@
+#include "SDFPipeline.h"
+#include "SDFContentHash.h"
+#include "SDFWindingNumber.h"
+#include "../Core/UnigmaParallel.h"
+#include <chrono>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    //Scene generation has to be identical everywhere, so no <random> distributions.
+    struct PipelineRng
+    {
+        uint32_t state;
+
+        explicit PipelineRng(uint32_t seed) : state(seed * 2654435761u + 1u) {}
+
+        uint32_t Next()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
+        float Uniform(float lo, float hi) { return lo + (hi - lo) * float(Next() >> 8) * (1.0f / 16777216.0f); }
+    };
+
+    SDFPipelineMesh MakeTorus(float major, float minor, uint32_t segments, uint32_t sides, int resolution)
+    {
+        SDFPipelineMesh mesh;
+        mesh.resolution = resolution;
+        for (uint32_t i = 0; i < segments; i++)
+        {
+            float u = 6.28318531f * float(i) / float(segments);
+            for (uint32_t j = 0; j < sides; j++)
+            {
+                float v = 6.28318531f * float(j) / float(sides);
+                float r = major + minor * std::cos(v);
+                mesh.positions.push_back(glm::vec3(r * std::cos(u), minor * std::sin(v), r * std::sin(u)));
+            }
+        }
+        for (uint32_t i = 0; i < segments; i++)
+            for (uint32_t j = 0; j < sides; j++)
+            {
+                uint32_t a = i * sides + j;
+                uint32_t b = ((i + 1) % segments) * sides + j;
+                uint32_t c = ((i + 1) % segments) * sides + (j + 1) % sides;
+                uint32_t d = i * sides + (j + 1) % sides;
+                mesh.triangles.push_back(glm::uvec3(a, d, c));
+                mesh.triangles.push_back(glm::uvec3(a, c, b));
+            }
+        return mesh;
+    }
+
+    SDFPipelineMesh MakeBox(const glm::vec3& half, int resolution)
+    {
+        SDFPipelineMesh mesh;
+        mesh.resolution = resolution;
+        for (int c = 0; c < 8; c++)
+            mesh.positions.push_back(glm::vec3((c & 1) ? half.x : -half.x, (c & 2) ? half.y : -half.y, (c & 4) ? half.z : -half.z));
+        const uint32_t faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+        for (const auto& f : faces)
+        {
+            mesh.triangles.push_back(glm::uvec3(f[0], f[1], f[2]));
+            mesh.triangles.push_back(glm::uvec3(f[0], f[2], f[3]));
+        }
+        return mesh;
+    }
+
+    //Uniform scale, rotation about y, then translation.
+    glm::mat4 MakeModel(const glm::vec3& position, float angle, float scale)
+    {
+        float c = std::cos(angle) * scale;
+        float s = std::sin(angle) * scale;
+        glm::mat4 m(1.0f);
+        m[0] = glm::vec4(c, 0.0f, -s, 0.0f);
+        m[1] = glm::vec4(0.0f, scale, 0.0f, 0.0f);
+        m[2] = glm::vec4(s, 0.0f, c, 0.0f);
+        m[3] = glm::vec4(position, 1.0f);
+        return m;
+    }
+
+    //Ericson, Real-Time Collision Detection 5.1.5.
+    glm::vec3 ClosestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        glm::vec3 ab = b - a;
+        glm::vec3 ac = c - a;
+        glm::vec3 ap = p - a;
+        float d1 = glm::dot(ab, ap);
+        float d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+            return a;
+
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp);
+        float d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+            return b;
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            return a + ab * (d1 / (d1 - d3));
+
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp);
+        float d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+            return c;
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            return a + ac * (d2 / (d2 - d6));
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+        float denom = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    SDFAABB MeshBounds(const SDFPipelineMesh& mesh)
+    {
+        SDFAABB bounds;
+        for (const glm::vec3& p : mesh.positions)
+            bounds.Expand(p);
+        bounds.min -= glm::vec3(mesh.padding);
+        bounds.max += glm::vec3(mesh.padding);
+        return bounds;
+    }
+
+    template<typename T>
+    uint64_t HashVector(const std::vector<T>& v, uint64_t hash = 14695981039346656037ull)
+    {
+        return v.empty() ? hash : SDFHashBytes(v.data(), v.size() * sizeof(T), hash);
+    }
+
+    template<typename T>
+    size_t VectorBytes(const std::vector<T>& v)
+    {
+        return v.size() * sizeof(T);
+    }
+
+    //Godunov upwind solve of |grad u| = 1 / h from the smaller neighbour per axis, like FSMUpdate.
+    float SolveEikonal(float a, float b, float c, float h)
+    {
+        if (a > b) std::swap(a, b);
+        if (b > c) std::swap(b, c);
+        if (a > b) std::swap(a, b);
+
+        float u = a + h;
+        if (u > b)
+        {
+            float tmp = 2.0f * h * h - (a - b) * (a - b);
+            if (tmp > 0.0f)
+            {
+                u = (a + b + std::sqrt(tmp)) * 0.5f;
+                if (u > c)
+                {
+                    tmp = 3.0f * h * h - (a - b) * (a - b) - (b - c) * (b - c) - (c - a) * (c - a);
+                    if (tmp > 0.0f)
+                        u = (a + b + c + std::sqrt(tmp)) * (1.0f / 3.0f);
+                }
+            }
+        }
+        return u;
+    }
+}
+
+const char* SDFPipelineStageName(SDFPipelineStage stage)
+{
+    switch (stage)
+    {
+    case SDFPipelineStage::CreateBrushes: return "CreateBrushes";
+    case SDFPipelineStage::TileBinning: return "TileBinning";
+    case SDFPipelineStage::WriteWorldSDF: return "WriteToWorldSDF";
+    case SDFPipelineStage::EikonalSweeps: return "EikonalSweeps";
+    case SDFPipelineStage::Labeling: return "Labeling";
+    case SDFPipelineStage::Meshing: return "Meshing";
+    default: return "Unknown";
+    }
+}
+
+SDFPipelineScene SDFPipelineScene::Canned(SDFPipelineSceneKind kind, int size, uint32_t seed)
+{
+    size = std::max(size, 1);
+
+    SDFPipelineScene scene;
+    const char* names[] = { "spheres", "meshes", "mixed" };
+    scene.name = std::string(names[uint32_t(kind) % 3]) + "-" + std::to_string(size);
+    scene.grid.resolution = glm::ivec3(32 * size);
+    scene.grid.sceneSize = glm::vec3(16.0f);
+
+    if (kind != SDFPipelineSceneKind::Spheres)
+    {
+        int cook = std::min(16 * size, 64);
+        scene.meshes.push_back(MakeTorus(0.7f, 0.3f, 24, 12, cook));
+        scene.meshes.push_back(MakeBox(glm::vec3(0.8f, 0.5f, 0.6f), cook));
+    }
+
+    PipelineRng rng(seed);
+    uint32_t brushCount = uint32_t(12 * size * size);
+    float reach = scene.grid.sceneSize.x * 0.5f - 2.0f;
+    for (uint32_t i = 0; i < brushCount; i++)
+    {
+        SDFPipelineBrush brush;
+        if (kind == SDFPipelineSceneKind::Meshes || (kind == SDFPipelineSceneKind::Mixed && (i % 3) != 0))
+            brush.mesh = rng.Next() % uint32_t(scene.meshes.size());
+        if (kind == SDFPipelineSceneKind::Mixed && (i % 5) == 4)
+            brush.op = SDFBrushOp::Subtraction;
+
+        glm::vec3 position(rng.Uniform(-reach, reach), rng.Uniform(-reach, reach), rng.Uniform(-reach, reach));
+        float angle = rng.Uniform(0.0f, 6.28318531f);
+        float scale = brush.op == SDFBrushOp::Subtraction ? rng.Uniform(0.3f, 0.6f) : rng.Uniform(0.6f, 1.6f);
+        brush.blend = rng.Uniform(0.02f, 0.3f);
+        brush.model = MakeModel(position, angle, scale);
+        scene.brushes.push_back(brush);
+    }
+    return scene;
+}
+
+void SDFCookMeshVolume(const SDFPipelineMesh& mesh, const SDFAABB& bounds, CSGVolume& out, uint32_t maxThreads)
+{
+    int res = std::max(mesh.resolution, 1);
+    glm::ivec3 resolution(res);
+    out.resolution = res;
+    out.values.assign(size_t(res) * res * res, SDF_EMPTY_SPACE);
+
+    //The winding number BVH settles inside/outside, the distance comes from the closest triangle.
+    SDFWindingNumber winding;
+    winding.Build(mesh.positions, mesh.triangles);
+    std::vector<uint8_t> inside;
+    winding.ClassifyGrid(bounds, resolution, inside);
+
+    //Triangle boxes let most closest point tests be skipped once a near triangle is known.
+    std::vector<SDFAABB> triangleBounds(mesh.triangles.size());
+    for (size_t t = 0; t < mesh.triangles.size(); t++)
+    {
+        triangleBounds[t].Expand(mesh.positions[mesh.triangles[t].x]);
+        triangleBounds[t].Expand(mesh.positions[mesh.triangles[t].y]);
+        triangleBounds[t].Expand(mesh.positions[mesh.triangles[t].z]);
+    }
+
+    glm::vec3 voxelSize = bounds.Extent() / glm::vec3(resolution);
+    UnigmaParallelForRange(uint32_t(res * res), 4, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t row = begin; row < end; row++)
+        {
+            int y = int(row) % res;
+            int z = int(row) / res;
+            for (int x = 0; x < res; x++)
+            {
+                glm::vec3 p = bounds.min + (glm::vec3(x, y, z) + 0.5f) * voxelSize;
+                float best = std::numeric_limits<float>::max();
+                for (size_t i = 0; i < mesh.triangles.size(); i++)
+                {
+                    glm::vec3 outside = glm::max(glm::max(triangleBounds[i].min - p, p - triangleBounds[i].max), glm::vec3(0.0f));
+                    if (glm::dot(outside, outside) >= best)
+                        continue;
+                    const glm::uvec3& t = mesh.triangles[i];
+                    glm::vec3 d = p - ClosestPointOnTriangle(p, mesh.positions[t.x], mesh.positions[t.y], mesh.positions[t.z]);
+                    best = std::min(best, glm::dot(d, d));
+                }
+                size_t index = size_t(x) + size_t(y) * res + size_t(z) * res * res;
+                float dist = std::sqrt(best);
+                out.values[index] = inside[index] ? -dist : dist;
+            }
+        }
+    }, maxThreads);
+
+    out.BuildBounds();
+}
+
+void SDFEikonalSweeps(const SDFGridDesc& grid, std::vector<float>& distance, int iterations, float maxDistance, uint32_t maxThreads)
+{
+    glm::ivec3 res = grid.resolution;
+    if (distance.size() != grid.VoxelCount() || grid.VoxelCount() == 0)
+        return;
+
+    float h = grid.VoxelSize().x;
+    auto at = [&](int x, int y, int z) { return size_t(x) + size_t(y) * res.x + size_t(z) * size_t(res.x) * res.y; };
+
+    //Voxels with a 6 neighbour of the other sign hold the interface and stay fixed, everything else starts at the cap.
+    std::vector<float> solved(distance.size());
+    std::vector<uint8_t> frozen(distance.size(), 0);
+    UnigmaParallelForRange(uint32_t(res.z), 1, [&](uint32_t begin, uint32_t end) {
+        for (int z = int(begin); z < int(end); z++)
+            for (int y = 0; y < res.y; y++)
+                for (int x = 0; x < res.x; x++)
+                {
+                    size_t i = at(x, y, z);
+                    bool negative = distance[i] < 0.0f;
+                    bool edge =
+                        (x > 0 && (distance[at(x - 1, y, z)] < 0.0f) != negative) || (x + 1 < res.x && (distance[at(x + 1, y, z)] < 0.0f) != negative) ||
+                        (y > 0 && (distance[at(x, y - 1, z)] < 0.0f) != negative) || (y + 1 < res.y && (distance[at(x, y + 1, z)] < 0.0f) != negative) ||
+                        (z > 0 && (distance[at(x, y, z - 1)] < 0.0f) != negative) || (z + 1 < res.z && (distance[at(x, y, z + 1)] < 0.0f) != negative);
+                    frozen[i] = edge ? 1 : 0;
+                    solved[i] = edge ? std::min(std::abs(distance[i]), maxDistance) : maxDistance;
+                }
+    }, maxThreads);
+
+    //Within one sweep a voxel reads its upwind neighbours from the previous diagonal plane and its downwind ones from
+    //the next, exactly what the sequential loop sees, so the planes can go one after another with each spread out.
+    int planes = res.x + res.y + res.z - 2;
+    for (int iteration = 0; iteration < iterations; iteration++)
+        for (int sweep = 0; sweep < 8; sweep++)
+        {
+            bool fx = (sweep & 1) != 0;
+            bool fy = (sweep & 2) != 0;
+            bool fz = (sweep & 4) != 0;
+            for (int plane = 0; plane < planes; plane++)
+            {
+                int z0 = std::max(0, plane - (res.x - 1) - (res.y - 1));
+                int z1 = std::min(res.z - 1, plane);
+                UnigmaParallelForRange(uint32_t(z1 - z0 + 1), 8, [&](uint32_t begin, uint32_t end) {
+                    for (int sz = z0 + int(begin); sz < z0 + int(end); sz++)
+                    {
+                        int y0 = std::max(0, plane - sz - (res.x - 1));
+                        int y1 = std::min(res.y - 1, plane - sz);
+                        for (int sy = y0; sy <= y1; sy++)
+                        {
+                            int sx = plane - sz - sy;
+                            int x = fx ? res.x - 1 - sx : sx;
+                            int y = fy ? res.y - 1 - sy : sy;
+                            int z = fz ? res.z - 1 - sz : sz;
+                            size_t i = at(x, y, z);
+                            if (frozen[i])
+                                continue;
+
+                            float a = std::min(x > 0 ? solved[at(x - 1, y, z)] : maxDistance, x + 1 < res.x ? solved[at(x + 1, y, z)] : maxDistance);
+                            float b = std::min(y > 0 ? solved[at(x, y - 1, z)] : maxDistance, y + 1 < res.y ? solved[at(x, y + 1, z)] : maxDistance);
+                            float c = std::min(z > 0 ? solved[at(x, y, z - 1)] : maxDistance, z + 1 < res.z ? solved[at(x, y, z + 1)] : maxDistance);
+                            solved[i] = std::min(solved[i], std::min(SolveEikonal(a, b, c, h), maxDistance));
+                        }
+                    }
+                }, maxThreads);
+            }
+        }
+
+    for (size_t i = 0; i < distance.size(); i++)
+        distance[i] = distance[i] < 0.0f ? -solved[i] : solved[i];
+}
+
+uint32_t SDFLabelComponents(const SDFGridDesc& grid, const std::vector<float>& distance, float threshold,
+    std::vector<uint32_t>& outLabels, uint32_t maxThreads)
+{
+    glm::ivec3 res = grid.resolution;
+    size_t count = grid.VoxelCount();
+    outLabels.assign(count, SDF_PIPELINE_NO_LABEL);
+    if (distance.size() != count || count == 0)
+        return 0;
+
+    auto at = [&](int x, int y, int z) { return uint32_t(x + y * res.x + z * res.x * res.y); };
+    auto solid = [&](uint32_t i) { return distance[i] < threshold; };
+
+    //Union find where the root is always the smallest index of its set, so the final labels are unique per component
+    //and independent of the order unions happen in (what MergeLabels converges to with its atomic min).
+    std::vector<uint32_t>& parent = outLabels;
+    for (uint32_t i = 0; i < uint32_t(count); i++)
+        if (solid(i))
+            parent[i] = i;
+
+    auto find = [&](uint32_t i) {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+    auto unite = [&](uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a < b)
+            parent[b] = a;
+        else if (b < a)
+            parent[a] = b;
+    };
+
+    //The 13 neighbours before a voxel in scan order cover all 26 links once.
+    const int offsets[13][3] = {
+        { -1, 0, 0 },
+        { -1, -1, 0 }, { 0, -1, 0 }, { 1, -1, 0 },
+        { -1, -1, -1 }, { 0, -1, -1 }, { 1, -1, -1 },
+        { -1, 0, -1 }, { 0, 0, -1 }, { 1, 0, -1 },
+        { -1, 1, -1 }, { 0, 1, -1 }, { 1, 1, -1 }
+    };
+    auto link = [&](int x, int y, int z, int zMin) {
+        uint32_t i = at(x, y, z);
+        for (const auto& o : offsets)
+        {
+            int nx = x + o[0], ny = y + o[1], nz = z + o[2];
+            if (nx < 0 || ny < 0 || nz < zMin || nx >= res.x || ny >= res.y)
+                continue;
+            uint32_t n = at(nx, ny, nz);
+            if (solid(n))
+                unite(i, n);
+        }
+    };
+
+    //Slabs of z only touch their own voxels, so they run in parallel. The seams are joined afterwards in order.
+    const int slab = 8;
+    uint32_t slabCount = uint32_t((res.z + slab - 1) / slab);
+    UnigmaParallelFor(slabCount, 1, [&](uint32_t s) {
+        int zBegin = int(s) * slab;
+        int zEnd = std::min(zBegin + slab, res.z);
+        for (int z = zBegin; z < zEnd; z++)
+            for (int y = 0; y < res.y; y++)
+                for (int x = 0; x < res.x; x++)
+                    if (solid(at(x, y, z)))
+                        link(x, y, z, zBegin);
+    }, maxThreads);
+
+    for (uint32_t s = 1; s < slabCount; s++)
+    {
+        int z = int(s) * slab;
+        for (int y = 0; y < res.y; y++)
+            for (int x = 0; x < res.x; x++)
+                if (solid(at(x, y, z)))
+                    for (int dy = -1; dy <= 1; dy++)
+                        for (int dx = -1; dx <= 1; dx++)
+                        {
+                            int nx = x + dx, ny = y + dy;
+                            if (nx >= 0 && ny >= 0 && nx < res.x && ny < res.y && solid(at(nx, ny, z - 1)))
+                                unite(at(x, y, z), at(nx, ny, z - 1));
+                        }
+    }
+
+    //Parents always point to smaller indices, so one ascending pass flattens every chain (FlattenLabels).
+    uint32_t components = 0;
+    for (uint32_t i = 0; i < uint32_t(count); i++)
+    {
+        if (parent[i] == SDF_PIPELINE_NO_LABEL)
+            continue;
+        if (parent[i] == i)
+            components++;
+        else
+            parent[i] = parent[parent[i]];
+    }
+    return components;
+}
+
+void SDFExtractSurface(const SDFGridDesc& grid, const std::vector<float>& distance, std::vector<glm::vec3>& outVertices,
+    std::vector<glm::uvec3>& outTriangles, uint32_t maxThreads)
+{
+    outVertices.clear();
+    outTriangles.clear();
+    glm::ivec3 res = grid.resolution;
+    if (distance.size() != grid.VoxelCount() || res.x < 2 || res.y < 2 || res.z < 2)
+        return;
+
+    glm::ivec3 cells = res - 1;
+    auto at = [&](int x, int y, int z) { return size_t(x) + size_t(y) * res.x + size_t(z) * size_t(res.x) * res.y; };
+    auto cellAt = [&](int x, int y, int z) { return size_t(x) + size_t(y) * cells.x + size_t(z) * size_t(cells.x) * cells.y; };
+    auto cornerMask = [&](int x, int y, int z) {
+        uint32_t mask = 0;
+        for (int c = 0; c < 8; c++)
+            if (distance[at(x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1))] < 0.0f)
+                mask |= 1u << c;
+        return mask;
+    };
+
+    //FindActiveCellsWorld: count sign changing cells per layer, then give each its vertex index in grid order.
+    std::vector<uint32_t> layerCounts(cells.z, 0);
+    UnigmaParallelFor(uint32_t(cells.z), 1, [&](uint32_t z) {
+        uint32_t n = 0;
+        for (int y = 0; y < cells.y; y++)
+            for (int x = 0; x < cells.x; x++)
+            {
+                uint32_t mask = cornerMask(x, y, int(z));
+                n += (mask != 0 && mask != 0xFF) ? 1 : 0;
+            }
+        layerCounts[z] = n;
+    }, maxThreads);
+
+    std::vector<uint32_t> layerOffsets(cells.z, 0);
+    uint32_t total = 0;
+    for (int z = 0; z < cells.z; z++)
+    {
+        layerOffsets[z] = total;
+        total += layerCounts[z];
+    }
+
+    const int edges[12][2] = { { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+    glm::vec3 voxelSize = grid.VoxelSize();
+    std::vector<uint32_t> cellVertex(size_t(cells.x) * cells.y * cells.z, SDF_PIPELINE_NO_LABEL);
+    outVertices.resize(total);
+    UnigmaParallelFor(uint32_t(cells.z), 1, [&](uint32_t zu) {
+        int z = int(zu);
+        uint32_t next = layerOffsets[z];
+        for (int y = 0; y < cells.y; y++)
+            for (int x = 0; x < cells.x; x++)
+            {
+                uint32_t mask = cornerMask(x, y, z);
+                if (mask == 0 || mask == 0xFF)
+                    continue;
+
+                //Mass point of the edge crossings, a QEF free DualContour vertex.
+                glm::vec3 sum(0.0f);
+                int crossings = 0;
+                for (const auto& e : edges)
+                {
+                    if (((mask >> e[0]) & 1) == ((mask >> e[1]) & 1))
+                        continue;
+                    glm::vec3 p0(float(e[0] & 1), float((e[0] >> 1) & 1), float((e[0] >> 2) & 1));
+                    glm::vec3 p1(float(e[1] & 1), float((e[1] >> 1) & 1), float((e[1] >> 2) & 1));
+                    float d0 = distance[at(x + int(p0.x), y + int(p0.y), z + int(p0.z))];
+                    float d1 = distance[at(x + int(p1.x), y + int(p1.y), z + int(p1.z))];
+                    float t = d0 / (d0 - d1);
+                    sum += p0 + (p1 - p0) * t;
+                    crossings++;
+                }
+                cellVertex[cellAt(x, y, z)] = next;
+                outVertices[next++] = grid.VoxelCenter(glm::ivec3(x, y, z)) + sum / float(crossings) * voxelSize;
+            }
+    }, maxThreads);
+
+    //One quad per sign changing voxel edge joining the four cells around it, wound so it faces the positive side.
+    std::vector<std::vector<glm::uvec3>> layerTriangles(res.z);
+    UnigmaParallelFor(uint32_t(res.z), 1, [&](uint32_t zu) {
+        int z = int(zu);
+        std::vector<glm::uvec3>& tris = layerTriangles[z];
+        for (int y = 0; y < res.y; y++)
+            for (int x = 0; x < res.x; x++)
+            {
+                bool inside = distance[at(x, y, z)] < 0.0f;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    glm::ivec3 v(x, y, z);
+                    glm::ivec3 n = v;
+                    n[axis]++;
+                    if (n[axis] >= res[axis] || (distance[at(n.x, n.y, n.z)] < 0.0f) == inside)
+                        continue;
+
+                    int u = (axis + 1) % 3;
+                    int w = (axis + 2) % 3;
+                    if (v[u] < 1 || v[w] < 1 || v[u] > cells[u] - 1 || v[w] > cells[w] - 1)
+                        continue;
+
+                    glm::ivec3 c00 = v; c00[u] -= 1; c00[w] -= 1;
+                    glm::ivec3 c10 = v; c10[w] -= 1;
+                    glm::ivec3 c11 = v;
+                    glm::ivec3 c01 = v; c01[u] -= 1;
+                    uint32_t q[4] = { cellVertex[cellAt(c00.x, c00.y, c00.z)], cellVertex[cellAt(c10.x, c10.y, c10.z)],
+                        cellVertex[cellAt(c11.x, c11.y, c11.z)], cellVertex[cellAt(c01.x, c01.y, c01.z)] };
+                    if (inside)
+                    {
+                        tris.push_back(glm::uvec3(q[0], q[1], q[2]));
+                        tris.push_back(glm::uvec3(q[0], q[2], q[3]));
+                    }
+                    else
+                    {
+                        tris.push_back(glm::uvec3(q[0], q[2], q[1]));
+                        tris.push_back(glm::uvec3(q[0], q[3], q[2]));
+                    }
+                }
+            }
+    }, maxThreads);
+
+    size_t triangleCount = 0;
+    for (const auto& layer : layerTriangles)
+        triangleCount += layer.size();
+    outTriangles.reserve(triangleCount);
+    for (const auto& layer : layerTriangles)
+        outTriangles.insert(outTriangles.end(), layer.begin(), layer.end());
+}
+
+size_t SDFPeakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return size_t(counters.PeakWorkingSetSize);
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return size_t(usage.ru_maxrss);
+#else
+    return size_t(usage.ru_maxrss) * 1024; //Kilobytes on Linux.
+#endif
+#endif
+}
+
+void SDFRunPipeline(const SDFPipelineScene& scene, const SDFPipelineSettings& settings, SDFPipelineOutput& out)
+{
+    using Clock = std::chrono::steady_clock;
+    const SDFGridDesc& grid = scene.grid;
+    Clock::time_point start;
+    auto begin = [&]() { start = Clock::now(); };
+    auto end = [&](SDFPipelineStage stage, uint64_t hash, size_t bytes) {
+        SDFPipelineStageResult& r = out.stages[uint32_t(stage)];
+        r.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        r.hash = hash;
+        r.outputBytes = bytes;
+        r.peakResidentBytes = SDFPeakResidentBytes();
+    };
+
+    //CreateBrushes: every mesh is cooked once and shared by all brushes instancing it.
+    begin();
+    out.volumes.assign(scene.meshes.size(), CSGVolume());
+    std::vector<SDFAABB> meshBounds(scene.meshes.size());
+    uint64_t hash = 14695981039346656037ull;
+    size_t bytes = 0;
+    for (size_t m = 0; m < scene.meshes.size(); m++)
+    {
+        meshBounds[m] = MeshBounds(scene.meshes[m]);
+        SDFCookMeshVolume(scene.meshes[m], meshBounds[m], out.volumes[m], settings.maxThreads);
+        hash = HashVector(out.volumes[m].values, hash);
+        bytes += VectorBytes(out.volumes[m].values) + VectorBytes(out.volumes[m].brickMin) + VectorBytes(out.volumes[m].brickMax);
+    }
+
+    std::vector<CSGBrush> brushes(scene.brushes.size());
+    std::vector<SDFAABB> brushBounds(scene.brushes.size());
+    for (size_t i = 0; i < scene.brushes.size(); i++)
+    {
+        const SDFPipelineBrush& in = scene.brushes[i];
+        CSGBrush& b = brushes[i];
+        b.op = in.op;
+        b.blend = in.blend;
+        b.model = in.model;
+        b.invModel = glm::inverse(in.model);
+        if (in.mesh == SDFPipelineBrush::SPHERE || in.mesh >= scene.meshes.size())
+        {
+            //Room for the blend past the unit surface.
+            b.primitive = CSGPrimitive::Sphere;
+            b.aabbMin = glm::vec3(-1.25f);
+            b.aabbMax = glm::vec3(1.25f);
+        }
+        else
+        {
+            b.primitive = CSGPrimitive::Volume;
+            b.aabbMin = meshBounds[in.mesh].min;
+            b.aabbMax = meshBounds[in.mesh].max;
+            b.volume = &out.volumes[in.mesh];
+        }
+        b.worldBounds = TransformAABB(SDFAABB(b.aabbMin, b.aabbMax), b.model);
+        brushBounds[i] = b.worldBounds;
+    }
+    end(SDFPipelineStage::CreateBrushes, hash, bytes);
+
+    //Tile binning (DispatchTile).
+    begin();
+    BinBrushesToTiles(SDFTileGrid(grid, scene.tileSize), brushBounds, out.bins);
+    hash = HashVector(out.bins.offsets);
+    hash = HashVector(out.bins.counts, hash);
+    hash = HashVector(out.bins.brushIndices, hash);
+    end(SDFPipelineStage::TileBinning, hash, VectorBytes(out.bins.offsets) + VectorBytes(out.bins.counts) + VectorBytes(out.bins.brushIndices));
+
+    //WriteToWorldSDF.
+    begin();
+    out.world.assign(grid.VoxelCount(), SDF_EMPTY_SPACE);
+    {
+        CSGProgram program;
+        program.Compile(brushes, grid, scene.tileSize);
+        program.EvaluateGrid(out.world.data());
+    }
+    end(SDFPipelineStage::WriteWorldSDF, HashVector(out.world), VectorBytes(out.world));
+
+    //Eikonal sweeps.
+    begin();
+    out.distance = out.world;
+    float cap = settings.eikonalMaxVoxels > 0.0f ? settings.eikonalMaxVoxels * grid.VoxelSize().x : SDF_EMPTY_SPACE;
+    SDFEikonalSweeps(grid, out.distance, settings.eikonalIterations, cap, settings.maxThreads);
+    end(SDFPipelineStage::EikonalSweeps, HashVector(out.distance), VectorBytes(out.distance));
+
+    //Labeling.
+    begin();
+    out.componentCount = SDFLabelComponents(grid, out.distance, settings.labelThreshold, out.labels, settings.maxThreads);
+    hash = HashVector(out.labels);
+    hash = SDFHashBytes(&out.componentCount, sizeof(out.componentCount), hash);
+    end(SDFPipelineStage::Labeling, hash, VectorBytes(out.labels));
+
+    //Meshing.
+    begin();
+    SDFExtractSurface(grid, out.distance, out.vertices, out.triangles, settings.maxThreads);
+    hash = HashVector(out.vertices);
+    hash = HashVector(out.triangles, hash);
+    end(SDFPipelineStage::Meshing, hash, VectorBytes(out.vertices) + VectorBytes(out.triangles));
+}
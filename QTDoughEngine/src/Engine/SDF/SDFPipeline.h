@@ -0,0 +1,123 @@
+#pragma once
+#include "SDFCSG.h"
+#include <string>
+
+//Headless CPU run of the voxelizer pipeline, for benchmarks and regression gates away from Vulkan.
+//The stages follow the compute passes in order: CreateBrushes cooks every mesh brush into a volume, the tile pass bins
+//brush bounds, WriteToWorldSDF folds the binned brushes into the world grid (SDFCSG), the eikonal sweeps redistance it,
+//labeling finds the connected solids and meshing extracts the surface. Every stage records a hash of its output, its
+//wall time and the memory it leaves behind, so two runs of one scene can be compared stage by stage.
+//All stages are parallel but their outputs do not depend on the thread count. Hashes are over raw float bits, so
+//goldens hold per compiler and platform, not across them.
+
+enum class SDFPipelineStage : uint32_t
+{
+    CreateBrushes = 0,
+    TileBinning,
+    WriteWorldSDF,
+    EikonalSweeps,
+    Labeling,
+    Meshing,
+    Count
+};
+
+const char* SDFPipelineStageName(SDFPipelineStage stage);
+
+enum class SDFPipelineSceneKind : uint32_t
+{
+    Spheres = 0, //Analytic sphere brushes only, mostly unions.
+    Meshes = 1, //Instances of a few cooked meshes (torus, box), shared like SDFBrushPool shares them.
+    Mixed = 2 //Both, with subtractions carved through.
+};
+
+//Local space triangle mesh a brush is cooked from. Triangles wind counter clockwise seen from outside.
+struct SDFPipelineMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::uvec3> triangles;
+    int resolution = 32; //Cooked volume edge.
+    float padding = 0.1f; //Added around the mesh bounds so the cooked field reaches past the surface.
+};
+
+struct SDFPipelineBrush
+{
+    static const uint32_t SPHERE = 0xFFFFFFFFu;
+
+    uint32_t mesh = SPHERE; //Index into SDFPipelineScene::meshes, or SPHERE for the analytic primitive.
+    SDFBrushOp op = SDFBrushOp::Union;
+    float blend = 0.0225f;
+    glm::mat4 model = glm::mat4(1.0f);
+};
+
+struct SDFPipelineScene
+{
+    std::string name;
+    SDFGridDesc grid;
+    int tileSize = 8; //VoxelizerPass::TILE_SIZE.
+    std::vector<SDFPipelineMesh> meshes;
+    std::vector<SDFPipelineBrush> brushes;
+
+    //Canned scene of the given kind. size scales everything: the grid is 32 * size voxels per edge, brush count and
+    //cook resolution grow with it. The same kind, size and seed always give the same scene.
+    static SDFPipelineScene Canned(SDFPipelineSceneKind kind, int size, uint32_t seed = 1);
+};
+
+struct SDFPipelineSettings
+{
+    int eikonalIterations = 2; //Rounds of the 8 sweep directions, as PerformEikonalSweeps.
+    float eikonalMaxVoxels = 4.0f; //Distances are capped at this many voxels like FSMUpdate. 0 caps at SDF_EMPTY_SPACE.
+    float labelThreshold = 0.1f; //Voxels below this distance are solid for labeling (InitLabels).
+    uint32_t maxThreads = 0; //0 uses every core.
+};
+
+struct SDFPipelineStageResult
+{
+    uint64_t hash = 0;
+    double milliseconds = 0.0;
+    size_t outputBytes = 0; //Size of what the stage produced.
+    size_t peakResidentBytes = 0; //Process high-water mark when the stage finished, 0 where the platform cannot tell.
+};
+
+#define SDF_PIPELINE_NO_LABEL 0xFFFFFFFFu
+
+struct SDFPipelineOutput
+{
+    std::vector<CSGVolume> volumes; //One per scene mesh.
+    SDFTileBins bins;
+    std::vector<float> world; //WriteToWorldSDF result, x fastest.
+    std::vector<float> distance; //After the eikonal sweeps.
+    std::vector<uint32_t> labels; //Smallest voxel index of the component, SDF_PIPELINE_NO_LABEL for empty voxels.
+    uint32_t componentCount = 0;
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::uvec3> triangles;
+
+    SDFPipelineStageResult stages[uint32_t(SDFPipelineStage::Count)];
+
+    const SDFPipelineStageResult& Stage(SDFPipelineStage stage) const { return stages[uint32_t(stage)]; }
+};
+
+//Runs every stage of scene into out.
+void SDFRunPipeline(const SDFPipelineScene& scene, const SDFPipelineSettings& settings, SDFPipelineOutput& out);
+
+//The stages on their own.
+
+//Cooks the signed distance of mesh over bounds into out: exact distance to the nearest triangle, signed by the
+//generalized winding number so slightly open meshes still cook solid.
+void SDFCookMeshVolume(const SDFPipelineMesh& mesh, const SDFAABB& bounds, CSGVolume& out, uint32_t maxThreads = 0);
+
+//Fast sweeping redistance of a signed field in place. Voxels next to a sign change keep their value, the rest are
+//solved outwards with the Godunov update FSMUpdate uses, keeping their sign. Sweeps walk diagonal planes, which gives
+//the same result as the sequential sweep order while the voxels of one plane run in parallel.
+void SDFEikonalSweeps(const SDFGridDesc& grid, std::vector<float>& distance, int iterations, float maxDistance, uint32_t maxThreads = 0);
+
+//26-connected components of the voxels below threshold. Returns the component count.
+uint32_t SDFLabelComponents(const SDFGridDesc& grid, const std::vector<float>& distance, float threshold,
+    std::vector<uint32_t>& outLabels, uint32_t maxThreads = 0);
+
+//Surface nets over the voxel centres: one vertex per sign changing cell at the mean of its edge crossings, one quad
+//per sign changing voxel edge. Output order follows the grid, so it does not depend on the thread count.
+void SDFExtractSurface(const SDFGridDesc& grid, const std::vector<float>& distance, std::vector<glm::vec3>& outVertices,
+    std::vector<glm::uvec3>& outTriangles, uint32_t maxThreads = 0);
+
+//Peak resident set of this process in bytes, 0 if unknown.
+size_t SDFPeakResidentBytes();
@@ -0,0 +1,273 @@
+#pragma once
+//Voxel grid sampling shared by the CPU tools and the shaders. This one file compiles as C++ and as HLSL
+//(included from shaders as "../../Engine/SDF/SDFSampling.h"), so a query made on either side runs the same operations
+//in the same order and, with contraction off, returns the same bits. GCC fuses into FMAs by default when FMA is enabled,
+//so the .cpp files that compare bits turn it off with a pragma at the top (see SDFCSG.cpp).
+//Grids follow SDFGridDesc: centred on the origin, voxel i covers [i, i+1) * voxelSize - sceneSize/2, samples sit at the
+//voxel centres and the edge voxels clamp. Dimensions are per grid, nothing assumes the world SDF or material grid size.
+//
+//HLSL includers define the source type before the include and the read of one voxel anywhere after it:
+//  #define SDFSampleSource uint
+//  float SDFSampleLoad(SDFSampleSource source, SDFSampleGrid grid, int3 cell) { return Read3D(source, cell); }
+//On the C++ side the source is a flat x fastest float array.
+
+#ifdef __cplusplus
+#include "SDFCommon.h"
+#if defined(_M_X64) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+//HLSL spellings for the shared section below.
+namespace SDFSamplingHLSL
+{
+    using float3 = glm::vec3;
+    using int3 = glm::ivec3;
+    using glm::clamp;
+    using glm::floor;
+    using glm::length;
+    using glm::max;
+    using glm::min;
+
+    typedef SDFGridDesc SDFSampleGrid;
+    typedef const float* SDFSampleSource;
+
+    inline float SDFSampleLoad(SDFSampleSource source, const SDFSampleGrid& grid, int3 cell)
+    {
+        return source[grid.Flatten(cell)];
+    }
+
+#define SDF_SAMPLE_FN inline
+#else
+#ifndef SDF_EMPTY_SPACE
+#define SDF_EMPTY_SPACE 2.0f //DEFUALT_EMPTY_SPACE in ShaderHelpers.hlsl.
+#endif
+
+struct SDFSampleGrid
+{
+    int3 resolution;
+    float3 sceneSize;
+};
+
+float SDFSampleLoad(SDFSampleSource source, SDFSampleGrid grid, int3 cell);
+
+#define SDF_SAMPLE_FN
+#endif
+
+SDF_SAMPLE_FN SDFSampleGrid SDFMakeSampleGrid(int3 resolution, float3 sceneSize)
+{
+    SDFSampleGrid grid;
+    grid.resolution = resolution;
+    grid.sceneSize = sceneSize;
+    return grid;
+}
+
+//Continuous voxel coordinate of p, voxel centres land on i + 0.5.
+SDF_SAMPLE_FN float3 SDFSampleToVoxel(SDFSampleGrid grid, float3 p)
+{
+    float3 origin = -grid.sceneSize * 0.5f;
+    float3 voxelSize = grid.sceneSize / float3(grid.resolution);
+    return (p - origin) / voxelSize;
+}
+
+//The voxel holding p, clamped to the grid (WorldToGridCoord).
+SDF_SAMPLE_FN int3 SDFSampleCell(SDFSampleGrid grid, float3 p)
+{
+    int3 cell = int3(floor(SDFSampleToVoxel(grid, p)));
+    return clamp(cell, int3(0, 0, 0), grid.resolution - 1);
+}
+
+//p in [-sceneSize/2, sceneSize/2).
+SDF_SAMPLE_FN bool SDFSampleInside(SDFSampleGrid grid, float3 p)
+{
+    float3 halfScene = grid.sceneSize * 0.5f;
+    return p.x >= -halfScene.x && p.y >= -halfScene.y && p.z >= -halfScene.z &&
+        p.x < halfScene.x && p.y < halfScene.y && p.z < halfScene.z;
+}
+
+SDF_SAMPLE_FN int SDFSampleIndex(SDFSampleGrid grid, int3 cell)
+{
+    return cell.x + cell.y * grid.resolution.x + cell.z * grid.resolution.x * grid.resolution.y;
+}
+
+//a + (b - a) * t spelled out: lerp and glm::mix are free to round differently.
+SDF_SAMPLE_FN float SDFSampleLerp(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+//Trilinear value at p. More than half a voxel outside the grid is empty space; rays clipped to the grid start exactly
+//on its faces, where rounding can land either side.
+SDF_SAMPLE_FN float SDFSampleTrilinear(SDFSampleSource source, SDFSampleGrid grid, float3 p)
+{
+    float3 local = SDFSampleToVoxel(grid, p);
+    float3 res = float3(grid.resolution);
+    if (local.x < -0.5f || local.y < -0.5f || local.z < -0.5f || local.x > res.x + 0.5f || local.y > res.y + 0.5f || local.z > res.z + 0.5f)
+        return SDF_EMPTY_SPACE;
+
+    float3 t = local - 0.5f;
+    int3 p0 = int3(floor(t));
+    float3 f = t - float3(p0);
+    int3 p1 = clamp(p0 + 1, int3(0, 0, 0), grid.resolution - 1);
+    p0 = clamp(p0, int3(0, 0, 0), grid.resolution - 1);
+
+    float c00 = SDFSampleLerp(SDFSampleLoad(source, grid, int3(p0.x, p0.y, p0.z)), SDFSampleLoad(source, grid, int3(p1.x, p0.y, p0.z)), f.x);
+    float c10 = SDFSampleLerp(SDFSampleLoad(source, grid, int3(p0.x, p1.y, p0.z)), SDFSampleLoad(source, grid, int3(p1.x, p1.y, p0.z)), f.x);
+    float c01 = SDFSampleLerp(SDFSampleLoad(source, grid, int3(p0.x, p0.y, p1.z)), SDFSampleLoad(source, grid, int3(p1.x, p0.y, p1.z)), f.x);
+    float c11 = SDFSampleLerp(SDFSampleLoad(source, grid, int3(p0.x, p1.y, p1.z)), SDFSampleLoad(source, grid, int3(p1.x, p1.y, p1.z)), f.x);
+    return SDFSampleLerp(SDFSampleLerp(c00, c10, f.y), SDFSampleLerp(c01, c11, f.y), f.z);
+}
+
+//Gradient from the 4 taps p + k * eps with k the corners (1,-1,-1), (-1,-1,1), (-1,1,-1), (1,1,1) of a tetrahedron:
+//sum(k * f(p + k * eps)) = 4 * eps * grad for a linear field, so it costs 4 samples where central differences take 6.
+SDF_SAMPLE_FN float3 SDFSampleTetraGradient(SDFSampleSource source, SDFSampleGrid grid, float3 p, float eps)
+{
+    float d0 = SDFSampleTrilinear(source, grid, p + float3(eps, -eps, -eps));
+    float d1 = SDFSampleTrilinear(source, grid, p + float3(-eps, -eps, eps));
+    float d2 = SDFSampleTrilinear(source, grid, p + float3(-eps, eps, -eps));
+    float d3 = SDFSampleTrilinear(source, grid, p + float3(eps, eps, eps));
+    float3 g = float3(d0 - d1 - d2 + d3, -d0 - d1 + d2 + d3, -d0 + d1 - d2 + d3);
+    return g / (4.0f * eps);
+}
+
+//Unit normal from SDFSampleTetraGradient, zero where the field is flat.
+SDF_SAMPLE_FN float3 SDFSampleNormal(SDFSampleSource source, SDFSampleGrid grid, float3 p, float eps)
+{
+    float3 g = SDFSampleTetraGradient(source, grid, p, eps);
+    float len = length(g);
+    return len > 1e-5f ? g / len : float3(0.0f, 0.0f, 0.0f);
+}
+
+//Brush local position to the [0, 1] coordinates of its volume, from the bounds the volume was authored with.
+SDF_SAMPLE_FN float3 SDFBrushUVW(float3 local, float3 aabbMin, float3 aabbMax)
+{
+    return (local - aabbMin) / (aabbMax - aabbMin);
+}
+
+SDF_SAMPLE_FN bool SDFBrushUVWInside(float3 uvw)
+{
+    return uvw.x >= 0.0f && uvw.y >= 0.0f && uvw.z >= 0.0f && uvw.x <= 1.0f && uvw.y <= 1.0f && uvw.z <= 1.0f;
+}
+
+#ifdef __cplusplus
+#undef SDF_SAMPLE_FN
+}
+
+using SDFSamplingHLSL::SDFSampleGrid;
+using SDFSamplingHLSL::SDFSampleSource;
+using SDFSamplingHLSL::SDFMakeSampleGrid;
+using SDFSamplingHLSL::SDFSampleToVoxel;
+using SDFSamplingHLSL::SDFSampleCell;
+using SDFSamplingHLSL::SDFSampleInside;
+using SDFSamplingHLSL::SDFSampleIndex;
+using SDFSamplingHLSL::SDFSampleLerp;
+using SDFSamplingHLSL::SDFSampleTrilinear;
+using SDFSamplingHLSL::SDFSampleTetraGradient;
+using SDFSamplingHLSL::SDFSampleNormal;
+using SDFSamplingHLSL::SDFBrushUVW;
+using SDFSamplingHLSL::SDFBrushUVWInside;
+
+#ifdef __AVX2__
+//SDFSampleTrilinear on 8 points at once, one gather per trilinear corner. Every lane repeats the scalar operations, so
+//the results match it bit for bit. values must hold grid.VoxelCount() floats with every index within int range.
+struct SDFSampleGridAVX2
+{
+    const float* values;
+    __m256 originX, originY, originZ;
+    __m256 voxelX, voxelY, voxelZ;
+    __m256 highX, highY, highZ;
+    __m256i lastX, lastY, lastZ;
+    __m256i strideY, strideZ;
+
+    SDFSampleGridAVX2(const float* source, const SDFGridDesc& grid) : values(source)
+    {
+        glm::vec3 origin = -grid.sceneSize * 0.5f;
+        glm::vec3 voxel = grid.sceneSize / glm::vec3(grid.resolution);
+        glm::vec3 res(grid.resolution);
+        originX = _mm256_set1_ps(origin.x); originY = _mm256_set1_ps(origin.y); originZ = _mm256_set1_ps(origin.z);
+        voxelX = _mm256_set1_ps(voxel.x); voxelY = _mm256_set1_ps(voxel.y); voxelZ = _mm256_set1_ps(voxel.z);
+        highX = _mm256_set1_ps(res.x + 0.5f); highY = _mm256_set1_ps(res.y + 0.5f); highZ = _mm256_set1_ps(res.z + 0.5f);
+        lastX = _mm256_set1_epi32(grid.resolution.x - 1);
+        lastY = _mm256_set1_epi32(grid.resolution.y - 1);
+        lastZ = _mm256_set1_epi32(grid.resolution.z - 1);
+        strideY = _mm256_set1_epi32(grid.resolution.x);
+        strideZ = _mm256_set1_epi32(grid.resolution.x * grid.resolution.y);
+    }
+};
+
+inline __m256 SDFSampleTrilinearAVX2(const SDFSampleGridAVX2& g, __m256 px, __m256 py, __m256 pz)
+{
+    const __m256 low = _mm256_set1_ps(-0.5f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    auto lerp = [](__m256 a, __m256 b, __m256 f) { return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), f)); };
+    auto clampIndex = [&](__m256i i, __m256i last) { return _mm256_min_epi32(_mm256_max_epi32(i, zero), last); };
+
+    __m256 lx = _mm256_div_ps(_mm256_sub_ps(px, g.originX), g.voxelX);
+    __m256 ly = _mm256_div_ps(_mm256_sub_ps(py, g.originY), g.voxelY);
+    __m256 lz = _mm256_div_ps(_mm256_sub_ps(pz, g.originZ), g.voxelZ);
+    __m256 outside = _mm256_or_ps(
+        _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(lx, low, _CMP_LT_OQ), _mm256_cmp_ps(ly, low, _CMP_LT_OQ)), _mm256_cmp_ps(lz, low, _CMP_LT_OQ)),
+        _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(lx, g.highX, _CMP_GT_OQ), _mm256_cmp_ps(ly, g.highY, _CMP_GT_OQ)), _mm256_cmp_ps(lz, g.highZ, _CMP_GT_OQ)));
+
+    __m256 cx = _mm256_sub_ps(lx, half), cy = _mm256_sub_ps(ly, half), cz = _mm256_sub_ps(lz, half);
+    __m256 floorX = _mm256_floor_ps(cx), floorY = _mm256_floor_ps(cy), floorZ = _mm256_floor_ps(cz);
+    __m256 fx = _mm256_sub_ps(cx, floorX), fy = _mm256_sub_ps(cy, floorY), fz = _mm256_sub_ps(cz, floorZ);
+    __m256i x0 = _mm256_cvttps_epi32(floorX), y0 = _mm256_cvttps_epi32(floorY), z0 = _mm256_cvttps_epi32(floorZ);
+    __m256i x1 = clampIndex(_mm256_add_epi32(x0, one), g.lastX);
+    __m256i y1 = clampIndex(_mm256_add_epi32(y0, one), g.lastY);
+    __m256i z1 = clampIndex(_mm256_add_epi32(z0, one), g.lastZ);
+    x0 = clampIndex(x0, g.lastX);
+    y0 = clampIndex(y0, g.lastY);
+    z0 = clampIndex(z0, g.lastZ);
+
+    //Lanes outside the grid still gather, from clamped indices, and are replaced by empty space below.
+    __m256i row00 = _mm256_add_epi32(_mm256_mullo_epi32(y0, g.strideY), _mm256_mullo_epi32(z0, g.strideZ));
+    __m256i row10 = _mm256_add_epi32(_mm256_mullo_epi32(y1, g.strideY), _mm256_mullo_epi32(z0, g.strideZ));
+    __m256i row01 = _mm256_add_epi32(_mm256_mullo_epi32(y0, g.strideY), _mm256_mullo_epi32(z1, g.strideZ));
+    __m256i row11 = _mm256_add_epi32(_mm256_mullo_epi32(y1, g.strideY), _mm256_mullo_epi32(z1, g.strideZ));
+    auto corner = [&](__m256i x, __m256i row) { return _mm256_i32gather_ps(g.values, _mm256_add_epi32(x, row), 4); };
+
+    __m256 c00 = lerp(corner(x0, row00), corner(x1, row00), fx);
+    __m256 c10 = lerp(corner(x0, row10), corner(x1, row10), fx);
+    __m256 c01 = lerp(corner(x0, row01), corner(x1, row01), fx);
+    __m256 c11 = lerp(corner(x0, row11), corner(x1, row11), fx);
+    return _mm256_blendv_ps(lerp(lerp(c00, c10, fy), lerp(c01, c11, fy), fz), _mm256_set1_ps(SDF_EMPTY_SPACE), outside);
+}
+#endif
+
+//SDFSampleTetraGradient for count points. With AVX2 two points share each 8 wide gather (their 4 taps side by side);
+//the results are the scalar ones either way.
+inline void SDFSampleTetraGradients(const float* values, const SDFGridDesc& grid, const glm::vec3* points, size_t count, float eps,
+    glm::vec3* outGradients)
+{
+    size_t i = 0;
+#ifdef __AVX2__
+    if (grid.VoxelCount() <= size_t(INT32_MAX))
+    {
+        SDFSampleGridAVX2 g(values, grid);
+        const __m256 kx = _mm256_setr_ps(eps, -eps, -eps, eps, eps, -eps, -eps, eps);
+        const __m256 ky = _mm256_setr_ps(-eps, -eps, eps, eps, -eps, -eps, eps, eps);
+        const __m256 kz = _mm256_setr_ps(-eps, eps, -eps, eps, -eps, eps, -eps, eps);
+        for (; i + 2 <= count; i += 2)
+        {
+            const glm::vec3& a = points[i];
+            const glm::vec3& b = points[i + 1];
+            __m256 px = _mm256_setr_ps(a.x, a.x, a.x, a.x, b.x, b.x, b.x, b.x);
+            __m256 py = _mm256_setr_ps(a.y, a.y, a.y, a.y, b.y, b.y, b.y, b.y);
+            __m256 pz = _mm256_setr_ps(a.z, a.z, a.z, a.z, b.z, b.z, b.z, b.z);
+            alignas(32) float d[8];
+            _mm256_store_ps(d, SDFSampleTrilinearAVX2(g, _mm256_add_ps(px, kx), _mm256_add_ps(py, ky), _mm256_add_ps(pz, kz)));
+            for (int k = 0; k < 2; k++)
+            {
+                const float* e = d + 4 * k;
+                glm::vec3 sum(e[0] - e[1] - e[2] + e[3], -e[0] - e[1] + e[2] + e[3], -e[0] + e[1] - e[2] + e[3]);
+                outGradients[i + k] = sum / (4.0f * eps);
+            }
+        }
+    }
+#endif
+    for (; i < count; i++)
+        outGradients[i] = SDFSampleTetraGradient(values, grid, points[i], eps);
+}
+#endif
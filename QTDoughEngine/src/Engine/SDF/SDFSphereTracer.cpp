@@ -0,0 +1,411 @@
+//Tiles have to render the same image as one ray at a time. Whether a multiply and add is fused into an FMA is decided
+//per inlined call site, so contraction is off for the whole file.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#include "SDFSphereTracer.h"
+#include "SDFPacketTracer.h"
+#include "SDFConeMarch.h"
+#include "SDFSampling.h"
+#include "../Core/UnigmaParallel.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdio>
+
+#if __has_include("stb_image_write.h")
+#include "stb_image_write.h"
+#define SDF_TRACE_PNG 1
+#endif
+
+namespace
+{
+    glm::vec3 Saturate(const glm::vec3& v) { return glm::clamp(v, glm::vec3(0.0f), glm::vec3(1.0f)); }
+
+    float SmoothStep(float edge0, float edge1, float x)
+    {
+        float t = glm::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+        return t * t * (3.0f - 2.0f * t);
+    }
+}
+
+SDFRay SDFTraceCamera::PixelRay(int x, int y, int width, int height) const
+{
+    return SDFCameraRays(*this).Pixel(x, y, width, height);
+}
+
+SDFRay SDFTraceCamera::RayAt(const glm::vec2& pixel, int width, int height) const
+{
+    return SDFCameraRays(*this).At(pixel, width, height);
+}
+
+SDFCameraRays::SDFCameraRays(const SDFTraceCamera& camera) :
+    invProj(glm::inverse(camera.proj)), invView(glm::inverse(camera.view)), isOrtho(camera.isOrtho),
+    eye(glm::vec3(invView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)))
+{
+}
+
+SDFRay SDFCameraRays::At(const glm::vec2& pixel, int width, int height) const
+{
+    glm::vec2 uv = pixel / glm::vec2(width, height) * 2.0f - 1.0f;
+    uv.y = -uv.y;
+    glm::vec4 viewPos = invProj * glm::vec4(uv.x, uv.y, 0.0f, 1.0f);
+
+    glm::vec3 perspectiveDir = glm::normalize(glm::vec3(invView * glm::vec4(glm::normalize(glm::vec3(viewPos)), 0.0f)));
+    //The blend below returns these unchanged, and ray setup is a fair share of a packet traced frame.
+    if (isOrtho == 0.0f)
+        return SDFRay(eye, perspectiveDir);
+    glm::vec3 orthoOrigin = glm::vec3(invView * glm::vec4(glm::vec3(viewPos), 1.0f));
+    glm::vec3 orthoDir = glm::normalize(glm::vec3(invView * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+
+    return SDFRay(glm::mix(eye, orthoOrigin, isOrtho), glm::mix(perspectiveDir, orthoDir, isOrtho));
+}
+
+SDFTraceCamera SDFTraceCamera::LookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up, float fovDegrees, float aspect)
+{
+    SDFTraceCamera camera;
+    camera.view = glm::lookAt(eye, target, up);
+    camera.proj = glm::perspective(glm::radians(fovDegrees), aspect, 0.1f, 1000.0f);
+    return camera;
+}
+
+std::vector<uint8_t> SDFTraceImage::ToRGBA8() const
+{
+    std::vector<uint8_t> bytes(pixels.size() * 4);
+    for (size_t i = 0; i < pixels.size(); i++)
+        for (int c = 0; c < 4; c++)
+            bytes[i * 4 + c] = (uint8_t)(glm::clamp(pixels[i][c], 0.0f, 1.0f) * 255.0f + 0.5f);
+    return bytes;
+}
+
+void SDFSphereTracer::SetField(const SDFGridDesc& gridDesc, const std::vector<float>* fieldValues)
+{
+    grid = gridDesc;
+    values = fieldValues;
+}
+
+void SDFSphereTracer::SetMaterialGrid(const SDFMaterialGrid* grid)
+{
+    material = grid;
+}
+
+void SDFSphereTracer::SetPyramid(const SDFMipPyramid* mipPyramid)
+{
+    pyramid = mipPyramid;
+}
+
+float SDFSphereTracer::Sample(const glm::vec3& p) const
+{
+    if (values == nullptr || values->size() != grid.VoxelCount())
+        return SDF_EMPTY_SPACE;
+    return SDFSampleTrilinear(values->data(), grid, p);
+}
+
+glm::vec3 SDFSphereTracer::Normal(const glm::vec3& p) const
+{
+    if (values == nullptr || values->size() != grid.VoxelCount())
+        return glm::vec3(0.0f);
+    return SDFSampleNormal(values->data(), grid, p, VoxelEdge());
+}
+
+void SDFSphereTracer::Normals(const glm::vec3* points, size_t count, glm::vec3* outNormals) const
+{
+    if (values == nullptr || values->size() != grid.VoxelCount())
+    {
+        std::fill(outNormals, outNormals + count, glm::vec3(0.0f));
+        return;
+    }
+    //SDFSampleNormal's normalisation over the batched gradients.
+    SDFSampleTetraGradients(values->data(), grid, points, count, VoxelEdge(), outNormals);
+    for (size_t i = 0; i < count; i++)
+    {
+        float len = glm::length(outNormals[i]);
+        outNormals[i] = len > 1e-5f ? outNormals[i] / len : glm::vec3(0.0f);
+    }
+}
+
+bool SDFSphereTracer::ClipToGrid(const SDFRay& ray, float& outEnter, float& outExit) const
+{
+    glm::vec3 invDir = 1.0f / ray.direction;
+    SDFAABB bounds(grid.Origin(), grid.Origin() + grid.sceneSize);
+    if (!RayAABB(ray, invDir, bounds, outEnter))
+        return false;
+    glm::vec3 t0 = (bounds.min - ray.origin) * invDir;
+    glm::vec3 t1 = (bounds.max - ray.origin) * invDir;
+    glm::vec3 tFar = glm::max(t0, t1);
+    outExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, ray.tMax));
+    return true;
+}
+
+bool SDFSphereTracer::March(const SDFRay& ray, float& t, float exit, int& steps, const SDFTraceSettings& settings) const
+{
+    float hitDistance = VoxelEdge() * settings.hitVoxels;
+    float minStep = VoxelEdge() * settings.minStepVoxels;
+    for (; steps < settings.maxSteps && t <= exit; steps++)
+    {
+        float d = Sample(ray.origin + ray.direction * t);
+        if (d < hitDistance)
+            return true;
+        t += std::max(d, minStep);
+    }
+    return false;
+}
+
+SDFTraceHit SDFSphereTracer::Trace(const SDFRay& ray, const SDFTraceSettings& settings, float tStart) const
+{
+    SDFTraceHit result;
+    float enter, exit;
+    if (values == nullptr || !ClipToGrid(ray, enter, exit))
+        return result;
+
+    float t = std::max(enter, tStart);
+    if (March(ray, t, exit, result.steps, settings))
+        Shade(ray, t, settings, result);
+    return result;
+}
+
+void SDFSphereTracer::Shade(const SDFRay& ray, float t, const SDFTraceSettings& settings, SDFTraceHit& hit) const
+{
+    hit.hit = true;
+    hit.t = t;
+    hit.position = ray.origin + ray.direction * t;
+    hit.normal = Normal(hit.position);
+    if (!settings.shadows)
+        return;
+
+    //Pushed out along the normal like FullMarch, then any hit before leaving the grid is a shadow.
+    float enter, exit;
+    SDFRay shadow = ShadowRay(hit, settings);
+    if (ClipToGrid(shadow, enter, exit) && March(shadow, enter, exit, hit.steps, settings))
+        hit.visibility = 0.0f;
+}
+
+SDFRay SDFSphereTracer::ShadowRay(const SDFTraceHit& hit, const SDFTraceSettings& settings) const
+{
+    return SDFRay(hit.position + hit.normal * VoxelEdge() * 4.0f, glm::normalize(settings.lightDirection));
+}
+
+float SDFSphereTracer::MarchMaterial(const SDFRay& ray, bool& outHit) const
+{
+    outHit = false;
+    if (material == nullptr || material->fieldValues.size() != size_t(material->resolution.x) * material->resolution.y * material->resolution.z)
+        return 0.0f;
+
+    glm::vec3 halfScene = material->sceneSize * 0.5f;
+    glm::vec3 cellSize = material->sceneSize / glm::vec3(material->resolution);
+    float minStep = std::min(cellSize.x, std::min(cellSize.y, cellSize.z)) * 0.1f;
+
+    //Outside the grid every sample is empty and adds no heat, so the walk starts at the first of the shader's sample
+    //points inside it.
+    glm::vec3 invDir = 1.0f / ray.direction;
+    glm::vec3 t0 = (-halfScene - ray.origin) * invDir;
+    glm::vec3 t1 = (halfScene - ray.origin) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+    if (enter > exit)
+        return 0.0f;
+
+    const int maxSteps = 10000;
+    int first = int(std::floor(enter / minStep));
+    int last = std::min(maxSteps - 1, int(std::ceil(exit / minStep)));
+    float heat = 0.0f;
+    for (int i = first; i <= last; i++)
+    {
+        glm::vec3 pos = ray.origin + ray.direction * (float(i) * minStep);
+        if (pos.x < -halfScene.x || pos.y < -halfScene.y || pos.z < -halfScene.z || pos.x >= halfScene.x || pos.y >= halfScene.y || pos.z >= halfScene.z)
+            continue;
+
+        glm::ivec3 coord = glm::clamp(glm::ivec3(glm::floor((pos + halfScene) / material->sceneSize * glm::vec3(material->resolution))),
+            glm::ivec3(0), material->resolution - 1);
+        const glm::vec4& cell = material->fieldValues[size_t(coord.x) + size_t(coord.y) * material->resolution.x +
+            size_t(coord.z) * material->resolution.x * material->resolution.y];
+        heat += cell.y * 0.1f;
+        if (cell.x < 0.01f)
+        {
+            outHit = true;
+            break;
+        }
+    }
+    return heat;
+}
+
+SDFTraceStats SDFSphereTracer::Render(const SDFTraceCamera& camera, const SDFTraceSettings& settings, int width, int height, SDFTraceImage& out) const
+{
+    out.width = std::max(width, 0);
+    out.height = std::max(height, 0);
+    out.pixels.assign(size_t(out.width) * out.height, glm::vec4(0.0f));
+
+    int tileSize = std::max(settings.tileSize, 1);
+    int tilesX = (out.width + tileSize - 1) / tileSize;
+    int tilesY = (out.height + tileSize - 1) / tileSize;
+    std::vector<SDFTraceStats> tileStats(size_t(tilesX) * tilesY);
+
+    //Pass material colours (main() in raymarchsdf_compute.hlsl).
+    const glm::vec3 front = glm::vec3(0.90f, 0.9f, 0.78f) * 1.0725f;
+    const glm::vec3 sides = glm::vec3(0.9f, 0.63f, 0.61f) * 1.0725f;
+    const glm::vec3 top = glm::vec3(1.0f, 0.92f, 0.928f) * 1.0725f;
+
+    auto shade = [&](const SDFTraceHit& hit, SDFTraceStats& stats) {
+        stats.steps += uint64_t(hit.steps);
+        stats.hits += hit.hit ? 1 : 0;
+        if (settings.mode == SDFTraceMode::Heat)
+            return glm::vec4(HeatRamp(float(hit.steps) / settings.heatSteps), 1.0f);
+        if (!hit.hit)
+            return glm::vec4(0.0f);
+        if (settings.mode == SDFTraceMode::Normal)
+            return glm::vec4(hit.normal * 0.5f + 0.5f, 1.0f);
+        if (settings.mode == SDFTraceMode::Depth)
+            return glm::vec4(glm::vec3(hit.t / settings.maxRenderDistance), 1.0f);
+        glm::vec3 w = glm::abs(hit.normal);
+        w /= w.x + w.y + w.z + 1e-6f;
+        glm::vec3 albedo = front * w.y + sides * w.x + top * w.z;
+        return glm::vec4(Saturate(albedo - (1.0f - hit.visibility) * 0.25f), 1.0f);
+    };
+
+    //Cone prepass over the coarse levels: one start depth per 8x8 tile, whatever the render tiles.
+    std::vector<float> coneStarts;
+    int coneTilesX = (out.width + SDF_CONE_TILE - 1) / SDF_CONE_TILE;
+    uint64_t coneSteps = 0;
+    bool cones = settings.conePrepass && pyramid != nullptr && values != nullptr && settings.mode != SDFTraceMode::MaterialHeat;
+    if (cones)
+        coneSteps = SDFConeStartDepths(*pyramid, camera, out.width, out.height, coneStarts).steps;
+    auto startOf = [&](int x, int y) { return cones ? coneStarts[size_t(y / SDF_CONE_TILE) * coneTilesX + x / SDF_CONE_TILE] : 0.0f; };
+
+    SDFCameraRays rays(camera);
+    SDFPacketTracer packetTracer(*this);
+    bool packets = settings.packets && settings.mode != SDFTraceMode::MaterialHeat;
+    UnigmaParallelFor(uint32_t(tileStats.size()), 1, [&](uint32_t tile) {
+        SDFTraceStats& stats = tileStats[tile];
+        int x0 = int(tile % uint32_t(tilesX)) * tileSize;
+        int y0 = int(tile / uint32_t(tilesX)) * tileSize;
+        int x1 = std::min(x0 + tileSize, out.width);
+        int y1 = std::min(y0 + tileSize, out.height);
+
+        if (packets)
+        {
+            //Tile rows in packets of 8 neighbouring pixels.
+            std::vector<SDFRay> tileRays;
+            std::vector<float> starts;
+            tileRays.reserve(size_t(x1 - x0) * (y1 - y0));
+            starts.reserve(tileRays.capacity());
+            for (int y = y0; y < y1; y++)
+                for (int x = x0; x < x1; x++)
+                {
+                    tileRays.push_back(rays.Pixel(x, y, out.width, out.height));
+                    starts.push_back(startOf(x, y));
+                }
+            std::vector<SDFTraceHit> hits(tileRays.size());
+            packetTracer.TraceRays(tileRays.data(), tileRays.size(), settings, hits.data(), starts.data());
+
+            size_t i = 0;
+            for (int y = y0; y < y1; y++)
+                for (int x = x0; x < x1; x++, i++)
+                    out.pixels[size_t(y) * out.width + x] = shade(hits[i], stats);
+            stats.rays += uint64_t(hits.size());
+            return;
+        }
+
+        for (int y = y0; y < y1; y++)
+            for (int x = x0; x < x1; x++)
+            {
+                SDFRay ray = rays.Pixel(x, y, out.width, out.height);
+                glm::vec4 colour;
+                stats.rays++;
+
+                if (settings.mode == SDFTraceMode::MaterialHeat)
+                {
+                    bool hit;
+                    colour = glm::vec4(StylizedHeat(MarchMaterial(ray, hit)), 1.0f);
+                    stats.hits += hit ? 1 : 0;
+                }
+                else
+                    colour = shade(Trace(ray, settings, startOf(x, y)), stats);
+                out.pixels[size_t(y) * out.width + x] = colour;
+            }
+    });
+
+    SDFTraceStats total;
+    total.coneSteps = coneSteps;
+    for (const SDFTraceStats& s : tileStats)
+    {
+        total.rays += s.rays;
+        total.hits += s.hits;
+        total.steps += s.steps;
+    }
+    return total;
+}
+
+glm::vec3 SDFSphereTracer::HeatRamp(float t)
+{
+    t = glm::clamp(t, 0.0f, 1.0f);
+    const glm::vec3 c0(0.0f, 0.0f, 0.0f);
+    const glm::vec3 c1(0.35f, 0.0f, 0.0f);
+    const glm::vec3 c2(1.0f, 0.0f, 0.0f);
+    const glm::vec3 c3(1.0f, 0.5f, 0.0f);
+    const glm::vec3 c4(1.0f, 1.0f, 0.0f);
+    const glm::vec3 c5(1.0f, 1.0f, 1.0f);
+    const glm::vec3 c6(0.7f, 0.85f, 1.0f);
+
+    if (t < 0.15f) return glm::mix(c0, c1, t / 0.15f);
+    if (t < 0.35f) return glm::mix(c1, c2, (t - 0.15f) / 0.20f);
+    if (t < 0.55f) return glm::mix(c2, c3, (t - 0.35f) / 0.20f);
+    if (t < 0.75f) return glm::mix(c3, c4, (t - 0.55f) / 0.20f);
+    if (t < 0.90f) return glm::mix(c4, c5, (t - 0.75f) / 0.15f);
+    return glm::mix(c5, c6, (t - 0.90f) / 0.10f);
+}
+
+glm::vec3 SDFSphereTracer::StylizedHeat(float t)
+{
+    t = glm::clamp(t * 0.01f, 0.0f, 1.0f);
+    const glm::vec3 highRed(2.0f, 1.90f, 1.0f);
+    const glm::vec3 midRed(1.0f, 0.9185f, 0.155f);
+    const glm::vec3 lowRed(1.0f, 0.125f, 0.05f);
+    const glm::vec3 borderline(0.75f, 0.125f, 0.1f);
+    const glm::vec3 shadow(0.0f, 0.0f, 0.0025f);
+
+    glm::vec3 c = glm::mix(midRed, highRed, SmoothStep(0.95f, 0.99f, t));
+    c = glm::mix(lowRed, c, SmoothStep(0.59f, 0.65f, t));
+    c = glm::mix(borderline, c, SmoothStep(0.3f, 0.35f, t));
+    c = glm::mix(shadow, c, SmoothStep(0.1f, 0.2f, t));
+    return c;
+}
+
+bool SDFWriteImage(const std::string& path, const SDFTraceImage& image)
+{
+    if (image.width <= 0 || image.height <= 0)
+        return false;
+
+    auto endsWith = [&](const char* ext) {
+        size_t n = std::char_traits<char>::length(ext);
+        return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+    };
+
+    std::vector<uint8_t> rgba = image.ToRGBA8();
+    if (endsWith(".png"))
+    {
+#ifdef SDF_TRACE_PNG
+        return stbi_write_png(path.c_str(), image.width, image.height, 4, rgba.data(), image.width * 4) != 0;
+#else
+        return false;
+#endif
+    }
+    if (!endsWith(".ppm"))
+        return false;
+
+    //Binary PPM: no alpha, no dependencies.
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    std::fprintf(file, "P6\n%d %d\n255\n", image.width, image.height);
+    std::vector<uint8_t> rgb(size_t(image.width) * image.height * 3);
+    for (size_t i = 0; i < size_t(image.width) * image.height; i++)
+        for (int c = 0; c < 3; c++)
+            rgb[i * 3 + c] = rgba[i * 4 + c];
+    bool ok = std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    return std::fclose(file) == 0 && ok;
+}
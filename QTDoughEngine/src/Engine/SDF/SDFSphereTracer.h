@@ -0,0 +1,151 @@
+#pragma once
+#include "SDFMipPyramid.h"
+#include <string>
+
+//CPU version of raymarchsdf_compute.hlsl for machines without a GPU: thumbnails, CI screenshots, previews of simulation
+//state. The world SDF is sphere traced like FullMarch (with its shadow ray), the material grid is walked with the fixed
+//steps of MaterialGridMarch, and the results are shown with the shader's visualizations. The image is split into
+//square tiles handed out across the cores; pixels do not share state, so the output does not depend on the thread count.
+
+enum class SDFTraceMode : uint32_t
+{
+    Albedo = 0, //The albedo target: normal weighted base/side/top colours, darkened in shadow.
+    Normal = 1, //World normal mapped to 0..1.
+    Depth = 2, //Hit distance over maxRenderDistance, as the normal target's w.
+    Heat = 3, //Steps taken through HeatRamp.
+    MaterialHeat = 4 //MaterialGridMarch heat through StylizedHeat, the material grid target.
+};
+
+//fieldValues of the MaterialGridPoints: x distance, y heat. Cells cover the scene like the world grid.
+struct SDFMaterialGrid
+{
+    glm::ivec3 resolution = glm::ivec3(256, 256, 64);
+    glm::vec3 sceneSize = glm::vec3(0.0f);
+    std::vector<glm::vec4> fieldValues;
+};
+
+//The UniformBufferObject the pass reads. isOrtho blends between the perspective and orthographic rays.
+struct SDFTraceCamera
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 proj = glm::mat4(1.0f);
+    float isOrtho = 0.0f;
+
+    //Ray through the centre of pixel, y down like the compute pass.
+    SDFRay PixelRay(int x, int y, int width, int height) const;
+    //Ray through any point of the image, in pixels from its top left corner.
+    SDFRay RayAt(const glm::vec2& pixel, int width, int height) const;
+
+    //Perspective camera for tools. Unlike UnigmaCamera the projection is not flipped for Vulkan, so images come out
+    //upright; matrices taken from the renderer's uniform buffer trace exactly what the compute pass traces.
+    static SDFTraceCamera LookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up, float fovDegrees, float aspect);
+};
+
+//A camera's rays with its inverses taken once, for code that builds many of them.
+struct SDFCameraRays
+{
+    glm::mat4 invProj;
+    glm::mat4 invView;
+    float isOrtho;
+    glm::vec3 eye; //Origin of every perspective ray.
+
+    explicit SDFCameraRays(const SDFTraceCamera& camera);
+
+    SDFRay Pixel(int x, int y, int width, int height) const { return At(glm::vec2(x, y) + 0.5f, width, height); }
+    SDFRay At(const glm::vec2& pixel, int width, int height) const;
+};
+
+struct SDFTraceSettings
+{
+    SDFTraceMode mode = SDFTraceMode::Albedo;
+    int maxSteps = 1024;
+    float hitVoxels = 0.05f; //Surface reached below this distance, in voxels (minDistReturn).
+    float minStepVoxels = 0.05f; //Smallest step, in voxels.
+    bool shadows = true; //FullMarch's second march towards the light.
+    glm::vec3 lightDirection = glm::vec3(-0.85f, 1.0f, 0.5f);
+    float heatSteps = 256.0f; //Step count that maps to the top of the heat ramp.
+    float maxRenderDistance = 64.0f;
+    int tileSize = 16; //Pixels per tile edge, the unit of parallel work.
+    bool packets = true; //Render traces the rays of a tile 8 at a time through SDFPacketTracer. Same image either way.
+    bool conePrepass = true; //Render starts rays at the SDFConeMarch depth of their tile when a pyramid is set.
+};
+
+struct SDFTraceHit
+{
+    bool hit = false;
+    float t = 0.0f;
+    int steps = 0;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 normal = glm::vec3(0.0f);
+    float visibility = 1.0f; //0 when the shadow ray is blocked.
+};
+
+struct SDFTraceStats
+{
+    uint64_t rays = 0;
+    uint64_t hits = 0;
+    uint64_t steps = 0; //Primary and shadow steps together.
+    uint64_t coneSteps = 0; //Cone prepass steps, one cone per 8x8 tile.
+};
+
+//Linear RGBA, row 0 at the top.
+struct SDFTraceImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec4> pixels;
+
+    //Clamped to 0..1 and rounded like the screenshot path.
+    std::vector<uint8_t> ToRGBA8() const;
+};
+
+class SDFSphereTracer
+{
+public:
+    //Neither is copied; both must outlive the tracer's use of them. Either may be left unset.
+    void SetField(const SDFGridDesc& grid, const std::vector<float>* values);
+    void SetMaterialGrid(const SDFMaterialGrid* grid);
+    //Min or Average pyramid of the field with at least 3 levels, for the cone prepass. Not copied either.
+    void SetPyramid(const SDFMipPyramid* pyramid);
+
+    //Trilinear over the voxel centres, clamped at the faces. SDF_EMPTY_SPACE from half a voxel outside the grid.
+    float Sample(const glm::vec3& p) const;
+    //Central differences one voxel wide.
+    glm::vec3 Normal(const glm::vec3& p) const;
+    //Normal for count points, two per 8 wide gather with AVX2. Same bits as Normal.
+    void Normals(const glm::vec3* points, size_t count, glm::vec3* outNormals) const;
+
+    //Sphere traces ray through the field from tStart, shadow ray included when settings ask for it.
+    SDFTraceHit Trace(const SDFRay& ray, const SDFTraceSettings& settings, float tStart = 0.0f) const;
+
+    //The pieces of Trace, for tracers that march rays their own way and must still agree with it.
+    //Ray span inside the grid, false when it misses.
+    bool ClipToGrid(const SDFRay& ray, float& outEnter, float& outExit) const;
+    //Marches from t towards exit, counting on from steps. True on a hit, with t at the hit.
+    bool March(const SDFRay& ray, float& t, float exit, int& steps, const SDFTraceSettings& settings) const;
+    //Fills hit for a surface reached at t, shadow ray included.
+    void Shade(const SDFRay& ray, float t, const SDFTraceSettings& settings, SDFTraceHit& hit) const;
+    SDFRay ShadowRay(const SDFTraceHit& hit, const SDFTraceSettings& settings) const;
+
+    const SDFGridDesc& Grid() const { return grid; }
+    const std::vector<float>* Values() const { return values; }
+    //Smallest voxel edge, the unit of the distance settings.
+    float VoxelEdge() const { glm::vec3 v = grid.VoxelSize(); return std::min(v.x, std::min(v.y, v.z)); }
+    //MaterialGridMarch: accumulated heat, and whether the walk reached a surface.
+    float MarchMaterial(const SDFRay& ray, bool& outHit) const;
+
+    SDFTraceStats Render(const SDFTraceCamera& camera, const SDFTraceSettings& settings, int width, int height, SDFTraceImage& out) const;
+
+    //The colour ramps of the compute pass.
+    static glm::vec3 HeatRamp(float t);
+    static glm::vec3 StylizedHeat(float t);
+
+private:
+    SDFGridDesc grid;
+    const std::vector<float>* values = nullptr;
+    const SDFMaterialGrid* material = nullptr;
+    const SDFMipPyramid* pyramid = nullptr;
+};
+
+//Writes .ppm always and .png when stb_image_write.h is on the include path. False on failure or unknown extension.
+bool SDFWriteImage(const std::string& path, const SDFTraceImage& image);
@@ -0,0 +1,121 @@
+#include "SDFTLASTracker.h"
+#include <cstring>
+
+static_assert(sizeof(SDFTLASInstance) == 64, "SDFTLASInstance must match VkAccelerationStructureInstanceKHR");
+
+SDFTLASInstance::SDFTLASInstance()
+{
+    std::memset(this, 0, sizeof(*this));
+    transform[0][0] = transform[1][1] = transform[2][2] = 1.0f;
+}
+
+bool SDFTLASInstance::operator==(const SDFTLASInstance& other) const
+{
+    //Bitwise: a record is unchanged only when the bytes the GPU reads are.
+    return std::memcmp(this, &other, sizeof(*this)) == 0;
+}
+
+float SDFTLASTracker::Motion(const SDFAABB& before, const SDFAABB& after, float sceneDiagonal)
+{
+    float moved = 0.5f * (glm::length(after.min - before.min) + glm::length(after.max - before.max));
+    if (moved <= 0.0f)
+        return 0.0f;
+    return sceneDiagonal > 0.0f ? moved / sceneDiagonal : std::numeric_limits<float>::max();
+}
+
+SDFTLASUpdate SDFTLASTracker::Update(const std::vector<SDFTLASSlot>& slots, SDFTLASBuilder& builder)
+{
+    stats.update = SDFTLASUpdate::None;
+    stats.changedSlots = 0;
+    stats.writtenRecords = 0;
+    stats.writeRanges = 0;
+    dirty.clear();
+
+    if (slots.empty())
+    {
+        //Nothing to build over; whatever comes next starts from scratch.
+        previous.clear();
+        valid = false;
+        return stats.update;
+    }
+
+    bool rebuild = !valid || slots.size() != previous.size();
+    float motion = 0.0f;
+    for (uint32_t i = 0; i < (uint32_t)slots.size(); i++)
+    {
+        const SDFTLASSlot& now = slots[i];
+        if (!valid || i >= previous.size())
+        {
+            dirty.push_back(i);
+            stats.changedSlots++;
+            continue;
+        }
+
+        const SDFTLASSlot& before = previous[i];
+        bool recordChanged = now.record != before.record;
+        bool moved = now.record.Active() && (now.bounds.min != before.bounds.min || now.bounds.max != before.bounds.max);
+        if (recordChanged)
+            dirty.push_back(i);
+        if (!recordChanged && !moved && now.geometryKey == before.geometryKey && !(now.blasRebuilt && now.record.Active()))
+            continue;
+
+        stats.changedSlots++;
+        if (now.record.Active() != before.record.Active())
+            rebuild = true;
+        else if (moved)
+            motion += Motion(before.bounds, now.bounds, sceneDiagonal);
+    }
+
+    if (stats.changedSlots == 0)
+        return stats.update;
+
+    WriteDirty(slots, builder);
+    stats.motion += motion;
+    if (rebuild || stats.motion >= rebuildMotion || stats.refitsSinceBuild >= maxRefits)
+        Build(slots, builder);
+    else
+    {
+        builder.Refit((uint32_t)slots.size());
+        stats.update = SDFTLASUpdate::Refit;
+        stats.refitsSinceBuild++;
+    }
+
+    previous = slots;
+    valid = true;
+    return stats.update;
+}
+
+void SDFTLASTracker::WriteDirty(const std::vector<SDFTLASSlot>& slots, SDFTLASBuilder& builder)
+{
+    //dirty is ascending. Runs closer than mergeGap clean records become one write, the clean records rewritten as is.
+    size_t i = 0;
+    while (i < dirty.size())
+    {
+        uint32_t first = dirty[i];
+        uint32_t last = first;
+        for (i++; i < dirty.size() && dirty[i] - last <= mergeGap + 1; i++)
+            last = dirty[i];
+
+        uint32_t count = last - first + 1;
+        staging.resize(count);
+        for (uint32_t k = 0; k < count; k++)
+            staging[k] = slots[first + k].record;
+        builder.WriteInstances(first, staging.data(), count);
+        stats.writtenRecords += count;
+        stats.writeRanges++;
+    }
+}
+
+void SDFTLASTracker::Build(const std::vector<SDFTLASSlot>& slots, SDFTLASBuilder& builder)
+{
+    builder.Build((uint32_t)slots.size());
+    stats.update = SDFTLASUpdate::Rebuild;
+    stats.motion = 0.0f;
+    stats.refitsSinceBuild = 0;
+
+    SDFAABB scene;
+    for (const SDFTLASSlot& slot : slots)
+        if (slot.record.Active())
+            scene.Expand(slot.bounds);
+    sceneDiagonal = scene.IsValid() ? glm::length(scene.Extent()) : 0.0f;
+}
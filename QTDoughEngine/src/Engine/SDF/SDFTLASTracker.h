@@ -0,0 +1,92 @@
+#pragma once
+#include "SDFCommon.h"
+
+//Keeps the top level acceleration structure in step with the brushes without rebuilding it every frame.
+//Every brush slot owns one instance record, inactive slots included (null BLAS reference), so records never shift when
+//a brush empties. Each frame the records and the world bounds of their geometry are diffed against the previous frame:
+//only changed records are written to the instance buffer, nothing at all happens when nothing changed, and changes
+//that keep the instance set intact are refit in place. Refits let the tree decay as instances drift from where the
+//build placed them, so the motion since the last build is accumulated and a full build is asked for once it is large
+//next to the scene. Nothing here touches Vulkan: the GPU work goes through SDFTLASBuilder, which tests can mock.
+
+//Same layout as VkAccelerationStructureInstanceKHR, so records copy straight into the instance buffer.
+struct SDFTLASInstance
+{
+    float transform[3][4];
+    uint32_t customIndex : 24;
+    uint32_t mask : 8;
+    uint32_t sbtOffset : 24;
+    uint32_t flags : 8;
+    uint64_t blasAddress; //0 makes the instance inactive.
+
+    //Identity transform, inactive.
+    SDFTLASInstance();
+    bool Active() const { return blasAddress != 0; }
+    bool operator==(const SDFTLASInstance& other) const;
+    bool operator!=(const SDFTLASInstance& other) const { return !(*this == other); }
+};
+
+struct SDFTLASSlot
+{
+    SDFTLASInstance record;
+    SDFAABB bounds; //World bounds of what the instance's BLAS holds. Ignored while inactive.
+    uint64_t geometryKey = 0; //Anything else that changes the BLAS content in place, e.g. its vertex count.
+    bool blasRebuilt = false; //The BLAS was built again this frame. Refits at least, even when nothing else changed.
+};
+
+enum class SDFTLASUpdate : uint32_t
+{
+    None = 0, //Nothing changed, the structure from the last frame stands.
+    Refit, //Same instances, new records or bounds: update in place.
+    Rebuild
+};
+
+//The GPU side. Calls arrive in order: the changed records, then at most one Build or Refit over all of them.
+class SDFTLASBuilder
+{
+public:
+    virtual ~SDFTLASBuilder() {}
+    virtual void WriteInstances(uint32_t first, const SDFTLASInstance* records, uint32_t count) = 0;
+    virtual void Build(uint32_t instanceCount) = 0;
+    virtual void Refit(uint32_t instanceCount) = 0;
+};
+
+struct SDFTLASStats
+{
+    SDFTLASUpdate update = SDFTLASUpdate::None;
+    uint32_t changedSlots = 0;
+    uint32_t writtenRecords = 0;
+    uint32_t writeRanges = 0;
+    float motion = 0.0f; //Accumulated since the last build, in scene diagonals.
+    uint32_t refitsSinceBuild = 0;
+};
+
+class SDFTLASTracker
+{
+public:
+    float rebuildMotion = 0.25f; //Accumulated motion, in diagonals of the scene at build time, that forces a build.
+    uint32_t maxRefits = 240; //Builds anyway after this many refits in a row.
+    uint32_t mergeGap = 4; //Clean records rewritten to join two dirty runs into one write.
+
+    //Diffs this frame's slots against the last call and drives the builder. The first call, a different slot count,
+    //an instance turning on or off, or Invalidate() build from scratch. Any other change, a rebuilt BLAS included,
+    //refits until rebuildMotion or maxRefits is reached.
+    SDFTLASUpdate Update(const std::vector<SDFTLASSlot>& slots, SDFTLASBuilder& builder);
+    //Forgets what the instance buffer and the structure hold, e.g. after either was recreated.
+    void Invalidate() { valid = false; }
+
+    const SDFTLASStats& Stats() const { return stats; }
+    //How far a box moved, the mean of its two corner displacements, over the scene diagonal.
+    static float Motion(const SDFAABB& before, const SDFAABB& after, float sceneDiagonal);
+
+private:
+    std::vector<SDFTLASSlot> previous;
+    std::vector<uint32_t> dirty; //Slots whose record has to be written.
+    std::vector<SDFTLASInstance> staging; //One write range, contiguous.
+    bool valid = false;
+    float sceneDiagonal = 0.0f; //At the last build.
+    SDFTLASStats stats;
+
+    void WriteDirty(const std::vector<SDFTLASSlot>& slots, SDFTLASBuilder& builder);
+    void Build(const std::vector<SDFTLASSlot>& slots, SDFTLASBuilder& builder);
+};
@@ -0,0 +1,225 @@
+#include "SDFTileBinning.h"
+#include "../Core/UnigmaParallel.h"
+
+SDFTileRange SDFTileGrid::RangeForBounds(const SDFAABB& bounds) const
+{
+    SDFTileRange r;
+    if (!bounds.IsValid())
+        return r;
+
+    glm::vec3 half = grid.sceneSize * 0.5f;
+    glm::vec3 tileWorld = TileWorldSize();
+    glm::ivec3 lo = glm::ivec3(glm::floor((bounds.min + half) / tileWorld));
+    glm::ivec3 hi = glm::ivec3(glm::floor((bounds.max + half) / tileWorld));
+
+    //Fully outside on any axis stays empty rather than clamping onto the border tiles.
+    glm::ivec3 count = TileCount();
+    if (glm::any(glm::lessThan(hi, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(lo, count)))
+        return r;
+
+    r.min = glm::max(lo, glm::ivec3(0));
+    r.max = glm::min(hi, count - 1);
+    return r;
+}
+
+glm::ivec3 SDFTileGrid::TileForPosition(const glm::vec3& p) const
+{
+    glm::ivec3 t = glm::ivec3(glm::floor((p + grid.sceneSize * 0.5f) / TileWorldSize()));
+    return glm::clamp(t, glm::ivec3(0), TileCount() - 1);
+}
+
+void SDFTileRangeBVH::Build(const std::vector<SDFTileRange>& ranges, uint32_t leafSize)
+{
+    nodes.clear();
+    items.clear();
+    itemRanges = ranges;
+    leafSize = std::max(leafSize, 1u);
+
+    for (uint32_t i = 0; i < (uint32_t)ranges.size(); i++)
+        if (!ranges[i].IsEmpty())
+            items.push_back(i);
+    if (items.empty())
+        return;
+
+    nodes.reserve(items.size() * 2);
+    nodes.push_back(Node{});
+
+    struct Task { uint32_t node, begin, end; };
+    std::vector<Task> stack = { { 0, 0, (uint32_t)items.size() } };
+    while (!stack.empty())
+    {
+        Task task = stack.back();
+        stack.pop_back();
+
+        SDFTileRange bounds = itemRanges[items[task.begin]];
+        glm::ivec3 cMin = bounds.min + bounds.max, cMax = cMin; //Centroids doubled to stay integer.
+        for (uint32_t i = task.begin + 1; i < task.end; i++)
+        {
+            const SDFTileRange& r = itemRanges[items[i]];
+            bounds.min = glm::min(bounds.min, r.min);
+            bounds.max = glm::max(bounds.max, r.max);
+            cMin = glm::min(cMin, r.min + r.max);
+            cMax = glm::max(cMax, r.min + r.max);
+        }
+        nodes[task.node].bounds = bounds;
+
+        uint32_t n = task.end - task.begin;
+        glm::ivec3 spread = cMax - cMin;
+        if (n <= leafSize || (spread.x == 0 && spread.y == 0 && spread.z == 0 && n <= leafSize * 4))
+        {
+            nodes[task.node].left = task.begin;
+            nodes[task.node].count = n;
+            continue;
+        }
+
+        int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+        uint32_t mid = task.begin + n / 2;
+        std::nth_element(items.begin() + task.begin, items.begin() + mid, items.begin() + task.end,
+            [&](uint32_t a, uint32_t b) {
+                int ca = itemRanges[a].min[axis] + itemRanges[a].max[axis];
+                int cb = itemRanges[b].min[axis] + itemRanges[b].max[axis];
+                return ca != cb ? ca < cb : a < b;
+            });
+
+        uint32_t left = (uint32_t)nodes.size();
+        nodes.push_back(Node{});
+        nodes.push_back(Node{});
+        nodes[task.node].left = left;
+        nodes[task.node].count = 0;
+        stack.push_back({ left, task.begin, mid });
+        stack.push_back({ left + 1, mid, task.end });
+    }
+}
+
+void SDFTileRangeBVH::Query(const SDFTileRange& query, std::vector<uint32_t>& out) const
+{
+    if (nodes.empty() || query.IsEmpty())
+        return;
+
+    uint32_t stack[64];
+    uint32_t top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+        if (!node.bounds.Overlaps(query))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.left; i < node.left + node.count; i++)
+                if (itemRanges[items[i]].Overlaps(query))
+                    out.push_back(items[i]);
+            continue;
+        }
+        stack[top++] = node.left;
+        stack[top++] = node.left + 1;
+    }
+}
+
+void BinBrushesToTiles(const SDFTileGrid& tiles, const std::vector<SDFAABB>& brushBounds, SDFTileBins& out, const SDFTileBinningSettings& settings)
+{
+    glm::ivec3 tileCount = tiles.TileCount();
+    uint32_t tileTotal = tiles.TileTotal();
+    out.tileCount = tileCount;
+    out.offsets.assign(tileTotal, 0);
+    out.counts.assign(tileTotal, 0);
+    out.brushIndices.clear();
+    out.maxCount = 0;
+
+    std::vector<SDFTileRange> ranges(brushBounds.size());
+    for (size_t i = 0; i < brushBounds.size(); i++)
+        ranges[i] = tiles.RangeForBounds(brushBounds[i]);
+
+    SDFTileRangeBVH bvh;
+    bvh.Build(ranges);
+    if (bvh.nodes.empty())
+        return;
+
+    int blockSize = std::max(settings.blockSize, 1);
+    glm::ivec3 blockCount = (tileCount + blockSize - 1) / blockSize;
+    uint32_t blockTotal = uint32_t(blockCount.x * blockCount.y * blockCount.z);
+
+    //Candidates per block, kept between the count and fill passes so the tree is walked once.
+    std::vector<std::vector<uint32_t>> candidates(blockTotal);
+    auto blockRange = [&](uint32_t b) {
+        glm::ivec3 bc(b % blockCount.x, (b / blockCount.x) % blockCount.y, b / (blockCount.x * blockCount.y));
+        SDFTileRange r;
+        r.min = bc * blockSize;
+        r.max = glm::min(r.min + blockSize, tileCount) - 1;
+        return r;
+    };
+
+    UnigmaParallelForRange(blockTotal, settings.grain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t b = begin; b < end; b++)
+        {
+            SDFTileRange block = blockRange(b);
+            std::vector<uint32_t>& list = candidates[b];
+            bvh.Query(block, list);
+            std::sort(list.begin(), list.end());
+
+            for (int z = block.min.z; z <= block.max.z; z++)
+                for (int y = block.min.y; y <= block.max.y; y++)
+                    for (int x = block.min.x; x <= block.max.x; x++)
+                    {
+                        glm::ivec3 t(x, y, z);
+                        uint32_t count = 0;
+                        for (uint32_t brush : list)
+                            count += ranges[brush].Contains(t) ? 1u : 0u;
+                        out.counts[tiles.Flatten(t)] = count;
+                    }
+        }
+    });
+
+    uint32_t running = 0;
+    for (uint32_t t = 0; t < tileTotal; t++)
+    {
+        out.offsets[t] = running;
+        running += out.counts[t];
+        out.maxCount = std::max(out.maxCount, out.counts[t]);
+    }
+    out.brushIndices.resize(running);
+
+    UnigmaParallelForRange(blockTotal, settings.grain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t b = begin; b < end; b++)
+        {
+            SDFTileRange block = blockRange(b);
+            const std::vector<uint32_t>& list = candidates[b];
+            for (int z = block.min.z; z <= block.max.z; z++)
+                for (int y = block.min.y; y <= block.max.y; y++)
+                    for (int x = block.min.x; x <= block.max.x; x++)
+                    {
+                        glm::ivec3 t(x, y, z);
+                        uint32_t* dst = out.brushIndices.data() + out.offsets[tiles.Flatten(t)];
+                        for (uint32_t brush : list)
+                            if (ranges[brush].Contains(t))
+                                *dst++ = brush;
+                    }
+        }
+    });
+}
+
+void BinBrushesToTilesBruteForce(const SDFTileGrid& tiles, const std::vector<SDFAABB>& brushBounds, SDFTileBins& out)
+{
+    uint32_t tileTotal = tiles.TileTotal();
+    out.tileCount = tiles.TileCount();
+    out.offsets.assign(tileTotal, 0);
+    out.counts.assign(tileTotal, 0);
+    out.brushIndices.clear();
+    out.maxCount = 0;
+
+    std::vector<SDFTileRange> ranges(brushBounds.size());
+    for (size_t i = 0; i < brushBounds.size(); i++)
+        ranges[i] = tiles.RangeForBounds(brushBounds[i]);
+
+    for (uint32_t t = 0; t < tileTotal; t++)
+    {
+        glm::ivec3 tc = tiles.Unflatten(t);
+        out.offsets[t] = (uint32_t)out.brushIndices.size();
+        for (uint32_t b = 0; b < (uint32_t)ranges.size(); b++)
+            if (ranges[b].Contains(tc))
+                out.brushIndices.push_back(b);
+        out.counts[t] = (uint32_t)out.brushIndices.size() - out.offsets[t];
+        out.maxCount = std::max(out.maxCount, out.counts[t]);
+    }
+}
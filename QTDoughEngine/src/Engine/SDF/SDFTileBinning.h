@@ -0,0 +1,91 @@
+#pragma once
+#include "SDFCommon.h"
+
+//Brush to tile binning without a per tile cap.
+//Brush bounds are snapped to inclusive tile ranges with the same floor((p + halfScene) / tileWorldSize) as the tile pass,
+//so the BVH works on integer boxes and the result is exact: a brush lands in a tile iff the tile is inside its range.
+//Lists are variable length, stored as offset/count into one index buffer and always sorted by brush index.
+
+struct SDFTileRange
+{
+    glm::ivec3 min = glm::ivec3(0);
+    glm::ivec3 max = glm::ivec3(-1); //Inclusive, empty when any max < min.
+
+    bool IsEmpty() const { return max.x < min.x || max.y < min.y || max.z < min.z; }
+    bool Contains(const glm::ivec3& t) const
+    {
+        return t.x >= min.x && t.y >= min.y && t.z >= min.z && t.x <= max.x && t.y <= max.y && t.z <= max.z;
+    }
+    bool Overlaps(const SDFTileRange& b) const
+    {
+        return min.x <= b.max.x && max.x >= b.min.x && min.y <= b.max.y && max.y >= b.min.y && min.z <= b.max.z && max.z >= b.min.z;
+    }
+};
+
+struct SDFTileGrid
+{
+    SDFGridDesc grid;
+    int tileSize = 8; //Voxels per tile edge (VoxelizerPass::TILE_SIZE).
+
+    SDFTileGrid() {}
+    SDFTileGrid(const SDFGridDesc& g, int size) : grid(g), tileSize(size) {}
+
+    glm::ivec3 TileCount() const { return (grid.resolution + tileSize - 1) / tileSize; }
+    glm::vec3 TileWorldSize() const { return grid.VoxelSize() * (float)tileSize; }
+    uint32_t TileTotal() const { glm::ivec3 c = TileCount(); return uint32_t(c.x * c.y * c.z); }
+    uint32_t Flatten(const glm::ivec3& t) const { glm::ivec3 c = TileCount(); return uint32_t(t.x + t.y * c.x + t.z * c.x * c.y); }
+    glm::ivec3 Unflatten(uint32_t i) const { glm::ivec3 c = TileCount(); return glm::ivec3(i % c.x, (i / c.x) % c.y, i / (c.x * c.y)); }
+
+    //Tiles touched by a world box, clamped to the grid.
+    SDFTileRange RangeForBounds(const SDFAABB& bounds) const;
+    //Tile holding a world position, clamped like the voxel pass.
+    glm::ivec3 TileForPosition(const glm::vec3& p) const;
+};
+
+//Compact per tile brush lists, laid out for upload: brushIndices[offsets[t] .. offsets[t] + counts[t]).
+struct SDFTileBins
+{
+    glm::ivec3 tileCount = glm::ivec3(0);
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> brushIndices;
+    uint32_t maxCount = 0;
+
+    const uint32_t* Begin(uint32_t tile) const { return brushIndices.data() + offsets[tile]; }
+    const uint32_t* End(uint32_t tile) const { return brushIndices.data() + offsets[tile] + counts[tile]; }
+};
+
+//Static BVH over integer tile ranges, median split on the longest axis.
+class SDFTileRangeBVH
+{
+public:
+    struct Node
+    {
+        SDFTileRange bounds;
+        uint32_t left = 0; //First child, or first item when count > 0. Right child is always left + 1.
+        uint32_t count = 0;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> items; //Leaf item order, indices into the build input.
+
+    void Build(const std::vector<SDFTileRange>& ranges, uint32_t leafSize = 4);
+    //Appends every item overlapping query. Order is traversal order, not sorted.
+    void Query(const SDFTileRange& query, std::vector<uint32_t>& out) const;
+
+private:
+    std::vector<SDFTileRange> itemRanges;
+};
+
+struct SDFTileBinningSettings
+{
+    int blockSize = 4; //Tiles per block edge. The BVH is walked once per block and the candidates filtered per tile.
+    uint32_t grain = 8; //Blocks per parallel work item.
+};
+
+//Bins brush bounds into tiles. Empty or invalid bounds are skipped.
+void BinBrushesToTiles(const SDFTileGrid& tiles, const std::vector<SDFAABB>& brushBounds, SDFTileBins& out,
+    const SDFTileBinningSettings& settings = SDFTileBinningSettings());
+
+//Reference binning: every brush tested against every tile. Only meant for validation.
+void BinBrushesToTilesBruteForce(const SDFTileGrid& tiles, const std::vector<SDFAABB>& brushBounds, SDFTileBins& out);
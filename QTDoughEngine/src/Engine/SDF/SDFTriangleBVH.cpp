@@ -0,0 +1,623 @@
+#include "SDFTriangleBVH.h"
+#include "../Core/UnigmaParallel.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <immintrin.h>
+#define SDF_BVH_SSE 1
+#endif
+
+//Past this binary depth splits fall back to the object median, so the depth (and the traversal stack) stays bounded
+//however badly the SAH splits a pathological soup.
+#define SDF_BVH_SAH_DEPTH 64
+#define SDF_BVH_STACK (3 * (SDF_BVH_SAH_DEPTH + 32) + 4)
+
+namespace
+{
+    struct BinaryNode
+    {
+        SDFAABB bounds;
+        int32_t left = -1; //Leaf when -1.
+        int32_t right = -1;
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+}
+
+class SDFBVHBuilder
+{
+public:
+    SDFBVHBuilder(const SDFBVHBuildSettings& buildSettings, const std::vector<glm::vec3>& soupCorners) :
+        settings(buildSettings), corners(soupCorners)
+    {
+        uint32_t count = (uint32_t)(corners.size() / 3);
+        primBounds.resize(count);
+        centroids.resize(count);
+        order.resize(count);
+        UnigmaParallelForRange(count, 4096, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                SDFAABB b(corners[i * 3], corners[i * 3]);
+                b.Expand(corners[i * 3 + 1]);
+                b.Expand(corners[i * 3 + 2]);
+                primBounds[i] = b;
+                centroids[i] = b.Center();
+                order[i] = i;
+            }
+        });
+    }
+
+    void Build(SDFTriangleBVH& out)
+    {
+        out.nodes.clear();
+        out.triangles.clear();
+        out.bounds = SDFAABB();
+        uint32_t count = (uint32_t)order.size();
+        if (count == 0)
+            return;
+
+        //Top levels on this thread, down to subtrees small enough to be one task each.
+        std::vector<Task> tasks;
+        int32_t root = BuildTop(0, count, 0, tasks);
+        std::vector<std::vector<BinaryNode>> subtrees(tasks.size());
+        UnigmaParallelFor((uint32_t)tasks.size(), 1, [&](uint32_t i) {
+            BuildSubtree(tasks[i].first, tasks[i].count, tasks[i].depth, subtrees[i]);
+        });
+
+        //Each subtree root replaces its placeholder, the rest is appended behind.
+        for (size_t i = 0; i < tasks.size(); i++)
+        {
+            int32_t offset = (int32_t)binary.size() - 1;
+            std::vector<BinaryNode>& local = subtrees[i];
+            for (BinaryNode& n : local)
+                if (n.left >= 0)
+                {
+                    n.left += offset;
+                    n.right += offset;
+                }
+            binary[tasks[i].node] = local[0];
+            binary.insert(binary.end(), local.begin() + 1, local.end());
+        }
+
+        out.bounds = binary[root].bounds;
+        out.triangles.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t t = order[i];
+            SDFTriangleBVH::Triangle& tri = out.triangles[i];
+            tri.a = corners[t * 3];
+            tri.edge1 = corners[t * 3 + 1] - tri.a;
+            tri.edge2 = corners[t * 3 + 2] - tri.a;
+            tri.index = t;
+        }
+
+        out.nodes.reserve(binary.size() / 2 + 1);
+        if (binary[root].left < 0)
+        {
+            //A single leaf still gets a node, so traversal always starts from one.
+            out.nodes.push_back(SDFTriangleBVH::Node());
+            ClearNode(out.nodes[0]);
+            SetChild(out.nodes[0], 0, binary[root], -1);
+        }
+        else
+            Collapse(root, out);
+    }
+
+private:
+    struct Task
+    {
+        uint32_t first;
+        uint32_t count;
+        int depth;
+        int32_t node;
+    };
+
+    const SDFBVHBuildSettings& settings;
+    const std::vector<glm::vec3>& corners;
+    std::vector<SDFAABB> primBounds;
+    std::vector<glm::vec3> centroids;
+    std::vector<uint32_t> order;
+    std::vector<BinaryNode> binary;
+
+    //Node bounds of [first, first + count), and the split point inside it or 0 for a leaf. Reorders the range.
+    uint32_t Split(uint32_t first, uint32_t count, int depth, SDFAABB& outBounds)
+    {
+        SDFAABB box, centroidBox;
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            box.Expand(primBounds[order[i]]);
+            centroidBox.Expand(centroids[order[i]]);
+        }
+        outBounds = box;
+        if (count <= 1)
+            return 0;
+
+        const int bins = std::min(std::max(settings.binCount, 2), 64);
+        glm::vec3 extent = centroidBox.Extent();
+        float area = box.SurfaceArea();
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1, bestBin = 0;
+
+        if (depth < SDF_BVH_SAH_DEPTH && area > 0.0f)
+        {
+            //All three axes binned in one pass over the range.
+            SDFAABB binBounds[3][64];
+            uint32_t binCounts[3][64] = {};
+            glm::vec3 scale(0.0f);
+            for (int axis = 0; axis < 3; axis++)
+                if (extent[axis] > 0.0f)
+                    scale[axis] = float(bins) / extent[axis];
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                uint32_t p = order[i];
+                glm::vec3 offset = (centroids[p] - centroidBox.min) * scale;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    int b = std::min(int(offset[axis]), bins - 1);
+                    binCounts[axis][b]++;
+                    binBounds[axis][b].Expand(primBounds[p]);
+                }
+            }
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (!(extent[axis] > 0.0f))
+                    continue;
+                //Right side areas and counts swept from the top, left side from the bottom.
+                float rightArea[64];
+                uint32_t rightCount[64];
+                SDFAABB acc;
+                uint32_t accCount = 0;
+                for (int b = bins - 1; b > 0; b--)
+                {
+                    if (binCounts[axis][b] > 0)
+                        acc.Expand(binBounds[axis][b]);
+                    accCount += binCounts[axis][b];
+                    rightArea[b] = acc.IsValid() ? acc.SurfaceArea() : 0.0f;
+                    rightCount[b] = accCount;
+                }
+                acc = SDFAABB();
+                accCount = 0;
+                for (int b = 0; b < bins - 1; b++)
+                {
+                    if (binCounts[axis][b] > 0)
+                        acc.Expand(binBounds[axis][b]);
+                    accCount += binCounts[axis][b];
+                    if (accCount == 0 || rightCount[b + 1] == 0)
+                        continue;
+                    float cost = settings.traversalCost + (acc.SurfaceArea() * accCount + rightArea[b + 1] * rightCount[b + 1]) / area;
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = b;
+                    }
+                }
+            }
+        }
+
+        if (count <= settings.maxLeafTriangles && (bestAxis < 0 || bestCost >= float(count)))
+            return 0;
+
+        uint32_t* begin = order.data() + first;
+        uint32_t* end = begin + count;
+        uint32_t* mid = nullptr;
+        if (bestAxis >= 0)
+        {
+            float scale = float(bins) / extent[bestAxis];
+            float low = centroidBox.min[bestAxis];
+            mid = std::partition(begin, end, [&](uint32_t p) {
+                return std::min(int((centroids[p][bestAxis] - low) * scale), bins - 1) <= bestBin;
+            });
+        }
+        else
+        {
+            //No usable SAH split: object median on the longest centroid axis. Identical centroids split anyway, so
+            //leaves stay within maxLeafTriangles.
+            int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            mid = begin + count / 2;
+            std::nth_element(begin, mid, end, [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+        return first + uint32_t(mid - begin);
+    }
+
+    int32_t BuildTop(uint32_t first, uint32_t count, int depth, std::vector<Task>& tasks)
+    {
+        int32_t id = (int32_t)binary.size();
+        binary.push_back(BinaryNode());
+        if (count <= settings.parallelThreshold)
+        {
+            tasks.push_back(Task{ first, count, depth, id });
+            return id;
+        }
+
+        SDFAABB box;
+        uint32_t mid = Split(first, count, depth, box);
+        binary[id].bounds = box;
+        if (mid == 0)
+        {
+            binary[id].first = first;
+            binary[id].count = count;
+            return id;
+        }
+        int32_t left = BuildTop(first, mid - first, depth + 1, tasks);
+        int32_t right = BuildTop(mid, first + count - mid, depth + 1, tasks);
+        binary[id].left = left;
+        binary[id].right = right;
+        return id;
+    }
+
+    int32_t BuildSubtree(uint32_t first, uint32_t count, int depth, std::vector<BinaryNode>& out)
+    {
+        int32_t id = (int32_t)out.size();
+        out.push_back(BinaryNode());
+        SDFAABB box;
+        uint32_t mid = Split(first, count, depth, box);
+        out[id].bounds = box;
+        if (mid == 0)
+        {
+            out[id].first = first;
+            out[id].count = count;
+            return id;
+        }
+        int32_t left = BuildSubtree(first, mid - first, depth + 1, out);
+        int32_t right = BuildSubtree(mid, first + count - mid, depth + 1, out);
+        out[id].left = left;
+        out[id].right = right;
+        return id;
+    }
+
+    static void ClearNode(SDFTriangleBVH::Node& node)
+    {
+        for (int i = 0; i < SDF_BVH_WIDTH; i++)
+        {
+            node.minX[i] = node.minY[i] = node.minZ[i] = 0.0f;
+            node.maxX[i] = node.maxY[i] = node.maxZ[i] = 0.0f;
+            node.child[i] = -1;
+            node.count[i] = 0;
+        }
+    }
+
+    static void SetChild(SDFTriangleBVH::Node& node, int slot, const BinaryNode& child, int32_t innerIndex)
+    {
+        //A few ulps of padding, so a hit point on a box face that rounds outside it is still found.
+        glm::vec3 pad = glm::max(glm::abs(child.bounds.min), glm::abs(child.bounds.max)) * 1e-6f;
+        glm::vec3 lo = child.bounds.min - pad;
+        glm::vec3 hi = child.bounds.max + pad;
+        node.minX[slot] = lo.x; node.minY[slot] = lo.y; node.minZ[slot] = lo.z;
+        node.maxX[slot] = hi.x; node.maxY[slot] = hi.y; node.maxZ[slot] = hi.z;
+        node.child[slot] = child.left < 0 ? (int32_t)child.first : innerIndex;
+        node.count[slot] = child.left < 0 ? child.count : 0;
+    }
+
+    //Pulls grandchildren up until the node is SDF_BVH_WIDTH wide, always opening the largest inner child.
+    int32_t Collapse(int32_t binaryId, SDFTriangleBVH& out)
+    {
+        int32_t id = (int32_t)out.nodes.size();
+        out.nodes.push_back(SDFTriangleBVH::Node());
+
+        int32_t children[SDF_BVH_WIDTH] = { binary[binaryId].left, binary[binaryId].right };
+        int childCount = 2;
+        while (childCount < SDF_BVH_WIDTH)
+        {
+            int open = -1;
+            float openArea = -1.0f;
+            for (int i = 0; i < childCount; i++)
+            {
+                const BinaryNode& c = binary[children[i]];
+                if (c.left >= 0 && c.bounds.SurfaceArea() > openArea)
+                {
+                    open = i;
+                    openArea = c.bounds.SurfaceArea();
+                }
+            }
+            if (open < 0)
+                break;
+            int32_t opened = children[open];
+            children[open] = binary[opened].left;
+            children[childCount++] = binary[opened].right;
+        }
+
+        int32_t inner[SDF_BVH_WIDTH];
+        for (int i = 0; i < childCount; i++)
+            inner[i] = binary[children[i]].left >= 0 ? Collapse(children[i], out) : -1;
+
+        SDFTriangleBVH::Node& node = out.nodes[id];
+        ClearNode(node);
+        for (int i = 0; i < childCount; i++)
+            SetChild(node, i, binary[children[i]], inner[i]);
+        return id;
+    }
+};
+
+void SDFTriangleBVH::Build(const glm::vec4* vertices, uint32_t vertexCount, const SDFBVHBuildSettings& settings)
+{
+    std::vector<glm::vec3> soup(vertexCount - vertexCount % 3);
+    for (size_t i = 0; i < soup.size(); i++)
+        soup[i] = glm::vec3(vertices[i]);
+    Build(soup, settings);
+}
+
+void SDFTriangleBVH::Build(const std::vector<glm::vec3>& soup, const SDFBVHBuildSettings& settings)
+{
+    SDFBVHBuilder builder(settings, soup);
+    builder.Build(*this);
+}
+
+bool SDFTriangleBVH::IntersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& edge1,
+    const glm::vec3& edge2, float tMax, float& outT, float& outU, float& outV)
+{
+    glm::vec3 p = glm::cross(direction, edge2);
+    float det = glm::dot(edge1, p);
+    if (std::abs(det) < 1e-12f)
+        return false;
+    float invDet = 1.0f / det;
+    glm::vec3 s = origin - a;
+    float u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+    float t = glm::dot(edge2, q) * invDet;
+    if (!(t >= 0.0f && t <= tMax))
+        return false;
+    outT = t;
+    outU = u;
+    outV = v;
+    return true;
+}
+
+bool SDFTriangleBVH::BruteForce(const std::vector<glm::vec3>& soup, const SDFRay& ray, SDFBVHHit& hit)
+{
+    bool found = false;
+    float tMax = ray.tMax;
+    for (size_t i = 0; i + 2 < soup.size(); i += 3)
+    {
+        glm::vec3 a = soup[i];
+        float t, u, v;
+        if (IntersectTriangle(ray.origin, ray.direction, a, soup[i + 1] - a, soup[i + 2] - a, tMax, t, u, v) && (!found || t < tMax))
+        {
+            found = true;
+            tMax = t;
+            hit.triangle = uint32_t(i / 3);
+            hit.t = t;
+            hit.u = u;
+            hit.v = v;
+        }
+    }
+    return found;
+}
+
+int SDFTriangleBVH::IntersectChildren(const Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float* outT) const
+{
+#ifdef SDF_BVH_SSE
+    const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+    const __m128 ix = _mm_set1_ps(invDir.x), iy = _mm_set1_ps(invDir.y), iz = _mm_set1_ps(invDir.z);
+    __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ox), ix);
+    __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ox), ix);
+    __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), oy), iy);
+    __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), oy), iy);
+    __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), oz), iz);
+    __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), oz), iz);
+    __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), _mm_setzero_ps()));
+    __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), _mm_set1_ps(tMax)));
+    _mm_storeu_ps(outT, tNear);
+
+    //Empty slots have child -1 and count 0.
+    __m128i child = _mm_loadu_si128((const __m128i*)node.child);
+    __m128i count = _mm_loadu_si128((const __m128i*)node.count);
+    __m128i empty = _mm_and_si128(_mm_cmplt_epi32(child, _mm_setzero_si128()), _mm_cmpeq_epi32(count, _mm_setzero_si128()));
+    return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) & ~_mm_movemask_ps(_mm_castsi128_ps(empty));
+#else
+    int mask = 0;
+    for (int i = 0; i < SDF_BVH_WIDTH; i++)
+    {
+        if (node.child[i] < 0 && node.count[i] == 0)
+            continue;
+        float x0 = (node.minX[i] - origin.x) * invDir.x, x1 = (node.maxX[i] - origin.x) * invDir.x;
+        float y0 = (node.minY[i] - origin.y) * invDir.y, y1 = (node.maxY[i] - origin.y) * invDir.y;
+        float z0 = (node.minZ[i] - origin.z) * invDir.z, z1 = (node.maxZ[i] - origin.z) * invDir.z;
+        float tNear = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+        float tFar = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), tMax));
+        outT[i] = tNear;
+        if (tNear <= tFar)
+            mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+bool SDFTriangleBVH::Intersect(const SDFRay& ray, SDFBVHHit& hit) const
+{
+    if (nodes.empty())
+        return false;
+
+    glm::vec3 invDir = 1.0f / ray.direction;
+    float tMax = ray.tMax;
+    bool found = false;
+
+    struct Entry { int32_t node; float t; };
+    Entry stack[SDF_BVH_STACK];
+    int top = 0;
+    stack[top++] = Entry{ 0, 0.0f };
+    while (top > 0)
+    {
+        Entry entry = stack[--top];
+        if (entry.t > tMax)
+            continue;
+
+        const Node& node = nodes[entry.node];
+        alignas(16) float tNear[SDF_BVH_WIDTH];
+        int mask = IntersectChildren(node, ray.origin, invDir, tMax, tNear);
+
+        //Leaves right away, they can only shrink tMax; inner children pushed far to near.
+        Entry inner[SDF_BVH_WIDTH];
+        int innerCount = 0;
+        for (int i = 0; i < SDF_BVH_WIDTH; i++)
+        {
+            if (!(mask & (1 << i)))
+                continue;
+            if (node.count[i] == 0)
+            {
+                Entry e{ node.child[i], tNear[i] };
+                int j = innerCount++;
+                for (; j > 0 && inner[j - 1].t < e.t; j--)
+                    inner[j] = inner[j - 1];
+                inner[j] = e;
+                continue;
+            }
+            for (uint32_t k = 0; k < node.count[i]; k++)
+            {
+                const Triangle& tri = triangles[node.child[i] + k];
+                float t, u, v;
+                if (IntersectTriangle(ray.origin, ray.direction, tri.a, tri.edge1, tri.edge2, tMax, t, u, v) && (!found || t < tMax ||
+                    (t == tMax && tri.index < hit.triangle)))
+                {
+                    found = true;
+                    tMax = t;
+                    hit.triangle = tri.index;
+                    hit.t = t;
+                    hit.u = u;
+                    hit.v = v;
+                }
+            }
+        }
+        for (int i = 0; i < innerCount; i++)
+            if (inner[i].t <= tMax)
+                stack[top++] = inner[i];
+    }
+    return found;
+}
+
+bool SDFTriangleBVH::Occluded(const SDFRay& ray) const
+{
+    if (nodes.empty())
+        return false;
+
+    glm::vec3 invDir = 1.0f / ray.direction;
+    int32_t stack[SDF_BVH_STACK];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+        alignas(16) float tNear[SDF_BVH_WIDTH];
+        int mask = IntersectChildren(node, ray.origin, invDir, ray.tMax, tNear);
+        for (int i = 0; i < SDF_BVH_WIDTH; i++)
+        {
+            if (!(mask & (1 << i)))
+                continue;
+            if (node.count[i] == 0)
+            {
+                stack[top++] = node.child[i];
+                continue;
+            }
+            for (uint32_t k = 0; k < node.count[i]; k++)
+            {
+                const Triangle& tri = triangles[node.child[i] + k];
+                float t, u, v;
+                if (IntersectTriangle(ray.origin, ray.direction, tri.a, tri.edge1, tri.edge2, ray.tMax, t, u, v))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool SDFTriangleBVH::ValidateNode(int32_t id, const SDFAABB& box, std::vector<uint8_t>& seen) const
+{
+    const Node& node = nodes[id];
+    for (int i = 0; i < SDF_BVH_WIDTH; i++)
+    {
+        if (node.child[i] < 0 && node.count[i] == 0)
+            continue;
+        SDFAABB child(glm::vec3(node.minX[i], node.minY[i], node.minZ[i]), glm::vec3(node.maxX[i], node.maxY[i], node.maxZ[i]));
+        if (!box.Contains(child))
+            return false;
+        if (node.count[i] == 0)
+        {
+            if (node.child[i] <= id || node.child[i] >= (int32_t)nodes.size() || !ValidateNode(node.child[i], child, seen))
+                return false;
+            continue;
+        }
+        for (uint32_t k = 0; k < node.count[i]; k++)
+        {
+            uint32_t t = uint32_t(node.child[i]) + k;
+            if (t >= triangles.size() || seen[t])
+                return false;
+            seen[t] = 1;
+            const Triangle& tri = triangles[t];
+            if (!child.Contains(tri.a) || !child.Contains(tri.a + tri.edge1) || !child.Contains(tri.a + tri.edge2))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool SDFTriangleBVH::Validate() const
+{
+    if (nodes.empty())
+        return triangles.empty();
+    std::vector<uint8_t> seen(triangles.size(), 0);
+    //Edges were subtracted from the corners, so adding them back can round just past the box.
+    glm::vec3 slack = glm::max(glm::abs(bounds.min), glm::abs(bounds.max)) * 1e-5f;
+    SDFAABB loose(bounds.min - slack, bounds.max + slack);
+    if (!ValidateNode(0, loose, seen))
+        return false;
+    return std::find(seen.begin(), seen.end(), uint8_t(0)) == seen.end();
+}
+
+void SDFBrushBVHSet::Build(const glm::vec4* vertices, const std::vector<uint32_t>& vertexOffsets, const std::vector<uint32_t>& vertexCounts,
+    const SDFBVHBuildSettings& settings)
+{
+    uint32_t count = (uint32_t)std::min(vertexOffsets.size(), vertexCounts.size());
+    brushes.assign(count, SDFTriangleBVH());
+
+    //Enough brushes keep every core busy on their own; otherwise each brush spreads its subtrees instead.
+    if (count >= UnigmaWorkerCount())
+    {
+        SDFBVHBuildSettings serial = settings;
+        serial.parallelThreshold = UINT32_MAX;
+        UnigmaParallelFor(count, 1, [&](uint32_t i) {
+            brushes[i].Build(vertices + vertexOffsets[i], vertexCounts[i], serial);
+        });
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++)
+        brushes[i].Build(vertices + vertexOffsets[i], vertexCounts[i], settings);
+}
+
+bool SDFBrushBVHSet::Intersect(const SDFRay& ray, SDFBVHHit& hit) const
+{
+    SDFRay clipped = ray;
+    glm::vec3 invDir = 1.0f / ray.direction;
+    bool found = false;
+    for (uint32_t i = 0; i < (uint32_t)brushes.size(); i++)
+    {
+        float enter;
+        if (brushes[i].TriangleCount() == 0 || !RayAABB(clipped, invDir, brushes[i].Bounds(), enter))
+            continue;
+        SDFBVHHit brushHit;
+        if (brushes[i].Intersect(clipped, brushHit) && (!found || brushHit.t < clipped.tMax))
+        {
+            found = true;
+            hit = brushHit;
+            hit.brush = i;
+            clipped.tMax = brushHit.t;
+        }
+    }
+    return found;
+}
+
+bool SDFBrushBVHSet::Occluded(const SDFRay& ray) const
+{
+    glm::vec3 invDir = 1.0f / ray.direction;
+    for (const SDFTriangleBVH& brush : brushes)
+    {
+        float enter;
+        if (brush.TriangleCount() > 0 && RayAABB(ray, invDir, brush.Bounds(), enter) && brush.Occluded(ray))
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "SDFCommon.h"
+
+//CPU ray queries against brush triangles, over the same vertex data RayTracerPass::BuildBLAS_PerBrush hands to the
+//driver: a triangle soup of float4 positions (three consecutive vertices per triangle), one slice per brush.
+//The builder is top down binned SAH into a binary tree, which is then collapsed into 4 wide nodes whose child boxes
+//are stored as SoA so one SSE slab test covers all four. Large brushes split their top levels on the calling thread
+//and build the subtrees on all cores; SDFBrushBVHSet builds many brushes side by side instead.
+//Closest hit visits children near to far and clips as it goes, any hit stops at the first triangle in range.
+//Both use the same Moller-Trumbore test as the brute force reference, so they return its exact t.
+
+#define SDF_BVH_WIDTH 4
+
+struct SDFBVHBuildSettings
+{
+    int binCount = 16; //SAH bins per axis.
+    uint32_t maxLeafTriangles = 4; //Leaves never hold more.
+    float traversalCost = 1.0f; //Cost of a node visit relative to one triangle test.
+    uint32_t parallelThreshold = 8192; //Subtrees with fewer triangles build as one task.
+};
+
+struct SDFBVHHit
+{
+    uint32_t triangle = UINT32_MAX; //Index in the soup the BVH was built from.
+    uint32_t brush = UINT32_MAX; //SDFBrushBVHSet only.
+    float t = std::numeric_limits<float>::max();
+    float u = 0.0f; //Barycentrics of the second and third vertex.
+    float v = 0.0f;
+
+    bool Hit() const { return triangle != UINT32_MAX; }
+};
+
+class SDFTriangleBVH
+{
+public:
+    //vertexCount / 3 triangles from vertices (xyz used, w ignored), like the BLAS geometry.
+    void Build(const glm::vec4* vertices, uint32_t vertexCount, const SDFBVHBuildSettings& settings = SDFBVHBuildSettings());
+    void Build(const std::vector<glm::vec3>& soup, const SDFBVHBuildSettings& settings = SDFBVHBuildSettings());
+
+    //Closest triangle with t in [0, ray.tMax]. Returns false and leaves hit alone on a miss.
+    bool Intersect(const SDFRay& ray, SDFBVHHit& hit) const;
+    //Any triangle with t in [0, ray.tMax].
+    bool Occluded(const SDFRay& ray) const;
+
+    uint32_t TriangleCount() const { return (uint32_t)triangles.size(); }
+    uint32_t NodeCount() const { return (uint32_t)nodes.size(); }
+    const SDFAABB& Bounds() const { return bounds; }
+    //Every triangle in exactly one leaf and every child box holding its subtree. Meant for tests.
+    bool Validate() const;
+
+    //Moller-Trumbore, shared with the traversal so brute force and BVH agree on t.
+    static bool IntersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& edge1,
+        const glm::vec3& edge2, float tMax, float& outT, float& outU, float& outV);
+    //Reference closest hit over a soup, one test per triangle.
+    static bool BruteForce(const std::vector<glm::vec3>& soup, const SDFRay& ray, SDFBVHHit& hit);
+
+private:
+    //Child i is empty when count[i] == 0 and child[i] < 0, a leaf of count[i] triangles from child[i] when count[i] > 0,
+    //an inner node otherwise.
+    struct Node
+    {
+        alignas(16) float minX[SDF_BVH_WIDTH];
+        alignas(16) float minY[SDF_BVH_WIDTH];
+        alignas(16) float minZ[SDF_BVH_WIDTH];
+        alignas(16) float maxX[SDF_BVH_WIDTH];
+        alignas(16) float maxY[SDF_BVH_WIDTH];
+        alignas(16) float maxZ[SDF_BVH_WIDTH];
+        int32_t child[SDF_BVH_WIDTH];
+        uint32_t count[SDF_BVH_WIDTH];
+    };
+
+    //Leaf order, first vertex and both edges precomputed.
+    struct Triangle
+    {
+        glm::vec3 a;
+        glm::vec3 edge1;
+        glm::vec3 edge2;
+        uint32_t index = 0;
+    };
+
+    std::vector<Node> nodes; //Root at 0.
+    std::vector<Triangle> triangles;
+    SDFAABB bounds;
+
+    //Entry distance of the ray into each child box, mask of the children hit.
+    int IntersectChildren(const Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float* outT) const;
+    bool ValidateNode(int32_t id, const SDFAABB& box, std::vector<uint8_t>& seen) const;
+    friend class SDFBVHBuilder;
+};
+
+//One SDFTriangleBVH per brush over the shared vertex buffer, brush i owning vertices
+//[vertexOffsets[i], vertexOffsets[i] + vertexCounts[i]) (VoxelizerPass::BrushVertexOffsets and BrushVerticesCount).
+class SDFBrushBVHSet
+{
+public:
+    void Build(const glm::vec4* vertices, const std::vector<uint32_t>& vertexOffsets, const std::vector<uint32_t>& vertexCounts,
+        const SDFBVHBuildSettings& settings = SDFBVHBuildSettings());
+
+    //Closest hit over every brush; hit.triangle is brush local.
+    bool Intersect(const SDFRay& ray, SDFBVHHit& hit) const;
+    bool Occluded(const SDFRay& ray) const;
+
+    uint32_t BrushCount() const { return (uint32_t)brushes.size(); }
+    const SDFTriangleBVH& Brush(uint32_t i) const { return brushes[i]; }
+
+private:
+    std::vector<SDFTriangleBVH> brushes;
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include "SDFCommon.h"
+
+//12 byte voxel encoding, mirrored in shaders/Helpers/VoxelPacking.hlsl. Keep both files in sync.
+//  distances    : distance (snorm16, low) | normalDistance.w (snorm16, high), both scaled by the distance range
+//  normal       : octahedral normal, x (snorm16, low) | y (snorm16, high)
+//  brushDensity : brushId (16 bits, low) | density (unorm16 over [0, SDF_VOXEL_DENSITY_MAX], high)
+//Rounding is floor(x + 0.5) on both sides so the CPU and GPU produce the same bits.
+
+#define SDF_VOXEL_DISTANCE_RANGE 4.0f //Distances are clamped to +-range. Twice DEFUALT_EMPTY_SPACE.
+#define SDF_VOXEL_DENSITY_MAX 8.0f //Density in DENSITY_SCALE units.
+#define SDF_VOXEL_MAX_BRUSH_ID 0xFFFFu
+
+struct SDFVoxelPacked
+{
+    uint32_t distances = 0;
+    uint32_t normal = 0;
+    uint32_t brushDensity = 0;
+};
+static_assert(sizeof(SDFVoxelPacked) == 12, "SDFVoxelPacked must match VoxelPacked in VoxelPacking.hlsl");
+
+inline uint32_t SDFPackSnorm16(float v)
+{
+    v = std::min(std::max(v, -1.0f), 1.0f);
+    int32_t q = (int32_t)std::floor(v * 32767.0f + 0.5f);
+    return uint32_t(q) & 0xFFFFu;
+}
+
+inline float SDFUnpackSnorm16(uint32_t bits)
+{
+    int32_t q = int32_t(bits << 16) >> 16;
+    return std::max(float(q) / 32767.0f, -1.0f);
+}
+
+inline uint32_t SDFPackUnorm16(float v)
+{
+    v = std::min(std::max(v, 0.0f), 1.0f);
+    return uint32_t(std::floor(v * 65535.0f + 0.5f));
+}
+
+inline float SDFUnpackUnorm16(uint32_t bits)
+{
+    return float(bits & 0xFFFFu) / 65535.0f;
+}
+
+//Unit vector to the [-1, 1]^2 octahedral square. A zero vector maps to +z.
+inline glm::vec2 SDFOctEncode(const glm::vec3& n)
+{
+    float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (sum <= 0.0f)
+        return glm::vec2(0.0f);
+
+    glm::vec2 p = glm::vec2(n.x, n.y) / sum;
+    if (n.z < 0.0f)
+    {
+        glm::vec2 fold = glm::vec2(1.0f - std::abs(p.y), 1.0f - std::abs(p.x));
+        p = glm::vec2(p.x >= 0.0f ? fold.x : -fold.x, p.y >= 0.0f ? fold.y : -fold.y);
+    }
+    return p;
+}
+
+inline glm::vec3 SDFOctDecode(const glm::vec2& p)
+{
+    glm::vec3 n = glm::vec3(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+inline uint32_t SDFPackNormalOct16(const glm::vec3& n)
+{
+    glm::vec2 p = SDFOctEncode(n);
+    return SDFPackSnorm16(p.x) | (SDFPackSnorm16(p.y) << 16);
+}
+
+inline glm::vec3 SDFUnpackNormalOct16(uint32_t bits)
+{
+    return SDFOctDecode(glm::vec2(SDFUnpackSnorm16(bits), SDFUnpackSnorm16(bits >> 16)));
+}
+
+inline SDFVoxelPacked SDFEncodeVoxel(float distance, float normalDistance, const glm::vec3& normal, uint32_t brushId, float density,
+    float distanceRange = SDF_VOXEL_DISTANCE_RANGE)
+{
+    SDFVoxelPacked v;
+    v.distances = SDFPackSnorm16(distance / distanceRange) | (SDFPackSnorm16(normalDistance / distanceRange) << 16);
+    v.normal = SDFPackNormalOct16(normal);
+    v.brushDensity = std::min(brushId, SDF_VOXEL_MAX_BRUSH_ID) | (SDFPackUnorm16(density / SDF_VOXEL_DENSITY_MAX) << 16);
+    return v;
+}
+
+inline float SDFDecodeVoxelDistance(const SDFVoxelPacked& v, float distanceRange = SDF_VOXEL_DISTANCE_RANGE)
+{
+    return SDFUnpackSnorm16(v.distances) * distanceRange;
+}
+
+inline float SDFDecodeVoxelNormalDistance(const SDFVoxelPacked& v, float distanceRange = SDF_VOXEL_DISTANCE_RANGE)
+{
+    return SDFUnpackSnorm16(v.distances >> 16) * distanceRange;
+}
+
+inline glm::vec3 SDFDecodeVoxelNormal(const SDFVoxelPacked& v)
+{
+    return SDFUnpackNormalOct16(v.normal);
+}
+
+inline uint32_t SDFDecodeVoxelBrushId(const SDFVoxelPacked& v)
+{
+    return v.brushDensity & 0xFFFFu;
+}
+
+inline float SDFDecodeVoxelDensity(const SDFVoxelPacked& v)
+{
+    return SDFUnpackUnorm16(v.brushDensity >> 16) * SDF_VOXEL_DENSITY_MAX;
+}
@@ -0,0 +1,281 @@
+#include "SDFWindingNumber.h"
+
+static const float kInvFourPi = 0.0795774715f;
+
+float SDFWindingNumber::TriangleWinding(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    //Van Oosterom and Strackee. Unnormalised form, so degenerate corners at p just give 0.
+    glm::vec3 va = a - p;
+    glm::vec3 vb = b - p;
+    glm::vec3 vc = c - p;
+    float la = glm::length(va);
+    float lb = glm::length(vb);
+    float lc = glm::length(vc);
+    float det = glm::dot(va, glm::cross(vb, vc));
+    float denom = la * lb * lc + glm::dot(va, vb) * lc + glm::dot(vb, vc) * la + glm::dot(vc, va) * lb;
+    return 2.0f * std::atan2(det, denom) * kInvFourPi;
+}
+
+float SDFWindingNumber::BruteForce(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles, const glm::vec3& p)
+{
+    double sum = 0.0;
+    for (const glm::uvec3& t : triangles)
+        sum += TriangleWinding(p, positions[t.x], positions[t.y], positions[t.z]);
+    return float(sum);
+}
+
+void SDFWindingNumber::Build(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles, uint32_t leafSize)
+{
+    std::vector<glm::vec3> soup;
+    soup.reserve(triangles.size() * 3);
+    for (const glm::uvec3& t : triangles)
+    {
+        soup.push_back(positions[t.x]);
+        soup.push_back(positions[t.y]);
+        soup.push_back(positions[t.z]);
+    }
+    BuildSoup(soup, leafSize);
+}
+
+void SDFWindingNumber::BuildSoup(const std::vector<glm::vec3>& soup, uint32_t leafSize)
+{
+    nodes.clear();
+    nodeBounds.clear();
+    corners.clear();
+
+    uint32_t triangleCount = (uint32_t)soup.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    std::vector<uint32_t> order(triangleCount);
+    std::vector<glm::vec3> centroids(triangleCount);
+    for (uint32_t i = 0; i < triangleCount; i++)
+    {
+        order[i] = i;
+        centroids[i] = (soup[i * 3] + soup[i * 3 + 1] + soup[i * 3 + 2]) * (1.0f / 3.0f);
+    }
+
+    nodes.reserve(2 * (triangleCount / std::max(leafSize, 1u) + 1));
+    nodeBounds.reserve(nodes.capacity());
+    BuildNode(order, centroids, soup, 0, triangleCount, std::max(leafSize, 1u));
+
+    corners.resize(soup.size());
+    for (uint32_t i = 0; i < triangleCount; i++)
+        for (uint32_t k = 0; k < 3; k++)
+            corners[i * 3 + k] = soup[order[i] * 3 + k];
+}
+
+uint32_t SDFWindingNumber::BuildNode(std::vector<uint32_t>& order, std::vector<glm::vec3>& centroids, const std::vector<glm::vec3>& soup,
+    uint32_t first, uint32_t count, uint32_t leafSize)
+{
+    uint32_t index = (uint32_t)nodes.size();
+    nodes.push_back(Node());
+    nodeBounds.push_back(SDFAABB());
+
+    //Dipole and bounds of the whole range.
+    SDFAABB bounds;
+    SDFAABB centroidBounds;
+    glm::vec3 normal(0.0f);
+    glm::vec3 weighted(0.0f);
+    float area = 0.0f;
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        const glm::vec3* t = &soup[order[i] * 3];
+        bounds.Expand(t[0]);
+        bounds.Expand(t[1]);
+        bounds.Expand(t[2]);
+        centroidBounds.Expand(centroids[order[i]]);
+        glm::vec3 n = 0.5f * glm::cross(t[1] - t[0], t[2] - t[0]);
+        float a = glm::length(n);
+        normal += n;
+        weighted += centroids[order[i]] * a;
+        area += a;
+    }
+    glm::vec3 center = area > 0.0f ? weighted / area : bounds.Center();
+    float radius = 0.0f;
+    for (uint32_t i = first; i < first + count; i++)
+        for (uint32_t k = 0; k < 3; k++)
+            radius = std::max(radius, glm::length(soup[order[i] * 3 + k] - center));
+
+    nodeBounds[index] = bounds;
+    nodes[index].center = center;
+    nodes[index].radius = radius;
+    nodes[index].normal = normal;
+
+    glm::vec3 extent = centroidBounds.Extent();
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    if (count <= leafSize || extent[axis] <= 0.0f)
+    {
+        nodes[index].next = first;
+        nodes[index].count = count;
+        return index;
+    }
+
+    //Median split on the widest centroid axis keeps the tree balanced regardless of triangle sizes.
+    uint32_t half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+        [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    BuildNode(order, centroids, soup, first, half, leafSize);
+    uint32_t right = BuildNode(order, centroids, soup, first + half, count - half, leafSize);
+    nodes[index].next = right;
+    return index;
+}
+
+float SDFWindingNumber::Query(const glm::vec3& p, float beta) const
+{
+    if (nodes.empty())
+        return 0.0f;
+
+    float sum = 0.0f;
+    uint32_t stack[64];
+    uint32_t top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        uint32_t index = stack[--top];
+        const Node& node = nodes[index];
+
+        glm::vec3 d = node.center - p;
+        float dist2 = glm::dot(d, d);
+        float reach = beta * node.radius;
+        if (dist2 > reach * reach)
+        {
+            //Far field: the node's triangles seen as one dipole.
+            float dist = std::sqrt(dist2);
+            sum += glm::dot(d, node.normal) * kInvFourPi / (dist2 * dist);
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.next; i < node.next + node.count; i++)
+                sum += TriangleWinding(p, corners[i * 3], corners[i * 3 + 1], corners[i * 3 + 2]);
+            continue;
+        }
+
+        //Median splits keep the depth near log2(n / leafSize), far below the stack size.
+        stack[top++] = node.next;
+        stack[top++] = index + 1;
+    }
+    return sum;
+}
+
+void SDFWindingNumber::QueryPoints(const std::vector<glm::vec3>& points, std::vector<float>& outWinding, float beta) const
+{
+    outWinding.resize(points.size());
+    UnigmaParallelFor((uint32_t)points.size(), 256, [&](uint32_t i) {
+        outWinding[i] = Query(points[i], beta);
+    });
+}
+
+bool SDFWindingNumber::TouchesTriangles(const SDFAABB& box) const
+{
+    if (nodes.empty())
+        return false;
+
+    uint32_t stack[64];
+    uint32_t top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        uint32_t index = stack[--top];
+        const Node& node = nodes[index];
+        if (!nodeBounds[index].Overlaps(box))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.next; i < node.next + node.count; i++)
+            {
+                SDFAABB t;
+                t.Expand(corners[i * 3]);
+                t.Expand(corners[i * 3 + 1]);
+                t.Expand(corners[i * 3 + 2]);
+                if (t.Overlaps(box))
+                    return true;
+            }
+            continue;
+        }
+
+        stack[top++] = node.next;
+        stack[top++] = index + 1;
+    }
+    return false;
+}
+
+void SDFWindingNumber::ClassifyGrid(const SDFAABB& bounds, const glm::ivec3& resolution, std::vector<uint8_t>& outInside,
+    float beta, uint32_t blockSize) const
+{
+    size_t voxelCount = size_t(resolution.x) * size_t(resolution.y) * size_t(resolution.z);
+    outInside.assign(voxelCount, 0);
+    if (voxelCount == 0 || nodes.empty())
+        return;
+
+    blockSize = std::max(blockSize, 1u);
+    glm::ivec3 blocks = (resolution + glm::ivec3(blockSize - 1)) / glm::ivec3(blockSize);
+    glm::vec3 voxelSize = bounds.Extent() / glm::vec3(resolution);
+    auto voxelCenter = [&](const glm::ivec3& v) { return bounds.min + (glm::vec3(v) + 0.5f) * voxelSize; };
+    auto flatten = [&](const glm::ivec3& v) { return size_t(v.x) + size_t(v.y) * resolution.x + size_t(v.z) * size_t(resolution.x) * resolution.y; };
+
+    auto queryVoxels = [&](const glm::ivec3& lo, const glm::ivec3& hi) {
+        for (int z = lo.z; z <= hi.z; z++)
+            for (int y = lo.y; y <= hi.y; y++)
+                for (int x = lo.x; x <= hi.x; x++)
+                {
+                    glm::ivec3 v(x, y, z);
+                    outInside[flatten(v)] = Query(voxelCenter(v), beta) > 0.5f ? 1 : 0;
+                }
+    };
+
+    //Blocks no triangle touches cannot contain a jump in the winding number. Those are settled by their corners and
+    //centre agreeing (always the case on closed meshes; an open mesh's 0.5 level set wandering through one makes them
+    //disagree). Touched blocks are split in octants until they are too small for that to pay off.
+    std::function<void(const glm::ivec3&, const glm::ivec3&)> classify = [&](const glm::ivec3& lo, const glm::ivec3& hi) {
+        glm::ivec3 size = hi - lo + 1;
+        if (size.x * size.y * size.z <= 8)
+        {
+            queryVoxels(lo, hi);
+            return;
+        }
+
+        //Voxel centres of the block, padded by half a voxel so a triangle exactly on the boundary still counts.
+        SDFAABB box(voxelCenter(lo) - voxelSize * 0.5f, voxelCenter(hi) + voxelSize * 0.5f);
+        if (TouchesTriangles(box))
+        {
+            glm::ivec3 mid = lo + glm::max(size / 2, glm::ivec3(1)) - 1;
+            for (int c = 0; c < 8; c++)
+            {
+                glm::ivec3 childLo((c & 1) ? mid.x + 1 : lo.x, (c & 2) ? mid.y + 1 : lo.y, (c & 4) ? mid.z + 1 : lo.z);
+                glm::ivec3 childHi((c & 1) ? hi.x : mid.x, (c & 2) ? hi.y : mid.y, (c & 4) ? hi.z : mid.z);
+                if (childLo.x <= childHi.x && childLo.y <= childHi.y && childLo.z <= childHi.z)
+                    classify(childLo, childHi);
+            }
+            return;
+        }
+
+        bool inside = Query(box.Center(), beta) > 0.5f;
+        for (int c = 0; c < 8; c++)
+        {
+            glm::ivec3 corner((c & 1) ? hi.x : lo.x, (c & 2) ? hi.y : lo.y, (c & 4) ? hi.z : lo.z);
+            if ((Query(voxelCenter(corner), beta) > 0.5f) != inside)
+            {
+                queryVoxels(lo, hi);
+                return;
+            }
+        }
+        if (inside)
+            for (int z = lo.z; z <= hi.z; z++)
+                for (int y = lo.y; y <= hi.y; y++)
+                    for (int x = lo.x; x <= hi.x; x++)
+                        outInside[flatten(glm::ivec3(x, y, z))] = 1;
+    };
+
+    uint32_t blockCount = uint32_t(blocks.x * blocks.y * blocks.z);
+    UnigmaParallelFor(blockCount, 1, [&](uint32_t b) {
+        glm::ivec3 block(b % blocks.x, (b / blocks.x) % blocks.y, b / (blocks.x * blocks.y));
+        glm::ivec3 lo = block * int(blockSize);
+        glm::ivec3 hi = glm::min(lo + int(blockSize), resolution) - 1;
+        classify(lo, hi);
+    });
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "SDFCommon.h"
+#include "../Core/UnigmaParallel.h"
+
+//Generalized winding number of a triangle mesh, for the inside/outside sign when baking brush SDFs.
+//Brute force sums the solid angle of every triangle (what CreateBrush does per voxel). This builds a BVH whose nodes
+//store the dipole of their triangles (area weighted normal sum at the area weighted centroid) and a radius around it.
+//A query further than beta * radius from a node uses the dipole instead of opening it, so cost falls to roughly
+//O(log n) per point. Larger beta is more accurate and slower; infinity gives the exact sum.
+//The winding number is ~1 inside a closed, outward facing mesh and ~0 outside, and degrades gracefully on open or
+//self intersecting meshes. Inside means > 0.5, the same threshold as |sum of solid angles| > 2 pi on the GPU.
+
+#define SDF_WINDING_DEFAULT_BETA 2.0f
+
+class SDFWindingNumber
+{
+public:
+    //Indexed mesh. Triangles wind counter clockwise seen from outside.
+    void Build(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles, uint32_t leafSize = 8);
+    //Triangle soup, three consecutive positions per triangle, like the brush vertex buffer.
+    void BuildSoup(const std::vector<glm::vec3>& soup, uint32_t leafSize = 8);
+
+    float Query(const glm::vec3& p, float beta = SDF_WINDING_DEFAULT_BETA) const;
+    bool Inside(const glm::vec3& p, float beta = SDF_WINDING_DEFAULT_BETA) const { return Query(p, beta) > 0.5f; }
+
+    //Winding numbers for many points across all cores.
+    void QueryPoints(const std::vector<glm::vec3>& points, std::vector<float>& outWinding, float beta = SDF_WINDING_DEFAULT_BETA) const;
+
+    //Inside flags for a brush volume: voxel (x, y, z) of resolution sits at lerp(bounds.min, bounds.max, (i + 0.5) / res)
+    //like in CreateBrush, stored x fastest. Only voxels near triangles are queried one by one; the empty space between
+    //them is filled per block, starting from blockSize^3 blocks, one task each across the cores.
+    void ClassifyGrid(const SDFAABB& bounds, const glm::ivec3& resolution, std::vector<uint8_t>& outInside,
+        float beta = SDF_WINDING_DEFAULT_BETA, uint32_t blockSize = 8) const;
+
+    //Exact reference, one solid angle per triangle.
+    static float BruteForce(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles, const glm::vec3& p);
+    //Signed solid angle of triangle abc seen from p, over 4 pi.
+    static float TriangleWinding(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+
+    uint32_t TriangleCount() const { return (uint32_t)corners.size() / 3; }
+    uint32_t NodeCount() const { return (uint32_t)nodes.size(); }
+    SDFAABB Bounds() const { return nodeBounds.empty() ? SDFAABB() : nodeBounds[0]; }
+
+    //True when some triangle's bounds overlap box.
+    bool TouchesTriangles(const SDFAABB& box) const;
+
+private:
+    //Query side of a node, kept to 32 bytes since traversal cost is mostly fetching these.
+    struct Node
+    {
+        glm::vec3 center = glm::vec3(0.0f); //Area weighted centroid.
+        float radius = 0.0f; //Furthest triangle corner from center.
+        glm::vec3 normal = glm::vec3(0.0f); //Sum of area weighted normals, |n| = area.
+        uint32_t next = 0; //Leaf: first triangle. Inner node: right child, the left one follows the node.
+        uint32_t count = 0; //Leaf: triangle count. Inner node: 0.
+    };
+
+    std::vector<Node> nodes;
+    std::vector<SDFAABB> nodeBounds; //Union of the triangle bounds per node, for TouchesTriangles.
+    std::vector<glm::vec3> corners; //Three per triangle, reordered so every leaf is a contiguous range.
+
+    uint32_t BuildNode(std::vector<uint32_t>& order, std::vector<glm::vec3>& centroids, const std::vector<glm::vec3>& soup,
+        uint32_t first, uint32_t count, uint32_t leafSize);
+};
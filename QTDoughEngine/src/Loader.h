@@ -1,9 +1,17 @@
 #pragma once
 #include <iostream>
+#include <string>
+#include "UnigmaNative/UnigmaNative.h"
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
 // Ensure the DLL file name matches your compiled DLL
 const char* DLLAssetPath = "../ExternalLibs/Unigma/";
 
+#ifdef _WIN32
+
 // Function to convert a const char* to a std::wstring
 std::wstring ConvertCharToWString(const char* charArray) {
     size_t len = strlen(charArray) + 1;
@@ -69,4 +77,28 @@ HMODULE LoadDLL(const wchar_t* dllName)
     SetCurrentDirectory(originalDir);
     return hModule;
 
+}
+#endif
+
+// The native plugin: UnigmaNative.dll on Windows, libUnigmaNative.so elsewhere. Null when it failed to load.
+UnigmaNativeModule LoadUnigmaNative()
+{
+#ifdef _WIN32
+    return LoadDLL(L"UnigmaNative.dll");
+#else
+    std::string path = std::string(DLLAssetPath) + "libUnigmaNative.so";
+    UnigmaNativeModule module = dlopen(path.c_str(), RTLD_NOW);
+    if (module == nullptr)
+        std::cerr << "Failed to load " << path << ": " << dlerror() << std::endl;
+    return module;
+#endif
+}
+
+void FreeUnigmaNative(UnigmaNativeModule module)
+{
+#ifdef _WIN32
+    FreeLibrary(module);
+#else
+    dlclose(module);
+#endif
 }
\ No newline at end of file
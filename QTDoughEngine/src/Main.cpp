@@ -7,7 +7,7 @@
 #include <iostream>
 #include <vulkan/vulkan.h>
 #include "Application/QTDoughApplication.h"
-#include "Engine\Core\InputManager.h"
+#include "Engine/Core/InputManager.h"
 #include "Loader.h"
 #include "UnigmaNative/UnigmaNative.h"
 #include <mutex>
@@ -44,6 +44,7 @@ static std::ofstream g_logFile;
 static TeeBuf* g_coutTee = nullptr;
 static TeeBuf* g_cerrTee = nullptr;
 
+#ifdef _WIN32
 static LONG WINAPI CrashHandler(EXCEPTION_POINTERS* ex) {
     std::cerr << "[CRASH] Unhandled exception 0x" << std::hex << ex->ExceptionRecord->ExceptionCode
         << " at address 0x" << ex->ExceptionRecord->ExceptionAddress << std::endl;
@@ -53,6 +54,7 @@ static LONG WINAPI CrashHandler(EXCEPTION_POINTERS* ex) {
     }
     return EXCEPTION_CONTINUE_SEARCH;
 }
+#endif
 
 
 UnigmaThread* QTDoughEngine;
@@ -108,7 +110,8 @@ void InitSDLWindow()
 
 void GetInput()
 {
-    qtDoughApp.PROGRAMEND = INPUTPROGRAMEND;
+    //Headless runs end themselves once their frames are done.
+    qtDoughApp.PROGRAMEND = qtDoughApp.PROGRAMEND || INPUTPROGRAMEND;
     qtDoughApp.framebufferResized = inputFramebufferResized;
 }
 
@@ -127,6 +130,11 @@ void UpdateRenderApplication()
 
 int CompileShader()
 {
+#ifndef _WIN32
+    //Compile.bat is Windows only; other platforms run the .spv files already built.
+    printf("Shader compilation skipped.\n");
+    return 0;
+#endif
     int result = std::system("src\\shaders\\Compile.bat");
     if (result != 0) {
         // Optional: handle error
@@ -148,19 +156,35 @@ int main(int argc, char* args[]) {
         std::cout.rdbuf(g_coutTee);
         std::cerr.rdbuf(g_cerrTee);
     }
+#ifdef _WIN32
     SetUnhandledExceptionFilter(CrashHandler);
+#endif
+
+    std::string argumentError;
+    if (!qtDoughApp.headless.ParseArguments(argc, args, argumentError)) {
+        std::cerr << argumentError << std::endl;
+        return EXIT_FAILURE;
+    }
+
     CompileShader();
     QTDoughApplication::SetInstance(&qtDoughApp);
 
-    //Create the window.
-    InitSDLWindow();
+    //Create the window. Headless renders offscreen and never opens one.
+    if (!qtDoughApp.headless.enabled)
+        InitSDLWindow();
+    else
+    {
+        QTSDLWindow = nullptr;
+        SCREEN_WIDTH = (int)qtDoughApp.headless.width;
+        SCREEN_HEIGHT = (int)qtDoughApp.headless.height;
+    }
 
     qtDoughApp.QTSDLWindow = QTSDLWindow;
     qtDoughApp._screenSurface = _screenSurface;
     qtDoughApp.SCREEN_WIDTH = SCREEN_WIDTH;
     qtDoughApp.SCREEN_HEIGHT = SCREEN_HEIGHT;
 
-    unigmaNative = LoadDLL(L"UnigmaNative.dll");
+    unigmaNative = LoadUnigmaNative();
     LoadUnigmaNativeFunctions();
 
     UNStartProgram();
@@ -248,7 +272,7 @@ int main(int argc, char* args[]) {
     //if (QTDoughEngine->thread.joinable())
     //    QTDoughEngine->thread.join();
     UNEndProgram();
-    FreeLibrary(unigmaNative);
+    FreeUnigmaNative(unigmaNative);
     unigmaNative = nullptr;
     qtDoughApp.Cleanup();
     delete QTDoughEngine;
@@ -0,0 +1,170 @@
+//Headless voxelizer pipeline benchmark and regression gate. Needs nothing but GLM and a C++20 compiler:
+//  cd QTDoughEngine/src
+//  g++ -std=c++20 -O2 -I<glm> -I. Tools/SDFPipelineBench.cpp Engine/SDF/SDFPipeline.cpp Engine/SDF/SDFCSG.cpp
+//      Engine/SDF/SDFTileBinning.cpp Engine/SDF/SDFWindingNumber.cpp -lpthread -o SDFPipelineBench
+//
+//  SDFPipelineBench [--scene spheres|meshes|mixed|all] [--size N] [--seed N] [--threads N] [--repeat N]
+//                   [--golden file] [--write-golden file]
+//
+//Prints one line per stage: hash, best time over the repeats, output size and the process high-water mark.
+//--golden compares the hashes against a file written by --write-golden and exits with 1 on any difference.
+
+#include "Engine/SDF/SDFPipeline.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace
+{
+    struct BenchOptions
+    {
+        std::vector<SDFPipelineSceneKind> scenes = { SDFPipelineSceneKind::Mixed };
+        int size = 2;
+        uint32_t seed = 1;
+        uint32_t threads = 0;
+        int repeat = 1;
+        std::string golden;
+        std::string writeGolden;
+    };
+
+    bool ParseScene(const char* name, std::vector<SDFPipelineSceneKind>& out)
+    {
+        if (std::strcmp(name, "spheres") == 0) out = { SDFPipelineSceneKind::Spheres };
+        else if (std::strcmp(name, "meshes") == 0) out = { SDFPipelineSceneKind::Meshes };
+        else if (std::strcmp(name, "mixed") == 0) out = { SDFPipelineSceneKind::Mixed };
+        else if (std::strcmp(name, "all") == 0) out = { SDFPipelineSceneKind::Spheres, SDFPipelineSceneKind::Meshes, SDFPipelineSceneKind::Mixed };
+        else return false;
+        return true;
+    }
+
+    bool ParseOptions(int argc, char* argv[], BenchOptions& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const char* arg = argv[i];
+            const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (value == nullptr)
+                return false;
+            if (std::strcmp(arg, "--scene") == 0) { if (!ParseScene(value, options.scenes)) return false; }
+            else if (std::strcmp(arg, "--size") == 0) options.size = std::max(std::atoi(value), 1);
+            else if (std::strcmp(arg, "--seed") == 0) options.seed = uint32_t(std::strtoul(value, nullptr, 10));
+            else if (std::strcmp(arg, "--threads") == 0) options.threads = uint32_t(std::strtoul(value, nullptr, 10));
+            else if (std::strcmp(arg, "--repeat") == 0) options.repeat = std::max(std::atoi(value), 1);
+            else if (std::strcmp(arg, "--golden") == 0) options.golden = value;
+            else if (std::strcmp(arg, "--write-golden") == 0) options.writeGolden = value;
+            else return false;
+            i++;
+        }
+        return true;
+    }
+
+    //"<scene> <stage> <hash>" per line.
+    std::map<std::string, std::string> LoadGolden(const std::string& path)
+    {
+        std::map<std::string, std::string> golden;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string scene, stage, hash;
+            if (fields >> scene >> stage >> hash)
+                golden[scene + " " + stage] = hash;
+        }
+        return golden;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "usage: %s [--scene spheres|meshes|mixed|all] [--size N] [--seed N] [--threads N] [--repeat N] "
+            "[--golden file] [--write-golden file]\n", argv[0]);
+        return 2;
+    }
+
+    std::map<std::string, std::string> golden;
+    if (!options.golden.empty())
+    {
+        golden = LoadGolden(options.golden);
+        if (golden.empty())
+        {
+            std::fprintf(stderr, "could not read golden hashes from %s\n", options.golden.c_str());
+            return 2;
+        }
+    }
+
+    SDFPipelineSettings settings;
+    settings.maxThreads = options.threads;
+
+    std::ostringstream goldenOut;
+    int mismatches = 0;
+    for (SDFPipelineSceneKind kind : options.scenes)
+    {
+        SDFPipelineScene scene = SDFPipelineScene::Canned(kind, options.size, options.seed);
+        std::printf("%s: %d^3 voxels, %zu brushes, %zu meshes\n", scene.name.c_str(), scene.grid.resolution.x,
+            scene.brushes.size(), scene.meshes.size());
+
+        //Best of the repeats per stage, hashes from the first run. Later runs must agree with it.
+        SDFPipelineOutput output;
+        SDFPipelineStageResult best[uint32_t(SDFPipelineStage::Count)];
+        for (int r = 0; r < options.repeat; r++)
+        {
+            SDFRunPipeline(scene, settings, output);
+            for (uint32_t s = 0; s < uint32_t(SDFPipelineStage::Count); s++)
+            {
+                if (r == 0)
+                    best[s] = output.stages[s];
+                else if (output.stages[s].hash != best[s].hash)
+                {
+                    std::printf("  %s changed between repeats\n", SDFPipelineStageName(SDFPipelineStage(s)));
+                    mismatches++;
+                }
+                best[s].milliseconds = std::min(best[s].milliseconds, output.stages[s].milliseconds);
+                best[s].peakResidentBytes = output.stages[s].peakResidentBytes;
+            }
+        }
+
+        double total = 0.0;
+        for (uint32_t s = 0; s < uint32_t(SDFPipelineStage::Count); s++)
+        {
+            const char* stage = SDFPipelineStageName(SDFPipelineStage(s));
+            char hash[17];
+            std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)best[s].hash);
+            total += best[s].milliseconds;
+
+            const char* verdict = "";
+            if (!golden.empty())
+            {
+                auto it = golden.find(scene.name + " " + stage);
+                verdict = it == golden.end() ? "  (no golden)" : (it->second == hash ? "  ok" : "  MISMATCH");
+                if (it == golden.end() || it->second != hash)
+                    mismatches++;
+            }
+
+            std::printf("  %-16s %s %10.2f ms %10.2f MB out %10.2f MB peak%s\n", stage, hash, best[s].milliseconds,
+                best[s].outputBytes / 1048576.0, best[s].peakResidentBytes / 1048576.0, verdict);
+            goldenOut << scene.name << " " << stage << " " << hash << "\n";
+        }
+        std::printf("  %-16s %16s %10.2f ms, %u components, %zu triangles\n", "total", "", total, output.componentCount,
+            output.triangles.size());
+    }
+
+    if (!options.writeGolden.empty())
+    {
+        std::ofstream file(options.writeGolden);
+        file << goldenOut.str();
+        if (!file)
+        {
+            std::fprintf(stderr, "could not write %s\n", options.writeGolden.c_str());
+            return 2;
+        }
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
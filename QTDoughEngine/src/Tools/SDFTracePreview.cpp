@@ -0,0 +1,193 @@
+//Renders the world SDF or the material grid to an image on the CPU, for thumbnails, CI screenshots and previews of
+//simulation state on machines without a GPU. Needs nothing but GLM and a C++20 compiler (stb_image_write.h on the
+//include path adds .png output):
+//  cd QTDoughEngine/src
+//  g++ -std=c++20 -O2 -mavx2 -I<glm> -I. Tools/SDFTracePreview.cpp Engine/SDF/SDFSphereTracer.cpp Engine/SDF/SDFPacketTracer.cpp
+//      Engine/SDF/SDFConeMarch.cpp Engine/SDF/SDFMipPyramid.cpp Engine/SDF/SDFPipeline.cpp Engine/SDF/SDFCSG.cpp Engine/SDF/SDFTileBinning.cpp Engine/SDF/SDFWindingNumber.cpp
+//      -lpthread -o SDFTracePreview
+//
+//  SDFTracePreview [--scene spheres|meshes|mixed] [--size N] [--seed N]         canned scene run through SDFPipeline
+//                  [--field file --res X Y Z --extent X Y Z]                     or raw float32 field, x fastest
+//                  [--material file --material-res X Y Z]                        raw float4 fieldValues per cell
+//                  [--mode albedo|normal|depth|heat|material] [--width W] [--height H]
+//                  [--eye X Y Z] [--target X Y Z] [--fov degrees] [--out image.ppm|image.png]
+//                  [--scalar]                                                    one ray at a time instead of packets
+//                  [--no-cone]                                                   every ray starts at the camera
+
+#if __has_include("stb_image_write.h")
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+#endif
+#include "Engine/SDF/SDFSphereTracer.h"
+#include "Engine/SDF/SDFPipeline.h"
+#include "Engine/SDF/SDFConeMarch.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    struct PreviewOptions
+    {
+        SDFPipelineSceneKind scene = SDFPipelineSceneKind::Mixed;
+        int size = 2;
+        uint32_t seed = 1;
+        std::string field;
+        glm::ivec3 resolution = glm::ivec3(0);
+        glm::vec3 extent = glm::vec3(0.0f);
+        std::string material;
+        glm::ivec3 materialResolution = glm::ivec3(256, 256, 64);
+        SDFTraceMode mode = SDFTraceMode::Albedo;
+        int width = 512;
+        int height = 512;
+        glm::vec3 eye = glm::vec3(0.0f);
+        glm::vec3 target = glm::vec3(0.0f);
+        bool eyeSet = false;
+        float fov = 45.0f;
+        std::string out = "preview.ppm";
+        bool packets = true;
+        bool cones = true;
+    };
+
+    bool ParseVec3(char* argv[], int argc, int& i, glm::vec3& out)
+    {
+        if (i + 3 >= argc)
+            return false;
+        out = glm::vec3(float(std::atof(argv[i + 1])), float(std::atof(argv[i + 2])), float(std::atof(argv[i + 3])));
+        i += 3;
+        return true;
+    }
+
+    bool ParseOptions(int argc, char* argv[], PreviewOptions& o)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const char* arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            glm::vec3 v;
+            if (std::strcmp(arg, "--scene") == 0 && hasValue)
+            {
+                const char* name = argv[++i];
+                if (std::strcmp(name, "spheres") == 0) o.scene = SDFPipelineSceneKind::Spheres;
+                else if (std::strcmp(name, "meshes") == 0) o.scene = SDFPipelineSceneKind::Meshes;
+                else if (std::strcmp(name, "mixed") == 0) o.scene = SDFPipelineSceneKind::Mixed;
+                else return false;
+            }
+            else if (std::strcmp(arg, "--mode") == 0 && hasValue)
+            {
+                const char* name = argv[++i];
+                if (std::strcmp(name, "albedo") == 0) o.mode = SDFTraceMode::Albedo;
+                else if (std::strcmp(name, "normal") == 0) o.mode = SDFTraceMode::Normal;
+                else if (std::strcmp(name, "depth") == 0) o.mode = SDFTraceMode::Depth;
+                else if (std::strcmp(name, "heat") == 0) o.mode = SDFTraceMode::Heat;
+                else if (std::strcmp(name, "material") == 0) o.mode = SDFTraceMode::MaterialHeat;
+                else return false;
+            }
+            else if (std::strcmp(arg, "--size") == 0 && hasValue) o.size = std::max(std::atoi(argv[++i]), 1);
+            else if (std::strcmp(arg, "--seed") == 0 && hasValue) o.seed = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+            else if (std::strcmp(arg, "--field") == 0 && hasValue) o.field = argv[++i];
+            else if (std::strcmp(arg, "--material") == 0 && hasValue) o.material = argv[++i];
+            else if (std::strcmp(arg, "--width") == 0 && hasValue) o.width = std::max(std::atoi(argv[++i]), 1);
+            else if (std::strcmp(arg, "--height") == 0 && hasValue) o.height = std::max(std::atoi(argv[++i]), 1);
+            else if (std::strcmp(arg, "--fov") == 0 && hasValue) o.fov = float(std::atof(argv[++i]));
+            else if (std::strcmp(arg, "--out") == 0 && hasValue) o.out = argv[++i];
+            else if (std::strcmp(arg, "--scalar") == 0) o.packets = false;
+            else if (std::strcmp(arg, "--no-cone") == 0) o.cones = false;
+            else if (std::strcmp(arg, "--res") == 0 && ParseVec3(argv, argc, i, v)) o.resolution = glm::ivec3(v);
+            else if (std::strcmp(arg, "--material-res") == 0 && ParseVec3(argv, argc, i, v)) o.materialResolution = glm::ivec3(v);
+            else if (std::strcmp(arg, "--extent") == 0 && ParseVec3(argv, argc, i, v)) o.extent = v;
+            else if (std::strcmp(arg, "--eye") == 0 && ParseVec3(argv, argc, i, v)) { o.eye = v; o.eyeSet = true; }
+            else if (std::strcmp(arg, "--target") == 0 && ParseVec3(argv, argc, i, v)) o.target = v;
+            else return false;
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool LoadRaw(const std::string& path, size_t count, std::vector<T>& out)
+    {
+        std::ifstream file(path, std::ios::binary);
+        out.resize(count);
+        file.read(reinterpret_cast<char*>(out.data()), std::streamsize(count * sizeof(T)));
+        return bool(file);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    PreviewOptions o;
+    if (!ParseOptions(argc, argv, o))
+    {
+        std::fprintf(stderr, "usage: see the header of SDFTracePreview.cpp\n");
+        return 2;
+    }
+
+    SDFGridDesc grid;
+    std::vector<float> field;
+    if (!o.field.empty())
+    {
+        if (glm::any(glm::lessThanEqual(o.resolution, glm::ivec3(0))) || glm::any(glm::lessThanEqual(o.extent, glm::vec3(0.0f))))
+        {
+            std::fprintf(stderr, "--field needs --res and --extent\n");
+            return 2;
+        }
+        grid = SDFGridDesc(o.resolution, o.extent);
+        if (!LoadRaw(o.field, grid.VoxelCount(), field))
+        {
+            std::fprintf(stderr, "could not read %zu floats from %s\n", grid.VoxelCount(), o.field.c_str());
+            return 2;
+        }
+    }
+    else
+    {
+        SDFPipelineScene scene = SDFPipelineScene::Canned(o.scene, o.size, o.seed);
+        SDFPipelineOutput pipeline;
+        SDFRunPipeline(scene, SDFPipelineSettings(), pipeline);
+        grid = scene.grid;
+        field = std::move(pipeline.distance);
+    }
+
+    SDFMaterialGrid material;
+    if (!o.material.empty())
+    {
+        material.resolution = o.materialResolution;
+        material.sceneSize = grid.sceneSize;
+        if (!LoadRaw(o.material, size_t(material.resolution.x) * material.resolution.y * material.resolution.z, material.fieldValues))
+        {
+            std::fprintf(stderr, "could not read the material grid from %s\n", o.material.c_str());
+            return 2;
+        }
+    }
+
+    SDFMipPyramid pyramid;
+    pyramid.Build(grid, field.data(), SDFMipReduce::Min, SDF_CONE_COARSE_LEVEL - 1);
+
+    SDFSphereTracer tracer;
+    tracer.SetField(grid, &field);
+    tracer.SetMaterialGrid(&material);
+    tracer.SetPyramid(o.cones ? &pyramid : nullptr);
+
+    //Default view looks at the scene from a raised corner, z up like the world.
+    if (!o.eyeSet)
+        o.eye = grid.sceneSize * glm::vec3(0.9f, -1.1f, 0.8f);
+    SDFTraceCamera camera = SDFTraceCamera::LookAt(o.eye, o.target, glm::vec3(0.0f, 0.0f, 1.0f), o.fov, float(o.width) / float(o.height));
+
+    SDFTraceSettings settings;
+    settings.mode = o.mode;
+    settings.packets = o.packets;
+    SDFTraceImage image;
+    auto start = std::chrono::steady_clock::now();
+    SDFTraceStats stats = tracer.Render(camera, settings, o.width, o.height, image);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%dx%d in %.2f ms, %llu hits, %.1f steps per ray, %llu cone steps\n", o.width, o.height, ms, (unsigned long long)stats.hits,
+        stats.rays > 0 ? double(stats.steps) / double(stats.rays) : 0.0, (unsigned long long)stats.coneSteps);
+    if (!SDFWriteImage(o.out, image))
+    {
+        std::fprintf(stderr, "could not write %s\n", o.out.c_str());
+        return 1;
+    }
+    return 0;
+}
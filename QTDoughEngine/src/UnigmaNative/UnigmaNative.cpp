@@ -8,6 +8,9 @@
 #include "stb_image.h"
 #include "../Engine/RenderPasses/VoxelizerPass.h"
 #include "../Engine/Physics/MaterialSimulationPass.h"
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
 
 AssetLoader assetLoader;
 static std::string currentLoadedSceneName;
@@ -37,33 +40,42 @@ FnRegisterRayCastSDFCallback UNRegisterRayCastSDFCallback;
 FnGetGameObject UNGetGameObject;
 FnGetComponentAttribute UNGetComponentAttribute;
 
-HMODULE unigmaNative;
+UnigmaNativeModule unigmaNative;
+
+static void* NativeSymbol(const char* name)
+{
+#ifdef _WIN32
+    return (void*)GetProcAddress(unigmaNative, name);
+#else
+    return dlsym(unigmaNative, name);
+#endif
+}
 
 void LoadGameObjectHooks()
 {
-    UNGetGameObject = (FnGetGameObject)GetProcAddress(unigmaNative, "GetGameObject");
-    UNGetComponentAttribute = (FnGetComponentAttribute)GetProcAddress(unigmaNative, "GetComponentAttribute");
+    UNGetGameObject = (FnGetGameObject)NativeSymbol("GetGameObject");
+    UNGetComponentAttribute = (FnGetComponentAttribute)NativeSymbol("GetComponentAttribute");
 }
 
 void LoadUnigmaNativeFunctions()
 {
-    UNStartProgram = (FnStartProgram)GetProcAddress(unigmaNative, "StartProgram");
-    UNEndProgram = (FnEndProgram)GetProcAddress(unigmaNative, "EndProgram");
-    UNUpdateProgram = (FnUpdateProgram)GetProcAddress(unigmaNative, "UpdateProgram");
+    UNStartProgram = (FnStartProgram)NativeSymbol("StartProgram");
+    UNEndProgram = (FnEndProgram)NativeSymbol("EndProgram");
+    UNUpdateProgram = (FnUpdateProgram)NativeSymbol("UpdateProgram");
 
     LoadGameObjectHooks();
 
-    UNGetRenderObjectAt = (FnGetRenderObjectAt)GetProcAddress(unigmaNative, "GetRenderObjectAt");
-    UNGetRenderObjectsSize = (FnGetRenderObjectsSize)GetProcAddress(unigmaNative, "GetRenderObjectsSize");
-    UNGetCamera = (FnGetCamera)GetProcAddress(unigmaNative, "GetCamera");
-    UNGetCamerasSize = (FnGetCamerasSize)GetProcAddress(unigmaNative, "GetCamerasSize");
-    UNGetLight = (FnGetLight)GetProcAddress(unigmaNative, "GetLight");
-    UNGetLightsSize = (FnGetLightsSize)GetProcAddress(unigmaNative, "GetLightsSize");
-    UNRegisterCallback = (FnRegisterCallback)GetProcAddress(unigmaNative, "RegisterCallback");
-    UNRegisterLoadSceneCallback = (FnRegisterLoadSceneCallback)GetProcAddress(unigmaNative, "RegisterLoadSceneCallback");
-    UNRegisterLoadInputCallback = (FnRegisterLoadInputCallback)GetProcAddress(unigmaNative, "RegisterLoadInputCallback");
-    UNRegisterAddBrushCallback = (FnRegisterAddBrushCallback)GetProcAddress(unigmaNative, "RegisterAddBrushCallback");
-    UNRegisterRayCastSDFCallback = (FnRegisterRayCastSDFCallback)GetProcAddress(unigmaNative, "RegisterRayCastSDFCallback");
+    UNGetRenderObjectAt = (FnGetRenderObjectAt)NativeSymbol("GetRenderObjectAt");
+    UNGetRenderObjectsSize = (FnGetRenderObjectsSize)NativeSymbol("GetRenderObjectsSize");
+    UNGetCamera = (FnGetCamera)NativeSymbol("GetCamera");
+    UNGetCamerasSize = (FnGetCamerasSize)NativeSymbol("GetCamerasSize");
+    UNGetLight = (FnGetLight)NativeSymbol("GetLight");
+    UNGetLightsSize = (FnGetLightsSize)NativeSymbol("GetLightsSize");
+    UNRegisterCallback = (FnRegisterCallback)NativeSymbol("RegisterCallback");
+    UNRegisterLoadSceneCallback = (FnRegisterLoadSceneCallback)NativeSymbol("RegisterLoadSceneCallback");
+    UNRegisterLoadInputCallback = (FnRegisterLoadInputCallback)NativeSymbol("RegisterLoadInputCallback");
+    UNRegisterAddBrushCallback = (FnRegisterAddBrushCallback)NativeSymbol("RegisterAddBrushCallback");
+    UNRegisterRayCastSDFCallback = (FnRegisterRayCastSDFCallback)NativeSymbol("RegisterRayCastSDFCallback");
 
     //Register the callback function
     UNRegisterCallback(ApplicationFunction);
@@ -7,6 +7,13 @@
 #include "../Engine/Renderer/UnigmaLights.h"
 #include "../Engine/Core/InputManager.h"
 
+#ifdef _WIN32
+#include <windows.h>
+typedef HMODULE UnigmaNativeModule;
+#else
+typedef void* UnigmaNativeModule; //dlopen handle.
+#endif
+
 
 
 // Define a callback function signature
@@ -73,7 +80,7 @@ int AddBrushFromNative(uint32_t type, float px, float py, float pz,
     float blend, float smoothness, uint32_t opcode, int density, float stiffness);
 int RayCastSDFFromNative(Photon* photon);
 
-extern HMODULE unigmaNative;
+extern UnigmaNativeModule unigmaNative;
 
 void LoadUnigmaNativeFunctions();
 void LoadGameObjectHooks();
@@ -0,0 +1,83 @@
+//Cone prepass over the coarse world SDF levels, mirrored in Engine/SDF/SDFConeMarch.h/.cpp. Keep both files in sync;
+//the C++ side is the reference and its tests cover the bounds.
+//One cone per 8x8 tile holds every pixel ray of the tile and only advances through space the L3/L4 levels prove empty,
+//so the depth it returns is a safe start for all of them.
+//The including shader defines ConeReadLevel(level, cell): the value of world SDF level (1 = full resolution) at cell.
+//GenerateMIPS averages, so a cell only bounds the field to within its footprint diagonal.
+
+#define SDF_CONE_TILE 8
+#define SDF_CONE_FINE_LEVEL 3
+#define SDF_CONE_COARSE_LEVEL 4
+#define SDF_CONE_MAX_STEPS 64
+#define SDF_CONE_MARGIN_VOXELS 1.0f
+
+struct SDFTileCone
+{
+    float3 origin;
+    float3 direction;
+    float offset; //Largest distance between pixel ray origins and the axis origin.
+    float spread; //Largest |d - direction| over the tile.
+    float tFar; //Past this every pixel ray is outside the grid.
+};
+
+SDFTileCone SDFMakeTileCone(float3 axisOrigin, float3 axisDirection, float3 cornerOrigins[4], float3 cornerDirections[4], float3 sceneSize)
+{
+    SDFTileCone cone;
+    cone.origin = axisOrigin;
+    cone.direction = axisDirection;
+    cone.offset = 0.0f;
+    cone.spread = 0.0f;
+    [unroll]
+    for (int i = 0; i < 4; i++)
+    {
+        cone.offset = max(cone.offset, length(cornerOrigins[i] - axisOrigin));
+        cone.spread = max(cone.spread, length(cornerDirections[i] - axisDirection));
+    }
+
+    float3 halfScene = sceneSize * 0.5f;
+    cone.tFar = 0.0f;
+    [unroll]
+    for (int c = 0; c < 8; c++)
+    {
+        float3 corner = float3((c & 1) ? halfScene.x : -halfScene.x, (c & 2) ? halfScene.y : -halfScene.y, (c & 4) ? halfScene.z : -halfScene.z);
+        cone.tFar = max(cone.tFar, length(corner - axisOrigin));
+    }
+    cone.tFar += cone.offset;
+    return cone;
+}
+
+float SDFConeBound(int level, float3 p, int3 voxelResolution, float3 sceneSize)
+{
+    float3 halfScene = sceneSize * 0.5f;
+    float3 voxelSize = sceneSize / float3(voxelResolution);
+    float3 q = clamp(p, -halfScene, halfScene);
+    int mip = level - 1;
+    int3 v = clamp(int3(floor((q + halfScene) / voxelSize)), int3(0, 0, 0), voxelResolution - 1);
+    float inside = ConeReadLevel(level, v >> mip) - float(1 << mip) * length(voxelSize);
+
+    //Outside, q is the grid point nearest p, so for anything in the grid |p - g|^2 >= |p - q|^2 + |q - g|^2.
+    float outside = length(p - q);
+    if (outside <= 0.0f)
+        return inside;
+    inside = max(inside, 0.0f);
+    return sqrt(outside * outside + inside * inside);
+}
+
+float SDFMarchCone(SDFTileCone cone, int3 voxelResolution, float3 sceneSize)
+{
+    float3 voxelSize = sceneSize / float3(voxelResolution);
+    float voxel = min(voxelSize.x, min(voxelSize.y, voxelSize.z));
+    float margin = voxel * SDF_CONE_MARGIN_VOXELS;
+
+    float t = 0.0f;
+    for (int steps = 0; steps < SDF_CONE_MAX_STEPS && t < cone.tFar; steps++)
+    {
+        float3 p = cone.origin + cone.direction * t;
+        float bound = max(SDFConeBound(SDF_CONE_FINE_LEVEL, p, voxelResolution, sceneSize), SDFConeBound(SDF_CONE_COARSE_LEVEL, p, voxelResolution, sceneSize));
+        float clearance = bound - (cone.offset + cone.spread * t) - margin;
+        if (clearance < voxel)
+            break;
+        t += clearance / (1.0f + cone.spread);
+    }
+    return min(t, cone.tFar);
+}
@@ -0,0 +1,109 @@
+//12 byte voxel encoding, mirrored in Engine/SDF/SDFVoxelPacking.h. Keep both files in sync.
+//  distances    : distance (snorm16, low) | normalDistance.w (snorm16, high), both scaled by the distance range
+//  normal       : octahedral normal, x (snorm16, low) | y (snorm16, high)
+//  brushDensity : brushId (16 bits, low) | density (unorm16 over [0, SDF_VOXEL_DENSITY_MAX], high)
+//Rounding is floor(x + 0.5) on both sides so the CPU and GPU produce the same bits.
+
+#define SDF_VOXEL_DISTANCE_RANGE 4.0f
+#define SDF_VOXEL_DENSITY_MAX 8.0f
+#define SDF_VOXEL_MAX_BRUSH_ID 0xFFFFu
+
+struct VoxelPacked
+{
+    uint distances;
+    uint normal;
+    uint brushDensity;
+};
+
+uint SDFPackSnorm16(float v)
+{
+    v = clamp(v, -1.0f, 1.0f);
+    int q = (int) floor(v * 32767.0f + 0.5f);
+    return asuint(q) & 0xFFFFu;
+}
+
+float SDFUnpackSnorm16(uint bits)
+{
+    int q = asint(bits << 16) >> 16;
+    return max((float) q / 32767.0f, -1.0f);
+}
+
+uint SDFPackUnorm16(float v)
+{
+    v = saturate(v);
+    return (uint) floor(v * 65535.0f + 0.5f);
+}
+
+float SDFUnpackUnorm16(uint bits)
+{
+    return (float) (bits & 0xFFFFu) / 65535.0f;
+}
+
+float2 SDFOctEncode(float3 n)
+{
+    float sum = abs(n.x) + abs(n.y) + abs(n.z);
+    if (sum <= 0.0f)
+        return float2(0.0f, 0.0f);
+
+    float2 p = n.xy / sum;
+    if (n.z < 0.0f)
+    {
+        float2 fold = float2(1.0f - abs(p.y), 1.0f - abs(p.x));
+        p = float2(p.x >= 0.0f ? fold.x : -fold.x, p.y >= 0.0f ? fold.y : -fold.y);
+    }
+    return p;
+}
+
+float3 SDFOctDecode(float2 p)
+{
+    float3 n = float3(p.x, p.y, 1.0f - abs(p.x) - abs(p.y));
+    float t = max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+uint SDFPackNormalOct16(float3 n)
+{
+    float2 p = SDFOctEncode(n);
+    return SDFPackSnorm16(p.x) | (SDFPackSnorm16(p.y) << 16);
+}
+
+float3 SDFUnpackNormalOct16(uint bits)
+{
+    return SDFOctDecode(float2(SDFUnpackSnorm16(bits), SDFUnpackSnorm16(bits >> 16)));
+}
+
+VoxelPacked SDFEncodeVoxel(float distance, float normalDistance, float3 normal, uint brushId, float density, float distanceRange = SDF_VOXEL_DISTANCE_RANGE)
+{
+    VoxelPacked v;
+    v.distances = SDFPackSnorm16(distance / distanceRange) | (SDFPackSnorm16(normalDistance / distanceRange) << 16);
+    v.normal = SDFPackNormalOct16(normal);
+    v.brushDensity = min(brushId, SDF_VOXEL_MAX_BRUSH_ID) | (SDFPackUnorm16(density / SDF_VOXEL_DENSITY_MAX) << 16);
+    return v;
+}
+
+float SDFDecodeVoxelDistance(VoxelPacked v, float distanceRange = SDF_VOXEL_DISTANCE_RANGE)
+{
+    return SDFUnpackSnorm16(v.distances) * distanceRange;
+}
+
+float SDFDecodeVoxelNormalDistance(VoxelPacked v, float distanceRange = SDF_VOXEL_DISTANCE_RANGE)
+{
+    return SDFUnpackSnorm16(v.distances >> 16) * distanceRange;
+}
+
+float3 SDFDecodeVoxelNormal(VoxelPacked v)
+{
+    return SDFUnpackNormalOct16(v.normal);
+}
+
+uint SDFDecodeVoxelBrushId(VoxelPacked v)
+{
+    return v.brushDensity & 0xFFFFu;
+}
+
+float SDFDecodeVoxelDensity(VoxelPacked v)
+{
+    return SDFUnpackUnorm16(v.brushDensity >> 16) * SDF_VOXEL_DENSITY_MAX;
+}
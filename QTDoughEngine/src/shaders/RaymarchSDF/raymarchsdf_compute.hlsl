@@ -8,6 +8,9 @@ SamplerState samplers[] : register(s1, space0); //Global
 
 #include "../Helpers/ShaderHelpers.hlsl"
 
+#define SDFSampleSource uint
+#include "../../Engine/SDF/SDFSampling.h"
+
 
 
 struct UnigmaMaterial
@@ -86,6 +89,27 @@ float Read3DMip(uint textureIndex, int3 coord, int level)
     return gBindless3D[textureIndex].Load(int4(coord, level));
 }
 
+//World SDF levels live one per texture, L1 at index 0 (see TrilinearSampleSDFTexture).
+float ConeReadLevel(int level, int3 cell)
+{
+    return Read3D(level - 1, cell);
+}
+
+#include "../Helpers/ConeMarch.hlsl"
+
+//Shared sampling reads world SDF level textures, the source is the texture index (level - 1).
+float SDFSampleLoad(uint source, SDFSampleGrid grid, int3 cell)
+{
+    return Read3D(source, cell);
+}
+
+SDFSampleGrid WorldSDFSampleGrid(float sampleLevel)
+{
+    return SDFMakeSampleGrid(int3(GetVoxelResolutionWorldSDFArbitrary(sampleLevel, pc.voxelResolution).xyz), GetSceneSize());
+}
+
+groupshared float gTileStart;
+
 // This uses the GPU's dedicated hardware for full, automatic trilinear filtering
 float2 HardwareTrilinearSample(uint textureIndex, float3 uvw)
 {
@@ -446,12 +470,8 @@ float3 CentralDifferenceNormalTexture(float3 p, float sampleLevel)
     
     float eps = 0.022127f * pow(2.0f, 1.0f + (smoothness * 8.0f) + blendFactor);
 
-    float dx = TrilinearSampleSDFTextureNormals(p + float3(eps, 0, 0), sampleLevel).x - TrilinearSampleSDFTextureNormals(p - float3(eps, 0, 0), sampleLevel).x;
-    float dy = TrilinearSampleSDFTextureNormals(p + float3(0, eps, 0), sampleLevel).x - TrilinearSampleSDFTextureNormals(p - float3(0, eps, 0), sampleLevel).x;
-    float dz = TrilinearSampleSDFTextureNormals(p + float3(0, 0, eps), sampleLevel).x - TrilinearSampleSDFTextureNormals(p - float3(0, 0, eps), sampleLevel).x;
-
-    float3 n = float3(dx, dy, dz);
-    return (length(n) > 1e-5f) ? normalize(n) : float3(0, 0, 0);
+    //4 tap tetrahedral gradient, the same query SDFSampleNormal makes on the CPU.
+    return SDFSampleNormal(uint(sampleLevel - 1), WorldSDFSampleGrid(sampleLevel), p, eps);
 }
 
 float3 CentralDifferenceNormal(float3 p)
@@ -752,13 +772,13 @@ float4 SphereMarch(float3 ro, float3 rd, inout float4 resultOutput)
 }
 
 
-float4 FullMarch(float3 ro, float3 rd, float3 camPos, inout float4 surface, inout float4 visibility, inout float4 specular, inout float4 positionId)
+float4 FullMarch(float3 ro, float3 rd, float3 camPos, float tStart, inout float4 surface, inout float4 visibility, inout float4 specular, inout float4 positionId)
 {
     visibility = 1;
     float3 direction = rd;
     float3 light = normalize(float3(-0.85f, 1.0, 0.5f));
     
-    float3 pos = ro;
+    float3 pos = ro + rd * tStart; //Cone prepass start, depth is still measured from ro.
     int maxSteps = 1024;
     float4 closesSDF = 1.0f;
     float4 currentSDF = 1.0f;
@@ -940,20 +960,14 @@ float3 turboColor(float t)
 
 float4 SampleMaterialGridSDF(float3 pos)
 {
-    float3 sceneSize = GetSceneSize();
-    float3 halfScene = sceneSize * 0.5;
-    int3 gridRes = int3(256, 256, 64);
+    SDFSampleGrid grid = SDFMakeSampleGrid(GetMaterialGridSize(), GetSceneSize());
 
-    if (any(pos < -halfScene) || any(pos >= halfScene))
+    if (!SDFSampleInside(grid, pos))
     {
         return float4(DEFUALT_EMPTY_SPACE, 0, 0, 0);
     }
 
-
-    float3 gridPos = ((pos + halfScene) / sceneSize) * float3(gridRes);
-    int3 coord = clamp(int3(floor(gridPos)), int3(0,0,0), gridRes - 1);
-    uint idx = Flatten3D(coord, gridRes); //coord.x + coord.y * gridRes.x + coord.z * gridRes.x * gridRes.y;
-    return materialGrid[idx].fieldValues;
+    return materialGrid[SDFSampleIndex(grid, SDFSampleCell(grid, pos))].fieldValues;
 }
 
 float3 CentralDifferenceNormalMaterialGrid(float3 p)
@@ -971,7 +985,7 @@ float3 CentralDifferenceNormalMaterialGrid(float3 p)
 float4 MaterialGridMarch(float3 ro, float3 rd, inout float4 materialPoint)
 {
     float3 sceneSize = GetSceneSize();
-    float3 cellSize = sceneSize / float3(256, 256, 64);
+    float3 cellSize = sceneSize / float3(GetMaterialGridSize());
     float minStep = min(cellSize.x, min(cellSize.y, cellSize.z)) * 0.1;
 
     float t = 0.0;
@@ -1090,8 +1104,43 @@ float3 StylizedHeat(float t)
 
 }
 
+//The ray main() builds for a point of the image, in pixels from the top left corner.
+void CameraRayAt(float2 pixelPos, float4x4 invProj, float4x4 invView, out float3 rayOrigin, out float3 rayDir)
+{
+    float2 uv = pixelPos * texelSize.xy * 2.0 - 1.0;
+    uv.y = -uv.y;
+    float4 viewPos = mul(invProj, float4(uv.x, uv.y, 0, 1));
+
+    float3 perspectiveRayDir = normalize(mul((float3x3) invView, normalize(viewPos.xyz)));
+    float3 perspectiveRayOrigin = mul(invView, float4(0, 0, 0, 1)).xyz;
+    float3 orthoRayOrigin = mul(invView, float4(viewPos.xyz, 1.0)).xyz;
+    float3 orthoRayDir = normalize(mul((float3x3) invView, float3(0.0, 0.0, -1.0)));
+
+    rayOrigin = lerp(perspectiveRayOrigin, orthoRayOrigin, isOrtho);
+    rayDir = lerp(perspectiveRayDir, orthoRayDir, isOrtho);
+}
+
+//Cone prepass of this thread group's 8x8 tile.
+float TileStartDepth(uint2 groupId, float4x4 invProj, float4x4 invView)
+{
+    float2 tileMin = float2(groupId * SDF_CONE_TILE);
+    float2 tileMax = min(tileMin + SDF_CONE_TILE, 1.0f / texelSize.xy);
+
+    float3 axisOrigin, axisDir;
+    CameraRayAt((tileMin + tileMax) * 0.5f, invProj, invView, axisOrigin, axisDir);
+    float3 cornerOrigins[4];
+    float3 cornerDirs[4];
+    CameraRayAt(float2(tileMin.x, tileMin.y), invProj, invView, cornerOrigins[0], cornerDirs[0]);
+    CameraRayAt(float2(tileMax.x, tileMin.y), invProj, invView, cornerOrigins[1], cornerDirs[1]);
+    CameraRayAt(float2(tileMin.x, tileMax.y), invProj, invView, cornerOrigins[2], cornerDirs[2]);
+    CameraRayAt(float2(tileMax.x, tileMax.y), invProj, invView, cornerOrigins[3], cornerDirs[3]);
+
+    SDFTileCone cone = SDFMakeTileCone(axisOrigin, axisDir, cornerOrigins, cornerDirs, GetSceneSize());
+    return SDFMarchCone(cone, pc.voxelResolution, GetSceneSize());
+}
+
 [numthreads(8, 8, 1)]
-void main(uint3 DTid : SV_DispatchThreadID)
+void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint3 Gid : SV_GroupID)
 {
     UnigmaMaterial material;
     material.baseColor = float4(0.90, 0.9, 0.78, 1.0);
@@ -1100,6 +1149,11 @@ void main(uint3 DTid : SV_DispatchThreadID)
     Images image = InitImages();
     float4x4 invProj = inverse(proj);
     float4x4 invView = inverse(view);
+
+    //One thread marches the tile's cone, every thread of the group starts its ray from the result.
+    if (GTid.x == 0 && GTid.y == 0)
+        gTileStart = TileStartDepth(Gid.xy, invProj, invView);
+    GroupMemoryBarrierWithGroupSync();
     
     uint2 pixel = DTid.xy;
     uint2 outputImageIndex = uint2(DTid.x, DTid.y);
@@ -1146,7 +1200,7 @@ void main(uint3 DTid : SV_DispatchThreadID)
     float4 positionId = 0;
     float4 surfaceFull = float4(0, 0, 0, 0);
     
-    float4 hit = FullMarch(interpRayOrigin, interpRayDir, camPos, surface, visibility, specular, positionId);
+    float4 hit = FullMarch(interpRayOrigin, interpRayDir, camPos, gTileStart, surface, visibility, specular, positionId);
     FieldFullMarch(interpRayOrigin, interpRayDir, camPos, surfaceFull, visibility, specular, positionId);
     float4 col = (hit.x < 1.0f) ? float4(1, 1, 1, 1) : float4(0, 0, 0, 0);
     
@@ -568,10 +568,12 @@ void main(uint3 DTid : SV_DispatchThreadID)
     uint brushID = DTid.x;
     Brush brush = Brushes[brushID];
     
-    //This happens when aabbmax roughly equals aabbmin.
-    /*
+    //Removed brush, the slot is kept until AddBrush reuses it.
     if(brush.isDirty == 2)
         return;
+    
+    //This happens when aabbmax roughly equals aabbmin.
+    /*
     if(brush.id > MAX_BRUSHES)
         return;
     */
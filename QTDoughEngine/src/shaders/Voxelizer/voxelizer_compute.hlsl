@@ -1,6 +1,9 @@
 ﻿﻿
 #include "../Helpers/ShaderHelpers.hlsl"
 
+#define SDFSampleSource uint
+#include "../../Engine/SDF/SDFSampling.h"
+
 struct DrawIndirectCommand
 {
     uint vertexCount;
@@ -180,10 +183,10 @@ float2 Read3DTransformed(in Brush brush, float3 worldPos)
     float3 localPos = mul(brush.invModel, float4(worldPos, 1.0f)).xyz;
 
     // map localPos into [0,1] using the SAME bounds used to author the volume
-    float3 uvw = (localPos - brush.aabbmin.xyz) / (brush.aabbmax.xyz - brush.aabbmin.xyz);
+    float3 uvw = SDFBrushUVW(localPos, brush.aabbmin.xyz, brush.aabbmax.xyz);
 
     // outside = empty
-    if (any(uvw < 0.0f) || any(uvw > 1.0f))
+    if (!SDFBrushUVWInside(uvw))
         return DEFUALT_EMPTY_SPACE;
 
     return Read3DTrilinearManual(brush.textureID2, uvw, (int) brush.resolution);
@@ -195,6 +198,12 @@ float Read3D(uint textureIndex, int3 coord)
 {
     return gBindless3D[textureIndex].Load(int4(coord, 0));
 }
+
+//Shared sampling reads world SDF level textures, the source is the texture index (mip).
+float SDFSampleLoad(uint source, SDFSampleGrid grid, int3 cell)
+{
+    return Read3D(source, cell);
+}
 /*
 float2 Read3D(uint textureIndex, int3 coord)
 {    
@@ -610,13 +619,9 @@ float GetSolidAngle(float3 p, float3 a, float3 b, float3 c)
     return 2.0f * atan2(triple_product, denominator);
 }
 
-void CreateBrush(uint3 DTid : SV_DispatchThreadID)
+//Local cook bounds of a brush, written to its header. Shared by CreateBrush and CreateBrushInstance.
+void WriteBrushBounds(uint index, Brush brush, out float3 minBounds, out float3 maxBounds, out float3 center)
 {
-    uint index = pc.triangleCount;
-    Brush brush = Brushes[index];
-
-    float3 minBounds, maxBounds;
-    float3 center;
     float maxExtent;
 
     if (brush.type == PrimSphere)
@@ -644,6 +649,16 @@ void CreateBrush(uint3 DTid : SV_DispatchThreadID)
     Brushes[index].invModel = inverse(Brushes[index].model);
     Brushes[index].aabbmax.xyz = maxBounds;
     Brushes[index].aabbmin.xyz = minBounds;
+}
+
+void CreateBrush(uint3 DTid : SV_DispatchThreadID)
+{
+    uint index = pc.triangleCount;
+    Brush brush = Brushes[index];
+
+    float3 minBounds, maxBounds;
+    float3 center;
+    WriteBrushBounds(index, brush, minBounds, maxBounds, center);
 
     float3 uvw = ((float3) DTid + 0.5f) / brush.resolution; // use centers
     float3 localPos = lerp(minBounds, maxBounds, uvw); // SAME bounds you stored
@@ -751,6 +766,34 @@ void CreateBrush(uint3 DTid : SV_DispatchThreadID)
     }
 }
 
+//Brush sharing the cooked volume of brush pc.voxelResolution.w (same mesh, resolution and blend). The texels are already
+//there, so this only writes what CreateBrush would have written per brush. One thread per coarse material grid cell.
+void CreateBrushInstance(uint3 DTid : SV_DispatchThreadID)
+{
+    uint index = pc.triangleCount;
+    uint source = (uint) pc.voxelResolution.w;
+
+    int3 gridRes = int3(MATERIAL_BRUSH_GRID_RES, MATERIAL_BRUSH_GRID_RES, MATERIAL_BRUSH_GRID_RES);
+    if (all((int3) DTid < gridRes))
+    {
+        int gridSize = MATERIAL_BRUSH_GRID_RES * MATERIAL_BRUSH_GRID_RES * MATERIAL_BRUSH_GRID_RES;
+        int cell = Flatten3D((int3) DTid, gridRes);
+        materialBrushPoints[(int) index * gridSize + cell] = materialBrushPoints[(int) source * gridSize + cell];
+    }
+
+    if (any(DTid != 0))
+        return;
+
+    float3 minBounds, maxBounds;
+    float3 center;
+    WriteBrushBounds(index, Brushes[index], minBounds, maxBounds, center);
+
+    for (int i = 0; i < CAGE_VERTS; i++)
+    {
+        controlParticlesL1Out[index * CAGE_VERTS + i].position = float4(canonicalControlPoints[i].xyz, 0);
+    }
+}
+
 void CreateParticles(uint3 DTid : SV_DispatchThreadID)
 {
 
@@ -1504,38 +1547,15 @@ void CookBrush(uint3 DTid : SV_DispatchThreadID)
 
 }
 
-float SampleSDF(float3 worldPos, int mipLevel)
+SDFSampleGrid WorldSDFSampleGrid(int mipLevel)
 {
-    float4 voxelRes = GetVoxelResolutionWorldSDFArbitrary(mipLevel + 1, pc.voxelResolution.xyz);
-    float3 sceneSize = GetSceneSize();
-    float3 halfScene = sceneSize.xyz * 0.5f;
-
-    // Convert world position to continuous texel coordinates
-    float3 uvw = (worldPos + halfScene) / (2.0f * halfScene);
-    float3 texelCoord = uvw * voxelRes.xyz;
-
-    // Get the integer base coordinate and the fractional part for interpolation
-    int3 baseTexel = int3(floor(texelCoord));
-    float3 frac = texelCoord - baseTexel;
-
-    // Fetch the 8 corner SDF values
-    float d000 = Read3D(mipLevel, baseTexel + int3(0, 0, 0)).x;
-    float d100 = Read3D(mipLevel, baseTexel + int3(1, 0, 0)).x;
-    float d010 = Read3D(mipLevel, baseTexel + int3(0, 1, 0)).x;
-    float d110 = Read3D(mipLevel, baseTexel + int3(1, 1, 0)).x;
-    float d001 = Read3D(mipLevel, baseTexel + int3(0, 0, 1)).x;
-    float d101 = Read3D(mipLevel, baseTexel + int3(1, 0, 1)).x;
-    float d011 = Read3D(mipLevel, baseTexel + int3(0, 1, 1)).x;
-    float d111 = Read3D(mipLevel, baseTexel + int3(1, 1, 1)).x;
+    return SDFMakeSampleGrid(int3(GetVoxelResolutionWorldSDFArbitrary(mipLevel + 1, pc.voxelResolution.xyz).xyz), GetSceneSize());
+}
 
-    // Perform trilinear interpolation (7 lerps)
-    float c00 = lerp(d000, d100, frac.x);
-    float c10 = lerp(d010, d110, frac.x);
-    float c01 = lerp(d001, d101, frac.x);
-    float c11 = lerp(d011, d111, frac.x);
-    float c0 = lerp(c00, c10, frac.y);
-    float c1 = lerp(c01, c11, frac.y);
-    return lerp(c0, c1, frac.z);
+//Trilinear over voxel centres, edges clamped (SDFSampleTrilinear, same as the CPU side).
+float SampleSDF(float3 worldPos, int mipLevel)
+{
+    return SDFSampleTrilinear(mipLevel, WorldSDFSampleGrid(mipLevel), worldPos);
 }
 
 
@@ -1545,19 +1565,12 @@ float3 GetNormal(float3 worldPos)
     
     const float epsilon = 0.025f;
 
-    // Use small offset vectors for sampling along each axis.
-    float3 offsetX = float3(epsilon, 0, 0);
-    float3 offsetY = float3(0, epsilon, 0);
-    float3 offsetZ = float3(0, 0, epsilon);
-
-    // Calculate the gradient using central differences on the interpolated SDF values.
-    float dx = SampleSDF(worldPos + offsetX, mipLevel) - SampleSDF(worldPos - offsetX, mipLevel);
-    float dy = SampleSDF(worldPos + offsetY, mipLevel) - SampleSDF(worldPos - offsetY, mipLevel);
-    float dz = SampleSDF(worldPos + offsetZ, mipLevel) - SampleSDF(worldPos - offsetZ, mipLevel);
+    // 4 tap tetrahedral gradient of the interpolated SDF values.
+    float3 gradient = SDFSampleTetraGradient(mipLevel, WorldSDFSampleGrid(mipLevel), worldPos, epsilon);
     
     // The gradient vector points in the direction of the normal.
     // Add a tiny value to prevent normalization of a zero vector.
-    return normalize(float3(dx, dy, dz) + 1e-6);
+    return normalize(gradient + 1e-6);
 }
 
 
@@ -2873,6 +2886,12 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint gIndex
         return;
     }
     
+    if (sampleLevelL == 27.0f)
+    {
+        CreateBrushInstance(DTid);
+        return;
+    }
+    
     if(sampleLevelL == 30.0f)
     {
         CookBrush(DTid);
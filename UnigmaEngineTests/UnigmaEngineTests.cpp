@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "CppUnitTest.h"
 #include "UnigmaGameObjectTests.h"
+#include "UnigmaSDFTests.h"
+#include "UnigmaRendererTests.h"
 #include "UnigmaNative/UnigmaNative.h"
 #include "Loader.h"
 
@@ -30,5 +32,161 @@ namespace UnigmaEngineTests
 			//Get Attribute testing.
 
 		}
+
+		TEST_METHOD(TestSDFTileBinning)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestTileBinningMatchesBruteForce());
+		}
+
+		TEST_METHOD(TestSDFVoxelPacking)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestVoxelPackingRoundTrip());
+		}
+
+		TEST_METHOD(TestSDFBrushScheduler)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestBrushSchedulerBudget());
+		}
+
+		TEST_METHOD(TestSDFFastWindingNumber)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestFastWindingNumberMatchesBruteForce());
+		}
+
+		TEST_METHOD(TestSDFWindingGrid)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestWindingGridMatchesPointQueries());
+		}
+
+		TEST_METHOD(TestSDFParticleSplat)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestParticleSplatMatchesScatter());
+		}
+
+		TEST_METHOD(TestSDFCageDeformer)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestCageWeightsMatchDirectEvaluation());
+		}
+
+		TEST_METHOD(TestSDFPipeline)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestPipelineHashesAreDeterministic());
+		}
+
+		TEST_METHOD(TestSDFSphereTracer)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestSphereTracerHitsAnalyticSphere());
+		}
+
+		TEST_METHOD(TestSDFPacketTracer)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestPacketTracerMatchesScalar());
+		}
+
+		TEST_METHOD(TestSDFConePrepass)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestConePrepassStartsBeforeSurfaces());
+		}
+
+		TEST_METHOD(TestSDFSharedSampling)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestSharedSamplingGradients());
+		}
+
+		TEST_METHOD(TestSDFTriangleBVH)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestTriangleBVHMatchesBruteForce());
+		}
+
+		TEST_METHOD(TestSDFTLASTracker)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestTLASTrackerRefitsAndRebuilds());
+		}
+
+		TEST_METHOD(TestSDFCameraPath)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestCameraPathParsesAndInterpolates());
+		}
+
+		TEST_METHOD(TestSDFMeshSimplifier)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestMeshSimplifierTargetsAndError());
+		}
+
+		TEST_METHOD(TestSDFCSGPruning)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestCSGPruningMatchesReference());
+		}
+
+		TEST_METHOD(TestSDFDynamicTree)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestDynamicTreeMatchesBruteForce());
+		}
+
+		TEST_METHOD(TestSDFBrickMap)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestBrickMapMatchesDenseGrid());
+		}
+
+		TEST_METHOD(TestSDFMipPyramid)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestMipPyramidReductionAndBounds());
+		}
+
+		TEST_METHOD(TestSDFBrushPool)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestBrushPoolHandlesAndDirtyRanges());
+		}
+
+		TEST_METHOD(TestSDFContentHash)
+		{
+			auto sdfTests = make_unique<UnigmaSDFTests>();
+			Assert::IsTrue(sdfTests->TestBrushContentKeyTracksContent());
+		}
+
+		TEST_METHOD(TestRenderGraph)
+		{
+			auto rendererTests = make_unique<UnigmaRendererTests>();
+			Assert::IsTrue(rendererTests->TestRenderGraphCompiles());
+		}
+
+		TEST_METHOD(TestDeviceMemoryPools)
+		{
+			auto rendererTests = make_unique<UnigmaRendererTests>();
+			Assert::IsTrue(rendererTests->TestDeviceMemoryPools());
+		}
+
+		TEST_METHOD(TestReadbackScheduling)
+		{
+			auto rendererTests = make_unique<UnigmaRendererTests>();
+			Assert::IsTrue(rendererTests->TestReadbackScheduling());
+		}
+
+		TEST_METHOD(TestPipelineCache)
+		{
+			auto rendererTests = make_unique<UnigmaRendererTests>();
+			Assert::IsTrue(rendererTests->TestPipelineCache());
+		}
 	};
 }
@@ -0,0 +1,896 @@
+#include "pch.h"
+#include "UnigmaRendererTests.h"
+#include "CppUnitTest.h"
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <unordered_map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+static RGResourceDesc TestImage(uint64_t size)
+{
+	RGResourceDesc desc;
+	desc.width = 16;
+	desc.height = 16;
+	desc.size = size;
+	desc.alignment = 256;
+	desc.memoryTypeBits = 0x3;
+	return desc;
+}
+
+bool UnigmaRendererTests::TestRenderGraphCompiles()
+{
+	//A deferred frame: the debug pass writes something nothing reads, ao's target can reuse the gbuffer's memory.
+	UnigmaRenderGraph graph;
+	RGResourceDesc swapchainDesc;
+	swapchainDesc.finalLayout = RGLayout::Present;
+	uint32_t swapchain = graph.Import("swapchain", swapchainDesc);
+	uint32_t gbuffer = graph.CreateTransient("gbuffer", TestImage(1024));
+	uint32_t depth = graph.CreateTransient("depth", TestImage(1024));
+	uint32_t lighting = graph.CreateTransient("lighting", TestImage(1024));
+	uint32_t aoTarget = graph.CreateTransient("ao_target", TestImage(1024));
+	uint32_t debug = graph.CreateTransient("debug", TestImage(1024));
+
+	uint32_t gbufferPass = graph.AddPass("gbuffer", RGPassType::Graphics);
+	graph.Use(gbufferPass, gbuffer, RGUsage::ColorAttachment);
+	graph.Use(gbufferPass, depth, RGUsage::DepthAttachment);
+	uint32_t debugPass = graph.AddPass("debug", RGPassType::Compute);
+	graph.Use(debugPass, gbuffer, RGUsage::Sampled);
+	graph.Use(debugPass, debug, RGUsage::StorageWrite);
+	uint32_t lightingPass = graph.AddPass("lighting", RGPassType::Compute);
+	graph.Use(lightingPass, gbuffer, RGUsage::Sampled);
+	graph.Use(lightingPass, depth, RGUsage::Sampled);
+	graph.Use(lightingPass, lighting, RGUsage::StorageWrite);
+	uint32_t aoPass = graph.AddPass("ao", RGPassType::Graphics);
+	graph.Use(aoPass, depth, RGUsage::Sampled);
+	graph.Use(aoPass, aoTarget, RGUsage::ColorAttachment);
+	uint32_t compositePass = graph.AddPass("composite", RGPassType::Graphics);
+	graph.Use(compositePass, lighting, RGUsage::Sampled);
+	graph.Use(compositePass, aoTarget, RGUsage::Sampled);
+	graph.Use(compositePass, depth, RGUsage::Sampled);
+	graph.Use(compositePass, swapchain, RGUsage::ColorAttachment);
+
+	RGCompiled compiled;
+	std::string error;
+	if (!graph.Compile(compiled, &error))
+	{
+		Logger::WriteMessage(("EXCEPTION: RENDER GRAPH DID NOT COMPILE: " + error).c_str());
+		return false;
+	}
+
+	if (compiled.culled != std::vector<uint32_t>{ debugPass } || compiled.passes.size() != 4 || compiled.placements[debug].heap != UINT32_MAX)
+	{
+		Logger::WriteMessage("EXCEPTION: RENDER GRAPH CULLED THE WRONG PASSES.");
+		return false;
+	}
+
+	//ao reads depth in the layout lighting left it in: no barrier, the one in front of lighting waits for both.
+	const RGCompiledPass& ao = compiled.passes[2];
+	if (ao.barriers.size() != 1 || ao.barriers[0].resource != aoTarget || !ao.barriers[0].aliasing)
+	{
+		Logger::WriteMessage("EXCEPTION: RENDER GRAPH BARRIERS IN FRONT OF AO ARE WRONG.");
+		return false;
+	}
+
+	if (compiled.placements[aoTarget].offset != compiled.placements[gbuffer].offset || compiled.stats.heapBytes != 3072 ||
+		compiled.stats.transientBytes != 4096)
+	{
+		Logger::WriteMessage("EXCEPTION: RENDER GRAPH DID NOT ALIAS DISJOINT TRANSIENTS.");
+		return false;
+	}
+
+	const char* expected =
+		"pass 0 gbuffer graphics\n"
+		"  barrier gbuffer undefined->color_attachment stages none->color_output access none->color_write\n"
+		"  barrier depth undefined->depth_attachment stages none->early_tests|late_tests access none->depth_read|depth_write\n"
+		"pass 2 lighting compute\n"
+		"  barrier gbuffer color_attachment->shader_read_only stages color_output->compute access color_write->sampled_read\n"
+		"  barrier depth depth_attachment->shader_read_only stages early_tests|late_tests->vertex|fragment|compute access depth_write->sampled_read\n"
+		"  barrier lighting undefined->general stages none->compute access none->storage_write\n"
+		"pass 3 ao graphics\n"
+		"  barrier ao_target aliasing undefined->color_attachment stages color_output|compute->color_output access none->color_write\n"
+		"pass 4 composite graphics\n"
+		"  barrier lighting general->shader_read_only stages compute->vertex|fragment access storage_write->sampled_read\n"
+		"  barrier ao_target color_attachment->shader_read_only stages color_output->vertex|fragment access color_write->sampled_read\n"
+		"  barrier swapchain undefined->color_attachment stages none->color_output access none->color_write\n"
+		"final\n"
+		"  barrier swapchain color_attachment->present stages color_output->none access color_write->none\n"
+		"culled 1 debug\n"
+		"heap 0 size 3072 types 0x3\n"
+		"  gbuffer offset 0 size 1024 passes 0-1\n"
+		"  depth offset 1024 size 1024 passes 0-3\n"
+		"  lighting offset 2048 size 1024 passes 1-3\n"
+		"  ao_target offset 0 size 1024 passes 2-3\n"
+		"stats uses 11 barriers 10 batches 5 transient 4096 heaps 3072\n";
+	if (graph.Serialize(compiled) != expected)
+	{
+		Logger::WriteMessage(("EXCEPTION: RENDER GRAPH SERIALIZED DIFFERENTLY:\n" + graph.Serialize(compiled)).c_str());
+		return false;
+	}
+
+	//Buffers: a read after an outside transfer, a second read widening it, and a write after both reads.
+	UnigmaRenderGraph compute;
+	RGResourceDesc particlesDesc;
+	particlesDesc.kind = RGResourceKind::Buffer;
+	particlesDesc.initialStages = RGStageTransfer;
+	particlesDesc.initialAccess = RGAccessTransferWrite;
+	uint32_t particles = compute.Import("particles", particlesDesc, false);
+	RGResourceDesc countsDesc;
+	countsDesc.kind = RGResourceKind::Buffer;
+	countsDesc.size = 64;
+	uint32_t counts = compute.CreateTransient("counts", countsDesc);
+	uint32_t simulate = compute.AddPass("simulate", RGPassType::Compute);
+	compute.Use(simulate, particles, RGUsage::StorageRead);
+	compute.Use(simulate, counts, RGUsage::StorageWrite);
+	uint32_t draw = compute.AddPass("draw", RGPassType::Graphics, true);
+	compute.Use(draw, particles, RGUsage::Vertex);
+	compute.Use(draw, counts, RGUsage::Indirect);
+	uint32_t update = compute.AddPass("update", RGPassType::Compute, true);
+	compute.Use(update, particles, RGUsage::StorageWrite);
+
+	if (!compute.Compile(compiled, &error) || compiled.passes.size() != 3 || compiled.passes[0].barriers.size() != 1 ||
+		compiled.passes[1].barriers.size() != 1 || compiled.passes[2].barriers.size() != 1)
+	{
+		Logger::WriteMessage("EXCEPTION: RENDER GRAPH BUFFER BARRIER COUNT IS WRONG.");
+		return false;
+	}
+	const RGBarrier& widened = compiled.passes[0].barriers[0];
+	const RGBarrier& war = compiled.passes[2].barriers[0];
+	if (widened.srcStages != RGStageTransfer || widened.srcAccess != RGAccessTransferWrite ||
+		widened.dstStages != (RGStageCompute | RGStageVertexInput) || widened.dstAccess != (RGAccessStorageRead | RGAccessVertexRead) ||
+		compiled.passes[1].barriers[0].resource != counts || compiled.passes[1].barriers[0].srcAccess != RGAccessStorageWrite ||
+		war.srcStages != (RGStageCompute | RGStageVertexInput) || war.srcAccess != RGAccessNone || war.dstAccess != RGAccessStorageWrite)
+	{
+		Logger::WriteMessage("EXCEPTION: RENDER GRAPH BUFFER BARRIERS ARE WRONG.");
+		return false;
+	}
+
+	//Reading a transient nothing wrote is an error, as is using a buffer through an image usage.
+	UnigmaRenderGraph broken;
+	uint32_t unwritten = broken.CreateTransient("unwritten", TestImage(256));
+	uint32_t reader = broken.AddPass("reader", RGPassType::Compute, true);
+	broken.Use(reader, unwritten, RGUsage::Sampled);
+	if (broken.Compile(compiled, &error) || error.find("unwritten") == std::string::npos)
+	{
+		Logger::WriteMessage("EXCEPTION: RENDER GRAPH ACCEPTED A READ BEFORE WRITE.");
+		return false;
+	}
+	UnigmaRenderGraph misused;
+	uint32_t buffer = misused.Import("buffer", particlesDesc);
+	misused.Use(misused.AddPass("misuse", RGPassType::Graphics, true), buffer, RGUsage::ColorAttachment);
+	if (misused.Compile(compiled, &error))
+	{
+		Logger::WriteMessage("EXCEPTION: RENDER GRAPH ACCEPTED A BUFFER AS A COLOR ATTACHMENT.");
+		return false;
+	}
+
+	return true;
+}
+
+//Hands out host memory for every host visible block, so mapped pointers and defragmentation copies can be checked.
+class MockMemoryBackend : public UnigmaMemoryBackend
+{
+public:
+	std::vector<uint32_t> typeFlags;
+	std::unordered_map<uint64_t, std::vector<uint8_t>> blocks;
+	uint64_t nextHandle = 1;
+
+	bool AllocateBlock(uint32_t memoryType, uint64_t size, uint64_t& block, void*& mapped) override
+	{
+		block = nextHandle++;
+		std::vector<uint8_t>& memory = blocks[block];
+		mapped = nullptr;
+		if (typeFlags[memoryType] & UnigmaMemoryHostVisible)
+		{
+			memory.resize(size);
+			mapped = memory.data();
+		}
+		return true;
+	}
+
+	void FreeBlock(uint64_t block) override { blocks.erase(block); }
+};
+
+static UnigmaMemoryProperties MockMemoryProperties(MockMemoryBackend& backend)
+{
+	//A discrete card: device local VRAM, host memory with and without caching, and a small host visible VRAM window.
+	UnigmaMemoryProperties properties;
+	uint32_t flags[] = { UnigmaMemoryDeviceLocal, UnigmaMemoryHostVisible | UnigmaMemoryHostCoherent,
+		UnigmaMemoryDeviceLocal | UnigmaMemoryHostVisible | UnigmaMemoryHostCoherent,
+		UnigmaMemoryHostVisible | UnigmaMemoryHostCoherent | UnigmaMemoryHostCached };
+	uint32_t heaps[] = { 0, 1, 2, 1 };
+	for (int i = 0; i < 4; i++)
+	{
+		UnigmaMemoryType type;
+		type.propertyFlags = flags[i];
+		type.heapIndex = heaps[i];
+		properties.types.push_back(type);
+		backend.typeFlags.push_back(flags[i]);
+	}
+	properties.heapSizes = { 64ull << 20, 32ull << 20, 4ull << 20 };
+	return properties;
+}
+
+//No two live allocations of a block overlap and all of them lie inside it.
+static bool DisjointAllocations(const UnigmaDeviceMemory& memory, const std::vector<UnigmaAllocationId>& live, uint64_t blockSize)
+{
+	std::vector<UnigmaAllocationInfo> infos;
+	for (UnigmaAllocationId id : live)
+		infos.push_back(memory.Info(id));
+	std::sort(infos.begin(), infos.end(), [](const UnigmaAllocationInfo& a, const UnigmaAllocationInfo& b) {
+		return a.block != b.block ? a.block < b.block : a.offset < b.offset;
+	});
+	for (size_t i = 0; i < infos.size(); i++)
+	{
+		if (!infos[i].dedicated && infos[i].offset + infos[i].size > blockSize)
+			return false;
+		if (i + 1 < infos.size() && infos[i + 1].block == infos[i].block && infos[i].offset + infos[i].size > infos[i + 1].offset)
+			return false;
+	}
+	return true;
+}
+
+bool UnigmaRendererTests::TestDeviceMemoryPools()
+{
+	MockMemoryBackend backend;
+	UnigmaMemoryProperties properties = MockMemoryProperties(backend);
+	UnigmaDeviceMemorySettings settings;
+	settings.blockSize = 1ull << 20;
+	UnigmaDeviceMemory memory;
+	memory.Init(properties, &backend, settings);
+
+	if (memory.FindMemoryType(~0u, UnigmaMemoryDeviceLocal) != 0 ||
+		memory.FindMemoryType(~0u, UnigmaMemoryHostVisible, UnigmaMemoryHostCoherent) != 1 ||
+		memory.FindMemoryType(~0u, UnigmaMemoryHostVisible, UnigmaMemoryHostCached) != 3 ||
+		memory.FindMemoryType(1u << 2, UnigmaMemoryHostVisible) != 2 || memory.FindMemoryType(~0u, 0x10) != UINT32_MAX)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY PICKED THE WRONG MEMORY TYPE.");
+		return false;
+	}
+
+	//TLSF under random churn: aligned, disjoint, and back to a single kept block once everything is freed.
+	std::mt19937 rng(4321);
+	std::uniform_int_distribution<uint64_t> size(1, 200 << 10);
+	std::uniform_int_distribution<int> alignShift(0, 12);
+	std::vector<UnigmaAllocationId> live;
+	uint64_t liveBytes = 0;
+	for (int step = 0; step < 3000; step++)
+	{
+		if (!live.empty() && rng() % 5 < 2)
+		{
+			size_t victim = rng() % live.size();
+			liveBytes -= memory.Info(live[victim]).size;
+			memory.Free(live[victim]);
+			live[victim] = live.back();
+			live.pop_back();
+			continue;
+		}
+		UnigmaAllocationDesc desc;
+		desc.size = size(rng);
+		desc.alignment = 1ull << alignShift(rng);
+		desc.requiredFlags = UnigmaMemoryDeviceLocal;
+		UnigmaAllocationId id;
+		if (!memory.Allocate(desc, id) || memory.Info(id).offset % desc.alignment != 0 || memory.Info(id).memoryType != 0)
+		{
+			Logger::WriteMessage("EXCEPTION: DEVICE MEMORY TLSF ALLOCATION FAILED OR IS MISALIGNED.");
+			return false;
+		}
+		live.push_back(id);
+		liveBytes += desc.size;
+	}
+	UnigmaMemoryStats stats = memory.Stats(0);
+	if (!DisjointAllocations(memory, live, settings.blockSize) || stats.allocations != live.size() || stats.allocatedBytes != liveBytes ||
+		stats.backendAllocations - stats.backendFrees != stats.blocks)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY TLSF ALLOCATIONS OVERLAP OR STATS ARE OFF.");
+		return false;
+	}
+	for (UnigmaAllocationId id : live)
+		memory.Free(id);
+	live.clear();
+	stats = memory.Stats(0);
+	if (stats.allocations != 0 || stats.blocks != 1 || stats.largestFree != settings.blockSize)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY TLSF DID NOT COALESCE.");
+		return false;
+	}
+
+	//Over half a block goes to a block of its own, released with it.
+	UnigmaAllocationDesc large;
+	large.size = 600 << 10;
+	large.requiredFlags = UnigmaMemoryDeviceLocal;
+	UnigmaAllocationId dedicated;
+	size_t backendBlocks = backend.blocks.size();
+	if (!memory.Allocate(large, dedicated) || !memory.Info(dedicated).dedicated || backend.blocks.size() != backendBlocks + 1)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY DID NOT DEDICATE A LARGE ALLOCATION.");
+		return false;
+	}
+	memory.Free(dedicated);
+	if (backend.blocks.size() != backendBlocks)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY KEPT A DEDICATED BLOCK.");
+		return false;
+	}
+
+	//Buddy: 1000 bytes take a 1 KiB range, so a 1 MiB block holds exactly 1024 of them.
+	UnigmaMemoryPoolDesc buddyDesc;
+	buddyDesc.memoryType = 3;
+	buddyDesc.strategy = UnigmaMemoryStrategy::Buddy;
+	buddyDesc.blockSize = (1ull << 20) + 5;
+	UnigmaPoolId buddy = memory.CreatePool(buddyDesc);
+	UnigmaAllocationDesc small;
+	small.size = 1000;
+	small.pool = buddy;
+	for (int i = 0; i <= 1024; i++)
+	{
+		UnigmaAllocationId id;
+		if (!memory.Allocate(small, id) || memory.Info(id).offset % 1024 != 0 || memory.Stats(3).blocks != (i < 1024 ? 1u : 2u))
+		{
+			Logger::WriteMessage("EXCEPTION: DEVICE MEMORY BUDDY POOL PLACED A RANGE WRONG.");
+			return false;
+		}
+		live.push_back(id);
+	}
+	for (UnigmaAllocationId id : live)
+		memory.Free(id);
+	live.clear();
+	if (memory.Stats(3).blocks != 1 || memory.Stats(3).largestFree != 1ull << 20)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY BUDDY POOL DID NOT MERGE.");
+		return false;
+	}
+
+	//Linear: bumps, and starts over once everything is freed.
+	UnigmaMemoryPoolDesc linearDesc;
+	linearDesc.memoryType = 1;
+	linearDesc.strategy = UnigmaMemoryStrategy::Linear;
+	linearDesc.blockSize = 64 << 10;
+	UnigmaPoolId linear = memory.CreatePool(linearDesc);
+	UnigmaAllocationDesc staging;
+	staging.pool = linear;
+	UnigmaAllocationId a, b, c;
+	staging.size = 100;
+	memory.Allocate(staging, a);
+	staging.size = 200;
+	staging.alignment = 256;
+	memory.Allocate(staging, b);
+	staging.size = 50;
+	staging.alignment = 1;
+	memory.Allocate(staging, c);
+	if (memory.Info(b).offset != 256 || memory.Info(c).offset != 456 || memory.Info(a).mapped == nullptr ||
+		memory.Info(b).mapped != (uint8_t*)memory.Info(a).mapped + 256)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY LINEAR POOL OFFSETS ARE WRONG.");
+		return false;
+	}
+	memory.Free(a);
+	memory.Free(b);
+	memory.Free(c);
+	memory.Allocate(staging, a);
+	if (memory.Info(a).offset != 0)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY LINEAR POOL DID NOT RESET.");
+		return false;
+	}
+	memory.Free(a);
+
+	//The 4 MiB window takes eight 512 KiB blocks of two, then fails; a request that only prefers it moves on.
+	UnigmaAllocationDesc window;
+	window.size = 200 << 10;
+	window.memoryTypeBits = 1u << 2;
+	window.requiredFlags = UnigmaMemoryHostVisible;
+	UnigmaAllocationId id;
+	int placed = 0;
+	while (placed < 100 && memory.Allocate(window, id))
+		placed++;
+	window.memoryTypeBits = ~0u;
+	window.preferredFlags = UnigmaMemoryDeviceLocal;
+	if (placed != 16 || memory.Stats(2).blockBytes != 4ull << 20 || !memory.Allocate(window, id) || memory.Info(id).memoryType == 2)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY IGNORED THE HEAP SIZE.");
+		return false;
+	}
+
+	//Defragmentation: four blocks a quarter full, one of them pinned by an allocation that cannot move. Steps of at
+	//most five moves empty the other two into the first, and the contents follow the copies.
+	UnigmaDeviceMemory compact;
+	compact.Init(properties, &backend, settings);
+	UnigmaAllocationDesc movable;
+	movable.size = 64 << 10;
+	movable.requiredFlags = UnigmaMemoryHostVisible | UnigmaMemoryHostCoherent;
+	std::vector<UnigmaAllocationId> all;
+	for (int i = 0; i < 64; i++)
+	{
+		movable.movable = i != 60;
+		compact.Allocate(movable, id);
+		all.push_back(id);
+	}
+	for (int i = 0; i < 64; i++)
+	{
+		if (i % 4 != 0)
+			compact.Free(all[i]);
+		else
+		{
+			live.push_back(all[i]);
+			memset(compact.Info(all[i]).mapped, i, (size_t)movable.size);
+		}
+	}
+	UnigmaAllocationInfo pinned = compact.Info(all[60]);
+	if (compact.Stats(1).blocks != 4)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY DEFRAGMENTATION SETUP IS WRONG.");
+		return false;
+	}
+
+	std::vector<UnigmaDefragMove> moves;
+	int steps = 0;
+	while (compact.BeginDefragmentStep(moves, ~0ull, 5) > 0 && steps < 10)
+	{
+		for (const UnigmaDefragMove& move : moves)
+			memcpy(backend.blocks[move.dstBlock].data() + move.dstOffset, backend.blocks[move.srcBlock].data() + move.srcOffset, (size_t)move.size);
+		compact.EndDefragmentStep();
+		steps++;
+	}
+	bool intact = DisjointAllocations(compact, live, settings.blockSize);
+	for (UnigmaAllocationId kept : live)
+	{
+		const uint8_t* bytes = (const uint8_t*)compact.Info(kept).mapped;
+		int value = (int)(std::find(all.begin(), all.end(), kept) - all.begin());
+		intact = intact && bytes[0] == value && bytes[movable.size - 1] == value;
+	}
+	if (steps != 2 || compact.Stats(1).blocks != 2 || compact.Stats(1).allocations != 16 || !intact ||
+		compact.Info(all[60]).block != pinned.block || compact.Info(all[60]).offset != pinned.offset)
+	{
+		Logger::WriteMessage("EXCEPTION: DEVICE MEMORY DEFRAGMENTATION DID NOT COMPACT.");
+		return false;
+	}
+
+	return true;
+}
+
+//Plays the device: copies land in the ring only once the test completes their timeline value, so reading them any
+//earlier shows up as wrong data. Also checks that the copies in flight never share ring bytes.
+class FakeReadbackQueue : public UnigmaReadbackQueue
+{
+public:
+	std::vector<uint8_t> ring;
+	std::unordered_map<uint64_t, std::vector<uint8_t>> buffers; //Snapshots too.
+	std::vector<std::pair<uint64_t, UnigmaReadbackCopy>> submitted;
+	std::vector<uint64_t> submitSources; //Source of the first ring copy of each batch.
+	uint64_t completed = 0;
+	uint64_t nextSnapshot = 1000;
+	uint32_t snapshots = 0;
+	bool overlapped = false;
+
+	void Submit(const std::vector<UnigmaReadbackCopy>& copies, uint64_t timelineValue) override
+	{
+		bool first = true;
+		for (const UnigmaReadbackCopy& copy : copies)
+		{
+			if (copy.snapshot == 0)
+			{
+				for (auto& [value, other] : submitted)
+					overlapped = overlapped || (other.snapshot == 0 && copy.ringOffset < other.ringOffset + other.size && other.ringOffset < copy.ringOffset + copy.size);
+				overlapped = overlapped || copy.ringOffset + copy.size > ring.size();
+				if (first)
+					submitSources.push_back(copy.source);
+				first = false;
+			}
+			submitted.push_back({ timelineValue, copy });
+		}
+	}
+
+	uint64_t CompletedValue() override { return completed; }
+	void Wait(uint64_t timelineValue) override { Complete(timelineValue); }
+
+	void Complete(uint64_t timelineValue)
+	{
+		completed = std::max(completed, timelineValue);
+		for (size_t i = 0; i < submitted.size();)
+		{
+			if (submitted[i].first > completed)
+			{
+				i++;
+				continue;
+			}
+			const UnigmaReadbackCopy& copy = submitted[i].second;
+			uint8_t* destination = copy.snapshot != 0 ? buffers[copy.snapshot].data() : ring.data();
+			memcpy(destination + copy.ringOffset, buffers[copy.source].data() + copy.sourceOffset, (size_t)copy.size);
+			submitted.erase(submitted.begin() + i);
+		}
+	}
+
+	uint64_t CreateSnapshot(uint64_t size) override
+	{
+		buffers[nextSnapshot].resize(size);
+		snapshots++;
+		return nextSnapshot++;
+	}
+
+	void DestroySnapshot(uint64_t snapshot) override
+	{
+		buffers.erase(snapshot);
+		snapshots--;
+	}
+};
+
+static std::vector<uint8_t> ReadbackPattern(uint64_t size, uint32_t seed)
+{
+	std::vector<uint8_t> bytes(size);
+	for (uint64_t i = 0; i < size; i++)
+		bytes[i] = (uint8_t)(i * 31 + seed * 7 + (i >> 8));
+	return bytes;
+}
+
+bool UnigmaRendererTests::TestReadbackScheduling()
+{
+	FakeReadbackQueue queue;
+	queue.ring.resize(16 << 10);
+	for (uint32_t source = 1; source <= 8; source++)
+		queue.buffers[source] = ReadbackPattern(64 << 10, source);
+
+	UnigmaReadbackSettings settings;
+	settings.frameBudget = 4096;
+	settings.chunkSize = 1024;
+	settings.agingFrames = 2;
+	UnigmaReadbackService readback;
+	readback.Init(&queue, queue.ring.data(), queue.ring.size(), settings);
+
+	//Results only arrive once the timeline passed the batch, on a later pump.
+	std::vector<uint8_t> received;
+	UnigmaReadbackRequest request;
+	request.source = 1;
+	request.offset = 100;
+	request.size = 3000;
+	request.callback = [&](const void* data, uint64_t size) { received.assign((const uint8_t*)data, (const uint8_t*)data + size); };
+	UnigmaReadbackId id = readback.Enqueue(request);
+	readback.Pump();
+	readback.Pump();
+	if (readback.Stats().submittedValue != 1 || !received.empty() || !readback.Pending(id))
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK DELIVERED BEFORE THE COPY COMPLETED.");
+		return false;
+	}
+	queue.Complete(1);
+	readback.Pump();
+	if (readback.Pending(id) || received.size() != 3000 || memcmp(received.data(), queue.buffers[1].data() + 100, 3000) != 0)
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK RETURNED THE WRONG BYTES.");
+		return false;
+	}
+
+	//Higher priority goes first, and a destination request over the budget streams in chunks spread over frames.
+	std::vector<uint8_t> grid(10000);
+	bool gridDone = false;
+	UnigmaReadbackRequest low;
+	low.source = 2;
+	low.size = 10000;
+	low.destination = grid.data();
+	low.priority = UnigmaReadbackPriority::Low;
+	low.callback = [&](const void* data, uint64_t size) { gridDone = data == grid.data() && size == 10000; };
+	readback.Enqueue(low);
+	UnigmaReadbackRequest high;
+	high.source = 3;
+	high.size = 512;
+	high.priority = UnigmaReadbackPriority::High;
+	readback.Enqueue(high);
+	readback.Pump();
+	UnigmaReadbackStats stats = readback.Stats();
+	if (queue.submitSources.back() != 3 || stats.submittedBytes != 512 + 3 * 1024 || stats.pendingBytes != 10000 - 3 * 1024)
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK IGNORED PRIORITY OR BUDGET.");
+		return false;
+	}
+	int frames = 0;
+	while (!gridDone && frames++ < 10)
+	{
+		queue.Complete(readback.Stats().submittedValue);
+		readback.Pump();
+	}
+	if (!gridDone || frames != 3 || grid != std::vector<uint8_t>(queue.buffers[2].begin(), queue.buffers[2].begin() + 10000))
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK CHUNKED REQUEST DID NOT REASSEMBLE.");
+		return false;
+	}
+
+	//A low priority request ages past a steady stream of high priority ones.
+	bool lowDone = false;
+	UnigmaReadbackRequest starved;
+	starved.source = 4;
+	starved.size = 4096;
+	starved.priority = UnigmaReadbackPriority::Low;
+	starved.callback = [&](const void*, uint64_t) { lowDone = true; };
+	readback.Enqueue(starved);
+	for (frames = 0; !lowDone && frames < 20; frames++)
+	{
+		high.source = 5;
+		high.size = 4096;
+		readback.Enqueue(high);
+		queue.Complete(readback.Stats().submittedValue);
+		readback.Pump();
+	}
+	if (!lowDone || frames > 6)
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK STARVED A LOW PRIORITY REQUEST.");
+		return false;
+	}
+
+	//A request over the budget and the ring comes back as the frame it was enqueued on, however many frames its chunks
+	//take. Each frame overwrites the source after its copies ran.
+	std::vector<uint8_t> dump(64 << 10);
+	bool dumpDone = false;
+	UnigmaReadbackRequest full;
+	full.source = 8;
+	full.size = dump.size();
+	full.destination = dump.data();
+	full.priority = UnigmaReadbackPriority::Low;
+	full.callback = [&](const void*, uint64_t) { dumpDone = true; };
+	uint32_t frameSeed = 100;
+	queue.buffers[8] = ReadbackPattern(dump.size(), frameSeed);
+	readback.Enqueue(full);
+	for (frames = 0; !dumpDone && frames < 100; frames++)
+	{
+		readback.Pump();
+		queue.Complete(readback.Stats().submittedValue);
+		queue.buffers[8] = ReadbackPattern(dump.size(), ++frameSeed);
+	}
+	if (!dumpDone || frames < 16 || dump != ReadbackPattern(dump.size(), 100) || queue.snapshots != 0 || readback.Stats().snapshotBytes != 0)
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK MIXED FRAMES IN ONE REQUEST.");
+		return false;
+	}
+
+	//Under the budget a destination request goes out whole, in one copy, however many chunks it spans.
+	std::vector<uint8_t> whole(4000);
+	UnigmaReadbackRequest wholeRequest;
+	wholeRequest.source = 8;
+	wholeRequest.size = whole.size();
+	wholeRequest.destination = whole.data();
+	readback.Enqueue(wholeRequest);
+	size_t submittedBefore = queue.submitted.size();
+	readback.Pump();
+	if (queue.submitted.size() != submittedBefore + 1 || queue.submitted.back().second.size != whole.size())
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK SPLIT A REQUEST UNDER THE BUDGET ACROSS COPIES.");
+		return false;
+	}
+	readback.Flush();
+
+	//Waiting on one request submits and waits on that one only, even when it has to stream through the ring.
+	std::vector<uint8_t> waited(20000);
+	UnigmaReadbackRequest other;
+	other.source = 2;
+	other.size = 3000;
+	other.priority = UnigmaReadbackPriority::High;
+	UnigmaReadbackId otherId = readback.Enqueue(other);
+	UnigmaReadbackRequest sync;
+	sync.source = 3;
+	sync.offset = 10;
+	sync.size = waited.size();
+	sync.destination = waited.data();
+	UnigmaReadbackId syncId = readback.Enqueue(sync);
+	readback.Wait(syncId);
+	stats = readback.Stats();
+	if (readback.Pending(syncId) || !readback.Pending(otherId) || stats.inFlightBytes != 0 || stats.pendingBytes != 3000 ||
+		waited != std::vector<uint8_t>(queue.buffers[3].begin() + 10, queue.buffers[3].begin() + 20010))
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK WAIT DID NOT WAIT ON ITS REQUEST ALONE.");
+		return false;
+	}
+
+	//Futures, the budget-free flush, and requests that cannot be served.
+	std::future<std::vector<uint8_t>> future = readback.EnqueueFuture(6, 4096, 40000);
+	UnigmaReadbackRequest tooLarge;
+	tooLarge.source = 7;
+	tooLarge.size = queue.ring.size() + 1;
+	readback.Flush();
+	stats = readback.Stats();
+	std::vector<uint8_t> bytes = future.get();
+	if (readback.Enqueue(tooLarge) != UnigmaNoReadback || stats.pending != 0 || stats.inFlightBytes != 0 ||
+		bytes != std::vector<uint8_t>(queue.buffers[6].begin() + 4096, queue.buffers[6].begin() + 44096))
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK FLUSH OR FUTURE FAILED.");
+		return false;
+	}
+
+	//Random sizes, priorities and completion lag wrap the ring many times; every byte still arrives exactly once.
+	std::mt19937 rng(99);
+	std::uniform_int_distribution<uint64_t> size(1, 6000);
+	std::vector<std::vector<uint8_t>> results(400);
+	std::vector<int> deliveries(results.size(), 0);
+	std::vector<UnigmaReadbackRequest> descs(results.size());
+	size_t enqueued = 0;
+	for (int frame = 0; frame < 2000 && (enqueued < results.size() || readback.Stats().pending > 0); frame++)
+	{
+		for (int n = rng() % 3; n > 0 && enqueued < results.size(); n--, enqueued++)
+		{
+			UnigmaReadbackRequest& desc = descs[enqueued];
+			desc.source = 1 + rng() % 8;
+			desc.size = size(rng);
+			desc.offset = rng() % (queue.buffers[desc.source].size() - desc.size);
+			desc.priority = (UnigmaReadbackPriority)(rng() % 3);
+			results[enqueued].resize(desc.size);
+			if (rng() % 2)
+				desc.destination = results[enqueued].data();
+			size_t index = enqueued;
+			desc.callback = [&, index](const void* data, uint64_t bytes) {
+				if (data != results[index].data())
+					memcpy(results[index].data(), data, (size_t)bytes);
+				deliveries[index]++;
+			};
+			readback.Enqueue(desc);
+		}
+		stats = readback.Stats();
+		if (stats.submittedValue > 0 && rng() % 3 != 0)
+			queue.Complete(stats.submittedValue - rng() % std::min<uint64_t>(stats.submittedValue, 3));
+		readback.Pump();
+	}
+	bool intact = !queue.overlapped && readback.Stats().pending == 0 && queue.snapshots == 0;
+	for (size_t i = 0; i < results.size() && intact; i++)
+	{
+		const std::vector<uint8_t>& source = queue.buffers[descs[i].source];
+		intact = deliveries[i] == 1 && memcmp(results[i].data(), source.data() + descs[i].offset, (size_t)descs[i].size) == 0;
+	}
+	if (!intact)
+	{
+		Logger::WriteMessage("EXCEPTION: READBACK RING OVERLAPPED OR LOST DATA UNDER RANDOM LOAD.");
+		return false;
+	}
+
+	return true;
+}
+
+static UnigmaPipelineCacheIdentity TestCacheIdentity()
+{
+	UnigmaPipelineCacheIdentity identity;
+	identity.vendorID = 0x10de;
+	identity.deviceID = 0x2684;
+	identity.driverVersion = 0x8a2d4000;
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		identity.deviceUUID[i] = i;
+		identity.driverUUID[i] = 0x40 + i;
+		identity.pipelineCacheUUID[i] = 0x80 + i;
+	}
+	return identity;
+}
+
+//What a driver hands out: its header followed by opaque data.
+static std::vector<uint8_t> TestDriverCacheData(const UnigmaPipelineCacheIdentity& identity, size_t payload)
+{
+	std::vector<uint8_t> data(32 + payload);
+	uint32_t header[4] = { 32, 1, identity.vendorID, identity.deviceID };
+	memcpy(data.data(), header, sizeof(header));
+	memcpy(data.data() + 16, identity.pipelineCacheUUID, 16);
+	for (size_t i = 0; i < payload; i++)
+		data[32 + i] = (uint8_t)(i * 13 + 5);
+	return data;
+}
+
+bool UnigmaRendererTests::TestPipelineCache()
+{
+	UnigmaPipelineCacheIdentity identity = TestCacheIdentity();
+	std::vector<uint8_t> driverData = TestDriverCacheData(identity, 5000);
+	std::vector<uint8_t> file = UnigmaPipelineCacheFile::Pack(identity, driverData);
+	std::vector<uint8_t> data;
+	std::string reason;
+	if (!UnigmaPipelineCacheFile::Unpack(file, identity, data, &reason) || data != driverData)
+	{
+		Logger::WriteMessage("EXCEPTION: PIPELINE CACHE FILE DID NOT ROUND TRIP.");
+		return false;
+	}
+
+	//Another device, another driver, a damaged or cut file, and driver data that disagrees with its own header.
+	UnigmaPipelineCacheIdentity otherDevice = identity;
+	otherDevice.deviceUUID[3] ^= 1;
+	UnigmaPipelineCacheIdentity otherDriver = identity;
+	otherDriver.driverUUID[15] ^= 1;
+	UnigmaPipelineCacheIdentity updatedDriver = identity;
+	updatedDriver.driverVersion++;
+	std::vector<uint8_t> damaged = file;
+	damaged[damaged.size() / 2] ^= 0x20;
+	std::vector<uint8_t> cut(file.begin(), file.end() - 100);
+	UnigmaPipelineCacheIdentity foreign = identity;
+	foreign.vendorID = 0x1002;
+	std::vector<uint8_t> mislabeled = UnigmaPipelineCacheFile::Pack(identity, TestDriverCacheData(foreign, 100));
+	std::string reasons[6];
+	bool rejected = !UnigmaPipelineCacheFile::Unpack(file, otherDevice, data, &reasons[0]) &&
+		!UnigmaPipelineCacheFile::Unpack(file, otherDriver, data, &reasons[1]) &&
+		!UnigmaPipelineCacheFile::Unpack(file, updatedDriver, data, &reasons[2]) &&
+		!UnigmaPipelineCacheFile::Unpack(damaged, identity, data, &reasons[3]) &&
+		!UnigmaPipelineCacheFile::Unpack(cut, identity, data, &reasons[4]) &&
+		!UnigmaPipelineCacheFile::Unpack(mislabeled, identity, data, &reasons[5]) && data.empty();
+	if (!rejected || reasons[0] != "made on another device" || reasons[1] != "made by another driver" ||
+		reasons[2] != "made by another driver" || reasons[3] != "damaged" || reasons[4] != "damaged" || reasons[5].empty())
+	{
+		Logger::WriteMessage("EXCEPTION: PIPELINE CACHE FILE ACCEPTED FOREIGN OR DAMAGED DATA.");
+		return false;
+	}
+
+	std::string path = (std::filesystem::temp_directory_path() / "unigma_pipeline_cache_test.bin").string();
+	std::filesystem::remove(path);
+	bool missing = !UnigmaPipelineCacheFile::Load(path, identity, data, &reason) && reason.empty();
+	bool saved = UnigmaPipelineCacheFile::Save(path, identity, driverData) && UnigmaPipelineCacheFile::Save(path, identity, driverData);
+	bool loaded = UnigmaPipelineCacheFile::Load(path, identity, data, &reason) && data == driverData;
+	std::filesystem::remove(path);
+	if (!missing || !saved || !loaded)
+	{
+		Logger::WriteMessage("EXCEPTION: PIPELINE CACHE FILE DID NOT SAVE AND LOAD.");
+		return false;
+	}
+
+	//Jobs run side by side, all of them before Wait returns.
+	UnigmaPipelineJobs jobs;
+	jobs.Start(4);
+	std::vector<int> results(64, -1);
+	std::atomic<int> active{ 0 };
+	std::atomic<int> peak{ 0 };
+	for (int i = 0; i < 64; i++)
+	{
+		jobs.Enqueue("job" + std::to_string(i), [&, i]() {
+			int now = ++active;
+			int seen = peak.load();
+			while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			results[i] = i * i;
+			active--;
+		});
+	}
+	jobs.Wait();
+	bool allRan = jobs.Completed() == 64 && peak.load() > 1 && jobs.BusyMilliseconds() > 0.0;
+	for (int i = 0; i < 64; i++)
+		allRan = allRan && results[i] == i * i;
+	if (!allRan)
+	{
+		Logger::WriteMessage("EXCEPTION: PIPELINE JOBS DID NOT ALL RUN OR DID NOT RUN IN PARALLEL.");
+		return false;
+	}
+
+	//A failing job surfaces at Wait with its name, once; the others still run.
+	int after = 0;
+	jobs.Enqueue("broken_pipeline", []() { throw std::runtime_error("bad spirv"); });
+	jobs.Enqueue("fine_pipeline", [&]() { after++; });
+	std::string failure;
+	try
+	{
+		jobs.Wait();
+	}
+	catch (const std::runtime_error& e)
+	{
+		failure = e.what();
+	}
+	bool waitedClean = true;
+	try
+	{
+		jobs.Wait();
+	}
+	catch (...)
+	{
+		waitedClean = false;
+	}
+	jobs.Stop();
+	UnigmaPipelineJobs inline_;
+	int ranInline = 0;
+	inline_.Enqueue("inline", [&]() { ranInline++; });
+	//Stopped, jobs run inline and their failure is thrown at Enqueue, since no Wait follows.
+	std::string inlineFailure;
+	try
+	{
+		jobs.Enqueue("broken_inline", []() { throw std::runtime_error("bad spirv"); });
+	}
+	catch (const std::runtime_error& e)
+	{
+		inlineFailure = e.what();
+	}
+	if (failure.find("broken_pipeline") == std::string::npos || failure.find("bad spirv") == std::string::npos ||
+		!waitedClean || after != 1 || ranInline != 1 || inline_.Threads() != 0 ||
+		inlineFailure.find("broken_inline") == std::string::npos)
+	{
+		Logger::WriteMessage("EXCEPTION: PIPELINE JOBS LOST A FAILURE OR DID NOT RUN INLINE.");
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "pch.h"
+#include "Engine/Renderer/UnigmaRenderGraph.h"
+#include "Engine/Renderer/UnigmaDeviceMemory.h"
+#include "Engine/Renderer/UnigmaReadback.h"
+#include "Engine/Renderer/UnigmaPipelineCache.h"
+
+class UnigmaRendererTests
+{
+	public:
+		bool TestRenderGraphCompiles();
+		bool TestDeviceMemoryPools();
+		bool TestReadbackScheduling();
+		bool TestPipelineCache();
+};
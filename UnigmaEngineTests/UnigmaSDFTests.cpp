@@ -0,0 +1,2178 @@
+#include "pch.h"
+#include "UnigmaSDFTests.h"
+#include "CppUnitTest.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstring>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+static bool SameBins(const SDFTileBins& a, const SDFTileBins& b)
+{
+	return a.tileCount == b.tileCount && a.offsets == b.offsets && a.counts == b.counts &&
+		a.brushIndices == b.brushIndices && a.maxCount == b.maxCount;
+}
+
+bool UnigmaSDFTests::TestTileBinningMatchesBruteForce()
+{
+	SDFTileGrid tiles(SDFGridDesc(glm::ivec3(256, 256, 64), glm::vec3(64.0f, 64.0f, 16.0f)), 8);
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> pos(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> size(0.05f, 6.0f);
+
+	std::vector<SDFAABB> bounds;
+	for (int i = 0; i < 2000; i++)
+	{
+		glm::vec3 c(pos(rng), pos(rng), pos(rng) * 0.25f);
+		bounds.push_back(SDFAABB(c - size(rng), c + size(rng)));
+	}
+
+	//Dense sculpting spot, well past the old 64 brush cap.
+	for (int i = 0; i < 300; i++)
+	{
+		glm::vec3 c(pos(rng) * 0.01f, pos(rng) * 0.01f, 0.0f);
+		bounds.push_back(SDFAABB(c - 0.5f, c + 0.5f));
+	}
+
+	bounds.push_back(SDFAABB()); //Invalid.
+	bounds.push_back(SDFAABB(glm::vec3(100.0f), glm::vec3(101.0f))); //Outside the grid.
+
+	SDFTileBins fast, reference;
+	BinBrushesToTiles(tiles, bounds, fast);
+	BinBrushesToTilesBruteForce(tiles, bounds, reference);
+
+	if (!SameBins(fast, reference))
+	{
+		Logger::WriteMessage("EXCEPTION: BVH TILE BINNING DIFFERS FROM BRUTE FORCE.");
+		return false;
+	}
+
+	if (fast.maxCount <= 300)
+	{
+		Logger::WriteMessage("EXCEPTION: DENSE TILE LOST BRUSHES.");
+		return false;
+	}
+
+	//Block size must not change the result.
+	SDFTileBinningSettings settings;
+	settings.blockSize = 1;
+	BinBrushesToTiles(tiles, bounds, fast, settings);
+	if (!SameBins(fast, reference))
+	{
+		Logger::WriteMessage("EXCEPTION: TILE BINNING DEPENDS ON BLOCK SIZE.");
+		return false;
+	}
+
+	return true;
+}
+
+static double AngleBetween(const glm::vec3& a, const glm::vec3& b)
+{
+	return std::atan2((double)glm::length(glm::cross(a, b)), (double)glm::dot(a, b));
+}
+
+bool UnigmaSDFTests::TestVoxelPackingRoundTrip()
+{
+	//Every 16 bit code decodes and re-encodes to itself. -32768 is never produced by the encoder.
+	for (uint32_t code = 0; code < 65536; code++)
+	{
+		if (code != 0x8000u && SDFPackSnorm16(SDFUnpackSnorm16(code)) != code)
+		{
+			Logger::WriteMessage("EXCEPTION: SNORM16 ROUND TRIP FAILED.");
+			return false;
+		}
+		if (SDFPackUnorm16(SDFUnpackUnorm16(code)) != code)
+		{
+			Logger::WriteMessage("EXCEPTION: UNORM16 ROUND TRIP FAILED.");
+			return false;
+		}
+
+		SDFVoxelPacked v;
+		v.distances = code | (code << 16);
+		v.brushDensity = code | (code << 16);
+		SDFVoxelPacked r = SDFEncodeVoxel(SDFDecodeVoxelDistance(v), SDFDecodeVoxelNormalDistance(v), glm::vec3(0, 0, 1),
+			SDFDecodeVoxelBrushId(v), SDFDecodeVoxelDensity(v));
+		if ((code != 0x8000u && r.distances != v.distances) || r.brushDensity != v.brushDensity)
+		{
+			Logger::WriteMessage("EXCEPTION: VOXEL FIELD ROUND TRIP FAILED.");
+			return false;
+		}
+	}
+
+	//Distances stay within half a quantization step and clamp to the range.
+	const float step = SDF_VOXEL_DISTANCE_RANGE / 32767.0f;
+	for (float d = -SDF_VOXEL_DISTANCE_RANGE; d <= SDF_VOXEL_DISTANCE_RANGE; d += 0.000731f)
+	{
+		SDFVoxelPacked v = SDFEncodeVoxel(d, -d, glm::vec3(1, 0, 0), 7, 1.0f);
+		if (std::abs(SDFDecodeVoxelDistance(v) - d) > step * 0.5001f || std::abs(SDFDecodeVoxelNormalDistance(v) + d) > step * 0.5001f)
+		{
+			Logger::WriteMessage("EXCEPTION: VOXEL DISTANCE QUANTIZATION TOO COARSE.");
+			return false;
+		}
+	}
+	SDFVoxelPacked clamped = SDFEncodeVoxel(100.0f, -100.0f, glm::vec3(0, 1, 0), 1u << 20, 1000.0f);
+	if (SDFDecodeVoxelDistance(clamped) != SDF_VOXEL_DISTANCE_RANGE || SDFDecodeVoxelNormalDistance(clamped) != -SDF_VOXEL_DISTANCE_RANGE ||
+		SDFDecodeVoxelBrushId(clamped) != SDF_VOXEL_MAX_BRUSH_ID || SDFDecodeVoxelDensity(clamped) != SDF_VOXEL_DENSITY_MAX)
+	{
+		Logger::WriteMessage("EXCEPTION: VOXEL ENCODING DOES NOT CLAMP.");
+		return false;
+	}
+
+	//Octahedral codes: a dense lattice plus every code along the fold edges and the axes.
+	auto checkCode = [](uint32_t x, uint32_t y) {
+		uint32_t code = x | (y << 16);
+		glm::vec3 n = SDFUnpackNormalOct16(code);
+		return std::abs(glm::length(n) - 1.0f) < 1e-5f && AngleBetween(n, SDFUnpackNormalOct16(SDFPackNormalOct16(n))) < 1e-4;
+	};
+	const uint32_t edges[] = { 0x0000u, 0x7FFFu, 0x8001u };
+	for (uint32_t a = 0; a < 65536; a++)
+	{
+		if (a == 0x8000u)
+			continue;
+		for (uint32_t e : edges)
+		{
+			if (!checkCode(a, e) || !checkCode(e, a))
+			{
+				Logger::WriteMessage("EXCEPTION: OCTAHEDRAL EDGE CODE ROUND TRIP FAILED.");
+				return false;
+			}
+		}
+	}
+	for (uint32_t y = 1; y < 65536; y += 61)
+		for (uint32_t x = 1; x < 65536; x += 61)
+			if (!checkCode(x, y))
+			{
+				Logger::WriteMessage("EXCEPTION: OCTAHEDRAL CODE ROUND TRIP FAILED.");
+				return false;
+			}
+
+	//Arbitrary unit normals come back within the 16 bit octahedral error.
+	std::mt19937 rng(99);
+	std::normal_distribution<float> gauss;
+	for (int i = 0; i < 1000000; i++)
+	{
+		glm::vec3 n = glm::normalize(glm::vec3(gauss(rng), gauss(rng), gauss(rng)));
+		if (AngleBetween(n, SDFUnpackNormalOct16(SDFPackNormalOct16(n))) > 1e-4)
+		{
+			Logger::WriteMessage("EXCEPTION: OCTAHEDRAL NORMAL ERROR TOO LARGE.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestBrushSchedulerBudget()
+{
+	//Simulated GPU: slice cost per (type, resolution) with some noise, unknown to the scheduler.
+	auto trueSliceMs = [](const SDFBrushCostKey& key) {
+		float area = float(key.resolution * key.resolution) / (64.0f * 64.0f);
+		return (key.type == 0 ? 0.4f : 0.15f) * area;
+	};
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> noise(0.95f, 1.05f);
+	std::uniform_real_distribution<float> pos(0.0f, 200.0f);
+
+	SDFBrushScheduler scheduler;
+	scheduler.frameBudgetMs = 3.0f;
+	const uint32_t resolutions[] = { 32, 64, 128 };
+	std::vector<float> distances;
+	for (int i = 0; i < 120; i++)
+	{
+		uint32_t type = i % 2;
+		uint32_t res = resolutions[(i / 2) % 3];
+		scheduler.Enqueue(i, type, res, (res + 7) / 8);
+		float d = pos(rng);
+		bool visible = (i % 3) != 0;
+		scheduler.SetView(i, d, visible);
+		distances.push_back(visible ? d : d * scheduler.invisibleDistanceScale + 1.0f);
+	}
+	scheduler.Enqueue(5, 1, 64, 8); //Re-enqueue replaces the job.
+	scheduler.Cancel(119);
+	if (scheduler.Jobs().size() != 119)
+	{
+		Logger::WriteMessage("EXCEPTION: ENQUEUE/CANCEL BOOKKEEPING WRONG.");
+		return false;
+	}
+
+	std::vector<uint32_t> slicesDone(120, 0);
+	std::vector<int> finishFrame(120, -1);
+	int frame = 0;
+	float worstFrame = 0.0f;
+	while (!scheduler.Empty() && frame < 10000)
+	{
+		std::vector<SDFBrushSlice> slices = scheduler.Plan();
+		if (slices.empty())
+		{
+			Logger::WriteMessage("EXCEPTION: SCHEDULER STALLED WITH QUEUED JOBS.");
+			return false;
+		}
+
+		//Frames that run a key for the first time go on an extrapolated estimate and may overrun.
+		bool extrapolated = false;
+		for (const SDFBrushSlice& slice : slices)
+			extrapolated = extrapolated || !scheduler.costModel.HasMeasurement(slice.key);
+
+		float measured = 0.0f;
+		for (const SDFBrushSlice& slice : slices)
+		{
+			if (slice.firstSlice != slicesDone[slice.brushIndex])
+			{
+				Logger::WriteMessage("EXCEPTION: SLICES SKIPPED OR REPEATED.");
+				return false;
+			}
+			slicesDone[slice.brushIndex] += slice.sliceCount;
+			measured += trueSliceMs(slice.key) * slice.sliceCount * noise(rng);
+			if (slicesDone[slice.brushIndex] == (slice.key.resolution + 7) / 8 || (slice.brushIndex == 5 && slicesDone[5] == 8))
+				finishFrame[slice.brushIndex] = frame;
+		}
+		scheduler.ReportFrame(slices, measured);
+
+		//Past a short warmup and with every key measured, a frame only overruns when a single slice is larger than the budget.
+		float largestSlice = 0.0f;
+		for (const SDFBrushSlice& slice : slices)
+			largestSlice = std::max(largestSlice, trueSliceMs(slice.key));
+		if (frame >= 20 && !extrapolated && largestSlice <= scheduler.frameBudgetMs)
+			worstFrame = std::max(worstFrame, measured);
+		frame++;
+	}
+
+	if (!scheduler.Empty())
+	{
+		Logger::WriteMessage("EXCEPTION: SCHEDULER DID NOT FINISH.");
+		return false;
+	}
+	for (int i = 0; i < 119; i++)
+	{
+		if (finishFrame[i] < 0)
+		{
+			Logger::WriteMessage("EXCEPTION: JOB NEVER COMPLETED.");
+			return false;
+		}
+	}
+	if (worstFrame > scheduler.frameBudgetMs * 1.15f)
+	{
+		Logger::WriteMessage("EXCEPTION: FRAME BUDGET EXCEEDED WITH MEASURED COSTS.");
+		return false;
+	}
+
+	//Learned costs land on the simulated ones. The cheapest keys are lost in frame noise, so they get an absolute margin.
+	for (uint32_t type = 0; type < 2; type++)
+		for (uint32_t res : resolutions)
+		{
+			SDFBrushCostKey key{ type, res };
+			float error = std::abs(scheduler.costModel.EstimateSliceMs(key) - trueSliceMs(key));
+			if (error > std::max(0.15f * trueSliceMs(key), 0.01f * scheduler.frameBudgetMs))
+			{
+				Logger::WriteMessage("EXCEPTION: COST MODEL DID NOT CONVERGE.");
+				return false;
+			}
+		}
+
+	//Priority order: the nearest visible quarter finishes before the farthest quarter on average.
+	std::vector<int> byPriority;
+	for (int i = 0; i < 119; i++)
+		if (i != 5)
+			byPriority.push_back(i);
+	std::sort(byPriority.begin(), byPriority.end(), [&](int a, int b) { return distances[a] < distances[b]; });
+	size_t quarter = byPriority.size() / 4;
+	double nearFinish = 0.0, farFinish = 0.0;
+	for (size_t i = 0; i < quarter; i++)
+	{
+		nearFinish += finishFrame[byPriority[i]];
+		farFinish += finishFrame[byPriority[byPriority.size() - 1 - i]];
+	}
+	if (nearFinish >= farFinish)
+	{
+		Logger::WriteMessage("EXCEPTION: NEAR VISIBLE BRUSHES NOT PRIORITIZED.");
+		return false;
+	}
+
+	return true;
+}
+
+//Closed, outward facing UV torus around z.
+static void MakeTorus(float major, float minor, int rings, int sides, const glm::vec3& offset,
+	std::vector<glm::vec3>& positions, std::vector<glm::uvec3>& triangles)
+{
+	uint32_t base = (uint32_t)positions.size();
+	for (int i = 0; i < rings; i++)
+		for (int j = 0; j < sides; j++)
+		{
+			float u = 6.2831853f * i / rings;
+			float v = 6.2831853f * j / sides;
+			float r = major + minor * std::cos(v);
+			positions.push_back(offset + glm::vec3(r * std::cos(u), r * std::sin(u), minor * std::sin(v)));
+		}
+	for (int i = 0; i < rings; i++)
+		for (int j = 0; j < sides; j++)
+		{
+			uint32_t a = base + i * sides + j;
+			uint32_t b = base + ((i + 1) % rings) * sides + j;
+			uint32_t c = base + ((i + 1) % rings) * sides + (j + 1) % sides;
+			uint32_t d = base + i * sides + (j + 1) % sides;
+			triangles.push_back(glm::uvec3(a, b, c));
+			triangles.push_back(glm::uvec3(a, c, d));
+		}
+}
+
+//Outward facing UV sphere. skipRings leaves the top rings out so the mesh is open.
+static void MakeSphere(float radius, int stacks, int slices, int skipRings, const glm::vec3& offset,
+	std::vector<glm::vec3>& positions, std::vector<glm::uvec3>& triangles)
+{
+	uint32_t base = (uint32_t)positions.size();
+	for (int i = 0; i <= stacks; i++)
+		for (int j = 0; j < slices; j++)
+		{
+			float theta = 3.14159265f * i / stacks;
+			float phi = 6.2831853f * j / slices;
+			positions.push_back(offset + radius * glm::vec3(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta)));
+		}
+	for (int i = skipRings; i < stacks; i++)
+		for (int j = 0; j < slices; j++)
+		{
+			uint32_t a = base + i * slices + j;
+			uint32_t b = base + (i + 1) * slices + j;
+			uint32_t c = base + (i + 1) * slices + (j + 1) % slices;
+			uint32_t d = base + i * slices + (j + 1) % slices;
+			if (i != stacks - 1)
+				triangles.push_back(glm::uvec3(a, b, c));
+			if (i != 0)
+				triangles.push_back(glm::uvec3(a, c, d));
+		}
+}
+
+bool UnigmaSDFTests::TestFastWindingNumberMatchesBruteForce()
+{
+	struct Case
+	{
+		const char* name;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::uvec3> triangles;
+	};
+	std::vector<Case> cases(4);
+	cases[0].name = "SPHERE";
+	MakeSphere(1.0f, 24, 32, 0, glm::vec3(0.0f), cases[0].positions, cases[0].triangles);
+	cases[1].name = "TORUS AND SPHERE";
+	MakeTorus(1.2f, 0.4f, 48, 16, glm::vec3(0.0f), cases[1].positions, cases[1].triangles);
+	MakeSphere(0.5f, 12, 16, 0, glm::vec3(0.3f, 0.2f, 1.1f), cases[1].positions, cases[1].triangles);
+	cases[2].name = "OPEN SPHERE";
+	MakeSphere(1.0f, 24, 32, 4, glm::vec3(0.0f), cases[2].positions, cases[2].triangles);
+	cases[3].name = "SOUP";
+	std::mt19937 rng(99);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (int i = 0; i < 600; i++)
+	{
+		glm::vec3 c(unit(rng), unit(rng), unit(rng));
+		for (int k = 0; k < 3; k++)
+			cases[3].positions.push_back(c + 0.3f * glm::vec3(unit(rng), unit(rng), unit(rng)));
+		cases[3].triangles.push_back(glm::uvec3(i * 3, i * 3 + 1, i * 3 + 2));
+	}
+
+	for (const Case& mesh : cases)
+	{
+		SDFWindingNumber winding;
+		winding.Build(mesh.positions, mesh.triangles, 4);
+		if (winding.TriangleCount() != mesh.triangles.size())
+		{
+			Logger::WriteMessage("EXCEPTION: WINDING BVH LOST TRIANGLES.");
+			return false;
+		}
+
+		//Random points around the mesh plus points just off the surface on both sides.
+		std::vector<glm::vec3> points;
+		for (int i = 0; i < 1500; i++)
+			points.push_back(2.2f * glm::vec3(unit(rng), unit(rng), unit(rng)));
+		for (size_t t = 0; t < mesh.triangles.size(); t += 7)
+		{
+			const glm::uvec3& tri = mesh.triangles[t];
+			glm::vec3 a = mesh.positions[tri.x], b = mesh.positions[tri.y], c = mesh.positions[tri.z];
+			glm::vec3 n = glm::cross(b - a, c - a);
+			if (glm::length(n) < 1e-12f)
+				continue;
+			n = glm::normalize(n);
+			glm::vec3 centroid = (a + b + c) / 3.0f;
+			points.push_back(centroid + n * 0.01f);
+			points.push_back(centroid - n * 0.01f);
+		}
+
+		//Infinite beta never uses a dipole and must agree with brute force. The dipole error shrinks as beta grows.
+		std::vector<float> exact, coarse, fine;
+		winding.QueryPoints(points, exact, std::numeric_limits<float>::infinity());
+		winding.QueryPoints(points, coarse, SDF_WINDING_DEFAULT_BETA);
+		winding.QueryPoints(points, fine, 4.0f);
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			float reference = SDFWindingNumber::BruteForce(mesh.positions, mesh.triangles, points[i]);
+			if (std::abs(exact[i] - reference) > 1e-4f)
+			{
+				Logger::WriteMessage((std::string("EXCEPTION: EXACT WINDING DIFFERS FROM BRUTE FORCE ON ") + mesh.name + ".").c_str());
+				return false;
+			}
+			if (std::abs(coarse[i] - reference) > 0.1f || std::abs(fine[i] - reference) > 0.015f)
+			{
+				Logger::WriteMessage((std::string("EXCEPTION: FAST WINDING OUT OF TOLERANCE ON ") + mesh.name + ".").c_str());
+				return false;
+			}
+			if (std::abs(reference - 0.5f) > 0.1f && (coarse[i] > 0.5f) != (reference > 0.5f))
+			{
+				Logger::WriteMessage((std::string("EXCEPTION: FAST WINDING MISCLASSIFIED A POINT ON ") + mesh.name + ".").c_str());
+				return false;
+			}
+		}
+	}
+
+	//Soup input builds the same tree as the indexed mesh.
+	std::vector<glm::vec3> soup;
+	for (const glm::uvec3& t : cases[1].triangles)
+	{
+		soup.push_back(cases[1].positions[t.x]);
+		soup.push_back(cases[1].positions[t.y]);
+		soup.push_back(cases[1].positions[t.z]);
+	}
+	SDFWindingNumber fromMesh, fromSoup;
+	fromMesh.Build(cases[1].positions, cases[1].triangles);
+	fromSoup.BuildSoup(soup);
+	glm::vec3 probe(0.3f, 0.25f, 0.9f);
+	if (fromMesh.NodeCount() != fromSoup.NodeCount() || fromMesh.Query(probe) != fromSoup.Query(probe))
+	{
+		Logger::WriteMessage("EXCEPTION: SOUP AND INDEXED BUILDS DIFFER.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestWindingGridMatchesPointQueries()
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::uvec3> triangles;
+	MakeTorus(1.2f, 0.4f, 64, 24, glm::vec3(0.0f), positions, triangles);
+	MakeSphere(0.5f, 16, 24, 0, glm::vec3(0.3f, 0.2f, 1.1f), positions, triangles);
+
+	SDFWindingNumber winding;
+	winding.Build(positions, triangles);
+
+	//Brush style bounds with padding, odd resolution so blocks are clipped at the far faces.
+	SDFAABB bounds(glm::vec3(-2.0f, -2.0f, -0.8f), glm::vec3(2.0f, 2.0f, 1.9f));
+	glm::ivec3 resolution(61, 64, 45);
+	std::vector<uint8_t> grid;
+	winding.ClassifyGrid(bounds, resolution, grid);
+
+	glm::vec3 voxelSize = bounds.Extent() / glm::vec3(resolution);
+	size_t insideCount = 0;
+	for (int z = 0; z < resolution.z; z++)
+		for (int y = 0; y < resolution.y; y++)
+			for (int x = 0; x < resolution.x; x++)
+			{
+				glm::vec3 p = bounds.min + (glm::vec3(x, y, z) + 0.5f) * voxelSize;
+				uint8_t expected = winding.Inside(p) ? 1 : 0;
+				uint8_t got = grid[size_t(x) + size_t(y) * resolution.x + size_t(z) * resolution.x * resolution.y];
+				if (got != expected)
+				{
+					Logger::WriteMessage("EXCEPTION: GRID CLASSIFICATION DIFFERS FROM POINT QUERIES.");
+					return false;
+				}
+				insideCount += got;
+			}
+
+	//Torus volume 2 pi^2 R r^2 plus the part of the sphere outside it, within a few voxels worth of error.
+	float voxelVolume = voxelSize.x * voxelSize.y * voxelSize.z;
+	float torusVolume = 2.0f * 3.14159265f * 3.14159265f * 1.2f * 0.4f * 0.4f;
+	float volume = float(insideCount) * voxelVolume;
+	if (volume < torusVolume * 0.95f || volume > torusVolume + 4.0f / 3.0f * 3.14159265f * 0.125f * 1.05f)
+	{
+		Logger::WriteMessage("EXCEPTION: GRID INSIDE VOLUME IMPLAUSIBLE.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestParticleSplatMatchesScatter()
+{
+	//Odd resolution so bricks are clipped at the far faces.
+	SDFGridDesc grid(glm::ivec3(90, 84, 42), glm::vec3(12.0f, 11.2f, 5.6f));
+	std::mt19937 rng(77);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	//A dense ball, a sparse spray and a few particles just outside the grid that still reach the border voxels.
+	std::vector<glm::vec3> positions;
+	glm::vec3 ballCenter(1.0f, -0.5f, 0.3f);
+	while (positions.size() < 2000)
+	{
+		glm::vec3 p(unit(rng), unit(rng), unit(rng));
+		if (glm::dot(p, p) <= 1.0f)
+			positions.push_back(ballCenter + p * 1.5f);
+	}
+	for (int i = 0; i < 500; i++)
+		positions.push_back(glm::vec3(unit(rng) * 6.0f, unit(rng) * 5.6f, unit(rng) * 2.8f));
+	for (int i = 0; i < 50; i++)
+		positions.push_back(glm::vec3(6.05f, unit(rng) * 5.6f, unit(rng) * 2.8f));
+
+	for (int kernel = 0; kernel < 2; kernel++)
+		for (float support : { 1.0f, 1.5f })
+		{
+			SDFParticleSplatSettings settings;
+			settings.kernel = (SDFParticleKernel)kernel;
+			settings.supportMultiplier = support;
+
+			SDFParticleField reference, hashed, smallBricks;
+			SDFSplatParticlesReference(grid, positions, settings, reference);
+			SDFSplatParticles(grid, positions, settings, hashed);
+			SDFSplatParticles(grid, positions, settings, smallBricks, 5);
+
+			//Integer sums do not depend on order, so every path must agree exactly.
+			if (hashed.density != reference.density || hashed.distance != reference.distance || hashed.phi != reference.phi ||
+				smallBricks.density != reference.density || smallBricks.distance != reference.distance)
+			{
+				Logger::WriteMessage("EXCEPTION: HASHED PARTICLE SPLAT DIFFERS FROM SCATTER.");
+				return false;
+			}
+
+			//The weighted average sits near zero inside the ball (it averages neighbours, not the nearest one), far below the
+			//empty value. The particles past +x only land in the border column through its clamped cells.
+			size_t center = grid.Flatten(glm::ivec3(grid.WorldToVoxel(ballCenter)));
+			uint64_t borderDensity = 0;
+			for (int z = 0; z < grid.resolution.z; z++)
+				for (int y = 0; y < grid.resolution.y; y++)
+					borderDensity += reference.density[grid.Flatten(glm::ivec3(grid.resolution.x - 1, y, z))];
+			if (reference.density[center] == 0 || std::abs(reference.phi[center]) > 0.25f || borderDensity == 0)
+			{
+				Logger::WriteMessage("EXCEPTION: PARTICLE SPLAT FIELD IMPLAUSIBLE.");
+				return false;
+			}
+
+			//Smooth min sums floats in a different order per path, so only closeness is expected.
+			settings.blend = SDFParticleBlend::SmoothMin;
+			SDFSplatParticlesReference(grid, positions, settings, reference);
+			SDFSplatParticles(grid, positions, settings, hashed);
+			for (size_t i = 0; i < reference.phi.size(); i++)
+				if (std::abs(hashed.phi[i] - reference.phi[i]) > 1e-4f)
+				{
+					Logger::WriteMessage("EXCEPTION: HASHED SMOOTH MIN SPLAT DIFFERS FROM SCATTER.");
+					return false;
+				}
+			if (reference.phi[center] >= 0.0f)
+			{
+				Logger::WriteMessage("EXCEPTION: SMOOTH MIN SPLAT FIELD IMPLAUSIBLE.");
+				return false;
+			}
+		}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestCageWeightsMatchDirectEvaluation()
+{
+	SDFCage cage = SDFCage::Canonical();
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<glm::vec3> displacement(cage.rest.size());
+	for (glm::vec3& d : displacement)
+		d = glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.2f;
+
+	//Untruncated inverse distance weights reproduce DeformBrush's per voxel sum.
+	glm::ivec3 resolution(13, 10, 7);
+	SDFCageBinding idw;
+	idw.BuildGrid(cage, resolution, SDFCageWeightMode::InverseDistance, 0);
+	std::vector<glm::vec3> delta, scalarDelta;
+	idw.Apply(displacement, delta);
+	idw.ApplyScalar(displacement, scalarDelta);
+	for (int z = 0; z < resolution.z; z++)
+		for (int y = 0; y < resolution.y; y++)
+			for (int x = 0; x < resolution.x; x++)
+			{
+				glm::vec3 p = (glm::vec3(x, y, z) + 0.5f) / glm::vec3(resolution) * 2.0f - 1.0f;
+				glm::vec3 num(0.0f);
+				float denom = 0.0f;
+				for (size_t i = 0; i < cage.rest.size(); i++)
+				{
+					glm::vec3 r = cage.rest[i] - p;
+					float w = 1.0f / std::pow(std::max(std::sqrt(glm::dot(r, r) + 1e-6f), 1e-6f), 2.0f);
+					num += w * displacement[i];
+					denom += w;
+				}
+				glm::vec3 expected = num / std::max(denom, 1e-6f);
+				size_t i = size_t(x) + size_t(y) * resolution.x + size_t(z) * resolution.x * resolution.y;
+				if (glm::length(delta[i] - expected) > 1e-5f || glm::length(delta[i] - scalarDelta[i]) > 1e-6f)
+				{
+					Logger::WriteMessage("EXCEPTION: CACHED CAGE WEIGHTS DIFFER FROM DIRECT EVALUATION.");
+					return false;
+				}
+			}
+
+	//Mean value coordinates reproduce affine cage motion exactly, and truncation to 8 influences must keep that.
+	auto affineMap = [](const glm::vec3& p) {
+		return glm::vec3(1.1f, 0.2f, -0.1f) * p.x + glm::vec3(0.05f, 0.9f, 0.15f) * p.y + glm::vec3(-0.2f, 0.1f, 1.2f) * p.z + glm::vec3(0.3f, -0.2f, 0.1f);
+	};
+	std::vector<glm::vec3> affine(cage.rest.size());
+	for (size_t i = 0; i < cage.rest.size(); i++)
+		affine[i] = affineMap(cage.rest[i]) - cage.rest[i];
+
+	std::vector<glm::vec3> points;
+	for (int i = 0; i < 2000; i++)
+		points.push_back(glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.98f);
+
+	for (uint32_t influences : { 0u, 8u })
+	{
+		SDFCageBinding mvc;
+		mvc.Build(cage, points, SDFCageWeightMode::MeanValue, influences);
+		mvc.Apply(affine, delta);
+		float worst = 0.0f;
+		for (size_t i = 0; i < points.size(); i++)
+			worst = std::max(worst, glm::length(points[i] + delta[i] - affineMap(points[i])));
+		if (worst > 1e-4f)
+		{
+			char message[128];
+			snprintf(message, sizeof(message), "EXCEPTION: MEAN VALUE CAGE NOT AFFINE EXACT (%u influences, error %f).", influences, worst);
+			Logger::WriteMessage(message);
+			return false;
+		}
+	}
+
+	//Every brush of one resolution shares a binding.
+	SDFCageWeightCache cache;
+	auto first = cache.Get(cage, glm::ivec3(16), SDFCageWeightMode::MeanValue);
+	auto second = cache.Get(cage, glm::ivec3(16), SDFCageWeightMode::MeanValue);
+	auto other = cache.Get(cage, glm::ivec3(8), SDFCageWeightMode::MeanValue);
+	if (first != second || first == other || cache.Size() != 2 || first->PointCount() != 16 * 16 * 16 || first->Influences() != 8)
+	{
+		Logger::WriteMessage("EXCEPTION: CAGE WEIGHT CACHE DID NOT SHARE BINDINGS.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestPipelineHashesAreDeterministic()
+{
+	SDFPipelineScene scene = SDFPipelineScene::Canned(SDFPipelineSceneKind::Mixed, 1, 3);
+	SDFPipelineSettings settings;
+	SDFPipelineOutput first, serial, again;
+	SDFRunPipeline(scene, settings, first);
+	settings.maxThreads = 1;
+	SDFRunPipeline(scene, settings, serial);
+	settings.maxThreads = 0;
+	SDFRunPipeline(scene, settings, again);
+
+	for (uint32_t s = 0; s < uint32_t(SDFPipelineStage::Count); s++)
+	{
+		if (first.stages[s].hash != serial.stages[s].hash || first.stages[s].hash != again.stages[s].hash)
+		{
+			Logger::WriteMessage("EXCEPTION: PIPELINE STAGE HASH CHANGED BETWEEN RUNS.");
+			return false;
+		}
+	}
+
+	//A cooked torus is solid inside its tube and empty at its hole (bounds are 1.1 x 0.4 x 1.1 around it).
+	const CSGVolume& torus = first.volumes[0];
+	float tube = torus.SampleTrilinear(glm::vec3(1.8f / 2.2f, 0.5f, 0.5f));
+	float hole = torus.SampleTrilinear(glm::vec3(0.5f));
+	if (tube >= 0.0f || hole <= 0.0f || first.componentCount == 0 || first.triangles.empty())
+	{
+		Logger::WriteMessage("EXCEPTION: PIPELINE PRODUCED AN EMPTY OR INSIDE OUT SCENE.");
+		return false;
+	}
+
+	//Redistancing keeps every sign.
+	for (size_t i = 0; i < first.world.size(); i++)
+	{
+		if ((first.world[i] < 0.0f) != (first.distance[i] < 0.0f))
+		{
+			Logger::WriteMessage("EXCEPTION: EIKONAL SWEEPS FLIPPED A VOXEL.");
+			return false;
+		}
+	}
+
+	//Labels against a plain 26-connected flood fill.
+	glm::ivec3 res = scene.grid.resolution;
+	std::vector<uint32_t> flood(first.labels.size(), SDF_PIPELINE_NO_LABEL);
+	std::vector<uint32_t> stack;
+	uint32_t components = 0;
+	for (uint32_t seed = 0; seed < uint32_t(flood.size()); seed++)
+	{
+		if (first.distance[seed] >= settings.labelThreshold || flood[seed] != SDF_PIPELINE_NO_LABEL)
+			continue;
+		components++;
+		flood[seed] = seed;
+		stack.push_back(seed);
+		while (!stack.empty())
+		{
+			uint32_t i = stack.back();
+			stack.pop_back();
+			glm::ivec3 v(i % res.x, (i / res.x) % res.y, i / (res.x * res.y));
+			for (int dz = -1; dz <= 1; dz++)
+				for (int dy = -1; dy <= 1; dy++)
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						glm::ivec3 n = v + glm::ivec3(dx, dy, dz);
+						if (n.x < 0 || n.y < 0 || n.z < 0 || n.x >= res.x || n.y >= res.y || n.z >= res.z)
+							continue;
+						uint32_t j = uint32_t(scene.grid.Flatten(n));
+						if (first.distance[j] < settings.labelThreshold && flood[j] == SDF_PIPELINE_NO_LABEL)
+						{
+							flood[j] = seed;
+							stack.push_back(j);
+						}
+					}
+		}
+	}
+	if (components != first.componentCount || flood != first.labels)
+	{
+		Logger::WriteMessage("EXCEPTION: PIPELINE LABELS DIFFER FROM FLOOD FILL.");
+		return false;
+	}
+
+	//Quads face away from the solid, so the mesh encloses a positive volume.
+	double volume = 0.0;
+	for (const glm::uvec3& t : first.triangles)
+		volume += glm::dot(first.vertices[t.x], glm::cross(first.vertices[t.y], first.vertices[t.z])) / 6.0;
+	if (volume <= 0.0)
+	{
+		Logger::WriteMessage("EXCEPTION: PIPELINE MESH IS INSIDE OUT.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestSphereTracerHitsAnalyticSphere()
+{
+	SDFGridDesc grid(glm::ivec3(48), glm::vec3(8.0f));
+	glm::vec3 center(0.5f, -0.25f, 0.0f);
+	float radius = 2.0f;
+	std::vector<float> field(grid.VoxelCount());
+	for (int z = 0; z < 48; z++)
+		for (int y = 0; y < 48; y++)
+			for (int x = 0; x < 48; x++)
+				field[grid.Flatten(glm::ivec3(x, y, z))] = glm::length(grid.VoxelCenter(glm::ivec3(x, y, z)) - center) - radius;
+
+	SDFSphereTracer tracer;
+	tracer.SetField(grid, &field);
+	SDFTraceCamera camera = SDFTraceCamera::LookAt(glm::vec3(0.0f, -12.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), 40.0f, 1.0f);
+	SDFTraceSettings settings;
+	settings.mode = SDFTraceMode::Normal;
+
+	//Every pixel agrees with the analytic intersection on hit or miss (away from grazing rays), and hits land on it.
+	const int size = 64;
+	float voxel = grid.VoxelSize().x;
+	int hits = 0;
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+		{
+			SDFRay ray = camera.PixelRay(x, y, size, size);
+			glm::vec3 oc = ray.origin - center;
+			float b = glm::dot(oc, ray.direction);
+			float disc = b * b - (glm::dot(oc, oc) - radius * radius);
+			SDFTraceHit hit = tracer.Trace(ray, settings);
+
+			if (std::abs(disc) < 0.5f)
+				continue;
+			if (hit.hit != (disc > 0.0f))
+			{
+				Logger::WriteMessage("EXCEPTION: SPHERE TRACER HIT/MISS DIFFERS FROM THE ANALYTIC SPHERE.");
+				return false;
+			}
+			if (!hit.hit)
+				continue;
+			hits++;
+			glm::vec3 expectedNormal = glm::normalize(hit.position - center);
+			if (std::abs(glm::length(hit.position - center) - radius) > voxel * 0.1f || glm::dot(hit.normal, expectedNormal) < 0.98f)
+			{
+				Logger::WriteMessage("EXCEPTION: SPHERE TRACER HIT POINT IS OFF THE SURFACE.");
+				return false;
+			}
+		}
+
+	//Tiles only split the work.
+	SDFTraceImage a, b;
+	settings.tileSize = 16;
+	SDFTraceStats stats = tracer.Render(camera, settings, size, size, a);
+	settings.tileSize = 7;
+	tracer.Render(camera, settings, size, size, b);
+	if (hits == 0 || stats.rays != uint64_t(size * size) || a.pixels != b.pixels)
+	{
+		Logger::WriteMessage("EXCEPTION: SPHERE TRACER IMAGE DEPENDS ON THE TILING.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestPacketTracerMatchesScalar()
+{
+	//A sphere cut by a box, so some rays graze, some pass through the hole and some run out of steps.
+	SDFGridDesc grid(glm::ivec3(40, 36, 32), glm::vec3(8.0f, 7.2f, 6.4f));
+	std::vector<float> field(grid.VoxelCount());
+	for (int z = 0; z < grid.resolution.z; z++)
+		for (int y = 0; y < grid.resolution.y; y++)
+			for (int x = 0; x < grid.resolution.x; x++)
+			{
+				glm::vec3 p = grid.VoxelCenter(glm::ivec3(x, y, z));
+				glm::vec3 q = glm::abs(p - glm::vec3(0.5f, 0.0f, 0.0f)) - glm::vec3(0.6f, 3.0f, 0.6f);
+				float box = glm::length(glm::max(q, glm::vec3(0.0f))) + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+				field[grid.Flatten(glm::ivec3(x, y, z))] = std::max(glm::length(p) - 2.0f, -box);
+			}
+
+	SDFSphereTracer tracer;
+	tracer.SetField(grid, &field);
+	SDFTraceCamera camera = SDFTraceCamera::LookAt(glm::vec3(1.0f, -10.0f, 2.5f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), 45.0f, 1.0f);
+	SDFTraceSettings settings;
+	settings.maxSteps = 48;
+
+	//Camera rays for coherent packets, then rays fanning out in every direction from inside the grid.
+	const int size = 32;
+	std::vector<SDFRay> rays;
+	std::vector<float> starts;
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+		{
+			rays.push_back(camera.PixelRay(x, y, size, size));
+			starts.push_back(float((x * 7 + y) % 5) * 0.5f);
+		}
+	uint32_t seed = 17;
+	auto random = [&]() { seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5; return float(seed & 0xFFFF) / 65535.0f * 2.0f - 1.0f; };
+	for (int i = 0; i < 64; i++)
+	{
+		glm::vec3 d(random(), random(), random());
+		rays.push_back(SDFRay(glm::vec3(0.0f, -3.2f, 0.0f), glm::length(d) > 1e-3f ? glm::normalize(d) : glm::vec3(0.0f, 1.0f, 0.0f)));
+		starts.push_back(0.0f);
+	}
+
+	for (int compactLanes : { 0, 2, 8 })
+	{
+		SDFPacketSettings packetSettings;
+		packetSettings.compactLanes = compactLanes;
+		SDFPacketTracer packets(tracer, packetSettings);
+
+		//Every ray forced through a packet, divergent or not, ends exactly where the scalar trace ends it.
+		std::vector<SDFTraceHit> hits(rays.size());
+		for (size_t i = 0; i < rays.size(); i += SDF_PACKET_WIDTH)
+			packets.Trace8(&rays[i], int(std::min<size_t>(SDF_PACKET_WIDTH, rays.size() - i)), settings, &hits[i], &starts[i]);
+
+		int hitCount = 0;
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			SDFTraceHit expected = tracer.Trace(rays[i], settings, starts[i]);
+			const SDFTraceHit& h = hits[i];
+			hitCount += h.hit ? 1 : 0;
+			if (h.hit != expected.hit || h.steps != expected.steps || h.t != expected.t || h.position != expected.position ||
+				h.normal != expected.normal || h.visibility != expected.visibility)
+			{
+				Logger::WriteMessage("EXCEPTION: PACKET TRACE DIFFERS FROM THE SCALAR TRACE.");
+				return false;
+			}
+		}
+		if (hitCount == 0 || hitCount == int(rays.size()))
+		{
+			Logger::WriteMessage("EXCEPTION: PACKET TRACER TEST RAYS DO NOT MIX HITS AND MISSES.");
+			return false;
+		}
+
+		//Camera rays go as packets, the fan falls back to single rays.
+		SDFPacketStats stats = packets.TraceRays(rays.data(), rays.size(), settings, hits.data(), starts.data());
+		if (stats.packetRays + stats.scalarRays != rays.size() || stats.packetRays < uint64_t(size * size) || stats.scalarRays == 0)
+		{
+			Logger::WriteMessage("EXCEPTION: PACKET TRACER DID NOT SPLIT COHERENT AND DIVERGENT RAYS.");
+			return false;
+		}
+	}
+
+	//Render gives the same image with and without packets.
+	SDFTraceImage a, b;
+	settings.packets = true;
+	tracer.Render(camera, settings, 45, 37, a);
+	settings.packets = false;
+	tracer.Render(camera, settings, 45, 37, b);
+	if (a.pixels != b.pixels)
+	{
+		Logger::WriteMessage("EXCEPTION: PACKET RENDER DIFFERS FROM THE SCALAR RENDER.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestConePrepassStartsBeforeSurfaces()
+{
+	//A few small spheres in a large open grid, the case the prepass is for. Distances stop at empty space like the world grid.
+	SDFGridDesc grid(glm::ivec3(128, 128, 64), glm::vec3(16.0f, 16.0f, 8.0f));
+	const glm::vec4 spheres[] = { glm::vec4(0.0f, 0.0f, 0.0f, 1.5f), glm::vec4(4.5f, 3.0f, -1.0f, 1.0f), glm::vec4(-5.0f, 2.0f, 1.5f, 0.75f),
+		glm::vec4(-3.0f, -4.0f, -2.0f, 1.25f) };
+	auto distance = [&](const glm::vec3& p) {
+		float d = SDF_EMPTY_SPACE;
+		for (const glm::vec4& s : spheres)
+			d = std::min(d, glm::length(p - glm::vec3(s)) - s.w);
+		return d;
+	};
+	std::vector<float> field(grid.VoxelCount());
+	for (int z = 0; z < grid.resolution.z; z++)
+		for (int y = 0; y < grid.resolution.y; y++)
+			for (int x = 0; x < grid.resolution.x; x++)
+				field[grid.Flatten(glm::ivec3(x, y, z))] = std::min(distance(grid.VoxelCenter(glm::ivec3(x, y, z))), SDF_EMPTY_SPACE);
+
+	SDFSphereTracer tracer;
+	tracer.SetField(grid, &field);
+	SDFTraceCamera camera = SDFTraceCamera::LookAt(glm::vec3(3.0f, -20.0f, 6.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), 50.0f, 1.25f);
+	SDFTraceSettings settings;
+	settings.mode = SDFTraceMode::Depth;
+	const int width = 192, height = 144;
+	float voxel = grid.VoxelSize().x;
+
+	for (SDFMipReduce reduce : { SDFMipReduce::Min, SDFMipReduce::Average })
+	{
+		SDFMipPyramid pyramid;
+		pyramid.Build(grid, field.data(), reduce, 3);
+		std::vector<float> starts;
+		SDFConeStats stats = SDFConeStartDepths(pyramid, camera, width, height, starts);
+		int tilesX = (width + SDF_CONE_TILE - 1) / SDF_CONE_TILE;
+		if (stats.tiles != starts.size() || stats.steps == 0)
+		{
+			Logger::WriteMessage("EXCEPTION: CONE PREPASS DID NOT MARCH EVERY TILE.");
+			return false;
+		}
+
+		float skipped = 0.0f;
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++)
+			{
+				float start = starts[size_t(y / SDF_CONE_TILE) * tilesX + x / SDF_CONE_TILE];
+				SDFRay ray = camera.PixelRay(x, y, width, height);
+				skipped += start;
+
+				//No sphere comes within the margin of the ray before its start.
+				for (const glm::vec4& s : spheres)
+				{
+					float along = glm::clamp(glm::dot(glm::vec3(s) - ray.origin, ray.direction), 0.0f, start);
+					if (glm::length(ray.origin + ray.direction * along - glm::vec3(s)) - s.w < voxel * 0.5f)
+					{
+						Logger::WriteMessage("EXCEPTION: CONE PREPASS STARTS A RAY PAST A SURFACE.");
+						return false;
+					}
+				}
+
+				//Tracing from the start finds the surface tracing from the camera finds.
+				SDFTraceHit full = tracer.Trace(ray, settings);
+				SDFTraceHit skip = tracer.Trace(ray, settings, start);
+				if (full.hit != skip.hit || (full.hit && std::abs(full.t - skip.t) > voxel * 0.1f) || skip.steps > full.steps)
+				{
+					Logger::WriteMessage("EXCEPTION: TRACE FROM THE CONE START DIFFERS FROM THE FULL TRACE.");
+					return false;
+				}
+			}
+		if (skipped <= 0.0f)
+		{
+			Logger::WriteMessage("EXCEPTION: CONE PREPASS SKIPPED NOTHING.");
+			return false;
+		}
+
+		//Render with the pyramid set finds the same surfaces in far fewer steps (about 2x here, more at higher resolutions
+		//where the cones are thinner).
+		SDFTraceImage withCones, without;
+		tracer.SetPyramid(&pyramid);
+		SDFTraceStats coneStats = tracer.Render(camera, settings, width, height, withCones);
+		tracer.SetPyramid(nullptr);
+		SDFTraceStats plainStats = tracer.Render(camera, settings, width, height, without);
+		if (coneStats.hits != plainStats.hits || coneStats.coneSteps == 0 || coneStats.steps * 3 > plainStats.steps * 2)
+		{
+			Logger::WriteMessage("EXCEPTION: CONE PREPASS DID NOT CUT THE RENDER STEPS.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestSharedSamplingGradients()
+{
+	//Non cubic and not a power of two, nothing in the sampler may assume the world grid.
+	SDFGridDesc grid(glm::ivec3(48, 40, 20), glm::vec3(6.0f, 5.0f, 2.5f));
+	glm::vec3 voxel = grid.VoxelSize();
+
+	//Trilinear reproduces a linear field exactly between voxel centres, and the 4 tap gradient recovers its slope.
+	glm::vec3 slope(0.6f, -0.3f, 0.74f);
+	std::vector<float> linear(grid.VoxelCount());
+	for (int z = 0; z < grid.resolution.z; z++)
+		for (int y = 0; y < grid.resolution.y; y++)
+			for (int x = 0; x < grid.resolution.x; x++)
+				linear[grid.Flatten(glm::ivec3(x, y, z))] = glm::dot(slope, grid.VoxelCenter(glm::ivec3(x, y, z))) + 0.25f;
+
+	uint32_t seed = 5;
+	auto random = [&]() { seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5; return float(seed & 0xFFFF) / 65535.0f; };
+	for (int i = 0; i < 500; i++)
+	{
+		glm::vec3 u(random(), random(), random());
+		glm::vec3 p = grid.Origin() + (voxel * 2.0f) + u * (grid.sceneSize - voxel * 4.0f);
+		float expected = glm::dot(slope, p) + 0.25f;
+		if (std::abs(SDFSampleTrilinear(linear.data(), grid, p) - expected) > 1e-4f ||
+			glm::length(SDFSampleTetraGradient(linear.data(), grid, p, voxel.x * 0.5f) - slope) > 1e-3f)
+		{
+			Logger::WriteMessage("EXCEPTION: SHARED SAMPLER MISSES A LINEAR FIELD.");
+			return false;
+		}
+	}
+
+	//Normals of a sampled sphere from 4 taps stay within a few degrees of the analytic ones, close to what 6 tap central
+	//differences reach.
+	std::vector<float> sphere(grid.VoxelCount());
+	for (int z = 0; z < grid.resolution.z; z++)
+		for (int y = 0; y < grid.resolution.y; y++)
+			for (int x = 0; x < grid.resolution.x; x++)
+				sphere[grid.Flatten(glm::ivec3(x, y, z))] = glm::length(grid.VoxelCenter(glm::ivec3(x, y, z))) - 1.0f;
+
+	float eps = std::min(voxel.x, std::min(voxel.y, voxel.z));
+	float worstTetra = 1.0f, worstCentral = 1.0f;
+	std::vector<glm::vec3> points;
+	for (int i = 0; i < 257; i++)
+	{
+		glm::vec3 d(random() * 2.0f - 1.0f, random() * 2.0f - 1.0f, random() * 2.0f - 1.0f);
+		if (glm::length(d) < 1e-2f)
+			continue;
+		glm::vec3 n = glm::normalize(d);
+		glm::vec3 p = n * 1.0f;
+		points.push_back(p);
+
+		auto sample = [&](const glm::vec3& q) { return SDFSampleTrilinear(sphere.data(), grid, q); };
+		glm::vec3 central(sample(p + glm::vec3(eps, 0, 0)) - sample(p - glm::vec3(eps, 0, 0)),
+			sample(p + glm::vec3(0, eps, 0)) - sample(p - glm::vec3(0, eps, 0)),
+			sample(p + glm::vec3(0, 0, eps)) - sample(p - glm::vec3(0, 0, eps)));
+		worstCentral = std::min(worstCentral, glm::dot(glm::normalize(central), n));
+		worstTetra = std::min(worstTetra, glm::dot(SDFSampleNormal(sphere.data(), grid, p, eps), n));
+	}
+	if (worstTetra < 0.995f || worstTetra < worstCentral - 0.005f)
+	{
+		Logger::WriteMessage("EXCEPTION: TETRAHEDRAL NORMALS DRIFT FROM THE SPHERE.");
+		return false;
+	}
+
+	//The batched gradients (two points per 8 wide gather with AVX2) give the scalar bits, points off the grid included.
+	points.push_back(grid.Origin() - voxel * 3.0f);
+	points.push_back(grid.Origin() + grid.sceneSize);
+	std::vector<glm::vec3> batched(points.size());
+	SDFSampleTetraGradients(sphere.data(), grid, points.data(), points.size(), eps, batched.data());
+	for (size_t i = 0; i < points.size(); i++)
+		if (batched[i] != SDFSampleTetraGradient(sphere.data(), grid, points[i], eps))
+		{
+			Logger::WriteMessage("EXCEPTION: BATCHED GRADIENTS DIFFER FROM THE SCALAR ONES.");
+			return false;
+		}
+
+	//Cell lookups clamp, and only the half open scene box is inside.
+	if (SDFSampleCell(grid, grid.Origin() - glm::vec3(1.0f)) != glm::ivec3(0) ||
+		SDFSampleCell(grid, grid.Origin() + grid.sceneSize * 2.0f) != grid.resolution - 1 ||
+		SDFSampleInside(grid, grid.Origin() + grid.sceneSize) || !SDFSampleInside(grid, grid.Origin()) ||
+		SDFSampleIndex(grid, grid.resolution - 1) != int(grid.VoxelCount()) - 1)
+	{
+		Logger::WriteMessage("EXCEPTION: SHARED SAMPLER CELL LOOKUP IS WRONG.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestTriangleBVHMatchesBruteForce()
+{
+	uint32_t seed = 91;
+	auto random = [&]() { seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5; return float(seed & 0xFFFF) / 65535.0f; };
+	auto randomPoint = [&](float extent) { return glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * extent; };
+
+	//Small random triangles in a box, plus a closed bumpy sphere, so rays both thread between triangles and hit surfaces.
+	std::vector<glm::vec3> soup;
+	for (int i = 0; i < 1500; i++)
+	{
+		glm::vec3 c = randomPoint(8.0f);
+		soup.push_back(c + randomPoint(0.6f));
+		soup.push_back(c + randomPoint(0.6f));
+		soup.push_back(c + randomPoint(0.6f));
+	}
+	const int rings = 40, segments = 48;
+	auto spherePoint = [&](int i, int j) {
+		float theta = 3.14159265f * float(i) / rings, phi = 6.28318531f * float(j) / segments;
+		float r = 2.0f + 0.3f * std::sin(4.0f * theta) * std::cos(5.0f * phi);
+		return r * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+	};
+	for (int i = 0; i < rings; i++)
+		for (int j = 0; j < segments; j++)
+		{
+			glm::vec3 a = spherePoint(i, j), b = spherePoint(i + 1, j), c = spherePoint(i + 1, j + 1), d = spherePoint(i, j + 1);
+			soup.insert(soup.end(), { a, b, c, a, c, d });
+		}
+
+	//A low threshold so the top levels split on this thread and the subtrees are stitched back together.
+	SDFBVHBuildSettings settings;
+	settings.parallelThreshold = 512;
+	SDFTriangleBVH bvh;
+	bvh.Build(soup, settings);
+	if (bvh.TriangleCount() != soup.size() / 3 || !bvh.Validate())
+	{
+		Logger::WriteMessage("EXCEPTION: TRIANGLE BVH IS MALFORMED.");
+		return false;
+	}
+
+	int hits = 0;
+	for (int i = 0; i < 2000; i++)
+	{
+		SDFRay ray(randomPoint(12.0f), glm::normalize(randomPoint(2.0f) + glm::vec3(1e-3f)));
+		if (i % 4 == 0)
+			ray.tMax = 1.0f + random() * 6.0f;
+
+		SDFBVHHit expected, actual;
+		bool expectedHit = SDFTriangleBVH::BruteForce(soup, ray, expected);
+		bool actualHit = bvh.Intersect(ray, actual);
+		if (expectedHit != actualHit || (expectedHit && (expected.triangle != actual.triangle || expected.t != actual.t)))
+		{
+			Logger::WriteMessage("EXCEPTION: BVH CLOSEST HIT DIFFERS FROM BRUTE FORCE.");
+			return false;
+		}
+		if (bvh.Occluded(ray) != expectedHit)
+		{
+			Logger::WriteMessage("EXCEPTION: BVH ANY HIT DIFFERS FROM BRUTE FORCE.");
+			return false;
+		}
+		hits += expectedHit ? 1 : 0;
+	}
+	if (hits < 200 || hits > 1800)
+	{
+		Logger::WriteMessage("EXCEPTION: BVH TEST RAYS DO NOT MIX HITS AND MISSES.");
+		return false;
+	}
+
+	//Per brush slices of one float4 buffer, as the BLAS build sees them; an empty brush and a partial triangle included.
+	std::vector<glm::vec4> vertices;
+	std::vector<uint32_t> offsets, counts;
+	std::vector<std::vector<glm::vec3>> brushSoups;
+	for (int brush = 0; brush < 6; brush++)
+	{
+		uint32_t triangleCount = brush == 2 ? 0 : 50 + brush * 120;
+		glm::vec3 centre = randomPoint(10.0f);
+		offsets.push_back((uint32_t)vertices.size());
+		brushSoups.emplace_back();
+		for (uint32_t t = 0; t < triangleCount * 3; t++)
+		{
+			glm::vec3 p = centre + randomPoint(3.0f);
+			vertices.push_back(glm::vec4(p, 1.0f));
+			brushSoups.back().push_back(p);
+		}
+		if (brush == 4)
+			vertices.push_back(glm::vec4(centre, 1.0f));
+		counts.push_back((uint32_t)vertices.size() - offsets.back());
+	}
+
+	SDFBrushBVHSet set;
+	set.Build(vertices.data(), offsets, counts, settings);
+	if (set.BrushCount() != 6 || set.Brush(2).TriangleCount() != 0 || set.Brush(4).TriangleCount() != brushSoups[4].size() / 3)
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH BVH SET SLICES THE VERTICES WRONG.");
+		return false;
+	}
+	for (int i = 0; i < 1000; i++)
+	{
+		SDFRay ray(randomPoint(16.0f), glm::normalize(randomPoint(2.0f) + glm::vec3(1e-3f)));
+		SDFBVHHit expected;
+		for (uint32_t brush = 0; brush < 6; brush++)
+		{
+			SDFRay clipped = ray;
+			clipped.tMax = expected.t;
+			SDFBVHHit brushHit;
+			if (SDFTriangleBVH::BruteForce(brushSoups[brush], clipped, brushHit) && brushHit.t < expected.t)
+			{
+				expected = brushHit;
+				expected.brush = brush;
+			}
+		}
+
+		SDFBVHHit actual;
+		bool actualHit = set.Intersect(ray, actual);
+		if (actualHit != expected.Hit() || set.Occluded(ray) != expected.Hit() ||
+			(actualHit && (actual.brush != expected.brush || actual.triangle != expected.triangle || actual.t != expected.t)))
+		{
+			Logger::WriteMessage("EXCEPTION: BRUSH BVH SET DIFFERS FROM BRUTE FORCE.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+namespace
+{
+	//Stands in for the instance buffer and the TLAS: keeps the written records and counts the builds and refits.
+	class MockTLASBuilder : public SDFTLASBuilder
+	{
+	public:
+		std::vector<SDFTLASInstance> buffer;
+		uint32_t writes = 0;
+		uint32_t writtenRecords = 0;
+		uint32_t builds = 0;
+		uint32_t refits = 0;
+		uint32_t lastCount = 0;
+
+		void WriteInstances(uint32_t first, const SDFTLASInstance* records, uint32_t count) override
+		{
+			if (buffer.size() < first + count)
+				buffer.resize(first + count);
+			std::copy(records, records + count, buffer.begin() + first);
+			writes++;
+			writtenRecords += count;
+		}
+
+		void Build(uint32_t instanceCount) override { builds++; lastCount = instanceCount; }
+		void Refit(uint32_t instanceCount) override { refits++; lastCount = instanceCount; }
+
+		void Reset() { writes = writtenRecords = builds = refits = 0; }
+	};
+}
+
+bool UnigmaSDFTests::TestTLASTrackerRefitsAndRebuilds()
+{
+	//A row of unit brushes along x, every third one without geometry.
+	const uint32_t count = 64;
+	std::vector<SDFTLASSlot> slots(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (i % 3 == 2)
+			continue;
+		slots[i].record.customIndex = i;
+		slots[i].record.mask = 0xFF;
+		slots[i].record.blasAddress = 0x10000 + uint64_t(i) * 0x100;
+		slots[i].bounds = SDFAABB(glm::vec3(float(i) * 2.0f, 0.0f, 0.0f), glm::vec3(float(i) * 2.0f + 1.0f, 1.0f, 1.0f));
+		slots[i].geometryKey = i * 36;
+	}
+	auto bufferMatches = [&](const MockTLASBuilder& builder) {
+		if (builder.buffer.size() < slots.size())
+			return false;
+		for (uint32_t i = 0; i < count; i++)
+			if (builder.buffer[i] != slots[i].record)
+				return false;
+		return true;
+	};
+
+	SDFTLASTracker tracker;
+	MockTLASBuilder builder;
+	if (tracker.Update(slots, builder) != SDFTLASUpdate::Rebuild || builder.builds != 1 || builder.lastCount != count ||
+		builder.writtenRecords != count || !bufferMatches(builder))
+	{
+		Logger::WriteMessage("EXCEPTION: FIRST TLAS UPDATE DID NOT BUILD EVERYTHING.");
+		return false;
+	}
+
+	//A static scene writes and builds nothing.
+	for (int frame = 0; frame < 10; frame++)
+	{
+		builder.Reset();
+		if (tracker.Update(slots, builder) != SDFTLASUpdate::None || builder.writes + builder.builds + builder.refits != 0)
+		{
+			Logger::WriteMessage("EXCEPTION: STATIC SCENE STILL TOUCHES THE TLAS.");
+			return false;
+		}
+	}
+
+	//A brush moving a little refits. Its record is the same (the BLAS is in world space), so nothing is written.
+	builder.Reset();
+	slots[10].bounds.min.y += 0.1f;
+	slots[10].bounds.max.y += 0.1f;
+	if (tracker.Update(slots, builder) != SDFTLASUpdate::Refit || builder.refits != 1 || builder.writes != 0 ||
+		tracker.Stats().changedSlots != 1 || !(tracker.Stats().motion > 0.0f))
+	{
+		Logger::WriteMessage("EXCEPTION: SMALL MOTION DID NOT REFIT.");
+		return false;
+	}
+
+	//Changed records are written in coalesced runs: 20 and 22 join over one clean record, 40 stays on its own.
+	builder.Reset();
+	tracker.mergeGap = 1;
+	slots[20].record.mask = 0x01;
+	slots[22].record.mask = 0x02;
+	slots[40].record.blasAddress = 0x900000;
+	if (tracker.Update(slots, builder) != SDFTLASUpdate::Refit || builder.writes != 2 || builder.writtenRecords != 4 ||
+		!bufferMatches(builder))
+	{
+		Logger::WriteMessage("EXCEPTION: CHANGED TLAS RECORDS WERE NOT WRITTEN AS RUNS.");
+		return false;
+	}
+
+	//New geometry in place refits without any motion.
+	builder.Reset();
+	float motionBefore = tracker.Stats().motion;
+	slots[30].geometryKey++;
+	if (tracker.Update(slots, builder) != SDFTLASUpdate::Refit || tracker.Stats().motion != motionBefore)
+	{
+		Logger::WriteMessage("EXCEPTION: IN PLACE GEOMETRY CHANGE DID NOT REFIT.");
+		return false;
+	}
+
+	//A BLAS built again under the same key still refits, then the flag clears and the scene is static again.
+	builder.Reset();
+	slots[31].blasRebuilt = true;
+	if (tracker.Update(slots, builder) != SDFTLASUpdate::Refit || builder.refits != 1 || builder.writes != 0)
+	{
+		Logger::WriteMessage("EXCEPTION: REBUILT BLAS DID NOT REFIT THE TLAS.");
+		return false;
+	}
+	builder.Reset();
+	slots[31].blasRebuilt = false;
+	if (tracker.Update(slots, builder) != SDFTLASUpdate::None)
+	{
+		Logger::WriteMessage("EXCEPTION: CLEARED BLAS REBUILD STILL TOUCHES THE TLAS.");
+		return false;
+	}
+
+	//Turning an instance on or off cannot be refit.
+	builder.Reset();
+	slots[2].record.blasAddress = 0x777000;
+	slots[2].bounds = SDFAABB(glm::vec3(4.0f, 0.0f, 0.0f), glm::vec3(5.0f, 1.0f, 1.0f));
+	if (tracker.Update(slots, builder) != SDFTLASUpdate::Rebuild || builder.writtenRecords != 1 || !bufferMatches(builder) ||
+		tracker.Stats().motion != 0.0f || tracker.Stats().refitsSinceBuild != 0)
+	{
+		Logger::WriteMessage("EXCEPTION: INSTANCE ACTIVATION DID NOT REBUILD.");
+		return false;
+	}
+
+	//Small steps refit until their sum reaches rebuildMotion, then one build starts the count again.
+	SDFAABB scene;
+	for (const SDFTLASSlot& slot : slots)
+		if (slot.record.Active())
+			scene.Expand(slot.bounds);
+	float diagonal = glm::length(scene.Extent());
+	float step = diagonal * 0.01f;
+	int refitsBeforeBuild = 0;
+	for (int frame = 0; frame < 100; frame++)
+	{
+		builder.Reset();
+		slots[4].bounds.min.z += step;
+		slots[4].bounds.max.z += step;
+		SDFTLASUpdate update = tracker.Update(slots, builder);
+		if (update == SDFTLASUpdate::Rebuild)
+			break;
+		if (update != SDFTLASUpdate::Refit)
+		{
+			Logger::WriteMessage("EXCEPTION: MOVING BRUSH WAS NOT REFIT.");
+			return false;
+		}
+		refitsBeforeBuild++;
+	}
+	int expectedRefits = int(std::ceil(tracker.rebuildMotion / 0.01f)) - 1;
+	if (std::abs(refitsBeforeBuild - expectedRefits) > 1 || tracker.Stats().motion != 0.0f)
+	{
+		Logger::WriteMessage("EXCEPTION: ACCUMULATED MOTION DID NOT TRIGGER A REBUILD.");
+		return false;
+	}
+
+	//maxRefits builds even when every step is tiny.
+	tracker.maxRefits = 5;
+	int refits = 0;
+	for (int frame = 0; frame < 6; frame++)
+	{
+		builder.Reset();
+		slots[7].bounds.max.x += 1e-4f;
+		refits += tracker.Update(slots, builder) == SDFTLASUpdate::Refit ? 1 : 0;
+	}
+	if (refits != 5 || builder.builds != 1)
+	{
+		Logger::WriteMessage("EXCEPTION: REFIT LIMIT DID NOT REBUILD.");
+		return false;
+	}
+
+	//A new slot count or a fresh buffer rebuilds; only the fresh buffer is rewritten in full.
+	builder.Reset();
+	slots.push_back(SDFTLASSlot());
+	if (tracker.Update(slots, builder) != SDFTLASUpdate::Rebuild || builder.writtenRecords != 1 || builder.lastCount != count + 1)
+	{
+		Logger::WriteMessage("EXCEPTION: GROWN INSTANCE LIST DID NOT REBUILD.");
+		return false;
+	}
+	MockTLASBuilder fresh;
+	tracker.Invalidate();
+	if (tracker.Update(slots, fresh) != SDFTLASUpdate::Rebuild || fresh.writtenRecords != count + 1 || !bufferMatches(fresh))
+	{
+		Logger::WriteMessage("EXCEPTION: INVALIDATED TRACKER DID NOT REWRITE THE BUFFER.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestCameraPathParsesAndInterpolates()
+{
+	//Keys out of order, a comment, a blank line and one key without a fov.
+	const std::string text =
+		"# time  eye  target  fov\n"
+		"2.0  10 0 5   0 0 0  60\n"
+		"\n"
+		"0.0  0 -10 5  0 0 0  # default fov\n"
+		"1.0  10 -10 5  0 0 1  50\n";
+	SDFCameraPath path;
+	std::string error;
+	if (!path.Parse(text, &error) || path.Keys().size() != 3 || path.StartTime() != 0.0f || path.EndTime() != 2.0f ||
+		path.Keys()[0].fov != 45.0f)
+	{
+		Logger::WriteMessage(("EXCEPTION: CAMERA PATH DID NOT PARSE. " + error).c_str());
+		return false;
+	}
+
+	//Every key is hit exactly, times outside hold the ends.
+	for (const SDFCameraKey& key : path.Keys())
+	{
+		SDFCameraKey at = path.Sample(key.time);
+		if (glm::length(at.eye - key.eye) > 1e-5f || glm::length(at.target - key.target) > 1e-5f || std::abs(at.fov - key.fov) > 1e-5f)
+		{
+			Logger::WriteMessage("EXCEPTION: CAMERA PATH MISSES A KEY.");
+			return false;
+		}
+	}
+	if (path.Sample(-1.0f).eye != path.Keys().front().eye || path.Sample(5.0f).eye != path.Keys().back().eye)
+	{
+		Logger::WriteMessage("EXCEPTION: CAMERA PATH DOES NOT CLAMP.");
+		return false;
+	}
+
+	//Continuous through the keys, fov linear between them.
+	glm::vec3 previous = path.Sample(0.0f).eye;
+	for (int i = 1; i <= 200; i++)
+	{
+		SDFCameraKey at = path.Sample(i * 0.01f);
+		if (glm::length(at.eye - previous) > 0.5f)
+		{
+			Logger::WriteMessage("EXCEPTION: CAMERA PATH JUMPS.");
+			return false;
+		}
+		previous = at.eye;
+	}
+	if (std::abs(path.Sample(1.5f).fov - 55.0f) > 1e-4f)
+	{
+		Logger::WriteMessage("EXCEPTION: CAMERA PATH FOV IS NOT LINEAR.");
+		return false;
+	}
+
+	//The tool camera looks from the eye at the target.
+	SDFTraceCamera camera = path.Camera(1.0f, 16.0f / 9.0f);
+	SDFRay centre = camera.RayAt(glm::vec2(640.0f, 360.0f), 1280, 720);
+	glm::vec3 toTarget = glm::normalize(path.Keys()[1].target - path.Keys()[1].eye);
+	if (glm::length(centre.origin - path.Keys()[1].eye) > 1e-3f || glm::dot(centre.direction, toTarget) < 0.9999f)
+	{
+		Logger::WriteMessage("EXCEPTION: CAMERA PATH CAMERA DOES NOT LOOK AT THE TARGET.");
+		return false;
+	}
+
+	//A bad line leaves the keys alone and names the line.
+	if (path.Parse("0 1 2 3 4 5 6\n1 1 2 3 x 5 6\n", &error) || path.Keys().size() != 3 || error.find("line 2") == std::string::npos ||
+		path.Parse("0 1 2 3 4 5 6 45 7\n") || path.Parse("0 1 2 3 4 5 6 0\n"))
+	{
+		Logger::WriteMessage("EXCEPTION: CAMERA PATH ACCEPTED A BAD LINE.");
+		return false;
+	}
+
+	return true;
+}
+
+//How far the flat triangles sink below the unit sphere, at their centroids.
+static float SphereDeviation(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles)
+{
+	float deviation = 0.0f;
+	for (const glm::uvec3& t : triangles)
+		deviation = std::max(deviation, 1.0f - glm::length((positions[t.x] + positions[t.y] + positions[t.z]) / 3.0f));
+	return deviation;
+}
+
+bool UnigmaSDFTests::TestMeshSimplifierTargetsAndError()
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::uvec3> triangles;
+	MakeSphere(1.0f, 32, 64, 0, glm::vec3(0.0f), positions, triangles);
+
+	//Without an error limit the target is reached exactly, a collapse takes one or two triangles.
+	MeshSimplifySettings settings;
+	float error = 0.0f;
+	uint32_t target = (uint32_t)triangles.size() / 4;
+	std::vector<glm::uvec3> simplified = SimplifyMesh(positions, triangles, target, settings, &error);
+	if (simplified.size() > target || simplified.size() + 2 < target || error <= 0.0f)
+	{
+		Logger::WriteMessage("EXCEPTION: MESH SIMPLIFIER MISSED ITS TRIANGLE TARGET.");
+		return false;
+	}
+
+	//The error limit stops it early, and the reported error bounds the real deviation: the simplified sphere sinks no
+	//further than the source tessellation already did plus that error.
+	float sourceDeviation = SphereDeviation(positions, triangles);
+	for (float maxError : { 0.001f, 0.005f, 0.02f })
+	{
+		settings.maxError = maxError;
+		simplified = SimplifyMesh(positions, triangles, 0, settings, &error);
+		if (simplified.empty() || simplified.size() >= triangles.size() || error > maxError)
+		{
+			Logger::WriteMessage("EXCEPTION: MESH SIMPLIFIER IGNORED ITS ERROR LIMIT.");
+			return false;
+		}
+		if (SphereDeviation(positions, simplified) > sourceDeviation + error + 1e-5f)
+		{
+			Logger::WriteMessage("EXCEPTION: MESH SIMPLIFIER ERROR DOES NOT TRACK THE SURFACE DEVIATION.");
+			return false;
+		}
+	}
+
+	//A flat patch simplifies at no error down to its locked border.
+	std::vector<glm::vec3> flatPositions;
+	std::vector<glm::uvec3> flatTriangles;
+	const uint32_t n = 32;
+	for (uint32_t y = 0; y <= n; y++)
+		for (uint32_t x = 0; x <= n; x++)
+			flatPositions.push_back(glm::vec3(x / (float)n, y / (float)n, 0.0f));
+	for (uint32_t y = 0; y < n; y++)
+	{
+		for (uint32_t x = 0; x < n; x++)
+		{
+			uint32_t a = y * (n + 1) + x;
+			flatTriangles.push_back(glm::uvec3(a, a + 1, a + n + 2));
+			flatTriangles.push_back(glm::uvec3(a, a + n + 2, a + n + 1));
+		}
+	}
+	settings.maxError = 1e-4f;
+	simplified = SimplifyMesh(flatPositions, flatTriangles, 200, settings, &error);
+	if (simplified.size() != 200 || error > 1e-6f)
+	{
+		Logger::WriteMessage("EXCEPTION: MESH SIMPLIFIER DID NOT FLATTEN A PLANE FOR FREE.");
+		return false;
+	}
+
+	//Chains: ratios reached, errors grow along the chain, and the parallel builder gives the same chains.
+	MeshLODChain chain = BuildMeshLODChain(positions, triangles, MeshSimplifySettings());
+	MeshSimplifySettings defaults;
+	if (chain.lods.size() != defaults.lodRatios.size() + 1)
+	{
+		Logger::WriteMessage("EXCEPTION: MESH LOD CHAIN IS SHORT.");
+		return false;
+	}
+	for (size_t i = 1; i < chain.lods.size(); i++)
+	{
+		if (chain.lods[i].ratio > defaults.lodRatios[i - 1] || chain.lods[i].error < chain.lods[i - 1].error)
+		{
+			Logger::WriteMessage("EXCEPTION: MESH LOD CHAIN IS NOT MONOTONIC.");
+			return false;
+		}
+	}
+
+	std::vector<MeshLODChain> chains;
+	BuildMeshLODChains({ positions, flatPositions }, { triangles, flatTriangles }, { MeshSimplifySettings() }, chains);
+	if (chains.size() != 2 || chains[0].lods.size() != chain.lods.size() || chains[0].lods.back().triangles != chain.lods.back().triangles)
+	{
+		Logger::WriteMessage("EXCEPTION: PARALLEL MESH LOD CHAINS DIFFER.");
+		return false;
+	}
+
+	if (SelectMeshLOD(chain, glm::vec3(0.0f, 0.0f, 1.1f), 1.0f, 720.0f) != 0 ||
+		SelectMeshLOD(chain, glm::vec3(0.0f, 0.0f, 1000.0f), 1.0f, 720.0f) != (uint32_t)chain.lods.size() - 1)
+	{
+		Logger::WriteMessage("EXCEPTION: MESH LOD SELECTION IGNORES DISTANCE.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestCSGPruningMatchesReference()
+{
+	//Box volume authored in [-1, 1]^3, read through trilinear filtering like a cooked mesh.
+	CSGVolume box;
+	box.resolution = 16;
+	for (int z = 0; z < box.resolution; z++)
+		for (int y = 0; y < box.resolution; y++)
+			for (int x = 0; x < box.resolution; x++)
+			{
+				glm::vec3 p = (glm::vec3(x, y, z) + 0.5f) / (float)box.resolution * 2.0f - 1.0f;
+				glm::vec3 q = glm::abs(p) - 0.6f;
+				box.values.push_back(glm::length(glm::max(q, glm::vec3(0.0f))) + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f));
+			}
+	box.BuildBounds();
+
+	std::mt19937 rng(77);
+	std::uniform_real_distribution<float> pos(-1.5f, 1.5f);
+	std::uniform_real_distribution<float> scale(0.6f, 1.5f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+	auto makeBrush = [&](CSGPrimitive primitive, SDFBrushOp op, float blend) {
+		CSGBrush brush;
+		brush.primitive = primitive;
+		brush.op = op;
+		brush.blend = blend;
+		brush.volume = primitive == CSGPrimitive::Volume ? &box : nullptr;
+		if (primitive == CSGPrimitive::Sphere)
+		{
+			brush.aabbMin = glm::vec3(-1.5f);
+			brush.aabbMax = glm::vec3(1.5f);
+		}
+		brush.model = glm::translate(glm::mat4(1.0f), glm::vec3(pos(rng), pos(rng), pos(rng))) *
+			glm::rotate(glm::mat4(1.0f), angle(rng), glm::normalize(glm::vec3(0.3f, 1.0f, 0.2f))) * glm::scale(glm::mat4(1.0f), glm::vec3(scale(rng)));
+		brush.invModel = glm::inverse(brush.model);
+		return brush;
+	};
+
+	//Hard union, smooth union, and a smooth union carved by subtractions.
+	struct Tree
+	{
+		const char* name;
+		float blend;
+		int subtractEvery;
+	};
+	const Tree trees[] = { { "UNION", 0.0f, 0 }, { "SMOOTH UNION", 0.01f, 0 }, { "SUBTRACTION", 0.01f, 3 } };
+	SDFGridDesc grid(glm::ivec3(64, 64, 48), glm::vec3(8.0f, 8.0f, 6.0f));
+	for (const Tree& tree : trees)
+	{
+		std::vector<CSGBrush> brushes;
+		for (int i = 0; i < 40; i++)
+		{
+			SDFBrushOp op = tree.subtractEvery > 0 && i % tree.subtractEvery == tree.subtractEvery - 1 ? SDFBrushOp::Subtraction : SDFBrushOp::Union;
+			brushes.push_back(makeBrush(i % 2 == 0 ? CSGPrimitive::Sphere : CSGPrimitive::Volume, op, tree.blend));
+		}
+
+		CSGProgram program;
+		program.Compile(brushes, grid, 16, 4);
+		std::vector<float> values(grid.VoxelCount(), 0.0f);
+		program.EvaluateGrid(values.data());
+
+		for (int z = 0; z < grid.resolution.z; z++)
+			for (int y = 0; y < grid.resolution.y; y++)
+				for (int x = 0; x < grid.resolution.x; x++)
+				{
+					glm::ivec3 v(x, y, z);
+					if (values[grid.Flatten(v)] != program.EvaluateReference(grid.VoxelCenter(v)))
+					{
+						Logger::WriteMessage((std::string("EXCEPTION: PRUNED CSG ") + tree.name + " DIFFERS FROM THE FULL FOLD.").c_str());
+						return false;
+					}
+				}
+
+		//The running blend only grows along the list, so smooth unions prune less; each tree still drops over a tenth.
+		if (program.stats.evaluatedBrushVoxels * 10 > program.stats.naiveEvaluations * 9)
+		{
+			Logger::WriteMessage((std::string("EXCEPTION: CSG ") + tree.name + " PRUNED ALMOST NOTHING.").c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestDynamicTreeMatchesBruteForce()
+{
+	SDFDynamicAABBTree tree;
+	std::mt19937 rng(29);
+	std::uniform_real_distribution<float> pos(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+	std::uniform_real_distribution<float> step(-1.5f, 1.5f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto randomBox = [&](const glm::vec3& centre) {
+		glm::vec3 half(size(rng), size(rng), size(rng));
+		return SDFAABB(centre - half, centre + half);
+	};
+
+	//Live proxies and their tight boxes, what the tree is checked against.
+	std::vector<int32_t> live;
+	std::vector<SDFAABB> tight;
+	for (int op = 0; op < 6000; op++)
+	{
+		float choice = unit(rng);
+		if (live.size() < 50 || choice < 0.4f)
+		{
+			SDFAABB box = randomBox(glm::vec3(pos(rng), pos(rng), pos(rng)));
+			int32_t proxy = tree.CreateProxy(box, (uint32_t)op);
+			if (proxy >= (int32_t)tight.size())
+				tight.resize(proxy + 1);
+			tight[proxy] = box;
+			live.push_back(proxy);
+		}
+		else if (choice < 0.85f)
+		{
+			//Mostly small steps that stay in the fat box, now and then a jump or a shrink.
+			int32_t proxy = live[rng() % live.size()];
+			glm::vec3 move = choice < 0.8f ? glm::vec3(step(rng), step(rng), step(rng)) * 0.1f : glm::vec3(step(rng), step(rng), step(rng)) * 10.0f;
+			SDFAABB box = choice < 0.83f ? SDFAABB(tight[proxy].min + move, tight[proxy].max + move) : randomBox(tight[proxy].Center() + move);
+			tree.MoveProxy(proxy, box, move);
+			tight[proxy] = box;
+		}
+		else
+		{
+			size_t i = rng() % live.size();
+			tree.DestroyProxy(live[i]);
+			live[i] = live.back();
+			live.pop_back();
+		}
+
+		if (op % 250 == 0 && !tree.Validate())
+		{
+			Logger::WriteMessage("EXCEPTION: DYNAMIC TREE FAILED VALIDATION.");
+			return false;
+		}
+	}
+
+	if (!tree.Validate() || tree.GetProxyCount() != live.size())
+	{
+		Logger::WriteMessage("EXCEPTION: DYNAMIC TREE FAILED VALIDATION.");
+		return false;
+	}
+	//AVL balancing keeps the height within 1.44 log2(n).
+	if (tree.GetHeight() > (int)std::ceil(1.45f * std::log2((float)live.size() + 2.0f)))
+	{
+		Logger::WriteMessage("EXCEPTION: DYNAMIC TREE IS UNBALANCED.");
+		return false;
+	}
+
+	//Box queries against every tight box.
+	std::vector<SDFAABB> queries;
+	for (int q = 0; q < 300; q++)
+		queries.push_back(randomBox(glm::vec3(pos(rng), pos(rng), pos(rng))));
+	SDFQueryResults results;
+	tree.QueryBatch(queries, results);
+	for (size_t q = 0; q < queries.size(); q++)
+	{
+		std::vector<uint32_t> expected;
+		for (int32_t proxy : live)
+			if (tight[proxy].Overlaps(queries[q]))
+				expected.push_back(tree.GetUserData(proxy));
+		std::sort(expected.begin(), expected.end());
+		std::vector<uint32_t> found(results.userData.begin() + results.offsets[q], results.userData.begin() + results.offsets[q] + results.counts[q]);
+		if (found != expected)
+		{
+			Logger::WriteMessage("EXCEPTION: DYNAMIC TREE QUERY DIFFERS FROM BRUTE FORCE.");
+			return false;
+		}
+	}
+
+	//Nearest tight box along rays.
+	std::vector<SDFRay> rays;
+	for (int r = 0; r < 300; r++)
+	{
+		glm::vec3 direction = glm::vec3(step(rng), step(rng), step(rng));
+		if (glm::length(direction) < 1e-3f)
+			direction = glm::vec3(1.0f, 0.0f, 0.0f);
+		rays.push_back(SDFRay(glm::vec3(pos(rng), pos(rng), pos(rng)), glm::normalize(direction), 80.0f));
+	}
+	std::vector<SDFRayHit> hits;
+	tree.RayCastBatch(rays, hits);
+	for (size_t r = 0; r < rays.size(); r++)
+	{
+		float nearest = std::numeric_limits<float>::max();
+		glm::vec3 invDir = 1.0f / rays[r].direction;
+		for (int32_t proxy : live)
+		{
+			float t;
+			if (RayAABB(rays[r], invDir, tight[proxy], t))
+				nearest = std::min(nearest, t);
+		}
+		if (hits[r].t != nearest || (hits[r].proxy >= 0 && tree.GetUserData(hits[r].proxy) != hits[r].userData))
+		{
+			Logger::WriteMessage("EXCEPTION: DYNAMIC TREE RAY CAST DIFFERS FROM BRUTE FORCE.");
+			return false;
+		}
+	}
+
+	//Emptied, the tree is valid and finds nothing.
+	for (int32_t proxy : live)
+		tree.DestroyProxy(proxy);
+	bool any = false;
+	tree.Query(SDFAABB(glm::vec3(-100.0f), glm::vec3(100.0f)), [&](int32_t) { any = true; return false; });
+	if (!tree.Validate() || tree.GetProxyCount() != 0 || any)
+	{
+		Logger::WriteMessage("EXCEPTION: EMPTIED DYNAMIC TREE IS NOT EMPTY.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestBrickMapMatchesDenseGrid()
+{
+	//Two spheres and a box, Lipschitz so the function build may skip bricks.
+	auto distance = [](const glm::vec3& p) {
+		float a = glm::length(p - glm::vec3(-1.5f, 0.5f, 0.2f)) - 1.2f;
+		float b = glm::length(p - glm::vec3(2.0f, -1.0f, -0.4f)) - 0.7f;
+		glm::vec3 q = glm::abs(p - glm::vec3(0.5f, 2.0f, 0.0f)) - glm::vec3(0.8f, 0.4f, 0.6f);
+		float c = glm::length(glm::max(q, glm::vec3(0.0f))) + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+		return std::min(a, std::min(b, c));
+	};
+
+	//Dimensions that are not brick multiples, a small scene stored dense and a large mostly empty one stored sparse.
+	struct Case
+	{
+		SDFGridDesc grid;
+		bool dense;
+	};
+	const Case cases[] = {
+		{ SDFGridDesc(glm::ivec3(36, 28, 20), glm::vec3(9.0f, 7.0f, 5.0f)), true },
+		{ SDFGridDesc(glm::ivec3(250, 200, 90), glm::vec3(20.0f, 16.0f, 7.2f)), false },
+	};
+	std::mt19937 rng(30);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (const Case& c : cases)
+	{
+		const SDFGridDesc& grid = c.grid;
+		std::vector<float> values(grid.VoxelCount());
+		for (int z = 0; z < grid.resolution.z; z++)
+			for (int y = 0; y < grid.resolution.y; y++)
+				for (int x = 0; x < grid.resolution.x; x++)
+					values[grid.Flatten(glm::ivec3(x, y, z))] = distance(grid.VoxelCenter(glm::ivec3(x, y, z)));
+
+		SDFBrickMap fromDense, fromFunction;
+		fromDense.BuildFromDense(grid, values.data());
+		fromFunction.Build(grid, distance);
+		float band = fromDense.settings.bandVoxels * std::min(grid.VoxelSize().x, std::min(grid.VoxelSize().y, grid.VoxelSize().z));
+
+		for (const SDFBrickMap* map : { &fromDense, &fromFunction })
+		{
+			if (map->stats.dense != c.dense || map->IsDense() != c.dense)
+			{
+				Logger::WriteMessage("EXCEPTION: BRICK MAP PICKED THE WRONG LAYOUT.");
+				return false;
+			}
+			size_t stored = c.dense ? map->dense.size() * sizeof(uint16_t) : map->stats.sparseBytes;
+			if (stored > map->stats.denseBytes || (!c.dense && map->stats.sparseBytes * 4 > map->stats.denseBytes))
+			{
+				Logger::WriteMessage("EXCEPTION: BRICK MAP IS LARGER THAN THE DENSE GRID.");
+				return false;
+			}
+
+			//Near the surface both samplers read the same texels, up to half float rounding. Further out the brick
+			//constant may only be closer to the surface, on the same side.
+			for (int i = 0; i < 20000; i++)
+			{
+				glm::vec3 p = (glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * grid.sceneSize * 0.999f;
+				float expected = SDFSampleTrilinear(values.data(), grid, p);
+				float sampled = map->Sample(p);
+				float tolerance = 2e-3f * (1.0f + std::abs(expected));
+				if (std::abs(expected) < band - grid.VoxelSize().x)
+				{
+					if (std::abs(sampled - expected) > tolerance)
+					{
+						Logger::WriteMessage("EXCEPTION: BRICK MAP SAMPLE DIFFERS FROM THE DENSE GRID.");
+						return false;
+					}
+				}
+				else if (sampled * expected < 0.0f || std::abs(sampled) > std::abs(expected) + tolerance)
+				{
+					Logger::WriteMessage("EXCEPTION: BRICK MAP CONSTANT IS NOT CONSERVATIVE.");
+					return false;
+				}
+			}
+
+			for (int i = 0; i < 20000; i++)
+			{
+				glm::ivec3 v(rng() % grid.resolution.x, rng() % grid.resolution.y, rng() % grid.resolution.z);
+				float expected = values[grid.Flatten(v)];
+				if (std::abs(expected) < band && std::abs(map->Load(v) - expected) > 2e-3f * (1.0f + std::abs(expected)))
+				{
+					Logger::WriteMessage("EXCEPTION: BRICK MAP VOXEL DIFFERS FROM THE DENSE GRID.");
+					return false;
+				}
+			}
+		}
+
+		if (!c.dense && fromFunction.stats.evaluatedVoxels >= fromDense.stats.evaluatedVoxels)
+		{
+			Logger::WriteMessage("EXCEPTION: BRICK MAP FUNCTION BUILD SKIPPED NOTHING.");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestMipPyramidReductionAndBounds()
+{
+	std::mt19937 rng(31);
+	std::uniform_real_distribution<float> unit(-4.0f, 4.0f);
+
+	//SDFMipReduceRow against a plain loop, for row widths that leave every possible tail after the SIMD groups.
+	for (int fineWidth = 1; fineWidth <= 41; fineWidth++)
+	{
+		int coarseWidth = (fineWidth + 1) / 2;
+		std::vector<float> rows[4];
+		for (std::vector<float>& row : rows)
+		{
+			row.resize(fineWidth);
+			for (float& v : row)
+				v = unit(rng);
+		}
+
+		for (SDFMipReduce reduce : { SDFMipReduce::Min, SDFMipReduce::Average })
+		{
+			std::vector<float> out(coarseWidth);
+			SDFMipReduceRow(rows[0].data(), rows[1].data(), rows[2].data(), rows[3].data(), fineWidth, out.data(), coarseWidth, reduce);
+			for (int cx = 0; cx < coarseWidth; cx++)
+			{
+				int x0 = cx * 2, x1 = std::min(x0 + 1, fineWidth - 1);
+				float expected;
+				if (reduce == SDFMipReduce::Min)
+				{
+					expected = rows[0][x0];
+					for (int r = 0; r < 4; r++)
+						expected = std::min(expected, std::min(rows[r][x0], rows[r][x1]));
+				}
+				else
+				{
+					float a = (rows[0][x0] + rows[1][x0]) + (rows[2][x0] + rows[3][x0]);
+					float b = (rows[0][x1] + rows[1][x1]) + (rows[2][x1] + rows[3][x1]);
+					expected = (a + b) * 0.125f;
+				}
+				if (std::memcmp(&expected, &out[cx], sizeof(float)) != 0)
+				{
+					Logger::WriteMessage("EXCEPTION: SIMD MIP REDUCTION DIFFERS FROM THE SCALAR ONE.");
+					return false;
+				}
+			}
+		}
+	}
+
+	//Odd resolutions so every level repeats an edge. The noise keeps neighbouring voxels from tying.
+	SDFGridDesc grid(glm::ivec3(45, 23, 17), glm::vec3(9.0f, 4.6f, 3.4f));
+	auto sphere = [](const glm::vec3& p) { return glm::length(p - glm::vec3(1.0f, -0.5f, 0.2f)) - 1.2f; };
+	const float noise = 0.01f;
+	std::vector<float> field(grid.VoxelCount());
+	for (int z = 0; z < grid.resolution.z; z++)
+		for (int y = 0; y < grid.resolution.y; y++)
+			for (int x = 0; x < grid.resolution.x; x++)
+				field[grid.Flatten(glm::ivec3(x, y, z))] = sphere(grid.VoxelCenter(glm::ivec3(x, y, z))) + noise * unit(rng) / 4.0f;
+
+	struct Strided
+	{
+		int pad;
+		float value;
+	};
+	std::vector<Strided> strided(field.size());
+	for (size_t i = 0; i < field.size(); i++)
+		strided[i].value = field[i];
+
+	for (SDFMipReduce reduce : { SDFMipReduce::Min, SDFMipReduce::Average })
+	{
+		SDFMipPyramid pyramid, fromStrided;
+		pyramid.Build(grid, field.data(), reduce);
+		fromStrided.BuildStrided(grid, &strided[0].value, sizeof(Strided), reduce);
+		if (pyramid.Level(pyramid.MipCount() - 1).resolution != glm::ivec3(1) || fromStrided.MipCount() != pyramid.MipCount())
+		{
+			Logger::WriteMessage("EXCEPTION: MIP PYRAMID DOES NOT END IN A SINGLE VOXEL.");
+			return false;
+		}
+
+		for (int mip = 1; mip < pyramid.MipCount(); mip++)
+		{
+			const SDFMipLevel& level = pyramid.Level(mip);
+			if (level.values != fromStrided.Level(mip).values)
+			{
+				Logger::WriteMessage("EXCEPTION: STRIDED MIP PYRAMID DIFFERS FROM THE DENSE ONE.");
+				return false;
+			}
+
+			for (int z = 0; z < level.resolution.z; z++)
+				for (int y = 0; y < level.resolution.y; y++)
+					for (int x = 0; x < level.resolution.x; x++)
+					{
+						//Every level 0 voxel under the cell.
+						glm::ivec3 lo = glm::ivec3(x, y, z) * (1 << mip);
+						glm::ivec3 hi = glm::min(lo + (1 << mip), grid.resolution) - 1;
+						float footprintMin = std::numeric_limits<float>::max(), footprintMax = -footprintMin;
+						for (int fz = lo.z; fz <= hi.z; fz++)
+							for (int fy = lo.y; fy <= hi.y; fy++)
+								for (int fx = lo.x; fx <= hi.x; fx++)
+								{
+									float v = field[grid.Flatten(glm::ivec3(fx, fy, fz))];
+									footprintMin = std::min(footprintMin, v);
+									footprintMax = std::max(footprintMax, v);
+								}
+
+						float value = level.Load(glm::ivec3(x, y, z));
+						if (reduce == SDFMipReduce::Min && value != footprintMin)
+						{
+							Logger::WriteMessage("EXCEPTION: MIN MIP IS NOT THE MINIMUM OF ITS FOOTPRINT.");
+							return false;
+						}
+						float slack = 1e-5f * (1.0f + std::abs(value));
+						if (value < footprintMin - slack || value > footprintMax + slack)
+						{
+							Logger::WriteMessage("EXCEPTION: MIP VALUE OUTSIDE THE RANGE OF ITS FOOTPRINT.");
+							return false;
+						}
+					}
+		}
+
+		if (reduce != SDFMipReduce::Min)
+			continue;
+
+		//The safe distance never exceeds the distance the voxels were taken from, anywhere and at any level.
+		for (int i = 0; i < 5000; i++)
+		{
+			glm::vec3 p = (glm::vec3(unit(rng), unit(rng), unit(rng)) / 8.0f) * grid.sceneSize * 0.999f;
+			float bound = sphere(p) + noise;
+			for (int mip = 1; mip < pyramid.MipCount(); mip++)
+				if (pyramid.SafeDistance(mip, p) > bound)
+				{
+					Logger::WriteMessage("EXCEPTION: MIP SAFE DISTANCE IS LARGER THAN THE FIELD.");
+					return false;
+				}
+		}
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestBrushPoolHandlesAndDirtyRanges()
+{
+	SDFBrushPool pool;
+	pool.Reset(10, 16, 4);
+	if (pool.Capacity() != 16 || pool.SlotCount() != 0 || pool.HasDirty())
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH POOL RESET TO THE WRONG CAPACITY.");
+		return false;
+	}
+
+	std::vector<SDFBrushHandle> handles;
+	for (uint32_t i = 0; i < 12; i++)
+	{
+		SDFBrushHandle handle = pool.Allocate();
+		if (handle.slot != i || handle.generation != 0 || !pool.IsAlive(handle))
+		{
+			Logger::WriteMessage("EXCEPTION: BRUSH POOL DID NOT APPEND SLOTS IN ORDER.");
+			return false;
+		}
+		handles.push_back(handle);
+	}
+	//Headroom of 4 past 12 slots fits 16 exactly, the 13th slot takes the next chunk.
+	if (pool.Capacity() != 16 || pool.Allocate().slot != 12 || pool.Capacity() != 32)
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH POOL DID NOT GROW A CHUNK AHEAD OF THE HEADROOM.");
+		return false;
+	}
+
+	std::vector<SDFSlotRange> ranges = pool.TakeDirtyRanges();
+	if (ranges.size() != 1 || ranges[0].first != 0 || ranges[0].count != 13 || pool.HasDirty())
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH POOL DID NOT MARK NEW SLOTS DIRTY.");
+		return false;
+	}
+
+	//Frees bump the generation, stale handles are rejected and freed slots come back last freed first.
+	const uint32_t freed[] = { 3, 9, 5 };
+	for (uint32_t slot : freed)
+	{
+		if (!pool.Free(handles[slot]) || pool.Free(handles[slot]) || pool.IsAlive(handles[slot]) || pool.HandleForSlot(slot).IsValid())
+		{
+			Logger::WriteMessage("EXCEPTION: BRUSH POOL FREED A SLOT TWICE OR KEPT IT ALIVE.");
+			return false;
+		}
+	}
+	if (pool.LiveCount() != 10 || pool.FreeCount() != 3)
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH POOL COUNTS ARE WRONG AFTER FREEING.");
+		return false;
+	}
+
+	for (int i = 2; i >= 0; i--)
+	{
+		SDFBrushHandle handle = pool.Allocate();
+		if (handle.slot != freed[i] || handle.generation != 1 || handle == handles[freed[i]] || pool.IsAlive(handles[freed[i]]) ||
+			pool.HandleForSlot(handle.slot) != handle)
+		{
+			Logger::WriteMessage("EXCEPTION: BRUSH POOL DID NOT REUSE THE LAST FREED SLOT WITH A NEW GENERATION.");
+			return false;
+		}
+		handles[freed[i]] = handle;
+	}
+	if (pool.FreeCount() != 0 || pool.SlotCount() != 13 || pool.Allocate().slot != 13)
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH POOL APPENDED WHILE SLOTS WERE FREE.");
+		return false;
+	}
+
+	//Slots dirtied more than once show up once; runs are sorted and joined across gaps up to mergeGap.
+	pool.TakeDirtyRanges();
+	for (uint32_t slot : { 7u, 2u, 3u, 7u, 11u, 4u })
+		pool.MarkDirty(slot);
+	pool.MarkDirtyRange(30, 10); //Past SlotCount(), ignored.
+	ranges = pool.TakeDirtyRanges();
+	if (ranges.size() != 3 || ranges[0].first != 2 || ranges[0].count != 3 || ranges[1].first != 7 || ranges[1].count != 1 ||
+		ranges[2].first != 11 || ranges[2].count != 1)
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH POOL DIRTY RANGES ARE WRONG.");
+		return false;
+	}
+
+	for (uint32_t slot : { 7u, 2u, 3u, 11u, 4u })
+		pool.MarkDirty(slot);
+	ranges = pool.TakeDirtyRanges(2);
+	if (ranges.size() != 2 || ranges[0].first != 2 || ranges[0].count != 6 || ranges[1].first != 11 || ranges[1].count != 1)
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH POOL DID NOT MERGE DIRTY RANGES ACROSS SMALL GAPS.");
+		return false;
+	}
+
+	pool.MarkDirtyRange(0, pool.SlotCount());
+	ranges = pool.TakeDirtyRanges();
+	if (ranges.size() != 1 || ranges[0].first != 0 || ranges[0].count != pool.SlotCount() || !pool.TakeDirtyRanges().empty())
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH POOL DIRTY RANGE DID NOT COVER EVERY SLOT.");
+		return false;
+	}
+
+	return true;
+}
+
+bool UnigmaSDFTests::TestBrushContentKeyTracksContent()
+{
+	//Published FNV-1a 64 values.
+	if (SDFHashBytes("", 0) != 0xcbf29ce484222325ull || SDFHashBytes("a", 1) != 0xaf63dc4c8601ec8cull)
+	{
+		Logger::WriteMessage("EXCEPTION: CONTENT HASH IS NOT FNV-1A.");
+		return false;
+	}
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::uvec3> triangles;
+	MakeSphere(1.0f, 8, 12, 0, glm::vec3(0.0f), positions, triangles);
+	SDFBrushContentKey key = SDFMakeBrushContentKey(3, 64, 0.25f, positions);
+	SDFBrushContentKeyHasher hasher;
+
+	//A copy of the same content, even with the signs of zeros flipped, cooks to the same texels.
+	std::vector<glm::vec3> copy = positions;
+	for (glm::vec3& p : copy)
+		for (int c = 0; c < 3; c++)
+			if (p[c] == 0.0f)
+				p[c] = -0.0f;
+	SDFBrushContentKey same = SDFMakeBrushContentKey(3, 64, 0.25f, copy);
+	if (same != key || hasher(same) != hasher(key) || !SDFSamePositions(positions, copy) ||
+		SDFMakeBrushContentKey(3, 64, -0.0f, positions) != SDFMakeBrushContentKey(3, 64, 0.0f, positions))
+	{
+		Logger::WriteMessage("EXCEPTION: EQUAL BRUSH CONTENT GAVE DIFFERENT KEYS.");
+		return false;
+	}
+
+	if (SDFMakeBrushContentKey(4, 64, 0.25f, positions) == key || SDFMakeBrushContentKey(3, 128, 0.25f, positions) == key ||
+		SDFMakeBrushContentKey(3, 64, 0.26f, positions) == key || hasher(SDFMakeBrushContentKey(3, 128, 0.25f, positions)) == hasher(key))
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH KEY IGNORES TYPE, RESOLUTION OR BLEND.");
+		return false;
+	}
+
+	//Every coordinate of every vertex is hashed, and so is their order.
+	for (size_t i = 0; i < positions.size(); i++)
+		for (int c = 0; c < 3; c++)
+		{
+			std::vector<glm::vec3> moved = positions;
+			moved[i][c] = std::nextafter(moved[i][c], 2.0f);
+			SDFBrushContentKey changed = SDFMakeBrushContentKey(3, 64, 0.25f, moved);
+			if (changed.hash == key.hash || changed == key || SDFSamePositions(positions, moved))
+			{
+				Logger::WriteMessage("EXCEPTION: BRUSH KEY IGNORES A VERTEX COORDINATE.");
+				return false;
+			}
+		}
+
+	std::vector<glm::vec3> swapped = positions;
+	std::swap(swapped[1], swapped[positions.size() - 2]);
+	std::vector<glm::vec3> shorter(positions.begin(), positions.end() - 1);
+	if (SDFMakeBrushContentKey(3, 64, 0.25f, swapped).hash == key.hash || SDFMakeBrushContentKey(3, 64, 0.25f, shorter) == key ||
+		SDFSamePositions(positions, shorter))
+	{
+		Logger::WriteMessage("EXCEPTION: BRUSH KEY IGNORES VERTEX ORDER OR COUNT.");
+		return false;
+	}
+
+	return true;
+}
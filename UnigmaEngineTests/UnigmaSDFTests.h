@@ -0,0 +1,50 @@
+#pragma once
+#include "pch.h"
+#include "Engine/SDF/SDFTileBinning.h"
+#include "Engine/SDF/SDFVoxelPacking.h"
+#include "Engine/SDF/SDFBrushScheduler.h"
+#include "Engine/SDF/SDFWindingNumber.h"
+#include "Engine/SDF/SDFParticleSplat.h"
+#include "Engine/SDF/SDFCageDeformer.h"
+#include "Engine/SDF/SDFPipeline.h"
+#include "Engine/SDF/SDFSphereTracer.h"
+#include "Engine/SDF/SDFPacketTracer.h"
+#include "Engine/SDF/SDFConeMarch.h"
+#include "Engine/SDF/SDFSampling.h"
+#include "Engine/SDF/SDFTriangleBVH.h"
+#include "Engine/SDF/SDFTLASTracker.h"
+#include "Engine/SDF/SDFCameraPath.h"
+#include "Engine/SDF/SDFContentHash.h"
+#include "Engine/SDF/SDFBrushPool.h"
+#include "Engine/SDF/SDFMipPyramid.h"
+#include "Engine/SDF/SDFBrickMap.h"
+#include "Engine/SDF/SDFDynamicTree.h"
+#include "Engine/SDF/SDFCSG.h"
+#include "Engine/SDF/SDFMeshSimplifier.h"
+
+class UnigmaSDFTests
+{
+	public:
+		bool TestTileBinningMatchesBruteForce();
+		bool TestVoxelPackingRoundTrip();
+		bool TestBrushSchedulerBudget();
+		bool TestFastWindingNumberMatchesBruteForce();
+		bool TestWindingGridMatchesPointQueries();
+		bool TestParticleSplatMatchesScatter();
+		bool TestCageWeightsMatchDirectEvaluation();
+		bool TestPipelineHashesAreDeterministic();
+		bool TestSphereTracerHitsAnalyticSphere();
+		bool TestPacketTracerMatchesScalar();
+		bool TestConePrepassStartsBeforeSurfaces();
+		bool TestSharedSamplingGradients();
+		bool TestTriangleBVHMatchesBruteForce();
+		bool TestTLASTrackerRefitsAndRebuilds();
+		bool TestCameraPathParsesAndInterpolates();
+		bool TestMeshSimplifierTargetsAndError();
+		bool TestCSGPruningMatchesReference();
+		bool TestDynamicTreeMatchesBruteForce();
+		bool TestBrickMapMatchesDenseGrid();
+		bool TestMipPyramidReductionAndBounds();
+		bool TestBrushPoolHandlesAndDirtyRanges();
+		bool TestBrushContentKeyTracksContent();
+};